@@ -0,0 +1,334 @@
+/* omap3_idle_sim.c
+ *
+ * Offline simulator for the OMAP3 predictive cpuidle governor
+ *
+ * Replays an idle trace recorded on the target and compares the C states
+ * the predictive policy picks with the ones the running governor picked,
+ * and with the best possible choice (the governor knowing every idle length
+ * in advance). The policy is built from arch/arm/mach-omap2/cpuidle34xx-
+ * predict.h, so policy changes can be evaluated before touching a board.
+ *
+ * Recording a trace on the target (CONFIG_OMAP3_CPUIDLE_PREDICT and debugfs):
+ *	echo 1 > /sys/kernel/debug/omap3_idle/trace	(empties it)
+ *	echo 1 > /sys/kernel/debug/omap3_idle/record
+ *	... run the use case ...
+ *	echo 0 > /sys/kernel/debug/omap3_idle/record
+ *	cat /sys/kernel/debug/omap3_idle/trace > trace.txt
+ *	cat /sys/kernel/debug/omap3_idle/states > states.txt
+ *
+ * Compile with
+ *	gcc -O2 -I arch/arm/mach-omap2 Documentation/arm/OMAP/omap3_idle_sim.c \
+ *		-o omap3_idle_sim
+ * and run with
+ *	./omap3_idle_sim [-s states.txt] [-p active,c1,c2,...] trace.txt
+ *
+ * The trace has one line per idle: state timer_us residency_us entry_us
+ * latency_req. The states file gives, for each C state, the board values
+ * and the costs learned on the target; they are the cost model of the
+ * simulation. Without it, the cpuidle34xx.c defaults are used.
+ *
+ * The energy figures come from a simple model: "active" power during the
+ * state transitions, the state power for the rest of the idle. The default
+ * powers are placeholders giving the right order of magnitude, pass the
+ * ones measured on your board with -p (in mW).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+
+typedef uint8_t u8;
+typedef uint32_t u32;
+typedef int32_t s32;
+typedef uint64_t u64;
+typedef int64_t s64;
+
+static inline u64 div_u64(u64 dividend, u32 divisor)
+{
+	return dividend / divisor;
+}
+
+#include "cpuidle34xx-predict.h"
+
+#define MAX_STATES	OMAP3_PREDICT_MAX_STATES
+
+struct cost {
+	u32 entry_nominal, exit_nominal, threshold;
+	u32 entry, exit;		/* actual costs used by the model */
+};
+
+/* cpuidle_params_table defaults in cpuidle34xx.c */
+static struct cost costs[MAX_STATES] = {
+	{ 0, 12, 15, 0, 12 },
+	{ 0, 18, 20, 0, 18 },
+	{ 50, 50, 300, 50, 50 },
+	{ 1500, 1800, 4000, 1500, 1800 },
+	{ 2500, 7500, 12000, 2500, 7500 },
+	{ 3000, 8500, 15000, 3000, 8500 },
+	{ 10000, 30000, 300000, 10000, 30000 },
+};
+static int nr_states = MAX_STATES;
+
+/* mW: transitions, then C1..C7 */
+static double power_active = 120.0;
+static double power[MAX_STATES] = { 70.0, 45.0, 12.0, 9.0, 2.5, 2.0, 0.5 };
+
+struct idle {
+	int state;
+	u32 timer_us;
+	u32 residency;
+	int entry_us;
+	u32 latency_req;
+	u32 event;		/* reconstructed idle length */
+	int timer_wakeup;
+};
+
+struct result {
+	const char *name;
+	double energy;		/* nJ */
+	u64 wake_latency;	/* us, sum of exit costs */
+	unsigned long usage[MAX_STATES];
+	unsigned long short_usage[MAX_STATES];
+	unsigned long latency_violations;
+};
+
+static double idle_energy(int state, u32 event)
+{
+	u32 transition = costs[state].entry + costs[state].exit;
+	u32 low = event > costs[state].entry ? event - costs[state].entry : 0;
+
+	return transition * power_active + low * power[state];
+}
+
+static void account(struct result *r, struct idle *idle, int state)
+{
+	r->energy += idle_energy(state, idle->event);
+	r->wake_latency += costs[state].exit;
+	r->usage[state]++;
+	if (idle->event < costs[state].threshold)
+		r->short_usage[state]++;
+	if (costs[state].entry + costs[state].exit > idle->latency_req)
+		r->latency_violations++;
+}
+
+static int best_state(struct idle *idle)
+{
+	double e, best_e = idle_energy(0, idle->event);
+	int i, best = 0;
+
+	for (i = 1; i < nr_states; i++) {
+		if (costs[i].entry + costs[i].exit > idle->latency_req)
+			break;
+		e = idle_energy(i, idle->event);
+		if (e < best_e) {
+			best_e = e;
+			best = i;
+		}
+	}
+	return best;
+}
+
+static void simulate(struct result *r, struct idle *idles, int n)
+{
+	struct omap3_predictor p;
+	int i, state;
+
+	omap3_predict_init(&p);
+	for (i = 0; i < nr_states; i++)
+		omap3_predict_add_state(&p, costs[i].entry_nominal,
+					costs[i].exit_nominal,
+					costs[i].threshold);
+
+	for (i = 0; i < n; i++) {
+		struct idle *idle = &idles[i];
+		u32 residency;
+
+		state = omap3_predict_select(&p, idle->timer_us,
+					     idle->latency_req);
+		account(r, idle, state);
+
+		/* what the governor would have measured */
+		if (idle->timer_wakeup)
+			residency = idle->timer_us + costs[state].exit;
+		else if (idle->event > costs[state].entry)
+			residency = idle->event + costs[state].exit;
+		else
+			residency = costs[state].entry + costs[state].exit;
+		omap3_predict_update(&p, state, residency,
+				     idle->entry_us < 0 ? -1 :
+				     (int)costs[state].entry);
+	}
+}
+
+static void print_result(struct result *r, int n)
+{
+	int i;
+
+	printf("%-10s energy %12.3f mJ  avg wake latency %6llu us  "
+	       "latency violations %lu\n", r->name, r->energy / 1e6,
+	       (unsigned long long)(n ? r->wake_latency / n : 0),
+	       r->latency_violations);
+	for (i = 0; i < nr_states; i++)
+		printf("%10s C%d %8lu idles, %8lu shorter than threshold\n",
+		       "", i + 1, r->usage[i], r->short_usage[i]);
+}
+
+static void read_states(const char *path)
+{
+	char line[256];
+	FILE *f;
+	int n = 0;
+
+	f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+	while (fgets(line, sizeof(line), f) && n < MAX_STATES) {
+		struct cost c;
+		int idx, fields;
+
+		if (line[0] == '#')
+			continue;
+		fields = sscanf(line, "C%d %u %u %u %u %u", &idx,
+				&c.entry_nominal, &c.exit_nominal,
+				&c.threshold, &c.entry, &c.exit);
+		if (fields < 4)
+			continue;
+		if (fields < 6) {
+			c.entry = c.entry_nominal;
+			c.exit = c.exit_nominal;
+		}
+		costs[n++] = c;
+	}
+	fclose(f);
+	if (!n) {
+		fprintf(stderr, "%s: no state found\n", path);
+		exit(1);
+	}
+	nr_states = n;
+}
+
+static void read_powers(char *arg)
+{
+	char *tok;
+	int i = -1;
+
+	for (tok = strtok(arg, ","); tok && i < MAX_STATES;
+	     tok = strtok(NULL, ","), i++) {
+		if (i < 0)
+			power_active = atof(tok);
+		else
+			power[i] = atof(tok);
+	}
+}
+
+static struct idle *read_trace(const char *path, int *count)
+{
+	struct idle *idles = NULL;
+	char line[256];
+	int n = 0, size = 0;
+	FILE *f;
+
+	f = strcmp(path, "-") ? fopen(path, "r") : stdin;
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+	while (fgets(line, sizeof(line), f)) {
+		struct idle idle;
+		u32 exit_cost;
+
+		if (line[0] == '#')
+			continue;
+		if (sscanf(line, "%d %u %u %d %u", &idle.state, &idle.timer_us,
+			   &idle.residency, &idle.entry_us,
+			   &idle.latency_req) != 5)
+			continue;
+		if (idle.state < 0 || idle.state >= nr_states)
+			continue;
+
+		/* same reconstruction as omap3_predict_update() */
+		exit_cost = costs[idle.state].exit;
+		idle.timer_wakeup = idle.entry_us >= 0 &&
+			idle.residency + OMAP3_PREDICT_TIMER_SLACK >=
+			idle.timer_us;
+		if (idle.timer_wakeup)
+			idle.event = idle.timer_us;
+		else if (idle.residency > exit_cost)
+			idle.event = idle.residency - exit_cost;
+		else
+			idle.event = 0;
+
+		if (n == size) {
+			size = size ? size * 2 : 4096;
+			idles = realloc(idles, size * sizeof(*idles));
+			if (!idles) {
+				perror("realloc");
+				exit(1);
+			}
+		}
+		idles[n++] = idle;
+	}
+	if (f != stdin)
+		fclose(f);
+	*count = n;
+	return idles;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-s states] [-p active,c1,...,c7] "
+		"trace|-\n", prog);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	struct result recorded = { .name = "recorded" };
+	struct result predict = { .name = "predict" };
+	struct result oracle = { .name = "oracle" };
+	struct idle *idles;
+	int c, i, n;
+
+	while ((c = getopt(argc, argv, "s:p:")) != -1) {
+		switch (c) {
+		case 's':
+			read_states(optarg);
+			break;
+		case 'p':
+			read_powers(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1)
+		usage(argv[0]);
+
+	idles = read_trace(argv[optind], &n);
+	if (!n) {
+		fprintf(stderr, "%s: empty trace\n", argv[optind]);
+		return 1;
+	}
+
+	for (i = 0; i < n; i++) {
+		account(&recorded, &idles[i], idles[i].state);
+		account(&oracle, &idles[i], best_state(&idles[i]));
+	}
+	simulate(&predict, idles, n);
+
+	printf("%d idles, %d states\n", n, nr_states);
+	print_result(&recorded, n);
+	print_result(&predict, n);
+	print_result(&oracle, n);
+
+	free(idles);
+	return 0;
+}
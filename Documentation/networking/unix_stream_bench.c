@@ -0,0 +1,292 @@
+/* unix_stream_bench.c
+ *
+ * AF_UNIX stream socket throughput benchmark
+ *
+ * A writer and a reader process exchange data over a socketpair, for a
+ * range of message sizes, and the throughput seen by the reader is
+ * reported for each of the ways of sending:
+ *
+ *	write	 write() from a user buffer (the data is copied in and out)
+ *	vmsplice vmsplice() of the user buffer into a pipe, then splice()
+ *		 from the pipe to the socket (the pages are referenced)
+ *	sendfile sendfile() from a file, 4MB of it, read from the page cache
+ *		 (the pages are referenced)
+ *
+ * Compile with
+ *	gcc -O2 -Wall Documentation/networking/unix_stream_bench.c \
+ *		-o unix_stream_bench
+ * and run with
+ *	./unix_stream_bench [-t seconds] [-m mode] [-f file] [size...]
+ *
+ * The sizes default to 64 bytes up to 256kB, by factors of 4, and each
+ * run lasts one second.  -m restricts the runs to one mode; sendfile
+ * needs a file of at least 4MB given with -f.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+#define MAX_SIZE	(1 << 20)
+#define FILE_SPAN	(4 << 20)
+
+enum mode { MODE_WRITE, MODE_VMSPLICE, MODE_SENDFILE, MODE_NR };
+
+static const char *mode_names[MODE_NR] = { "write", "vmsplice", "sendfile" };
+
+static volatile sig_atomic_t done;
+
+static void alarm_handler(int sig)
+{
+	done = 1;
+}
+
+static void die(const char *what)
+{
+	perror(what);
+	exit(1);
+}
+
+static void write_all(int fd, const char *buf, size_t size)
+{
+	ssize_t ret;
+
+	while (size) {
+		ret = write(fd, buf, size);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EPIPE || errno == ECONNRESET)
+				exit(0);
+			die("write");
+		}
+		buf += ret;
+		size -= ret;
+	}
+}
+
+static void splice_all(int pipe_rd, int sock, size_t size)
+{
+	ssize_t ret;
+
+	while (size) {
+		ret = splice(pipe_rd, NULL, sock, NULL, size, SPLICE_F_MOVE);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EPIPE || errno == ECONNRESET)
+				exit(0);
+			die("splice");
+		}
+		size -= ret;
+	}
+}
+
+/* Send @size byte messages until the reader goes away */
+static void writer(int sock, enum mode mode, size_t size, int file_fd)
+{
+	char *buf = malloc(MAX_SIZE);
+	int pipefd[2];
+	off_t off = 0;
+	ssize_t ret;
+
+	if (!buf)
+		die("malloc");
+	memset(buf, 0x5a, MAX_SIZE);
+
+	if (mode == MODE_VMSPLICE && pipe(pipefd))
+		die("pipe");
+
+	for (;;) {
+		switch (mode) {
+		case MODE_WRITE:
+			write_all(sock, buf, size);
+			break;
+		case MODE_VMSPLICE: {
+			struct iovec iov = { .iov_base = buf, .iov_len = size };
+
+			/* as much as the pipe takes at a time */
+			while (iov.iov_len) {
+				ret = vmsplice(pipefd[1], &iov, 1, 0);
+				if (ret < 0)
+					die("vmsplice");
+				splice_all(pipefd[0], sock, ret);
+				iov.iov_base = (char *)iov.iov_base + ret;
+				iov.iov_len -= ret;
+			}
+			break;
+		}
+		case MODE_SENDFILE:
+			if (off + size > FILE_SPAN)
+				off = 0;
+			ret = sendfile(sock, file_fd, &off, size);
+			if (ret < 0) {
+				if (errno == EPIPE || errno == ECONNRESET)
+					exit(0);
+				die("sendfile");
+			}
+			break;
+		default:
+			exit(1);
+		}
+	}
+}
+
+/* Read for @seconds, return the throughput in MB/s */
+static double reader(int sock, int seconds)
+{
+	char *buf = malloc(MAX_SIZE);
+	struct timeval start, end;
+	unsigned long long bytes = 0;
+	double secs;
+	ssize_t ret;
+
+	if (!buf)
+		die("malloc");
+
+	done = 0;
+	alarm(seconds);
+	gettimeofday(&start, NULL);
+	while (!done) {
+		ret = read(sock, buf, MAX_SIZE);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			die("read");
+		}
+		if (!ret)
+			break;
+		bytes += ret;
+	}
+	gettimeofday(&end, NULL);
+	free(buf);
+
+	secs = (end.tv_sec - start.tv_sec) +
+	       (end.tv_usec - start.tv_usec) / 1e6;
+	return bytes / secs / 1e6;
+}
+
+static int run(enum mode mode, size_t size, int seconds, int file_fd,
+	       double *mbps)
+{
+	int sv[2], status;
+	pid_t pid;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv))
+		die("socketpair");
+
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0)
+		die("fork");
+	if (!pid) {
+		close(sv[0]);
+		writer(sv[1], mode, size, file_fd);
+		exit(0);
+	}
+
+	close(sv[1]);
+	*mbps = reader(sv[0], seconds);
+	close(sv[0]);
+
+	waitpid(pid, &status, 0);
+	return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: unix_stream_bench [-t seconds] "
+		"[-m write|vmsplice|sendfile] [-f file] [size...]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	static const size_t default_sizes[] = {
+		64, 256, 1024, 4096, 16384, 65536, 262144,
+	};
+	size_t sizes[64];
+	int nr_sizes = 0, seconds = 1, only = -1, file_fd = -1;
+	int i, m, opt;
+	double mbps;
+	struct sigaction sa;
+
+	while ((opt = getopt(argc, argv, "t:m:f:")) != -1) {
+		switch (opt) {
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		case 'm':
+			for (m = 0; m < MODE_NR; m++)
+				if (!strcmp(optarg, mode_names[m]))
+					only = m;
+			if (only < 0)
+				usage();
+			break;
+		case 'f':
+			file_fd = open(optarg, O_RDONLY);
+			if (file_fd < 0)
+				die(optarg);
+			if (lseek(file_fd, 0, SEEK_END) < FILE_SPAN) {
+				fprintf(stderr, "%s: less than 4MB\n", optarg);
+				exit(1);
+			}
+			break;
+		default:
+			usage();
+		}
+	}
+
+	for (i = optind; i < argc && nr_sizes < 64; i++) {
+		sizes[nr_sizes] = strtoul(argv[i], NULL, 0);
+		if (!sizes[nr_sizes] || sizes[nr_sizes] > MAX_SIZE)
+			usage();
+		nr_sizes++;
+	}
+	if (!nr_sizes) {
+		nr_sizes = sizeof(default_sizes) / sizeof(default_sizes[0]);
+		memcpy(sizes, default_sizes, sizeof(default_sizes));
+	}
+	if (seconds < 1)
+		usage();
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = alarm_handler;
+	sigaction(SIGALRM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	printf("%10s", "bytes");
+	for (m = 0; m < MODE_NR; m++)
+		printf(" %10s", mode_names[m]);
+	printf("   (MB/s)\n");
+
+	for (i = 0; i < nr_sizes; i++) {
+		printf("%10zu", sizes[i]);
+		for (m = 0; m < MODE_NR; m++) {
+			if ((only >= 0 && m != only) ||
+			    (m == MODE_SENDFILE && file_fd < 0) ||
+			    run(m, sizes[i], seconds, file_fd, &mbps))
+				printf(" %10s", "-");
+			else
+				printf(" %10.1f", mbps);
+			fflush(stdout);
+		}
+		printf("\n");
+	}
+	return 0;
+}
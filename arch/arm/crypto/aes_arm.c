@@ -0,0 +1,514 @@
+/*
+ * AES cipher and CBC/CTR/XTS modes for ARM
+ *
+ * The rounds use one 1KB table per direction instead of the four of
+ * aes_generic: the other three are rotations of the first, which the
+ * ARM barrel shifter applies for free as an operand of the EOR.  That
+ * keeps the tables of both directions within a few L1 lines' worth of
+ * pressure on the small D-caches of ARM cores.
+ *
+ * The modes are implemented directly on the block functions, with the
+ * chaining value, counter or tweak kept as words, rather than going
+ * through the cbc/ctr/xts templates and one indirect call per block.
+ *
+ * Key expansion and the tables come from aes_generic.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <crypto/aes.h>
+#include <crypto/algapi.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/types.h>
+#include <linux/bitops.h>
+#include <linux/crypto.h>
+#include <asm/byteorder.h>
+
+#define AES_ARM_PRIORITY	200
+#define AES_ARM_MODE_PRIORITY	300
+
+#define ft	crypto_ft_tab[0]
+#define fl	crypto_fl_tab[0]
+#define it	crypto_it_tab[0]
+#define il	crypto_il_tab[0]
+
+#define b0(x)	((x) & 0xff)
+#define b1(x)	(((x) >> 8) & 0xff)
+#define b2(x)	(((x) >> 16) & 0xff)
+#define b3(x)	((x) >> 24)
+
+/* crypto_ft_tab[n][x] == rol32(crypto_ft_tab[0][x], 8 * n), same for it */
+#define f_rn(bo, bi, n, k)						\
+	bo[n] = ft[b0(bi[n])] ^						\
+		rol32(ft[b1(bi[(n + 1) & 3])], 8) ^			\
+		rol32(ft[b2(bi[(n + 2) & 3])], 16) ^			\
+		rol32(ft[b3(bi[(n + 3) & 3])], 24) ^ (k)[n]
+
+/* crypto_fl_tab[0][x] is the S-box value in the low byte */
+#define f_rl(bo, bi, n, k)						\
+	bo[n] = fl[b0(bi[n])] ^						\
+		(fl[b1(bi[(n + 1) & 3])] << 8) ^			\
+		(fl[b2(bi[(n + 2) & 3])] << 16) ^			\
+		(fl[b3(bi[(n + 3) & 3])] << 24) ^ (k)[n]
+
+#define i_rn(bo, bi, n, k)						\
+	bo[n] = it[b0(bi[n])] ^						\
+		rol32(it[b1(bi[(n + 3) & 3])], 8) ^			\
+		rol32(it[b2(bi[(n + 2) & 3])], 16) ^			\
+		rol32(it[b3(bi[(n + 1) & 3])], 24) ^ (k)[n]
+
+#define i_rl(bo, bi, n, k)						\
+	bo[n] = il[b0(bi[n])] ^						\
+		(il[b1(bi[(n + 3) & 3])] << 8) ^			\
+		(il[b2(bi[(n + 2) & 3])] << 16) ^			\
+		(il[b3(bi[(n + 1) & 3])] << 24) ^ (k)[n]
+
+#define f_round(bo, bi, k)	do {					\
+	f_rn(bo, bi, 0, k);						\
+	f_rn(bo, bi, 1, k);						\
+	f_rn(bo, bi, 2, k);						\
+	f_rn(bo, bi, 3, k);						\
+	k += 4;								\
+} while (0)
+
+#define i_round(bo, bi, k)	do {					\
+	i_rn(bo, bi, 0, k);						\
+	i_rn(bo, bi, 1, k);						\
+	i_rn(bo, bi, 2, k);						\
+	i_rn(bo, bi, 3, k);						\
+	k += 4;								\
+} while (0)
+
+/* Encrypt the block in @s, as little endian words, in place */
+static void aes_arm_encrypt_words(const struct crypto_aes_ctx *ctx, u32 *s)
+{
+	const u32 *kp = ctx->key_enc + 4;
+	u32 b0[4], b1[4];
+	int rounds = ctx->key_length / 4 + 6;
+
+	b0[0] = s[0] ^ ctx->key_enc[0];
+	b0[1] = s[1] ^ ctx->key_enc[1];
+	b0[2] = s[2] ^ ctx->key_enc[2];
+	b0[3] = s[3] ^ ctx->key_enc[3];
+
+	/* all but the last round, two at a time */
+	for (rounds -= 2; rounds > 0; rounds -= 2) {
+		f_round(b1, b0, kp);
+		f_round(b0, b1, kp);
+	}
+	f_round(b1, b0, kp);
+
+	f_rl(s, b1, 0, kp);
+	f_rl(s, b1, 1, kp);
+	f_rl(s, b1, 2, kp);
+	f_rl(s, b1, 3, kp);
+}
+
+static void aes_arm_decrypt_words(const struct crypto_aes_ctx *ctx, u32 *s)
+{
+	const u32 *kp = ctx->key_dec + 4;
+	u32 b0[4], b1[4];
+	int rounds = ctx->key_length / 4 + 6;
+
+	b0[0] = s[0] ^ ctx->key_dec[0];
+	b0[1] = s[1] ^ ctx->key_dec[1];
+	b0[2] = s[2] ^ ctx->key_dec[2];
+	b0[3] = s[3] ^ ctx->key_dec[3];
+
+	for (rounds -= 2; rounds > 0; rounds -= 2) {
+		i_round(b1, b0, kp);
+		i_round(b0, b1, kp);
+	}
+	i_round(b1, b0, kp);
+
+	i_rl(s, b1, 0, kp);
+	i_rl(s, b1, 1, kp);
+	i_rl(s, b1, 2, kp);
+	i_rl(s, b1, 3, kp);
+}
+
+static inline void aes_load(u32 *s, const u8 *in)
+{
+	const __le32 *src = (const __le32 *)in;
+
+	s[0] = le32_to_cpu(src[0]);
+	s[1] = le32_to_cpu(src[1]);
+	s[2] = le32_to_cpu(src[2]);
+	s[3] = le32_to_cpu(src[3]);
+}
+
+static inline void aes_store(u8 *out, const u32 *s)
+{
+	__le32 *dst = (__le32 *)out;
+
+	dst[0] = cpu_to_le32(s[0]);
+	dst[1] = cpu_to_le32(s[1]);
+	dst[2] = cpu_to_le32(s[2]);
+	dst[3] = cpu_to_le32(s[3]);
+}
+
+static void aes_arm_encrypt(struct crypto_tfm *tfm, u8 *out, const u8 *in)
+{
+	u32 s[4];
+
+	aes_load(s, in);
+	aes_arm_encrypt_words(crypto_tfm_ctx(tfm), s);
+	aes_store(out, s);
+}
+
+static void aes_arm_decrypt(struct crypto_tfm *tfm, u8 *out, const u8 *in)
+{
+	u32 s[4];
+
+	aes_load(s, in);
+	aes_arm_decrypt_words(crypto_tfm_ctx(tfm), s);
+	aes_store(out, s);
+}
+
+static int cbc_encrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	struct crypto_aes_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	u32 s[4], x[4];
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+	if (!walk.nbytes)
+		return err;
+
+	aes_load(s, walk.iv);
+	while ((nbytes = walk.nbytes)) {
+		const u8 *in = walk.src.virt.addr;
+		u8 *out = walk.dst.virt.addr;
+
+		do {
+			aes_load(x, in);
+			s[0] ^= x[0];
+			s[1] ^= x[1];
+			s[2] ^= x[2];
+			s[3] ^= x[3];
+			aes_arm_encrypt_words(ctx, s);
+			aes_store(out, s);
+			in += AES_BLOCK_SIZE;
+			out += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+
+		/* walk.iv may be a bounce buffer gone after the last step */
+		aes_store(walk.iv, s);
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int cbc_decrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	struct crypto_aes_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	u32 iv[4], c[4], s[4];
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+	if (!walk.nbytes)
+		return err;
+
+	aes_load(iv, walk.iv);
+	while ((nbytes = walk.nbytes)) {
+		const u8 *in = walk.src.virt.addr;
+		u8 *out = walk.dst.virt.addr;
+
+		do {
+			/* the ciphertext is read before out overwrites it */
+			aes_load(c, in);
+			s[0] = c[0];
+			s[1] = c[1];
+			s[2] = c[2];
+			s[3] = c[3];
+			aes_arm_decrypt_words(ctx, s);
+			s[0] ^= iv[0];
+			s[1] ^= iv[1];
+			s[2] ^= iv[2];
+			s[3] ^= iv[3];
+			aes_store(out, s);
+			iv[0] = c[0];
+			iv[1] = c[1];
+			iv[2] = c[2];
+			iv[3] = c[3];
+			in += AES_BLOCK_SIZE;
+			out += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+
+		aes_store(walk.iv, iv);
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int ctr_crypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		     struct scatterlist *src, unsigned int nbytes)
+{
+	struct crypto_aes_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	u8 *ctrblk;
+	u32 s[4], x[4];
+	u32 ks[AES_BLOCK_SIZE / 4];
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt_block(desc, &walk, AES_BLOCK_SIZE);
+	ctrblk = walk.iv;
+
+	while ((nbytes = walk.nbytes) >= AES_BLOCK_SIZE) {
+		const u8 *in = walk.src.virt.addr;
+		u8 *out = walk.dst.virt.addr;
+
+		do {
+			aes_load(s, ctrblk);
+			aes_arm_encrypt_words(ctx, s);
+			aes_load(x, in);
+			s[0] ^= x[0];
+			s[1] ^= x[1];
+			s[2] ^= x[2];
+			s[3] ^= x[3];
+			aes_store(out, s);
+			crypto_inc(ctrblk, AES_BLOCK_SIZE);
+			in += AES_BLOCK_SIZE;
+			out += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	if (walk.nbytes) {
+		aes_load(s, ctrblk);
+		aes_arm_encrypt_words(ctx, s);
+		aes_store((u8 *)ks, s);
+		crypto_xor((u8 *)ks, walk.src.virt.addr, walk.nbytes);
+		memcpy(walk.dst.virt.addr, ks, walk.nbytes);
+		crypto_inc(ctrblk, AES_BLOCK_SIZE);
+		err = blkcipher_walk_done(desc, &walk, 0);
+	}
+
+	return err;
+}
+
+struct aes_xts_ctx {
+	struct crypto_aes_ctx crypt;
+	struct crypto_aes_ctx tweak;
+};
+
+static int xts_setkey(struct crypto_tfm *tfm, const u8 *key,
+		      unsigned int keylen)
+{
+	struct aes_xts_ctx *ctx = crypto_tfm_ctx(tfm);
+	int err;
+
+	/* Key1 encrypts the data, Key2 the tweak, as in crypto/xts.c */
+	if (keylen % 2) {
+		tfm->crt_flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return -EINVAL;
+	}
+	err = crypto_aes_expand_key(&ctx->crypt, key, keylen / 2);
+	if (!err)
+		err = crypto_aes_expand_key(&ctx->tweak, key + keylen / 2,
+					    keylen / 2);
+	if (err)
+		tfm->crt_flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+	return err;
+}
+
+/* multiply the tweak by x in GF(2^128), little endian as gf128mul_x_ble */
+static inline void xts_next_tweak(u32 *t)
+{
+	u32 carry = t[3] >> 31;
+
+	t[3] = (t[3] << 1) | (t[2] >> 31);
+	t[2] = (t[2] << 1) | (t[1] >> 31);
+	t[1] = (t[1] << 1) | (t[0] >> 31);
+	t[0] = (t[0] << 1) ^ (0x87 & -carry);
+}
+
+static int xts_crypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		     struct scatterlist *src, unsigned int nbytes, int enc)
+{
+	struct aes_xts_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	u32 t[4], s[4];
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+	if (!walk.nbytes)
+		return err;
+
+	aes_load(t, walk.iv);
+	aes_arm_encrypt_words(&ctx->tweak, t);
+
+	while ((nbytes = walk.nbytes)) {
+		const u8 *in = walk.src.virt.addr;
+		u8 *out = walk.dst.virt.addr;
+
+		do {
+			aes_load(s, in);
+			s[0] ^= t[0];
+			s[1] ^= t[1];
+			s[2] ^= t[2];
+			s[3] ^= t[3];
+			if (enc)
+				aes_arm_encrypt_words(&ctx->crypt, s);
+			else
+				aes_arm_decrypt_words(&ctx->crypt, s);
+			s[0] ^= t[0];
+			s[1] ^= t[1];
+			s[2] ^= t[2];
+			s[3] ^= t[3];
+			aes_store(out, s);
+			xts_next_tweak(t);
+			in += AES_BLOCK_SIZE;
+			out += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int xts_encrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	return xts_crypt(desc, dst, src, nbytes, 1);
+}
+
+static int xts_decrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	return xts_crypt(desc, dst, src, nbytes, 0);
+}
+
+static struct crypto_alg aes_arm_algs[] = { {
+	.cra_name		=	"aes",
+	.cra_driver_name	=	"aes-arm",
+	.cra_priority		=	AES_ARM_PRIORITY,
+	.cra_flags		=	CRYPTO_ALG_TYPE_CIPHER,
+	.cra_blocksize		=	AES_BLOCK_SIZE,
+	.cra_ctxsize		=	sizeof(struct crypto_aes_ctx),
+	.cra_alignmask		=	3,
+	.cra_module		=	THIS_MODULE,
+	.cra_u			=	{
+		.cipher = {
+			.cia_min_keysize	=	AES_MIN_KEY_SIZE,
+			.cia_max_keysize	=	AES_MAX_KEY_SIZE,
+			.cia_setkey		=	crypto_aes_set_key,
+			.cia_encrypt		=	aes_arm_encrypt,
+			.cia_decrypt		=	aes_arm_decrypt
+		}
+	}
+}, {
+	.cra_name		=	"cbc(aes)",
+	.cra_driver_name	=	"cbc-aes-arm",
+	.cra_priority		=	AES_ARM_MODE_PRIORITY,
+	.cra_flags		=	CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		=	AES_BLOCK_SIZE,
+	.cra_ctxsize		=	sizeof(struct crypto_aes_ctx),
+	.cra_alignmask		=	3,
+	.cra_type		=	&crypto_blkcipher_type,
+	.cra_module		=	THIS_MODULE,
+	.cra_u			=	{
+		.blkcipher = {
+			.min_keysize	=	AES_MIN_KEY_SIZE,
+			.max_keysize	=	AES_MAX_KEY_SIZE,
+			.ivsize		=	AES_BLOCK_SIZE,
+			.setkey		=	crypto_aes_set_key,
+			.encrypt	=	cbc_encrypt,
+			.decrypt	=	cbc_decrypt,
+		}
+	}
+}, {
+	.cra_name		=	"ctr(aes)",
+	.cra_driver_name	=	"ctr-aes-arm",
+	.cra_priority		=	AES_ARM_MODE_PRIORITY,
+	.cra_flags		=	CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		=	1,
+	.cra_ctxsize		=	sizeof(struct crypto_aes_ctx),
+	.cra_alignmask		=	3,
+	.cra_type		=	&crypto_blkcipher_type,
+	.cra_module		=	THIS_MODULE,
+	.cra_u			=	{
+		.blkcipher = {
+			.min_keysize	=	AES_MIN_KEY_SIZE,
+			.max_keysize	=	AES_MAX_KEY_SIZE,
+			.ivsize		=	AES_BLOCK_SIZE,
+			.setkey		=	crypto_aes_set_key,
+			.encrypt	=	ctr_crypt,
+			.decrypt	=	ctr_crypt,
+			.geniv		=	"chainiv",
+		}
+	}
+}, {
+	.cra_name		=	"xts(aes)",
+	.cra_driver_name	=	"xts-aes-arm",
+	.cra_priority		=	AES_ARM_MODE_PRIORITY,
+	.cra_flags		=	CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		=	AES_BLOCK_SIZE,
+	.cra_ctxsize		=	sizeof(struct aes_xts_ctx),
+	.cra_alignmask		=	3,
+	.cra_type		=	&crypto_blkcipher_type,
+	.cra_module		=	THIS_MODULE,
+	.cra_u			=	{
+		.blkcipher = {
+			.min_keysize	=	2 * AES_MIN_KEY_SIZE,
+			.max_keysize	=	2 * AES_MAX_KEY_SIZE,
+			.ivsize		=	AES_BLOCK_SIZE,
+			.setkey		=	xts_setkey,
+			.encrypt	=	xts_encrypt,
+			.decrypt	=	xts_decrypt,
+		}
+	}
+} };
+
+static int __init aes_arm_init(void)
+{
+	int i, err;
+
+	for (i = 0; i < ARRAY_SIZE(aes_arm_algs); i++) {
+		INIT_LIST_HEAD(&aes_arm_algs[i].cra_list);
+		err = crypto_register_alg(&aes_arm_algs[i]);
+		if (err)
+			goto unregister;
+	}
+	return 0;
+
+unregister:
+	while (--i >= 0)
+		crypto_unregister_alg(&aes_arm_algs[i]);
+	return err;
+}
+
+static void __exit aes_arm_fini(void)
+{
+	int i;
+
+	for (i = ARRAY_SIZE(aes_arm_algs) - 1; i >= 0; i--)
+		crypto_unregister_alg(&aes_arm_algs[i]);
+}
+
+/*
+ * Built in, arch/arm/crypto links before crypto/: register once the
+ * generic drivers and the crypto manager are up, so that testmgr checks
+ * these against the vectors too.
+ */
+late_initcall(aes_arm_init);
+module_exit(aes_arm_fini);
+
+MODULE_DESCRIPTION("AES cipher and CBC/CTR/XTS modes, ARM optimized");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("aes");
@@ -0,0 +1,312 @@
+/*
+ * SHA-224 and SHA-256 for ARM
+ *
+ * Same algorithm as sha256_generic, with a transform shaped for ARM:
+ * the message schedule is a rolling window of 16 words, expanded in
+ * place before each batch of 16 rounds, instead of 64 words rebuilt and
+ * cleared for every block, the working variables rotate through macro
+ * arguments rather than moves, and update() hands all the full blocks
+ * it has to the transform in one call.  The rotations fold into the
+ * barrel shifter operand of the EOR and ADD instructions.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <crypto/internal/hash.h>
+#include <crypto/sha.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/types.h>
+#include <linux/bitops.h>
+#include <asm/byteorder.h>
+#include <asm/unaligned.h>
+
+#define SHA256_ARM_PRIORITY	200
+
+static const u32 sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define Ch(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
+#define Maj(x, y, z)	(((x) & (y)) | ((z) & ((x) | (y))))
+
+#define e0(x)	(ror32(x, 2) ^ ror32(x, 13) ^ ror32(x, 22))
+#define e1(x)	(ror32(x, 6) ^ ror32(x, 11) ^ ror32(x, 25))
+#define s0(x)	(ror32(x, 7) ^ ror32(x, 18) ^ ((x) >> 3))
+#define s1(x)	(ror32(x, 17) ^ ror32(x, 19) ^ ((x) >> 10))
+
+#define ROUND(a, b, c, d, e, f, g, h, j)	do {			\
+	u32 t1 = h + e1(e) + Ch(e, f, g) + k[j] + W[j];			\
+	d += t1;							\
+	h = t1 + e0(a) + Maj(a, b, c);					\
+} while (0)
+
+#define ROUNDS16()	do {						\
+	ROUND(a, b, c, d, e, f, g, h, 0);				\
+	ROUND(h, a, b, c, d, e, f, g, 1);				\
+	ROUND(g, h, a, b, c, d, e, f, 2);				\
+	ROUND(f, g, h, a, b, c, d, e, 3);				\
+	ROUND(e, f, g, h, a, b, c, d, 4);				\
+	ROUND(d, e, f, g, h, a, b, c, 5);				\
+	ROUND(c, d, e, f, g, h, a, b, 6);				\
+	ROUND(b, c, d, e, f, g, h, a, 7);				\
+	ROUND(a, b, c, d, e, f, g, h, 8);				\
+	ROUND(h, a, b, c, d, e, f, g, 9);				\
+	ROUND(g, h, a, b, c, d, e, f, 10);				\
+	ROUND(f, g, h, a, b, c, d, e, 11);				\
+	ROUND(e, f, g, h, a, b, c, d, 12);				\
+	ROUND(d, e, f, g, h, a, b, c, 13);				\
+	ROUND(c, d, e, f, g, h, a, b, 14);				\
+	ROUND(b, c, d, e, f, g, h, a, 15);				\
+} while (0)
+
+static void sha256_arm_blocks(u32 *state, const u8 *data, unsigned int blocks)
+{
+	u32 a, b, c, d, e, f, g, h;
+	u32 W[16];
+	const u32 *k;
+	int i;
+
+	while (blocks--) {
+		if (!((unsigned long)data & 3)) {
+			const __be32 *src = (const __be32 *)data;
+
+			for (i = 0; i < 16; i++)
+				W[i] = be32_to_cpu(src[i]);
+		} else {
+			for (i = 0; i < 16; i++)
+				W[i] = get_unaligned_be32(data + 4 * i);
+		}
+
+		a = state[0]; b = state[1]; c = state[2]; d = state[3];
+		e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+		k = sha256_k;
+		ROUNDS16();
+		for (k += 16; k < sha256_k + 64; k += 16) {
+			/* W[j] becomes W[t], from W[t-2], W[t-7], W[t-15] */
+			for (i = 0; i < 16; i++)
+				W[i] += s1(W[(i + 14) & 15]) + W[(i + 9) & 15] +
+					s0(W[(i + 1) & 15]);
+			ROUNDS16();
+		}
+
+		state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+		state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+
+		data += SHA256_BLOCK_SIZE;
+	}
+
+	/* clear any sensitive info... */
+	memset(W, 0, sizeof(W));
+}
+
+static int sha224_arm_init(struct shash_desc *desc)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+
+	sctx->state[0] = SHA224_H0;
+	sctx->state[1] = SHA224_H1;
+	sctx->state[2] = SHA224_H2;
+	sctx->state[3] = SHA224_H3;
+	sctx->state[4] = SHA224_H4;
+	sctx->state[5] = SHA224_H5;
+	sctx->state[6] = SHA224_H6;
+	sctx->state[7] = SHA224_H7;
+	sctx->count = 0;
+
+	return 0;
+}
+
+static int sha256_arm_init(struct shash_desc *desc)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+
+	sctx->state[0] = SHA256_H0;
+	sctx->state[1] = SHA256_H1;
+	sctx->state[2] = SHA256_H2;
+	sctx->state[3] = SHA256_H3;
+	sctx->state[4] = SHA256_H4;
+	sctx->state[5] = SHA256_H5;
+	sctx->state[6] = SHA256_H6;
+	sctx->state[7] = SHA256_H7;
+	sctx->count = 0;
+
+	return 0;
+}
+
+static int sha256_arm_update(struct shash_desc *desc, const u8 *data,
+			     unsigned int len)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+	unsigned int partial = sctx->count & 0x3f;
+	unsigned int blocks;
+
+	sctx->count += len;
+
+	if (partial) {
+		unsigned int fill = SHA256_BLOCK_SIZE - partial;
+
+		if (len < fill) {
+			memcpy(sctx->buf + partial, data, len);
+			return 0;
+		}
+		memcpy(sctx->buf + partial, data, fill);
+		sha256_arm_blocks(sctx->state, sctx->buf, 1);
+		data += fill;
+		len -= fill;
+	}
+
+	blocks = len / SHA256_BLOCK_SIZE;
+	if (blocks) {
+		sha256_arm_blocks(sctx->state, data, blocks);
+		data += blocks * SHA256_BLOCK_SIZE;
+		len -= blocks * SHA256_BLOCK_SIZE;
+	}
+	memcpy(sctx->buf, data, len);
+
+	return 0;
+}
+
+static int sha256_arm_final(struct shash_desc *desc, u8 *out)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+	__be32 *dst = (__be32 *)out;
+	__be64 bits;
+	unsigned int index, pad_len;
+	int i;
+	static const u8 padding[64] = { 0x80, };
+
+	/* Save number of bits */
+	bits = cpu_to_be64(sctx->count << 3);
+
+	/* Pad out to 56 mod 64. */
+	index = sctx->count & 0x3f;
+	pad_len = (index < 56) ? (56 - index) : ((64+56) - index);
+	sha256_arm_update(desc, padding, pad_len);
+
+	/* Append length (before padding) */
+	sha256_arm_update(desc, (const u8 *)&bits, sizeof(bits));
+
+	/* Store state in digest */
+	for (i = 0; i < 8; i++)
+		dst[i] = cpu_to_be32(sctx->state[i]);
+
+	/* Zeroize sensitive information. */
+	memset(sctx, 0, sizeof(*sctx));
+
+	return 0;
+}
+
+static int sha224_arm_final(struct shash_desc *desc, u8 *hash)
+{
+	u8 D[SHA256_DIGEST_SIZE];
+
+	sha256_arm_final(desc, D);
+
+	memcpy(hash, D, SHA224_DIGEST_SIZE);
+	memset(D, 0, SHA256_DIGEST_SIZE);
+
+	return 0;
+}
+
+static int sha256_arm_export(struct shash_desc *desc, void *out)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+
+	memcpy(out, sctx, sizeof(*sctx));
+	return 0;
+}
+
+static int sha256_arm_import(struct shash_desc *desc, const void *in)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+
+	memcpy(sctx, in, sizeof(*sctx));
+	return 0;
+}
+
+static struct shash_alg sha256_arm = {
+	.digestsize	=	SHA256_DIGEST_SIZE,
+	.init		=	sha256_arm_init,
+	.update		=	sha256_arm_update,
+	.final		=	sha256_arm_final,
+	.export		=	sha256_arm_export,
+	.import		=	sha256_arm_import,
+	.descsize	=	sizeof(struct sha256_state),
+	.statesize	=	sizeof(struct sha256_state),
+	.base		=	{
+		.cra_name	=	"sha256",
+		.cra_driver_name=	"sha256-arm",
+		.cra_priority	=	SHA256_ARM_PRIORITY,
+		.cra_flags	=	CRYPTO_ALG_TYPE_SHASH,
+		.cra_blocksize	=	SHA256_BLOCK_SIZE,
+		.cra_module	=	THIS_MODULE,
+	}
+};
+
+static struct shash_alg sha224_arm = {
+	.digestsize	=	SHA224_DIGEST_SIZE,
+	.init		=	sha224_arm_init,
+	.update		=	sha256_arm_update,
+	.final		=	sha224_arm_final,
+	.export		=	sha256_arm_export,
+	.import		=	sha256_arm_import,
+	.descsize	=	sizeof(struct sha256_state),
+	.statesize	=	sizeof(struct sha256_state),
+	.base		=	{
+		.cra_name	=	"sha224",
+		.cra_driver_name=	"sha224-arm",
+		.cra_priority	=	SHA256_ARM_PRIORITY,
+		.cra_flags	=	CRYPTO_ALG_TYPE_SHASH,
+		.cra_blocksize	=	SHA224_BLOCK_SIZE,
+		.cra_module	=	THIS_MODULE,
+	}
+};
+
+static int __init sha256_arm_mod_init(void)
+{
+	int ret;
+
+	ret = crypto_register_shash(&sha224_arm);
+	if (ret < 0)
+		return ret;
+
+	ret = crypto_register_shash(&sha256_arm);
+	if (ret < 0)
+		crypto_unregister_shash(&sha224_arm);
+
+	return ret;
+}
+
+static void __exit sha256_arm_mod_fini(void)
+{
+	crypto_unregister_shash(&sha224_arm);
+	crypto_unregister_shash(&sha256_arm);
+}
+
+/* After the crypto manager, see aes_arm.c */
+late_initcall(sha256_arm_mod_init);
+module_exit(sha256_arm_mod_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("SHA-224 and SHA-256 Secure Hash Algorithm, ARM optimized");
+MODULE_ALIAS("sha224");
+MODULE_ALIAS("sha256");
@@ -0,0 +1,298 @@
+/*
+ * linux/arch/arm/mach-omap2/cpuidle34xx-predict.h
+ *
+ * OMAP3 idle state prediction policy
+ *
+ * This is the decision logic of the OMAP3 predictive cpuidle governor.
+ * It only deals with numbers (microseconds and state indexes) so that
+ * the very same code can be built into the kernel and into the offline
+ * simulator in Documentation/arm/OMAP/omap3_idle_sim.c, which replays
+ * idle traces recorded through debugfs.
+ *
+ * The policy learns, for each C state:
+ *  - the entry cost: time from the cpuidle entry to the WFI, which covers
+ *    the context save done by omap_sram_idle();
+ *  - the exit cost: how late we come back from idle when the wakeup was
+ *    the expected timer, which covers the hardware wakeup, the ROM code
+ *    and the context restore.
+ * The break-even residency of a state is the board threshold scaled by
+ * the ratio of the measured to the nominal transition cost, and never
+ * less than the transition cost itself.
+ *
+ * The idle length is predicted as the next timer event, corrected by a
+ * per-range factor (idles are often cut short by interrupts), and bounded
+ * by the typical interval of the last idles when they are regular enough.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ARCH_ARM_MACH_OMAP2_CPUIDLE34XX_PREDICT_H
+#define __ARCH_ARM_MACH_OMAP2_CPUIDLE34XX_PREDICT_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#include <linux/math64.h>
+#endif
+
+#define OMAP3_PREDICT_MAX_STATES	7
+#define OMAP3_PREDICT_HISTORY		8	/* must be a power of 2 */
+#define OMAP3_PREDICT_BUCKETS		6
+#define OMAP3_PREDICT_RESOLUTION	1024	/* correction factor unit */
+#define OMAP3_PREDICT_DECAY		8	/* correction factor weight */
+#define OMAP3_PREDICT_COST_SHIFT	3	/* cost EWMA weight: 1/8 */
+#define OMAP3_PREDICT_MIN_SAMPLES	8	/* before trusting a cost */
+#define OMAP3_PREDICT_MAX_US		(1U << 22)	/* ~4s */
+
+/*
+ * A wakeup up to this late after the timer expiry is taken as the timer
+ * wakeup. Covers the 32kHz clocksource resolution used to time idles.
+ */
+#define OMAP3_PREDICT_TIMER_SLACK	62
+
+struct omap3_predict_state {
+	/* board values, in us */
+	u32 entry_nominal;
+	u32 exit_nominal;
+	u32 threshold;
+
+	/* learned values, in us */
+	u32 entry_cost;
+	u32 exit_cost;
+	u32 entry_samples;
+	u32 exit_samples;
+	u32 break_even;
+
+	/* statistics */
+	u32 usage;
+	u32 short_usage;	/* idle ended before break_even */
+};
+
+struct omap3_predictor {
+	int nr_states;
+	struct omap3_predict_state states[OMAP3_PREDICT_MAX_STATES];
+	u32 correction[OMAP3_PREDICT_BUCKETS];
+	u32 history[OMAP3_PREDICT_HISTORY];
+	unsigned int history_idx;
+
+	/* last decision */
+	u32 timer_us;
+	u32 predicted_us;
+	int bucket;
+};
+
+static inline int omap3_predict_bucket(u32 us)
+{
+	if (us < 100)
+		return 0;
+	if (us < 1000)
+		return 1;
+	if (us < 10000)
+		return 2;
+	if (us < 100000)
+		return 3;
+	if (us < 1000000)
+		return 4;
+	return 5;
+}
+
+static inline void omap3_predict_init(struct omap3_predictor *p)
+{
+	int i;
+
+	for (i = 0; i < OMAP3_PREDICT_BUCKETS; i++)
+		p->correction[i] = OMAP3_PREDICT_RESOLUTION *
+				   OMAP3_PREDICT_DECAY;
+	for (i = 0; i < OMAP3_PREDICT_HISTORY; i++)
+		p->history[i] = OMAP3_PREDICT_MAX_US;
+	p->history_idx = 0;
+	p->nr_states = 0;
+}
+
+static inline void omap3_predict_add_state(struct omap3_predictor *p,
+					   u32 entry, u32 exit, u32 threshold)
+{
+	struct omap3_predict_state *s;
+
+	if (p->nr_states >= OMAP3_PREDICT_MAX_STATES)
+		return;
+
+	s = &p->states[p->nr_states++];
+	s->entry_nominal = entry;
+	s->exit_nominal = exit;
+	s->threshold = threshold;
+	s->entry_cost = entry;
+	s->exit_cost = exit;
+	s->entry_samples = 0;
+	s->exit_samples = 0;
+	s->break_even = threshold;
+	s->usage = 0;
+	s->short_usage = 0;
+}
+
+static inline u32 omap3_predict_ewma(u32 avg, u32 sample, u32 samples)
+{
+	/* plain average until the EWMA window is filled */
+	if (samples < (1U << OMAP3_PREDICT_COST_SHIFT))
+		return (avg * samples + sample) / (samples + 1);
+	return avg - (avg >> OMAP3_PREDICT_COST_SHIFT) +
+	       (sample >> OMAP3_PREDICT_COST_SHIFT);
+}
+
+static inline void omap3_predict_break_even(struct omap3_predict_state *s)
+{
+	u32 nominal = s->entry_nominal + s->exit_nominal;
+	u32 cost = s->entry_cost + s->exit_cost;
+	u32 be;
+
+	if (s->entry_samples < OMAP3_PREDICT_MIN_SAMPLES ||
+	    s->exit_samples < OMAP3_PREDICT_MIN_SAMPLES || !nominal) {
+		s->break_even = s->threshold;
+		return;
+	}
+
+	be = div_u64((u64)s->threshold * cost, nominal);
+	/* the board value stays the reference: allow 4x either way */
+	if (be < s->threshold / 4)
+		be = s->threshold / 4;
+	if (be > s->threshold * 4)
+		be = s->threshold * 4;
+	if (be < cost)
+		be = cost;
+	s->break_even = be;
+}
+
+/*
+ * Typical interval of the recent idles, or OMAP3_PREDICT_MAX_US if they
+ * are too spread out to tell (standard deviation above 1/6 of the mean,
+ * which keeps most of a normal distribution above mean / 2).
+ */
+static inline u32 omap3_predict_typical(struct omap3_predictor *p)
+{
+	u64 sum = 0, sq = 0, avg, var;
+	int i;
+
+	for (i = 0; i < OMAP3_PREDICT_HISTORY; i++)
+		sum += p->history[i];
+	avg = sum / OMAP3_PREDICT_HISTORY;
+
+	for (i = 0; i < OMAP3_PREDICT_HISTORY; i++) {
+		s64 d = (s64)p->history[i] - (s64)avg;
+
+		sq += d * d;
+	}
+	var = sq / OMAP3_PREDICT_HISTORY;
+
+	if (avg >= OMAP3_PREDICT_MAX_US || var * 36 > avg * avg)
+		return OMAP3_PREDICT_MAX_US;
+	return avg;
+}
+
+/**
+ * omap3_predict_select - pick the state for the coming idle
+ * @p: predictor
+ * @timer_us: time to the next timer event
+ * @latency_req: tolerated wakeup latency, in us
+ *
+ * Returns the index of the deepest state whose break-even residency fits
+ * the predicted idle and whose measured transition cost fits the latency
+ * constraint. State 0 is always allowed.
+ */
+static inline int omap3_predict_select(struct omap3_predictor *p,
+				       u32 timer_us, u32 latency_req)
+{
+	u32 predicted, typical;
+	int i, state = 0;
+
+	if (timer_us > OMAP3_PREDICT_MAX_US)
+		timer_us = OMAP3_PREDICT_MAX_US;
+
+	p->timer_us = timer_us;
+	p->bucket = omap3_predict_bucket(timer_us);
+	predicted = div_u64((u64)timer_us * p->correction[p->bucket],
+			    OMAP3_PREDICT_RESOLUTION * OMAP3_PREDICT_DECAY);
+
+	typical = omap3_predict_typical(p);
+	if (typical < predicted)
+		predicted = typical;
+	p->predicted_us = predicted;
+
+	for (i = 1; i < p->nr_states; i++) {
+		struct omap3_predict_state *s = &p->states[i];
+
+		if (s->break_even > predicted)
+			break;
+		if (s->entry_cost + s->exit_cost > latency_req)
+			break;
+		state = i;
+	}
+	return state;
+}
+
+/**
+ * omap3_predict_update - learn from the idle which just ended
+ * @p: predictor
+ * @state: index of the state actually entered
+ * @residency: measured idle time, in us
+ * @entry_us: measured entry cost, in us, or -1 if the WFI was not reached
+ *
+ * Must follow the omap3_predict_select() call for the same idle.
+ */
+static inline void omap3_predict_update(struct omap3_predictor *p, int state,
+					u32 residency, int entry_us)
+{
+	struct omap3_predict_state *s;
+	u32 event, factor;
+	int timer_wakeup;
+
+	if (state < 0 || state >= p->nr_states)
+		return;
+	s = &p->states[state];
+
+	if (entry_us >= 0) {
+		s->entry_cost = omap3_predict_ewma(s->entry_cost, entry_us,
+						   s->entry_samples);
+		s->entry_samples++;
+	}
+
+	timer_wakeup = entry_us >= 0 &&
+		       residency + OMAP3_PREDICT_TIMER_SLACK >= p->timer_us;
+	if (timer_wakeup) {
+		u32 late = residency > p->timer_us ?
+			   residency - p->timer_us : 0;
+
+		s->exit_cost = omap3_predict_ewma(s->exit_cost, late,
+						  s->exit_samples);
+		s->exit_samples++;
+		event = p->timer_us;
+	} else {
+		/* the exit cost is part of the measured time, not of the idle */
+		event = residency > s->exit_cost ? residency - s->exit_cost : 0;
+	}
+	if (event > OMAP3_PREDICT_MAX_US)
+		event = OMAP3_PREDICT_MAX_US;
+
+	omap3_predict_break_even(s);
+
+	s->usage++;
+	if (event < s->break_even)
+		s->short_usage++;
+
+	/* correction factor of the timer range, as the menu governor does */
+	factor = p->correction[p->bucket];
+	factor -= factor / OMAP3_PREDICT_DECAY;
+	if (p->timer_us > 0 && event < p->timer_us)
+		factor += div_u64((u64)OMAP3_PREDICT_RESOLUTION * event,
+				  p->timer_us);
+	else
+		factor += OMAP3_PREDICT_RESOLUTION;
+	/* never let it reach 0 */
+	if (factor < 1)
+		factor = 1;
+	p->correction[p->bucket] = factor;
+
+	p->history[p->history_idx] = event;
+	p->history_idx = (p->history_idx + 1) & (OMAP3_PREDICT_HISTORY - 1);
+}
+
+#endif /* __ARCH_ARM_MACH_OMAP2_CPUIDLE34XX_PREDICT_H */
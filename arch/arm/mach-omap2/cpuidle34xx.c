@@ -24,6 +24,11 @@
 
 #include <linux/sched.h>
 #include <linux/cpuidle.h>
+#include <linux/pm_qos_params.h>
+#include <linux/tick.h>
+#include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <plat/prcm.h>
 #include <plat/irqs.h>
@@ -33,6 +38,7 @@
 #include <plat/serial.h>
 
 #include "pm.h"
+#include "cpuidle34xx-predict.h"
 
 #ifdef CONFIG_CPU_IDLE
 
@@ -99,6 +105,244 @@ static int omap3_idle_bm_check(void)
 	return 0;
 }
 
+#ifdef CONFIG_OMAP3_CPUIDLE_PREDICT
+/*
+ * Glue for the predictive governor: timing of the idle entry, governor
+ * callbacks and debugfs files. The policy is in cpuidle34xx-predict.h.
+ */
+#define OMAP3_IDLE_TRACE_LEN	4096
+
+struct omap3_idle_trace {
+	u8 state;
+	u32 timer_us;
+	u32 residency;
+	s32 entry_us;
+	s32 latency_req;
+};
+
+static struct omap3_predictor omap3_predictor;
+static struct timespec omap3_idle_ts_wfi;
+static int omap3_idle_wfi_reached;
+static int omap3_idle_entry_us = -1;
+
+static u32 omap3_idle_trace_enabled;
+static struct omap3_idle_trace *omap3_idle_trace;
+static unsigned int omap3_idle_trace_head, omap3_idle_trace_count;
+
+/* Called by omap_sram_idle() right before the WFI */
+void omap3_idle_mark_wfi(void)
+{
+	getnstimeofday(&omap3_idle_ts_wfi);
+	omap3_idle_wfi_reached = 1;
+}
+
+static inline void omap3_idle_start(void)
+{
+	omap3_idle_wfi_reached = 0;
+}
+
+/* Called with interrupts disabled at the end of omap3_enter_idle() */
+static void omap3_idle_account(struct cpuidle_device *dev,
+			       struct cpuidle_state *state,
+			       struct timespec *ts_preidle, u32 residency)
+{
+	struct omap3_idle_trace *t;
+	struct timespec ts_entry;
+
+	if (omap3_idle_wfi_reached) {
+		ts_entry = timespec_sub(omap3_idle_ts_wfi, *ts_preidle);
+		omap3_idle_entry_us = ts_entry.tv_nsec / NSEC_PER_USEC +
+				      ts_entry.tv_sec * USEC_PER_SEC;
+	} else
+		omap3_idle_entry_us = -1;
+
+	if (!omap3_idle_trace_enabled || !omap3_idle_trace)
+		return;
+
+	t = &omap3_idle_trace[omap3_idle_trace_head];
+	t->state = state - dev->states;
+	t->timer_us = min_t(s64, ktime_to_us(tick_nohz_get_sleep_length()),
+			    OMAP3_PREDICT_MAX_US);
+	t->residency = residency;
+	t->entry_us = omap3_idle_entry_us;
+	t->latency_req = pm_qos_requirement(PM_QOS_CPU_DMA_LATENCY);
+	omap3_idle_trace_head = (omap3_idle_trace_head + 1) %
+				OMAP3_IDLE_TRACE_LEN;
+	if (omap3_idle_trace_count < OMAP3_IDLE_TRACE_LEN)
+		omap3_idle_trace_count++;
+}
+
+static int omap3_predict_select_state(struct cpuidle_device *dev)
+{
+	int latency_req = pm_qos_requirement(PM_QOS_CPU_DMA_LATENCY);
+	s64 timer_us;
+
+	/* Special case when user has set very strict latency requirement */
+	if (unlikely(latency_req == 0))
+		return 0;
+
+	timer_us = ktime_to_us(tick_nohz_get_sleep_length());
+	return omap3_predict_select(&omap3_predictor,
+				    timer_us > 0 ? timer_us : 0, latency_req);
+}
+
+static void omap3_predict_reflect(struct cpuidle_device *dev)
+{
+	omap3_predict_update(&omap3_predictor, dev->last_state - dev->states,
+			     cpuidle_get_last_residency(dev),
+			     omap3_idle_entry_us);
+}
+
+static struct cpuidle_governor omap3_predict_governor = {
+	.name =		"omap3_predict",
+	.rating =	30,
+	.select =	omap3_predict_select_state,
+	.reflect =	omap3_predict_reflect,
+	.owner =	THIS_MODULE,
+};
+
+#ifdef CONFIG_DEBUG_FS
+static int omap3_idle_states_show(struct seq_file *s, void *unused)
+{
+	struct omap3_predict_state st;
+	int i;
+
+	seq_printf(s, "# state entry_nominal exit_nominal threshold"
+		   " entry exit break_even usage short\n");
+	for (i = 0; i < omap3_predictor.nr_states; i++) {
+		local_irq_disable();
+		st = omap3_predictor.states[i];
+		local_irq_enable();
+		seq_printf(s, "C%d %u %u %u %u %u %u %u %u\n", i + 1,
+			   st.entry_nominal, st.exit_nominal, st.threshold,
+			   st.entry_cost, st.exit_cost, st.break_even,
+			   st.usage, st.short_usage);
+	}
+	return 0;
+}
+
+static int omap3_idle_states_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omap3_idle_states_show, NULL);
+}
+
+static const struct file_operations omap3_idle_states_fops = {
+	.open		= omap3_idle_states_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/*
+ * One line per idle, oldest first:
+ * state timer_us residency_us entry_us latency_req
+ * which is the input format of Documentation/arm/OMAP/omap3_idle_sim.c.
+ */
+static int omap3_idle_trace_show(struct seq_file *s, void *unused)
+{
+	struct omap3_idle_trace t;
+	unsigned int i, first, count;
+
+	local_irq_disable();
+	count = omap3_idle_trace_count;
+	first = (omap3_idle_trace_head + OMAP3_IDLE_TRACE_LEN - count) %
+		OMAP3_IDLE_TRACE_LEN;
+	local_irq_enable();
+
+	for (i = 0; i < count; i++) {
+		local_irq_disable();
+		t = omap3_idle_trace[(first + i) % OMAP3_IDLE_TRACE_LEN];
+		local_irq_enable();
+		seq_printf(s, "%u %u %u %d %d\n", t.state, t.timer_us,
+			   t.residency, t.entry_us, t.latency_req);
+	}
+	return 0;
+}
+
+static int omap3_idle_trace_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omap3_idle_trace_show, NULL);
+}
+
+/* Any write empties the trace */
+static ssize_t omap3_idle_trace_write(struct file *file,
+				      const char __user *buf,
+				      size_t count, loff_t *ppos)
+{
+	local_irq_disable();
+	omap3_idle_trace_head = 0;
+	omap3_idle_trace_count = 0;
+	local_irq_enable();
+	return count;
+}
+
+static const struct file_operations omap3_idle_trace_fops = {
+	.open		= omap3_idle_trace_open,
+	.read		= seq_read,
+	.write		= omap3_idle_trace_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init omap3_idle_debugfs_init(void)
+{
+	struct dentry *d;
+
+	d = debugfs_create_dir("omap3_idle", NULL);
+	if (IS_ERR(d) || !d)
+		return;
+
+	omap3_idle_trace = kcalloc(OMAP3_IDLE_TRACE_LEN,
+				   sizeof(*omap3_idle_trace), GFP_KERNEL);
+
+	(void) debugfs_create_file("states", S_IRUGO, d, NULL,
+				   &omap3_idle_states_fops);
+	if (omap3_idle_trace) {
+		(void) debugfs_create_u32("record", S_IRUGO | S_IWUSR, d,
+					  &omap3_idle_trace_enabled);
+		(void) debugfs_create_file("trace", S_IRUGO | S_IWUSR, d,
+					   NULL, &omap3_idle_trace_fops);
+	}
+}
+#else
+static inline void omap3_idle_debugfs_init(void)
+{
+}
+#endif /* CONFIG_DEBUG_FS */
+
+static void __init omap3_predict_init_states(struct cpuidle_device *dev)
+{
+	struct omap3_processor_cx *cx;
+	int i;
+
+	omap3_predict_init(&omap3_predictor);
+	for (i = 0; i < dev->state_count; i++) {
+		cx = cpuidle_get_statedata(&dev->states[i]);
+		omap3_predict_add_state(&omap3_predictor, cx->sleep_latency,
+					cx->wakeup_latency, cx->threshold);
+	}
+
+	if (cpuidle_register_governor(&omap3_predict_governor))
+		printk(KERN_ERR "%s: cannot register governor\n", __func__);
+	omap3_idle_debugfs_init();
+}
+#else
+static inline void omap3_idle_start(void)
+{
+}
+
+static inline void omap3_idle_account(struct cpuidle_device *dev,
+				      struct cpuidle_state *state,
+				      struct timespec *ts_preidle,
+				      u32 residency)
+{
+}
+
+static inline void omap3_predict_init_states(struct cpuidle_device *dev)
+{
+}
+#endif /* CONFIG_OMAP3_CPUIDLE_PREDICT */
+
 static int _cpuidle_allow_idle(struct powerdomain *pwrdm,
 				struct clockdomain *clkdm)
 {
@@ -127,8 +371,10 @@ static int omap3_enter_idle(struct cpuidle_device *dev,
 	struct omap3_processor_cx *cx = cpuidle_get_statedata(state);
 	struct timespec ts_preidle, ts_postidle, ts_idle;
 	u32 mpu_state = cx->mpu_state, core_state = cx->core_state;
+	u32 residency;
 
 	current_cx_state = *cx;
+	omap3_idle_start();
 
 	/* Used to keep track of the total time in idle */
 	getnstimeofday(&ts_preidle);
@@ -165,11 +411,14 @@ static int omap3_enter_idle(struct cpuidle_device *dev,
 return_sleep_time:
 	getnstimeofday(&ts_postidle);
 	ts_idle = timespec_sub(ts_postidle, ts_preidle);
+	residency = ts_idle.tv_nsec / NSEC_PER_USEC +
+		    ts_idle.tv_sec * USEC_PER_SEC;
+	omap3_idle_account(dev, state, &ts_preidle, residency);
 
 	local_irq_enable();
 	local_fiq_enable();
 
-	return ts_idle.tv_nsec / NSEC_PER_USEC + ts_idle.tv_sec * USEC_PER_SEC;
+	return residency;
 }
 
 /**
@@ -466,6 +715,7 @@ int __init omap3_idle_init(void)
 	if (!count)
 		return -EINVAL;
 	dev->state_count = count;
+	omap3_predict_init_states(dev);
 
 	if (cpuidle_register_device(dev)) {
 		printk(KERN_ERR "%s: CPUidle register device failed\n",
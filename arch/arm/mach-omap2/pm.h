@@ -25,6 +25,13 @@ extern void omap_sram_idle(void);
 extern int omap3_can_sleep(void);
 extern int set_pwrdm_state(struct powerdomain *pwrdm, u32 state);
 extern int omap3_idle_init(void);
+#ifdef CONFIG_OMAP3_CPUIDLE_PREDICT
+extern void omap3_idle_mark_wfi(void);
+#else
+static inline void omap3_idle_mark_wfi(void)
+{
+}
+#endif
 extern void vfp_pm_save_context(void);
 
 extern void lock_scratchpad_sem(void);
@@ -546,6 +546,7 @@ void omap_sram_idle(void)
 	 * get saved. The restore path then reads from this
 	 * location and restores them back.
 	 */
+	omap3_idle_mark_wfi();
 	_omap_sram_idle(omap3_arm_context, save_state);
 	cpu_init();
 
@@ -127,6 +127,7 @@ void blk_rq_init(struct request_queue *q, struct request *rq)
 	rq->tag = -1;
 	rq->ref_count = 1;
 	rq->start_time = jiffies;
+	blk_rq_latency_init(rq);
 }
 EXPORT_SYMBOL(blk_rq_init);
 
@@ -1075,6 +1076,7 @@ void __blk_put_request(struct request_queue *q, struct request *req)
 		return;
 
 	elv_completed_request(q, req);
+	blk_rq_latency_free(req);
 
 	/* this is a bio leak */
 	WARN_ON(req->bio != NULL);
@@ -1263,6 +1265,7 @@ get_rq:
 	 * often, and the elevators are able to handle it.
 	 */
 	init_request_from_bio(req, bio);
+	blk_rq_latency_attach(req);
 
 	spin_lock_irq(q->queue_lock);
 	if (test_bit(QUEUE_FLAG_SAME_COMP, &q->queue_flags) ||
@@ -1897,6 +1900,7 @@ void blk_start_request(struct request *req)
 	if (unlikely(blk_bidi_rq(req)))
 		req->next_rq->resid_len = blk_rq_bytes(req->next_rq);
 
+	blk_rq_latency_start(req);
 	blk_add_timer(req);
 }
 EXPORT_SYMBOL(blk_start_request);
@@ -2115,6 +2119,7 @@ static void blk_finish_request(struct request *req, int error)
 	blk_delete_timer(req);
 
 	blk_account_io_done(req);
+	blk_account_io_latency(req);
 
 	if (req->end_io)
 		req->end_io(req, error);
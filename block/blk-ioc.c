@@ -101,6 +101,9 @@ struct io_context *alloc_io_context(gfp_t gfp_flags, int node)
 		INIT_RADIX_TREE(&ret->radix_root, GFP_ATOMIC | __GFP_HIGH);
 		INIT_HLIST_HEAD(&ret->cic_list);
 		ret->ioc_data = NULL;
+#ifdef CONFIG_BLK_IO_LATENCY
+		memset(&ret->latency, 0, sizeof(ret->latency));
+#endif
 	}
 
 	return ret;
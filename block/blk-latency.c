@@ -0,0 +1,286 @@
+/*
+ * Block request latency histograms
+ *
+ * Each request records when it was allocated, when the I/O scheduler
+ * dispatched it and when the driver started it.  On completion the
+ * resulting queue, dispatch, service and total times go into log2
+ * histograms kept for the whole system (per cpu, shown in debugfs) and
+ * for the io_context of the task which allocated the request (shown in
+ * /proc/<pid>/io_latency).
+ *
+ * Note that the submitter of a buffered write is the flusher thread,
+ * not the task which dirtied the pages.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/blkdev.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+#include <linux/debugfs.h>
+#include <linux/uaccess.h>
+
+#include "blk.h"
+
+static DEFINE_PER_CPU(struct io_latency, blk_io_latency);
+
+static const char *io_latency_names[IO_LATENCY_NR] = {
+	[IO_LATENCY_QUEUE]	= "queue",
+	[IO_LATENCY_DISPATCH]	= "dispatch",
+	[IO_LATENCY_SERVICE]	= "service",
+	[IO_LATENCY_TOTAL]	= "total",
+};
+
+static void io_latency_account(struct io_latency *lat, int rw,
+			       const u32 *us, unsigned valid)
+{
+	int i;
+
+	lat->count[rw]++;
+	for (i = 0; i < IO_LATENCY_NR; i++) {
+		struct io_latency_hist *h = &lat->hist[i];
+
+		if (!(valid & (1 << i)))
+			continue;
+		h->sum += us[i];
+		if (us[i] > h->max)
+			h->max = us[i];
+		h->buckets[min_t(int, fls(us[i]), IO_LATENCY_BUCKETS - 1)]++;
+	}
+}
+
+static void io_latency_add(struct io_latency *sum, struct io_latency *lat)
+{
+	int i, j;
+
+	sum->count[0] += lat->count[0];
+	sum->count[1] += lat->count[1];
+	for (i = 0; i < IO_LATENCY_NR; i++) {
+		struct io_latency_hist *s = &sum->hist[i];
+		struct io_latency_hist *h = &lat->hist[i];
+
+		s->sum += h->sum;
+		s->max = max(s->max, h->max);
+		for (j = 0; j < IO_LATENCY_BUCKETS; j++)
+			s->buckets[j] += h->buckets[j];
+	}
+}
+
+static inline u32 blk_latency_us(u64 from, u64 to)
+{
+	u64 us;
+
+	if (to <= from)
+		return 0;
+	us = div_u64(to - from, NSEC_PER_USEC);
+	return min_t(u64, us, ~0U);
+}
+
+/*
+ * Take a reference on the io_context of the task allocating the
+ * request, dropped when the request is freed.
+ */
+void blk_rq_latency_attach(struct request *rq)
+{
+	struct io_context *ioc = current->io_context;
+
+	if (ioc) {
+		atomic_long_inc(&ioc->refcount);
+		rq->lat_ioc = ioc;
+	}
+}
+
+/*
+ * Called on request completion, queue lock held
+ */
+void blk_account_io_latency(struct request *rq)
+{
+	struct io_context *ioc = rq->lat_ioc;
+	u32 us[IO_LATENCY_NR];
+	unsigned valid = 0;
+	unsigned long flags;
+	int rw = rq_data_dir(rq);
+	u64 now;
+
+	if (!blk_fs_request(rq) || rq == &rq->q->bar_rq)
+		return;
+
+	now = sched_clock();
+	if (rq->dispatch_time_ns) {
+		us[IO_LATENCY_QUEUE] = blk_latency_us(rq->start_time_ns,
+						      rq->dispatch_time_ns);
+		valid |= 1 << IO_LATENCY_QUEUE;
+		if (rq->io_start_time_ns) {
+			us[IO_LATENCY_DISPATCH] =
+				blk_latency_us(rq->dispatch_time_ns,
+					       rq->io_start_time_ns);
+			valid |= 1 << IO_LATENCY_DISPATCH;
+		}
+	}
+	if (rq->io_start_time_ns) {
+		us[IO_LATENCY_SERVICE] = blk_latency_us(rq->io_start_time_ns,
+							now);
+		valid |= 1 << IO_LATENCY_SERVICE;
+	}
+	us[IO_LATENCY_TOTAL] = blk_latency_us(rq->start_time_ns, now);
+	valid |= 1 << IO_LATENCY_TOTAL;
+
+	local_irq_save(flags);
+	io_latency_account(&__get_cpu_var(blk_io_latency), rw, us, valid);
+	local_irq_restore(flags);
+
+	if (ioc) {
+		spin_lock_irqsave(&ioc->lock, flags);
+		io_latency_account(&ioc->latency, rw, us, valid);
+		spin_unlock_irqrestore(&ioc->lock, flags);
+	}
+}
+
+static void io_latency_print(struct seq_file *m, struct io_latency *lat)
+{
+	unsigned long count[IO_LATENCY_NR];
+	int i, j;
+
+	seq_printf(m, "reads %lu writes %lu\n", lat->count[0], lat->count[1]);
+
+	seq_printf(m, "%-10s", "us");
+	for (i = 0; i < IO_LATENCY_NR; i++)
+		seq_printf(m, " %10s", io_latency_names[i]);
+
+	seq_printf(m, "\n%-10s", "avg");
+	for (i = 0; i < IO_LATENCY_NR; i++) {
+		struct io_latency_hist *h = &lat->hist[i];
+
+		count[i] = 0;
+		for (j = 0; j < IO_LATENCY_BUCKETS; j++)
+			count[i] += h->buckets[j];
+		seq_printf(m, " %10llu", count[i] ?
+			   div64_u64(h->sum, count[i]) : 0ULL);
+	}
+
+	seq_printf(m, "\n%-10s", "max");
+	for (i = 0; i < IO_LATENCY_NR; i++)
+		seq_printf(m, " %10u", lat->hist[i].max);
+	seq_putc(m, '\n');
+
+	for (j = 0; j < IO_LATENCY_BUCKETS; j++) {
+		if (j < IO_LATENCY_BUCKETS - 1)
+			seq_printf(m, "<%-9lu", 1UL << j);
+		else
+			seq_printf(m, ">=%-8lu", 1UL << (j - 1));
+		for (i = 0; i < IO_LATENCY_NR; i++)
+			seq_printf(m, " %10u", lat->hist[i].buckets[j]);
+		seq_putc(m, '\n');
+	}
+}
+
+static void task_io_latency_add(struct io_latency *sum,
+				struct task_struct *first,
+				struct task_struct *task)
+{
+	struct io_context *ioc;
+
+	task_lock(task);
+	ioc = task->io_context;
+	if (ioc && atomic_read(&ioc->nr_tasks) > 1) {
+		struct task_struct *t;
+
+		/* shared with CLONE_IO, only count it once */
+		for (t = first; t != task; t = next_thread(t))
+			if (t->io_context == ioc) {
+				ioc = NULL;
+				break;
+			}
+	}
+	if (ioc) {
+		spin_lock_irq(&ioc->lock);
+		io_latency_add(sum, &ioc->latency);
+		spin_unlock_irq(&ioc->lock);
+	}
+	task_unlock(task);
+}
+
+/*
+ * Show the latencies of the requests of @task, or with @whole of all
+ * the live threads of its process.
+ */
+int task_io_latency_show(struct seq_file *m, struct task_struct *task,
+			 int whole)
+{
+	struct io_latency *sum;
+
+	sum = kzalloc(sizeof(*sum), GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+
+	if (whole) {
+		struct task_struct *t = task;
+
+		rcu_read_lock();
+		do {
+			task_io_latency_add(sum, task, t);
+		} while_each_thread(task, t);
+		rcu_read_unlock();
+	} else
+		task_io_latency_add(sum, task, task);
+
+	io_latency_print(m, sum);
+	kfree(sum);
+	return 0;
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int blk_io_latency_show(struct seq_file *m, void *v)
+{
+	struct io_latency *sum;
+	int cpu;
+
+	sum = kzalloc(sizeof(*sum), GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu)
+		io_latency_add(sum, &per_cpu(blk_io_latency, cpu));
+
+	io_latency_print(m, sum);
+	kfree(sum);
+	return 0;
+}
+
+static int blk_io_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, blk_io_latency_show, NULL);
+}
+
+/* Writing anything resets the system wide histograms */
+static ssize_t blk_io_latency_write(struct file *file, const char __user *buf,
+				    size_t count, loff_t *ppos)
+{
+	unsigned long flags;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		local_irq_save(flags);
+		memset(&per_cpu(blk_io_latency, cpu), 0,
+		       sizeof(struct io_latency));
+		local_irq_restore(flags);
+	}
+	return count;
+}
+
+static const struct file_operations blk_io_latency_fops = {
+	.open		= blk_io_latency_open,
+	.read		= seq_read,
+	.write		= blk_io_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init blk_io_latency_debugfs(void)
+{
+	debugfs_create_file("io_latency", 0600, NULL, NULL,
+			    &blk_io_latency_fops);
+	return 0;
+}
+late_initcall(blk_io_latency_debugfs);
+#endif
@@ -25,6 +25,47 @@ void blk_delete_timer(struct request *);
 void blk_add_timer(struct request *);
 void __generic_unplug_device(struct request_queue *);
 
+#ifdef CONFIG_BLK_IO_LATENCY
+void blk_account_io_latency(struct request *rq);
+void blk_rq_latency_attach(struct request *rq);
+
+static inline void blk_rq_latency_init(struct request *rq)
+{
+	rq->start_time_ns = sched_clock();
+}
+
+static inline void blk_rq_latency_dispatch(struct request *rq)
+{
+	rq->dispatch_time_ns = sched_clock();
+}
+
+static inline void blk_rq_latency_start(struct request *rq)
+{
+	rq->io_start_time_ns = sched_clock();
+}
+
+static inline void blk_rq_latency_merge(struct request *rq,
+					struct request *next)
+{
+	if (rq->start_time_ns > next->start_time_ns)
+		rq->start_time_ns = next->start_time_ns;
+}
+
+static inline void blk_rq_latency_free(struct request *rq)
+{
+	put_io_context(rq->lat_ioc);
+}
+#else
+static inline void blk_account_io_latency(struct request *rq) { }
+static inline void blk_rq_latency_attach(struct request *rq) { }
+static inline void blk_rq_latency_init(struct request *rq) { }
+static inline void blk_rq_latency_dispatch(struct request *rq) { }
+static inline void blk_rq_latency_start(struct request *rq) { }
+static inline void blk_rq_latency_merge(struct request *rq,
+					struct request *next) { }
+static inline void blk_rq_latency_free(struct request *rq) { }
+#endif
+
 /*
  * Internal atomic flags for request handling
  */
@@ -447,6 +447,7 @@ void elv_dispatch_sort(struct request_queue *q, struct request *rq)
 	}
 
 	list_add(&rq->queuelist, entry);
+	blk_rq_latency_dispatch(rq);
 }
 EXPORT_SYMBOL(elv_dispatch_sort);
 
@@ -467,6 +468,7 @@ void elv_dispatch_add_tail(struct request_queue *q, struct request *rq)
 	q->end_sector = rq_end_sector(rq);
 	q->boundary_rq = rq;
 	list_add_tail(&rq->queuelist, &q->queue_head);
+	blk_rq_latency_dispatch(rq);
 }
 EXPORT_SYMBOL(elv_dispatch_add_tail);
 
@@ -607,12 +609,14 @@ void elv_insert(struct request_queue *q, struct request *rq, int where)
 		rq->cmd_flags |= REQ_SOFTBARRIER;
 
 		list_add(&rq->queuelist, &q->queue_head);
+		blk_rq_latency_dispatch(rq);
 		break;
 
 	case ELEVATOR_INSERT_BACK:
 		rq->cmd_flags |= REQ_SOFTBARRIER;
 		elv_drain_elevator(q);
 		list_add_tail(&rq->queuelist, &q->queue_head);
+		blk_rq_latency_dispatch(rq);
 		/*
 		 * We kick the queue here for the following reasons.
 		 * - The elevator might have returned NULL previously
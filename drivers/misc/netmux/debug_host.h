@@ -160,6 +160,7 @@ void log_packettype(COMMBUFF *);
 #define netmuxPanicMemFail2 0x00080c08
 #define netmuxPanicPkgFail1 0x00080c09
 #define netmuxPanicPkgFail2 0x00080c10
+#define netmuxPanicSKBFail5 0x00080c11
 /*----------------------------------------------*/
 #define netmuxPanicLast  0x00080c7f
 /*----------------------------------------------*/
@@ -176,6 +176,7 @@ int32 RegisterInterface(sint8 *name, int32(*inform) (void *, void *),
 	newinterface->Receive = receive;
 	newinterface->interface_index = index;
 	newinterface->param = param;
+	newinterface->flags = 0;
 
 	lib->interfaces[index] = newinterface;
 	lib->names[index] = newname;
@@ -223,6 +224,40 @@ int32 UnregisterInterface(int32 interface_index,
 	return DEBUGERROR(ERROR_NONE);
 }
 
+/*
+ * SetInterfaceFlags lets a registered interface describe what kind of
+ * commbuffs it is able to handle. The mux consults these flags before
+ * delivering received data to the interface.
+ *
+ * Params:
+ * interface_index -- the interface id/index for the interface
+ * flags -- the INTERFACE_FLAG_* values to set
+ * lib -- the library which holds the interface
+ */
+int32 SetInterfaceFlags(int32 interface_index, int32 flags,
+			MUXINTERFACE_LIBRARY *lib)
+{
+	DEBUG("SetInterfaceFlags(%lu, %lu, %p)\n", interface_index, flags,
+	      lib);
+
+	if (interface_index >= lib->maxinterfaces)
+		return DEBUGERROR(ERROR_OPERATIONFAILED);
+
+	enter_write_criticalsection(&lib->lock);
+
+	if (!lib->interfaces[interface_index]) {
+		exit_write_criticalsection(&lib->lock);
+
+		return DEBUGERROR(ERROR_OPERATIONFAILED);
+	}
+
+	lib->interfaces[interface_index]->flags = flags;
+
+	exit_write_criticalsection(&lib->lock);
+
+	return DEBUGERROR(ERROR_NONE);
+}
+
 /*
  * QueryInterfaceIndex allows an interface or a mux to locate the interface
  * id by supplying the ascii name of the interface assigned upon registration.
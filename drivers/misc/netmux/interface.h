@@ -56,6 +56,15 @@
 		((l)->interfaces[index]->Inform((void *)if,	\
 		 (void *)(l)->interfaces[index]->param))
 
+/*
+ * Define flags an interface can set on itself
+ *
+ * INTERFACE_FLAG_FRAGMENTED -- the receive function accepts commbuffs
+ *                              whose data is chained across several
+ *                              link buffers rather than contiguous
+ */
+#define INTERFACE_FLAG_FRAGMENTED 0x00000001
+
 /*
  * INTERFACEINFORM defines a structure to be delivered to
  * interface inform functions. The members are briefly described
@@ -82,6 +91,7 @@ typedef struct INTERFACEINFORM {
  * interface_index stores the index of the interface which is
  * 	 equivlent to the id
  * param is a parameter passed to the invoke and receive functions
+ * flags is a set of INTERFACE_FLAG_* values describing the interface
  */
 typedef struct MUXINTERFACE {
 	int32(*Inform) (void *, void *);
@@ -89,6 +99,7 @@ typedef struct MUXINTERFACE {
 
 	int32 interface_index;
 	int32 param;
+	int32 flags;
 } MUXINTERFACE;
 
 /*
@@ -119,6 +130,7 @@ int32 RegisterInterface(sint8 *, int32(*inform) (void *, void *),
 			int32(*receive) (COMMBUFF *, void *), int32,
 			MUXINTERFACE_LIBRARY *);
 int32 UnregisterInterface(int32, MUXINTERFACE_LIBRARY *);
+int32 SetInterfaceFlags(int32, int32, MUXINTERFACE_LIBRARY *);
 
 int32 QueryInterfaceIndex(sint8 *, MUXINTERFACE_LIBRARY *, int32 *);
 int32 ConnectInterface(int32, MUXINTERFACE_LIBRARY *, MUXINTERFACE **);
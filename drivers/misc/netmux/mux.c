@@ -579,7 +579,13 @@ void ProcessSendQueues(struct work_struct *work)
 
 	disable_task(&mux->send_task);
 
-	/* tell the interfaces that they can do their send prep work */
+	/* tell the interfaces that they can do their send prep work,  */
+	/* everything they queue now is picked up by the loop below so */
+	/* SendData does not need to reschedule us for each buffer     */
+	enter_write_criticalsection(&mux->lock);
+	mux->send_batching = 1;
+	exit_write_criticalsection(&mux->lock);
+
 	informdata.inform_type = INFORM_INTERFACE_PREPSEND;
 	informdata.source = mux;
 	informdata.data = NULL;
@@ -590,6 +596,7 @@ void ProcessSendQueues(struct work_struct *work)
 	informdata.inform_type = INFORM_INTERFACE_DATA;
 
 	enter_write_criticalsection(&mux->lock);
+	mux->send_batching = 0;
 	holding_lock = 1;
 
 	/* while there is queued data that we can't ignore, keep trying */
@@ -947,10 +954,16 @@ void ReceivePartial(COMMBUFF *commbuff, MUX *mux)
 	if (part_recv->buffer) {
 		/* we're already building up from something previously
 		 * received so just merge this one into the previous
-		 * one and update the stats
+		 * one and update the stats. Once the data header has
+		 * been parsed the body is chained rather than copied
+		 * since only the header needs to be contiguous
 		 */
-		part_recv->buffer =
-		    commbuff_merge(part_recv->buffer, commbuff);
+		if (part_recv->type == PACKETTYPE_DATA_BDY)
+			part_recv->buffer =
+			    commbuff_chain(part_recv->buffer, commbuff);
+		else
+			part_recv->buffer =
+			    commbuff_merge(part_recv->buffer, commbuff);
 		part_recv->packet.payload =
 		    commbuff_data(part_recv->buffer);
 	} else {
@@ -1282,6 +1295,19 @@ void ReceiveData(MUX *mux)
 	/* get rid of the header before it goes on the channel queue */
 	commbuff_remove_front(databuffer, sizeof(DATA_PACKET_HDR));
 
+	/* only interfaces that say so can take chained data as is */
+	if (!commbuff_linear(databuffer)
+	    && !(channel->connected_interface->flags &
+		 INTERFACE_FLAG_FRAGMENTED)
+	    && commbuff_linearize(databuffer)) {
+		DEBUG("NETMUX ERROR: DISCARDING DATA THAT COULD NOT BE  \
+			LINEARIZED ON CHANNEL NUMBER %d\n",
+			chanlNum);
+		free_commbuff(databuffer);
+		exit_write_criticalsection(&mux->lock);
+		return;
+	}
+
 	queue_commbuff(databuffer, &channel->receive_queue);
 
 	exit_write_criticalsection(&mux->lock);
@@ -2370,6 +2396,7 @@ int32 SendData(int32 channel, COMMBUFF *commbuff, COMMBUFF **split,
 	CHANNEL *send_channel;
 	int32 room;
 	int32 buffer_length;
+	int32 batching;
 
 	DEBUG("SendData(%lu, %p, %p, %p)\n", channel, commbuff, split,
 	      mux);
@@ -2432,10 +2459,15 @@ int32 SendData(int32 channel, COMMBUFF *commbuff, COMMBUFF **split,
 	/* the channel has data to send, change its state */
 	(void) ExecuteStateTransition(LOCAL_DATA, mux, channel);
 
+	/* the send task is collecting data and will send this too */
+	batching = mux->send_batching;
+
 	exit_write_criticalsection(&mux->lock);
 
-	enable_task(&mux->send_task);
-	task_schedule(&mux->send_task);
+	if (!batching) {
+		enable_task(&mux->send_task);
+		task_schedule(&mux->send_task);
+	}
 
 	if (split && (*split))
 		return DEBUGERROR(ERROR_INCOMPLETE);
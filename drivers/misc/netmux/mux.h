@@ -231,6 +231,8 @@ typedef struct CHANNELCREDIT {
  * shutdown_task defines a task to be used when the linkdriver
  * 	shuts down the mux
  * partial_receive defines the MUX receiving state
+ * send_batching is set while the send task collects data from the
+ * 	interfaces, SendData does not reschedule the task during that time
  * lock synchronizes the mux
  */
 typedef struct MUX {
@@ -258,6 +260,8 @@ typedef struct MUX {
 
 	PARTIAL_RECEIVE partial_receive;
 
+	int32 send_batching;
+
 	CRITICALSECTION lock;
 } MUX;
 
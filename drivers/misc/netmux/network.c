@@ -353,6 +353,16 @@ int32 NetworkReceive(COMMBUFF *commbuff, void *param)
 	netint = (NETWORKINTERFACE *) inform_data->inform_type;
 	channel = (int32) inform_data->data;
 
+	/* the payload may be chained across several link buffers, */
+	/* make sure the IP version is contiguous before peeking   */
+	if (!pskb_may_pull(commbuff, sizeof(int8))) {
+		netint->netdevs[channel - netint->channel_min].stats.
+		    rx_dropped++;
+		free_commbuff(commbuff);
+
+		return DEBUGERROR(ERROR_NONE);
+	}
+
 	commbuff->dev =
 	    netint->netdevs[channel - netint->channel_min].netdevice;
 	commbuff->ip_summed = CHECKSUM_NONE;
@@ -445,6 +455,12 @@ int32 CreateNetworkInterface(sint8 *name, int32 channel_min,
 
 	QueryInterfaceIndex(name, mux->interface_lib,
 			    &newnetint->host_interface);
+
+	/* received skbs go straight to the stack which copes with */
+	/* chained data, so let the mux skip linearizing them      */
+	SetInterfaceFlags(newnetint->host_interface,
+			  INTERFACE_FLAG_FRAGMENTED, mux->interface_lib);
+
 	initialize_criticalsection_lock(&newnetint->lock);
 
 	*netint = newnetint;
@@ -511,6 +527,9 @@ void NetworkInit(struct net_device *netdev)
 	DEBUG("NetworkInit(0x%p)\n", netdev);
 
 	netdev->hard_header_len = 0;
+	/* leave room for the mux data header so it can be pushed */
+	/* onto the skb in place rather than copied into a new one */
+	netdev->needed_headroom = sizeof(DATA_PACKET_HDR);
 	netdev->addr_len = 0;
 	netdev->mtu = 1500;
 	netdev->tx_queue_len = 1000;	/* determine appropriate value */
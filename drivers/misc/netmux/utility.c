@@ -283,6 +283,50 @@ COMMBUFF *commbuff_merge(COMMBUFF *focus, COMMBUFF *source)
 	return newcommbuff;
 }
 
+/*
+ * commbuff_chain appends source to focus without copying the payload.
+ * source is hung off the frag_list of focus, so the result is only
+ * contiguous up to the end of focus. Small pieces and cloned heads
+ * are still handled by commbuff_merge.
+ * focus is where source is being chained to
+ * source is what is being chained onto focus
+ */
+COMMBUFF *commbuff_chain(COMMBUFF *focus, COMMBUFF *source)
+{
+	COMMBUFF **tail;
+
+	if (!skb_is_nonlinear(focus)
+	    && (skb_cloned(focus) || skb_tailroom(focus) >= source->len))
+		return commbuff_merge(focus, source);
+
+	tail = &skb_shinfo(focus)->frag_list;
+	while (*tail)
+		tail = &(*tail)->next;
+
+	source->next = NULL;
+	*tail = source;
+
+	focus->len += source->len;
+	focus->data_len += source->len;
+	focus->truesize += source->truesize;
+
+	return focus;
+}
+
+/*
+ * commbuff_headroom makes sure a commbuff has private headroom for a
+ * header of the given size. Buffers coming from the network stack
+ * normally already have it, in which case nothing is copied.
+ * commbuff is the buffer the header is going to be pushed onto
+ * amount is the size of the header
+ */
+void commbuff_headroom(COMMBUFF *commbuff, int32 amount)
+{
+	if (skb_cow_head(commbuff, amount))
+		PANIC(netmuxPanicSKBFail5,
+		      "NetMUX PANIC: Unable to expand commbuff\n");
+}
+
 void tag_commbuff(COMMBUFF *commbuff, int32 channel, void *param,
 		  void (*release) (int32, int32, void*))
 {
@@ -129,9 +129,11 @@ COMMBUFF *alloc_commbuff(int32, int32);
 #define commbuff_data(ptr)                   ((ptr)->data)
 #define commbuff_copyout(dst, cb, off, len)  memcpy(dst, ((cb)->data)+off, len)
 #define commbuff_remove_front(ptr, amount)   skb_pull(ptr, amount)
-/* the memcopys work because the skbuff is in contiguous memory */
+/* the memcopys work because the skbuff is in contiguous memory, */
+/* commbuff_headroom only reallocates when the stack left no room  */
 #define commbuff_add_header(ptr, hdr, amount) \
 	{ 			\
+		commbuff_headroom(ptr, amount);\
 		skb_push(ptr, amount);\
 		memcpy((ptr)->data, hdr, amount);\
 	}
@@ -140,9 +142,13 @@ COMMBUFF *alloc_commbuff(int32, int32);
 #define commbuff_copyin_word(ptr, off, val)  (*(int16 *)((ptr)->data+off) = val)
 #define commbuff_copyin_dword(ptr, off, val) (*(int32 *)((ptr)->data+off) = val)
 #define commbuff_data_pullup(ptr, len)
+#define commbuff_linear(ptr)                 (!skb_is_nonlinear(ptr))
+#define commbuff_linearize(ptr)              skb_linearize(ptr)
 
 COMMBUFF *commbuff_split(COMMBUFF *, int32);
 COMMBUFF *commbuff_merge(COMMBUFF *, COMMBUFF *);
+COMMBUFF *commbuff_chain(COMMBUFF *, COMMBUFF *);
+void commbuff_headroom(COMMBUFF *, int32);
 void tag_commbuff(COMMBUFF *, int32, void *,
 		  void (*__cdecl) (int32, int32, void *));
 void detag_commbuff(COMMBUFF *);
@@ -109,6 +109,17 @@ enum {
 
 #define WL1271_BUSY_WORD_LEN 8
 
+/* RX and TX frames are aggregated in a buffer of this size */
+#define WL1271_AGGR_BUFFER_SIZE (4 * PAGE_SIZE)
+
+/*
+ * The length field of a SPI command is 12 bits: longer transfers are
+ * split in chunks of one command each, sent in the same SPI message.
+ */
+#define WSPI_MAX_CHUNK_SIZE    4092
+#define WSPI_MAX_NUM_OF_CHUNKS \
+	(WL1271_AGGR_BUFFER_SIZE / WSPI_MAX_CHUNK_SIZE + 1)
+
 #define WL1271_ELP_HW_STATE_ASLEEP 0
 #define WL1271_ELP_HW_STATE_IRQ    1
 
@@ -343,6 +354,9 @@ struct wl1271 {
 	/* Rx memory pool address */
 	struct wl1271_rx_mem_pool_addr rx_mem_pool_addr;
 
+	/* Frames read or written in one bus transaction */
+	u8 *aggr_buf;
+
 	/* The target interrupt mask */
 	struct work_struct irq_work;
 
@@ -382,7 +396,7 @@ struct wl1271 {
 	struct wl1271_debugfs debugfs;
 
 	u32 buffer_32;
-	u32 buffer_cmd;
+	u32 buffer_cmd[WSPI_MAX_NUM_OF_CHUNKS];
 	u8 buffer_busyword[WL1271_BUSY_WORD_LEN];
 	struct wl1271_rx_descriptor *rx_descriptor;
 
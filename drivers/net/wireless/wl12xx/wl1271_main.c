@@ -1195,7 +1195,7 @@ static int __devinit wl1271_probe(struct spi_device *spi)
 	struct wl12xx_platform_data *pdata;
 	struct ieee80211_hw *hw;
 	struct wl1271 *wl;
-	int ret, i;
+	int ret, i, order;
 	static const u8 nokia_oui[3] = {0x00, 0x1f, 0xdf};
 
 	pdata = spi->dev.platform_data;
@@ -1257,6 +1257,14 @@ static int __devinit wl1271_probe(struct spi_device *spi)
 		goto out_free;
 	}
 
+	order = get_order(WL1271_AGGR_BUFFER_SIZE);
+	wl->aggr_buf = (u8 *)__get_free_pages(GFP_KERNEL, order);
+	if (!wl->aggr_buf) {
+		wl1271_error("could not allocate aggregation buffer");
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
 	/* This is the only SPI value that we need to set here, the rest
 	 * comes from the board-peripherals file */
 	spi->bits_per_word = 32;
@@ -1319,6 +1327,8 @@ static int __devinit wl1271_probe(struct spi_device *spi)
 	free_irq(wl->irq, wl);
 
  out_free:
+	free_pages((unsigned long)wl->aggr_buf,
+		   get_order(WL1271_AGGR_BUFFER_SIZE));
 	kfree(wl->rx_descriptor);
 	wl->rx_descriptor = NULL;
 
@@ -1345,6 +1355,9 @@ static int __devexit wl1271_remove(struct spi_device *spi)
 	kfree(wl->rx_descriptor);
 	wl->rx_descriptor = NULL;
 
+	free_pages((unsigned long)wl->aggr_buf,
+		   get_order(WL1271_AGGR_BUFFER_SIZE));
+
 	kfree(wl->fw_status);
 	kfree(wl->tx_res_if);
 
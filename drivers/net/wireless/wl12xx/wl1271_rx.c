@@ -122,7 +122,7 @@ static void wl1271_rx_status(struct wl1271 *wl,
 		wl1271_warning("unsupported rate");
 }
 
-static void wl1271_rx_handle_data(struct wl1271 *wl, u32 length)
+static void wl1271_rx_handle_data(struct wl1271 *wl, u8 *data, u32 length)
 {
 	struct ieee80211_rx_status rx_status;
 	struct wl1271_rx_descriptor *desc;
@@ -138,7 +138,7 @@ static void wl1271_rx_handle_data(struct wl1271 *wl, u32 length)
 	}
 
 	buf = skb_put(skb, length);
-	wl1271_spi_reg_read(wl, WL1271_SLV_MEM_DATA, buf, length, true);
+	memcpy(buf, data, length);
 
 	/* the data read starts with the descriptor */
 	desc = (struct wl1271_rx_descriptor *) buf;
@@ -162,34 +162,69 @@ static void wl1271_rx_handle_data(struct wl1271 *wl, u32 length)
 void wl1271_rx(struct wl1271 *wl, struct wl1271_fw_status *status)
 {
 	struct wl1271_acx_mem_map *wl_mem_map = wl->target_mem_map;
-	u32 buf_size;
+	u32 buf_size, pkt_size, pkt_offset;
 	u32 fw_rx_counter  = status->fw_rx_counter & NUM_RX_PKT_DESC_MOD_MASK;
 	u32 drv_rx_counter = wl->rx_counter & NUM_RX_PKT_DESC_MOD_MASK;
+	u32 rx_counter;
 	u32 mem_block;
+	int nr_pkts;
 
 	while (drv_rx_counter != fw_rx_counter) {
-		mem_block = wl1271_rx_get_mem_block(status, drv_rx_counter);
-		buf_size = wl1271_rx_get_buf_size(status, drv_rx_counter);
+		/* take as many pending frames as the buffer can hold */
+		buf_size = 0;
+		nr_pkts = 0;
+		rx_counter = drv_rx_counter;
+		while (rx_counter != fw_rx_counter) {
+			pkt_size = wl1271_rx_get_buf_size(status, rx_counter);
+			if (pkt_size == 0 ||
+			    buf_size + pkt_size > WL1271_AGGR_BUFFER_SIZE)
+				break;
+			buf_size += pkt_size;
+			nr_pkts++;
+			rx_counter = (rx_counter + 1) &
+				NUM_RX_PKT_DESC_MOD_MASK;
+		}
 
 		if (buf_size == 0) {
 			wl1271_warning("received empty data");
 			break;
 		}
 
+		mem_block = wl1271_rx_get_mem_block(status, drv_rx_counter);
+
 		wl->rx_mem_pool_addr.addr =
 			(mem_block << 8) + wl_mem_map->packet_memory_pool_start;
 		wl->rx_mem_pool_addr.addr_extra =
 			wl->rx_mem_pool_addr.addr + 4;
 
-		/* Choose the block we want to read */
+		/*
+		 * Choose the block of the first frame: the firmware hands
+		 * out the following ones in order through the same port,
+		 * so they are all read in one transaction.
+		 */
 		wl1271_spi_reg_write(wl, WL1271_SLV_REG_DATA,
 				     &wl->rx_mem_pool_addr,
 				     sizeof(wl->rx_mem_pool_addr), false);
 
-		wl1271_rx_handle_data(wl, buf_size);
+		wl1271_spi_reg_read(wl, WL1271_SLV_MEM_DATA, wl->aggr_buf,
+				    buf_size, true);
 
-		wl->rx_counter++;
-		drv_rx_counter = wl->rx_counter & NUM_RX_PKT_DESC_MOD_MASK;
+		wl1271_debug(DEBUG_RX, "rx %d frames, %u B", nr_pkts,
+			     buf_size);
+
+		/* split the data into frames */
+		pkt_offset = 0;
+		while (nr_pkts--) {
+			pkt_size = wl1271_rx_get_buf_size(status,
+							  drv_rx_counter);
+			wl1271_rx_handle_data(wl, wl->aggr_buf + pkt_offset,
+					      pkt_size);
+			pkt_offset += pkt_size;
+
+			wl->rx_counter++;
+			drv_rx_counter = wl->rx_counter &
+				NUM_RX_PKT_DESC_MOD_MASK;
+		}
 	}
 
 	wl1271_reg_write32(wl, RX_DRIVER_COUNTER_ADDRESS, wl->rx_counter);
@@ -247,77 +247,114 @@ int wl1271_set_partition(struct wl1271 *wl,
 void wl1271_spi_read(struct wl1271 *wl, int addr, void *buf,
 		     size_t len, bool fixed)
 {
-	struct spi_transfer t[3];
+	struct spi_transfer t[3 * WSPI_MAX_NUM_OF_CHUNKS];
 	struct spi_message m;
-	u8 *busy_buf;
+	size_t chunk_len, left = len;
+	u8 *busy_buf, *data = buf;
 	u32 *cmd;
+	int i = 0;
 
-	cmd = &wl->buffer_cmd;
-	busy_buf = wl->buffer_busyword;
-
-	*cmd = 0;
-	*cmd |= WSPI_CMD_READ;
-	*cmd |= (len << WSPI_CMD_BYTE_LENGTH_OFFSET) & WSPI_CMD_BYTE_LENGTH;
-	*cmd |= addr & WSPI_CMD_BYTE_ADDR;
+	if (WARN_ON(len > WSPI_MAX_NUM_OF_CHUNKS * WSPI_MAX_CHUNK_SIZE))
+		return;
 
-	if (fixed)
-		*cmd |= WSPI_CMD_FIXED;
+	cmd = wl->buffer_cmd;
+	busy_buf = wl->buffer_busyword;
 
 	spi_message_init(&m);
 	memset(t, 0, sizeof(t));
 
-	t[0].tx_buf = cmd;
-	t[0].len = 4;
-	spi_message_add_tail(&t[0], &m);
-
-	/* Busy and non busy words read */
-	t[1].rx_buf = busy_buf;
-	t[1].len = WL1271_BUSY_WORD_LEN;
-	spi_message_add_tail(&t[1], &m);
-
-	t[2].rx_buf = buf;
-	t[2].len = len;
-	spi_message_add_tail(&t[2], &m);
+	while (left > 0) {
+		chunk_len = min_t(size_t, WSPI_MAX_CHUNK_SIZE, left);
+
+		*cmd = 0;
+		*cmd |= WSPI_CMD_READ;
+		*cmd |= (chunk_len << WSPI_CMD_BYTE_LENGTH_OFFSET) &
+			WSPI_CMD_BYTE_LENGTH;
+		*cmd |= addr & WSPI_CMD_BYTE_ADDR;
+
+		if (fixed)
+			*cmd |= WSPI_CMD_FIXED;
+
+		t[i].tx_buf = cmd;
+		t[i].len = 4;
+		spi_message_add_tail(&t[i++], &m);
+
+		/* Busy and non busy words read */
+		t[i].rx_buf = busy_buf;
+		t[i].len = WL1271_BUSY_WORD_LEN;
+		spi_message_add_tail(&t[i++], &m);
+
+		t[i].rx_buf = data;
+		t[i].len = chunk_len;
+		left -= chunk_len;
+		/* each chunk is a command of its own */
+		t[i].cs_change = left > 0;
+		spi_message_add_tail(&t[i++], &m);
+
+		if (!fixed)
+			addr += chunk_len;
+		data += chunk_len;
+		cmd++;
+	}
 
 	spi_sync(wl->spi, &m);
 
 	/* FIXME: check busy words */
 
-	wl1271_dump(DEBUG_SPI, "spi_read cmd -> ", cmd, sizeof(*cmd));
+	wl1271_dump(DEBUG_SPI, "spi_read cmd -> ", wl->buffer_cmd,
+		    sizeof(*cmd));
 	wl1271_dump(DEBUG_SPI, "spi_read buf <- ", buf, len);
 }
 
 void wl1271_spi_write(struct wl1271 *wl, int addr, void *buf,
 		      size_t len, bool fixed)
 {
-	struct spi_transfer t[2];
+	struct spi_transfer t[2 * WSPI_MAX_NUM_OF_CHUNKS];
 	struct spi_message m;
+	size_t chunk_len, left = len;
+	u8 *data = buf;
 	u32 *cmd;
+	int i = 0;
 
-	cmd = &wl->buffer_cmd;
-
-	*cmd = 0;
-	*cmd |= WSPI_CMD_WRITE;
-	*cmd |= (len << WSPI_CMD_BYTE_LENGTH_OFFSET) & WSPI_CMD_BYTE_LENGTH;
-	*cmd |= addr & WSPI_CMD_BYTE_ADDR;
+	if (WARN_ON(len > WSPI_MAX_NUM_OF_CHUNKS * WSPI_MAX_CHUNK_SIZE))
+		return;
 
-	if (fixed)
-		*cmd |= WSPI_CMD_FIXED;
+	cmd = wl->buffer_cmd;
 
 	spi_message_init(&m);
 	memset(t, 0, sizeof(t));
 
-	t[0].tx_buf = cmd;
-	t[0].len = sizeof(*cmd);
-	spi_message_add_tail(&t[0], &m);
+	while (left > 0) {
+		chunk_len = min_t(size_t, WSPI_MAX_CHUNK_SIZE, left);
+
+		*cmd = 0;
+		*cmd |= WSPI_CMD_WRITE;
+		*cmd |= (chunk_len << WSPI_CMD_BYTE_LENGTH_OFFSET) &
+			WSPI_CMD_BYTE_LENGTH;
+		*cmd |= addr & WSPI_CMD_BYTE_ADDR;
 
-	t[1].tx_buf = buf;
-	t[1].len = len;
-	spi_message_add_tail(&t[1], &m);
+		if (fixed)
+			*cmd |= WSPI_CMD_FIXED;
+
+		t[i].tx_buf = cmd;
+		t[i].len = sizeof(*cmd);
+		spi_message_add_tail(&t[i++], &m);
+
+		t[i].tx_buf = data;
+		t[i].len = chunk_len;
+		spi_message_add_tail(&t[i++], &m);
+
+		if (!fixed)
+			addr += chunk_len;
+		data += chunk_len;
+		left -= chunk_len;
+		cmd++;
+	}
 
 	spi_sync(wl->spi, &m);
 
-	wl1271_dump(DEBUG_SPI, "spi_write cmd -> ", cmd, sizeof(*cmd));
+	wl1271_dump(DEBUG_SPI, "spi_write cmd -> ", wl->buffer_cmd,
+		    sizeof(*cmd));
 	wl1271_dump(DEBUG_SPI, "spi_write buf -> ", buf, len);
 }
 
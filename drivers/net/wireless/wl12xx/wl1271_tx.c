@@ -43,13 +43,18 @@ static int wl1271_tx_id(struct wl1271 *wl, struct sk_buff *skb)
 	return -EBUSY;
 }
 
-static int wl1271_tx_allocate(struct wl1271 *wl, struct sk_buff *skb, u32 extra)
+static int wl1271_tx_allocate(struct wl1271 *wl, struct sk_buff *skb, u32 extra,
+			      u32 buf_offset)
 {
 	struct wl1271_tx_hw_descr *desc;
 	u32 total_len = skb->len + sizeof(struct wl1271_tx_hw_descr) + extra;
 	u32 total_blocks, excluded;
 	int id, ret = -EBUSY;
 
+	/* no room left in the aggregation buffer, send it first */
+	if (buf_offset + WL1271_TX_ALIGN(total_len) > WL1271_AGGR_BUFFER_SIZE)
+		return -EAGAIN;
+
 	/* allocate free identifier for the packet */
 	id = wl1271_tx_id(wl, skb);
 	if (id < 0)
@@ -116,52 +121,49 @@ static int wl1271_tx_fill_hdr(struct wl1271 *wl, struct sk_buff *skb,
 	return 0;
 }
 
-static int wl1271_tx_send_packet(struct wl1271 *wl, struct sk_buff *skb,
-				 struct ieee80211_tx_info *control)
+/*
+ * Copy the frame, descriptor included, at @buf_offset in the aggregation
+ * buffer.  The copy also takes care of frames which are not aligned on a
+ * 4-byte boundary, as the EAPOL ones from user space.
+ */
+static int wl1271_tx_copy_packet(struct wl1271 *wl, struct sk_buff *skb,
+				 u32 buf_offset)
 {
-
 	struct wl1271_tx_hw_descr *desc;
 	int len;
 
-	/* FIXME: This is a workaround for getting non-aligned packets.
-	   This happens at least with EAPOL packets from the user space.
-	   Our DMA requires packets to be aligned on a 4-byte boundary.
-	*/
-	if (unlikely((long)skb->data & 0x03)) {
-		int offset = (4 - (long)skb->data) & 0x03;
-		wl1271_debug(DEBUG_TX, "skb offset %d", offset);
-
-		/* check whether the current skb can be used */
-		if (!skb_cloned(skb) && (skb_tailroom(skb) >= offset)) {
-			unsigned char *src = skb->data;
-
-			/* align the buffer on a 4-byte boundary */
-			skb_reserve(skb, offset);
-			memmove(skb->data, src, skb->len);
-		} else {
-			wl1271_info("No handler, fixme!");
-			return -EINVAL;
-		}
-	}
-
 	len = WL1271_TX_ALIGN(skb->len);
 
-	/* perform a fixed address block write with the packet */
-	wl1271_spi_reg_write(wl, WL1271_SLV_MEM_DATA, skb->data, len, true);
+	memcpy(wl->aggr_buf + buf_offset, skb->data, skb->len);
+	memset(wl->aggr_buf + buf_offset + skb->len, 0, len - skb->len);
 
-	/* write packet new counter into the write access register */
 	wl->tx_packets_count++;
-	wl1271_reg_write32(wl, WL1271_HOST_WR_ACCESS, wl->tx_packets_count);
 
 	desc = (struct wl1271_tx_hw_descr *) skb->data;
 	wl1271_debug(DEBUG_TX, "tx id %u skb 0x%p payload %u (%u words)",
 		     desc->id, skb, len, desc->length);
 
-	return 0;
+	return len;
 }
 
-/* caller must hold wl->mutex */
-static int wl1271_tx_frame(struct wl1271 *wl, struct sk_buff *skb)
+/* Send the @len bytes of frames in the aggregation buffer */
+static void wl1271_tx_send_packets(struct wl1271 *wl, u32 len)
+{
+	/* perform a fixed address block write with the packets */
+	wl1271_spi_reg_write(wl, WL1271_SLV_MEM_DATA, wl->aggr_buf, len, true);
+
+	/* write packet new counter into the write access register */
+	wl1271_reg_write32(wl, WL1271_HOST_WR_ACCESS, wl->tx_packets_count);
+}
+
+/*
+ * Prepare the frame at @buf_offset in the aggregation buffer, return
+ * its length or -EAGAIN when the buffer must be sent first.
+ *
+ * caller must hold wl->mutex
+ */
+static int wl1271_tx_frame(struct wl1271 *wl, struct sk_buff *skb,
+			   u32 buf_offset)
 {
 	struct ieee80211_tx_info *info;
 	u32 extra = 0;
@@ -182,13 +184,17 @@ static int wl1271_tx_frame(struct wl1271 *wl, struct sk_buff *skb)
 
 		/* FIXME: do we have to do this if we're not using WEP? */
 		if (unlikely(wl->default_key != idx)) {
+			/* the frames already aggregated use the old key */
+			if (buf_offset)
+				return -EAGAIN;
+
 			ret = wl1271_cmd_set_default_wep_key(wl, idx);
 			if (ret < 0)
 				return ret;
 		}
 	}
 
-	ret = wl1271_tx_allocate(wl, skb, extra);
+	ret = wl1271_tx_allocate(wl, skb, extra, buf_offset);
 	if (ret < 0)
 		return ret;
 
@@ -196,11 +202,7 @@ static int wl1271_tx_frame(struct wl1271 *wl, struct sk_buff *skb)
 	if (ret < 0)
 		return ret;
 
-	ret = wl1271_tx_send_packet(wl, skb, info);
-	if (ret < 0)
-		return ret;
-
-	return ret;
+	return wl1271_tx_copy_packet(wl, skb, buf_offset);
 }
 
 void wl1271_tx_work(struct work_struct *work)
@@ -208,6 +210,7 @@ void wl1271_tx_work(struct work_struct *work)
 	struct wl1271 *wl = container_of(work, struct wl1271, tx_work);
 	struct sk_buff *skb;
 	bool woken_up = false;
+	u32 buf_offset = 0;
 	int ret;
 
 	mutex_lock(&wl->mutex);
@@ -223,18 +226,24 @@ void wl1271_tx_work(struct work_struct *work)
 			woken_up = true;
 		}
 
-		ret = wl1271_tx_frame(wl, skb);
-		if (ret == -EBUSY) {
+		ret = wl1271_tx_frame(wl, skb, buf_offset);
+		if (ret == -EAGAIN) {
+			/* aggregation buffer is full, send it and go on */
+			skb_queue_head(&wl->tx_queue, skb);
+			wl1271_tx_send_packets(wl, buf_offset);
+			buf_offset = 0;
+			continue;
+		} else if (ret == -EBUSY) {
 			/* firmware buffer is full, stop queues */
 			wl1271_debug(DEBUG_TX, "tx_work: fw buffer full, "
 				     "stop queues");
 			ieee80211_stop_queues(wl->hw);
 			wl->tx_queue_stopped = true;
 			skb_queue_head(&wl->tx_queue, skb);
-			goto out;
+			goto out_send;
 		} else if (ret < 0) {
 			dev_kfree_skb(skb);
-			goto out;
+			goto out_send;
 		} else if (wl->tx_queue_stopped) {
 			/* firmware buffer has space, restart queues */
 			wl1271_debug(DEBUG_TX,
@@ -242,8 +251,14 @@ void wl1271_tx_work(struct work_struct *work)
 			ieee80211_wake_queues(wl->hw);
 			wl->tx_queue_stopped = false;
 		}
+
+		buf_offset += ret;
 	}
 
+out_send:
+	if (buf_offset)
+		wl1271_tx_send_packets(wl, buf_offset);
+
 out:
 	if (woken_up)
 		wl1271_ps_elp_sleep(wl);
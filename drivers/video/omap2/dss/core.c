@@ -410,6 +410,10 @@ static int dss_initialize_debugfs(void)
 #ifdef CONFIG_OMAP2_DSS_VENC
 	debugfs_create_file("venc", S_IRUGO, dss_debugfs_dir,
 			&venc_dump_regs, &dss_debug_fops);
+#endif
+#ifdef CONFIG_OMAP2_DSS_FRAME_STATS
+	debugfs_create_file("frame_stats", S_IRUGO | S_IWUSR, dss_debugfs_dir,
+			NULL, &dss_frame_stats_fops);
 #endif
 	return 0;
 }
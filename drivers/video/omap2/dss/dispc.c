@@ -144,6 +144,19 @@ struct omap_dispc_isr_data {
 #define REG_FLD_MOD(idx, val, start, end)				\
 	dispc_write_reg(idx, FLD_MOD(dispc_read_reg(idx), val, start, end))
 
+/* FIR coefficient registers as last written for a video plane, and the
+ * scaling parameters they were computed for */
+struct dispc_fir_coef {
+	bool valid;
+	u16 orig_width, out_width;
+	u16 orig_height, out_height;
+	bool five_taps;
+	bool dmaoptenabled;
+	u32 h[8];
+	u32 hv[8];
+	u32 v[8];
+};
+
 static const struct dispc_reg dispc_reg_att[] = { DISPC_GFX_ATTRIBUTES,
 	DISPC_VID_ATTRIBUTES(0),
 	DISPC_VID_ATTRIBUTES(1) };
@@ -159,6 +172,14 @@ static struct {
 	u32 error_irqs;
 	struct work_struct error_work;
 
+	/* BA0/BA1 offsets from the last full setup of each plane, so that
+	 * a flip only needs to rewrite the base addresses */
+	unsigned ba_offset0[3];
+	unsigned ba_offset1[3];
+
+	/* FIR coefficients last written to VID1 and VID2 */
+	struct dispc_fir_coef fir_coef[2];
+
 	u32		ctx[DISPC_SZ_REGS / sizeof(u32)];
 } dispc;
 
@@ -550,10 +571,11 @@ static void _dispc_set_scale_coef(enum omap_plane plane,
 			int five_taps, bool dmaoptenabled)
 {
 	unsigned long reg, mval, rem_ratio;
-	short int vc_3tap[3][8];
-	short int vc[5][8];
-	short int hc[5][8];
+	short int vc_3tap[3][8] = { { 0 } };
+	short int vc[5][8] = { { 0 } };
+	short int hc[5][8] = { { 0 } };
 	int i = 0;
+	struct dispc_fir_coef *fc;
 
 	/* 3-taps vertical filter coefficients */
 	/* Downscaling matrix, if image width > 1024 */
@@ -679,6 +701,20 @@ static void _dispc_set_scale_coef(enum omap_plane plane,
 		{34,	31,	27,	24,	45,	42,	39,	37},
 		{7,	4,	1,	-1,	21,	17,	14,	10} };
 
+	BUG_ON(plane == OMAP_DSS_GFX);
+
+	fc = &dispc.fir_coef[plane - 1];
+
+	/* Same scaling as last time, the registers already hold the
+	 * right coefficients */
+	if (fc->valid && fc->orig_width == orig_width &&
+			fc->out_width == out_width &&
+			fc->orig_height == orig_height &&
+			fc->out_height == out_height &&
+			fc->five_taps == !!five_taps &&
+			fc->dmaoptenabled == dmaoptenabled)
+		return;
+
 	/* Select the coefficients based on the ratio - height/vertical */
 	if (out_height != 0 && five_taps) {
 		if (out_height != orig_height) {
@@ -854,7 +890,9 @@ static void _dispc_set_scale_coef(enum omap_plane plane,
 		}
 	}
 
-	/* Pack the coefficients - use fivetaps for all ratios */
+	/* Pack the coefficients - use fivetaps for all ratios. Different
+	 * sizes often map to the same table, so only the registers whose
+	 * value actually changes are written */
 	for (i = 0; i < 8; i++) {
 		reg = 0;
 		DSSDBG("Phase i = %d \n", (int)i);
@@ -862,7 +900,10 @@ static void _dispc_set_scale_coef(enum omap_plane plane,
 			| ((hc[2][i] & 0xff) << 16)
 			| ((hc[3][i] & 0xff) << 8)
 			| (hc[4][i] & 0xff);
-		_dispc_write_firh_reg(plane, i, reg);
+		if (!fc->valid || fc->h[i] != reg) {
+			_dispc_write_firh_reg(plane, i, reg);
+			fc->h[i] = reg;
+		}
 		DSSDBG("H coefficients = 0x%x\n", (int)reg);
 
 		if (!five_taps) {
@@ -871,7 +912,10 @@ static void _dispc_set_scale_coef(enum omap_plane plane,
 				| ((vc_3tap[2][i] & 0xff) << 8)
 				| ((vc_3tap[1][i] & 0xff) << 16)
 				| ((vc_3tap[0][i] & 0xff) << 24);
-			_dispc_write_firhv_reg(plane, i, reg);
+			if (!fc->valid || fc->hv[i] != reg) {
+				_dispc_write_firhv_reg(plane, i, reg);
+				fc->hv[i] = reg;
+			}
 			DSSDBG("HV coefficients = 0x%x\n", (int)reg);
 
 		} else {
@@ -880,15 +924,31 @@ static void _dispc_set_scale_coef(enum omap_plane plane,
 				| ((vc[3][i] & 0xff) << 8)
 				| ((vc[2][i] & 0xff) << 16)
 				| ((vc[1][i] & 0xff) << 24);
-			_dispc_write_firhv_reg(plane, i, reg);
+			if (!fc->valid || fc->hv[i] != reg) {
+				_dispc_write_firhv_reg(plane, i, reg);
+				fc->hv[i] = reg;
+			}
 			DSSDBG("HV coefficients = 0x%x\n", (int)reg);
 
 			reg = 0;
 			reg =  ((vc[0][i] & 0xff) << 8) | (vc[4][i] & 0xff);
-			_dispc_write_firv_reg(plane, i, reg);
+			/* the V registers are not written in 3-tap mode, so
+			 * they are only trusted after a previous 5-tap setup */
+			if (!fc->valid || !fc->five_taps || fc->v[i] != reg) {
+				_dispc_write_firv_reg(plane, i, reg);
+				fc->v[i] = reg;
+			}
 			DSSDBG("V coefficients = 0x%x\n", (int)reg);
 		}
 	}
+
+	fc->orig_width = orig_width;
+	fc->out_width = out_width;
+	fc->orig_height = orig_height;
+	fc->out_height = out_height;
+	fc->five_taps = !!five_taps;
+	fc->dmaoptenabled = dmaoptenabled;
+	fc->valid = true;
 }
 
 static void _dispc_setup_color_conv_coef(void)
@@ -1897,6 +1957,8 @@ static int _dispc_setup_plane(enum omap_plane plane,
 
 	_dispc_set_plane_ba0(plane, paddr + offset0);
 	_dispc_set_plane_ba1(plane, paddr + offset1);
+	dispc.ba_offset0[plane] = offset0;
+	dispc.ba_offset1[plane] = offset1;
 
 	_dispc_set_row_inc(plane, row_inc);
 	_dispc_set_pix_inc(plane, pix_inc);
@@ -3332,3 +3394,17 @@ int dispc_setup_plane(enum omap_plane plane,
 
 	return r;
 }
+
+/* Change only the buffer address of a plane. Everything else, including
+ * the rotation offsets, is kept from the last dispc_setup_plane() */
+void dispc_set_plane_paddr(enum omap_plane plane, u32 paddr)
+{
+	DSSDBG("dispc_set_plane_paddr %d, pa %x\n", plane, paddr);
+
+	enable_clocks(1);
+
+	_dispc_set_plane_ba0(plane, paddr + dispc.ba_offset0[plane]);
+	_dispc_set_plane_ba1(plane, paddr + dispc.ba_offset1[plane]);
+
+	enable_clocks(0);
+}
@@ -192,6 +192,9 @@ int dss_mgr_wait_for_go_ovl(struct omap_overlay *ovl);
 void dss_setup_partial_planes(struct omap_dss_device *dssdev,
 				u16 *x, u16 *y, u16 *w, u16 *h);
 void dss_start_update(struct omap_dss_device *dssdev);
+#ifdef CONFIG_OMAP2_DSS_FRAME_STATS
+extern const struct file_operations dss_frame_stats_fops;
+#endif
 
 /* overlay */
 void dss_init_overlays(struct platform_device *pdev);
@@ -308,6 +311,7 @@ int dispc_setup_plane(enum omap_plane plane,
 		      enum omap_dss_rotation_type rotation_type,
 		      u8 rotation, bool mirror,
 		      u8 global_alpha);
+void dispc_set_plane_paddr(enum omap_plane plane, u32 paddr);
 
 bool dispc_go_busy(enum omap_channel channel);
 void dispc_go(enum omap_channel channel);
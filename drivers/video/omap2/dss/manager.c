@@ -27,6 +27,10 @@
 #include <linux/platform_device.h>
 #include <linux/spinlock.h>
 #include <linux/jiffies.h>
+#include <linux/hrtimer.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/fs.h>
 
 #include <plat/display.h>
 #include <plat/cpu.h>
@@ -378,14 +382,26 @@ static struct kobj_type manager_ktype = {
  * +--------------------+
  */
 
+/* overlay_cache_data.dirty bits, telling which registers to rewrite */
+#define OVL_DIRTY_PADDR		(1 << 0)	/* buffer address only */
+#define OVL_DIRTY_SETUP		(1 << 1)	/* all of dispc_setup_plane() */
+#define OVL_DIRTY_FIFO		(1 << 2)	/* burst size, fifo thresholds */
+#define OVL_DIRTY_ENABLE	(1 << 3)	/* plane enable bit */
+#define OVL_DIRTY_ALL		(OVL_DIRTY_SETUP | OVL_DIRTY_FIFO | \
+				 OVL_DIRTY_ENABLE)
+
 struct overlay_cache_data {
-	/* If true, cache changed, but not written to shadow registers. Set
-	 * in apply(), cleared when registers written. */
-	bool dirty;
+	/* OVL_DIRTY_* bits for cache fields changed, but not written to
+	 * shadow registers. Set in apply(), cleared when registers
+	 * written. */
+	u32 dirty;
 	/* If true, shadow registers contain changed values not yet in real
 	 * registers. Set when writing to shadow registers, cleared at
 	 * VSYNC/EVSYNC */
 	bool shadow_dirty;
+	/* If true, configure had to turn the plane off although it is
+	 * enabled in the cache, so the next write must be a full one */
+	bool plane_off;
 
 	bool enabled;
 
@@ -449,6 +465,219 @@ static struct {
 	bool irq_enabled;
 } dss_cache;
 
+/*
+ * Frame timing. Each manager records when an apply started, when its GO
+ * bit was set, when the GO bit was latched at VSYNC/EVSYNC and when the
+ * waiter in dss_mgr_wait_for_go() was released. The events are always
+ * emitted as markers; with CONFIG_OMAP2_DSS_FRAME_STATS the latencies
+ * are also collected into log2 histograms shown in debugfs.
+ */
+#ifdef CONFIG_OMAP2_DSS_FRAME_STATS
+#define DSS_HIST_BUCKETS	16
+
+/* bucket 0 counts values below 1 us, bucket n values in [2^(n-1), 2^n) us,
+ * the last bucket everything above */
+struct dss_latency_hist {
+	u32 count[DSS_HIST_BUCKETS];
+	u32 samples;
+	u32 max_us;
+	u64 total_us;
+};
+
+struct dss_frame_stats {
+	ktime_t apply_time;
+	ktime_t go_time;
+	bool go_pending;
+
+	u32 frames;		/* GO bits latched */
+	u32 missed;		/* VSYNCs that passed with GO still set */
+
+	struct dss_latency_hist apply_to_go;
+	struct dss_latency_hist go_to_vsync;
+	struct dss_latency_hist apply_to_release;
+};
+
+static struct dss_fstats {
+	struct dss_frame_stats mgr[2];
+	struct dss_latency_hist irq;
+} dss_fstats;
+
+static void dss_hist_add(struct dss_latency_hist *h, ktime_t start,
+		ktime_t end)
+{
+	u32 us = (u32)ktime_to_us(ktime_sub(end, start));
+	int b;
+
+	b = fls(us);
+	if (b >= DSS_HIST_BUCKETS)
+		b = DSS_HIST_BUCKETS - 1;
+
+	h->count[b]++;
+	h->samples++;
+	h->total_us += us;
+	if (us > h->max_us)
+		h->max_us = us;
+}
+
+/* called with dss_cache.lock held */
+static void dss_fstats_apply(enum omap_channel channel, ktime_t now)
+{
+	dss_fstats.mgr[channel].apply_time = now;
+}
+
+static void dss_fstats_go(enum omap_channel channel)
+{
+	struct dss_frame_stats *fs = &dss_fstats.mgr[channel];
+
+	fs->go_time = ktime_get();
+	fs->go_pending = true;
+
+	if (fs->apply_time.tv64)
+		dss_hist_add(&fs->apply_to_go, fs->apply_time, fs->go_time);
+}
+
+static void dss_fstats_vsync(enum omap_channel channel, bool busy,
+		ktime_t now)
+{
+	struct dss_frame_stats *fs = &dss_fstats.mgr[channel];
+
+	if (!fs->go_pending)
+		return;
+
+	if (busy) {
+		fs->missed++;
+		return;
+	}
+
+	fs->go_pending = false;
+	fs->frames++;
+	dss_hist_add(&fs->go_to_vsync, fs->go_time, now);
+}
+
+static void dss_fstats_release(enum omap_channel channel, ktime_t now)
+{
+	struct dss_frame_stats *fs = &dss_fstats.mgr[channel];
+
+	/* one sample per apply, however many waits find the cache clean */
+	if (fs->apply_time.tv64) {
+		dss_hist_add(&fs->apply_to_release, fs->apply_time, now);
+		fs->apply_time.tv64 = 0;
+	}
+}
+
+static void dss_fstats_irq(ktime_t start, ktime_t end)
+{
+	dss_hist_add(&dss_fstats.irq, start, end);
+}
+
+static void dss_hist_print(struct seq_file *s, const char *name,
+		struct dss_latency_hist *h)
+{
+	int i;
+
+	seq_printf(s, "  %s: samples %u avg %llu us max %u us\n", name,
+			h->samples,
+			h->samples ? div_u64(h->total_us, h->samples) : 0,
+			h->max_us);
+
+	for (i = 0; i < DSS_HIST_BUCKETS; ++i) {
+		if (!h->count[i])
+			continue;
+
+		if (i == 0)
+			seq_printf(s, "    %8s %6s us: %u\n", "",
+					"<1", h->count[i]);
+		else if (i == DSS_HIST_BUCKETS - 1)
+			seq_printf(s, "    %8s %6u us: %u\n", ">=",
+					1 << (i - 1), h->count[i]);
+		else
+			seq_printf(s, "    %6u - %6u us: %u\n",
+					1 << (i - 1), (1 << i) - 1,
+					h->count[i]);
+	}
+}
+
+static int dss_frame_stats_show(struct seq_file *s, void *unused)
+{
+	static const char * const mgr_names[] = { "lcd", "tv" };
+	unsigned long flags;
+	struct dss_fstats *snap;
+	int i;
+
+	snap = kmalloc(sizeof(*snap), GFP_KERNEL);
+	if (!snap)
+		return -ENOMEM;
+
+	spin_lock_irqsave(&dss_cache.lock, flags);
+	memcpy(snap, &dss_fstats, sizeof(*snap));
+	spin_unlock_irqrestore(&dss_cache.lock, flags);
+
+	for (i = 0; i < ARRAY_SIZE(snap->mgr); ++i) {
+		struct dss_frame_stats *fs = &snap->mgr[i];
+
+		seq_printf(s, "%s: frames %u missed vsyncs %u\n",
+				mgr_names[i], fs->frames, fs->missed);
+		dss_hist_print(s, "apply->go", &fs->apply_to_go);
+		dss_hist_print(s, "go->vsync", &fs->go_to_vsync);
+		dss_hist_print(s, "apply->release", &fs->apply_to_release);
+	}
+
+	seq_printf(s, "irq handler:\n");
+	dss_hist_print(s, "duration", &snap->irq);
+
+	kfree(snap);
+
+	return 0;
+}
+
+static int dss_frame_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dss_frame_stats_show, NULL);
+}
+
+/* any write resets the statistics */
+static ssize_t dss_frame_stats_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dss_cache.lock, flags);
+	memset(&dss_fstats, 0, sizeof(dss_fstats));
+	spin_unlock_irqrestore(&dss_cache.lock, flags);
+
+	return count;
+}
+
+const struct file_operations dss_frame_stats_fops = {
+	.open           = dss_frame_stats_open,
+	.read           = seq_read,
+	.write          = dss_frame_stats_write,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+#else
+static inline void dss_fstats_apply(enum omap_channel channel, ktime_t now)
+{
+}
+
+static inline void dss_fstats_go(enum omap_channel channel)
+{
+}
+
+static inline void dss_fstats_vsync(enum omap_channel channel, bool busy,
+		ktime_t now)
+{
+}
+
+static inline void dss_fstats_release(enum omap_channel channel, ktime_t now)
+{
+}
+
+static inline void dss_fstats_irq(ktime_t start, ktime_t end)
+{
+}
+#endif /* CONFIG_OMAP2_DSS_FRAME_STATS */
+
 
 
 static int omap_dss_set_device(struct omap_overlay_manager *mgr,
@@ -539,9 +768,12 @@ static int dss_mgr_wait_for_go(struct omap_overlay_manager *mgr)
 		spin_lock_irqsave(&dss_cache.lock, flags);
 		dirty = mc->dirty;
 		shadow_dirty = mc->shadow_dirty;
+		if (!dirty && !shadow_dirty)
+			dss_fstats_release(mgr->id, ktime_get());
 		spin_unlock_irqrestore(&dss_cache.lock, flags);
 
 		if (!dirty && !shadow_dirty) {
+			trace_mark(omapdss, mgr_release, "mgr %d", mgr->id);
 			r = 0;
 			break;
 		}
@@ -702,6 +934,7 @@ static int configure_overlay(enum omap_plane plane)
 	u16 outw, outh;
 	u16 x, y, w, h;
 	u32 paddr;
+	u32 dirty;
 	int r;
 
 	DSSDBGF("%d", plane);
@@ -715,6 +948,19 @@ static int configure_overlay(enum omap_plane plane)
 
 	mc = &dss_cache.manager_cache[c->channel];
 
+	dirty = c->dirty;
+
+	/* a partial update moves and clips the plane within the update
+	 * area, and a plane we had to turn off needs everything again */
+	if ((c->manual_update && mc->do_manual_update) || c->plane_off)
+		dirty = OVL_DIRTY_ALL;
+
+	if (!(dirty & OVL_DIRTY_SETUP)) {
+		if (dirty & OVL_DIRTY_PADDR)
+			dispc_set_plane_paddr(plane, c->paddr);
+		goto setup_done;
+	}
+
 	x = c->pos_x;
 	y = c->pos_y;
 	w = c->width;
@@ -729,6 +975,7 @@ static int configure_overlay(enum omap_plane plane)
 		if (!rectangle_intersects(mc->x, mc->y, mc->w, mc->h,
 					x, y, outw, outh)) {
 			dispc_enable_plane(plane, 0);
+			c->plane_off = true;
 			return 0;
 		}
 
@@ -807,15 +1054,22 @@ static int configure_overlay(enum omap_plane plane)
 		/* this shouldn't happen */
 		DSSERR("dispc_setup_plane failed for ovl %d\n", plane);
 		dispc_enable_plane(plane, 0);
+		c->plane_off = true;
 		return r;
 	}
 
 	dispc_enable_replication(plane, c->replication);
 
-	dispc_set_burst_size(plane, c->burst_size);
-	dispc_setup_plane_fifo(plane, c->fifo_low, c->fifo_high);
+setup_done:
+	if (dirty & OVL_DIRTY_FIFO) {
+		dispc_set_burst_size(plane, c->burst_size);
+		dispc_setup_plane_fifo(plane, c->fifo_low, c->fifo_high);
+	}
 
-	dispc_enable_plane(plane, 1);
+	if (dirty & OVL_DIRTY_ENABLE) {
+		dispc_enable_plane(plane, 1);
+		c->plane_off = false;
+	}
 
 	return 0;
 }
@@ -877,7 +1131,7 @@ static int configure_dispc(void)
 		if (r)
 			DSSERR("configure_overlay %d failed\n", i);
 
-		oc->dirty = false;
+		oc->dirty = 0;
 		oc->shadow_dirty = true;
 		mgr_go[oc->channel] = true;
 	}
@@ -913,8 +1167,11 @@ static int configure_dispc(void)
 		/* We don't need GO with manual update display. LCD iface will
 		 * always be turned off after frame, and new settings will be
 		 * taken in to use at next update */
-		if (!mc->manual_upd_display)
+		if (!mc->manual_upd_display) {
 			dispc_go(i);
+			dss_fstats_go(i);
+			trace_mark(omapdss, mgr_go, "mgr %d", i);
+		}
 	}
 
 	if (busy)
@@ -967,7 +1224,7 @@ void dss_setup_partial_planes(struct omap_dss_device *dssdev,
 		if (oc->channel != mgr->id)
 			continue;
 
-		oc->dirty = true;
+		oc->dirty = OVL_DIRTY_ALL;
 
 		if (!oc->enabled)
 			continue;
@@ -1069,18 +1326,34 @@ void dss_start_update(struct omap_dss_device *dssdev)
 
 static void dss_apply_irq_handler(void *data, u32 mask)
 {
+	const u32 vsync_irq[2] = { DISPC_IRQ_VSYNC,
+		DISPC_IRQ_EVSYNC_ODD | DISPC_IRQ_EVSYNC_EVEN };
 	struct manager_cache_data *mc;
 	struct overlay_cache_data *oc;
 	const int num_ovls = ARRAY_SIZE(dss_cache.overlay_cache);
 	const int num_mgrs = ARRAY_SIZE(dss_cache.manager_cache);
 	int i, r;
 	bool mgr_busy[2];
+	ktime_t start;
+
+	start = ktime_get();
 
 	mgr_busy[0] = dispc_go_busy(0);
 	mgr_busy[1] = dispc_go_busy(1);
 
 	spin_lock(&dss_cache.lock);
 
+	/* a GO bit still set at this manager's vsync means the new
+	 * settings missed the frame */
+	for (i = 0; i < num_mgrs; ++i) {
+		if (!(mask & vsync_irq[i]))
+			continue;
+
+		dss_fstats_vsync(i, mgr_busy[i], start);
+		trace_mark(omapdss, mgr_vsync, "mgr %d go_busy %d",
+				i, mgr_busy[i]);
+	}
+
 	for (i = 0; i < num_ovls; ++i) {
 		oc = &dss_cache.overlay_cache[i];
 		if (!mgr_busy[oc->channel])
@@ -1114,11 +1387,59 @@ static void dss_apply_irq_handler(void *data, u32 mask)
 	dss_cache.irq_enabled = false;
 
 end:
+	dss_fstats_irq(start, ktime_get());
 	spin_unlock(&dss_cache.lock);
 }
 
+/* Which registers have to be rewritten to go from cached state o to n */
+static u32 overlay_cache_diff(struct overlay_cache_data *o,
+		struct overlay_cache_data *n)
+{
+	u32 dirty = 0;
+
+	if (!o->enabled)
+		return OVL_DIRTY_ALL;
+
+	if (o->paddr != n->paddr)
+		dirty |= OVL_DIRTY_PADDR;
+
+	if (o->screen_width != n->screen_width ||
+			o->width != n->width ||
+			o->height != n->height ||
+			o->color_mode != n->color_mode ||
+			o->rotation != n->rotation ||
+			o->rotation_type != n->rotation_type ||
+			o->mirror != n->mirror ||
+			o->pos_x != n->pos_x ||
+			o->pos_y != n->pos_y ||
+			o->out_width != n->out_width ||
+			o->out_height != n->out_height ||
+			o->global_alpha != n->global_alpha ||
+			o->replication != n->replication ||
+			o->ilace != n->ilace)
+		dirty |= OVL_DIRTY_SETUP;
+
+	if (o->channel != n->channel ||
+			o->manual_update != n->manual_update)
+		dirty |= OVL_DIRTY_SETUP | OVL_DIRTY_ENABLE;
+
+	if (o->burst_size != n->burst_size ||
+			o->fifo_low != n->fifo_low ||
+			o->fifo_high != n->fifo_high)
+		dirty |= OVL_DIRTY_FIFO;
+
+	return dirty;
+}
+
 static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
 {
+	struct overlay_cache_data new_oc[ARRAY_SIZE(dss_cache.overlay_cache)];
+	enum {
+		OVL_SKIP = 0,	/* not a dispc overlay */
+		OVL_DISABLE,	/* turn the overlay off */
+		OVL_KEEP,	/* info unchanged, only fifo may change */
+		OVL_UPDATE,	/* new info in new_oc */
+	} ovl_op[ARRAY_SIZE(dss_cache.overlay_cache)];
 	struct overlay_cache_data *oc;
 	struct manager_cache_data *mc;
 	int i;
@@ -1126,49 +1447,89 @@ static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
 	int num_planes_enabled = 0;
 	bool use_fifomerge;
 	unsigned long flags;
+	ktime_t apply_time;
 	int r;
 
 	DSSDBG("omap_dss_mgr_apply(%s)\n", mgr->name);
 
-	spin_lock_irqsave(&dss_cache.lock, flags);
+	apply_time = ktime_get();
+	trace_mark(omapdss, mgr_apply, "mgr %d", mgr->id);
 
-	/* Configure overlays */
+	/* XXX TODO: Try to get fifomerge working. The problem is that it
+	 * affects both managers, not individually but at the same time. This
+	 * means the change has to be well synchronized. I guess the proper way
+	 * is to have a two step process for fifo merge:
+	 *        fifomerge enable:
+	 *             1. disable other planes, leaving one plane enabled
+	 *             2. wait until the planes are disabled on HW
+	 *             3. config merged fifo thresholds, enable fifomerge
+	 *        fifomerge disable:
+	 *             1. config unmerged fifo thresholds, disable fifomerge
+	 *             2. wait until fifo changes are in HW
+	 *             3. enable planes
+	 */
+	use_fifomerge = false;
+
+	memset(ovl_op, 0, sizeof(ovl_op));
+
+	/* Gather the new overlay state. This doesn't touch dss_cache, so
+	 * it is done before taking the lock */
 	for (i = 0; i < omap_dss_get_num_overlays(); ++i) {
 		struct omap_dss_device *dssdev;
+		u32 size;
 
 		ovl = omap_dss_get_overlay(i);
 
 		if (!(ovl->caps & OMAP_DSS_OVL_CAP_DISPC))
 			continue;
 
-		oc = &dss_cache.overlay_cache[ovl->id];
+		oc = &new_oc[ovl->id];
 
 		if (!overlay_enabled(ovl)) {
-			if (oc->enabled) {
-				oc->enabled = false;
-				oc->dirty = true;
-			}
+			ovl_op[ovl->id] = OVL_DISABLE;
 			continue;
 		}
 
+		dssdev = ovl->manager->device;
+
+		/* The thresholds depend on the display as well, so they are
+		 * computed even if the overlay info has not changed */
+		size = dispc_get_plane_fifo_size(ovl->id);
+		if (use_fifomerge)
+			size *= 3;
+
+		switch (dssdev->type) {
+		case OMAP_DISPLAY_TYPE_DPI:
+		case OMAP_DISPLAY_TYPE_DBI:
+		case OMAP_DISPLAY_TYPE_SDI:
+		case OMAP_DISPLAY_TYPE_VENC:
+			default_get_overlay_fifo_thresholds(ovl->id, size,
+					&oc->burst_size, &oc->fifo_low,
+					&oc->fifo_high);
+			break;
+#ifdef CONFIG_OMAP2_DSS_DSI
+		case OMAP_DISPLAY_TYPE_DSI:
+			dsi_get_overlay_fifo_thresholds(ovl->id, size,
+					&oc->burst_size, &oc->fifo_low,
+					&oc->fifo_high);
+			break;
+#endif
+		default:
+			BUG();
+		}
+
 		if (!ovl->info_dirty) {
-			if (oc->enabled)
-				++num_planes_enabled;
+			ovl_op[ovl->id] = OVL_KEEP;
 			continue;
 		}
 
-		dssdev = ovl->manager->device;
-
 		if (dss_check_overlay(ovl, dssdev)) {
-			if (oc->enabled) {
-				oc->enabled = false;
-				oc->dirty = true;
-			}
+			ovl_op[ovl->id] = OVL_DISABLE;
 			continue;
 		}
 
 		ovl->info_dirty = false;
-		oc->dirty = true;
+		ovl_op[ovl->id] = OVL_UPDATE;
 
 		oc->paddr = ovl->info.paddr;
 		oc->vaddr = ovl->info.vaddr;
@@ -1197,8 +1558,54 @@ static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
 		oc->manual_update =
 			dssdev->caps & OMAP_DSS_DISPLAY_CAP_MANUAL_UPDATE &&
 			dssdev->get_update_mode(dssdev) != OMAP_DSS_UPDATE_AUTO;
+	}
+
+	spin_lock_irqsave(&dss_cache.lock, flags);
 
-		++num_planes_enabled;
+	dss_fstats_apply(mgr->id, apply_time);
+
+	/* Configure overlays, marking only what actually changed dirty */
+	for (i = 0; i < ARRAY_SIZE(ovl_op); ++i) {
+		struct overlay_cache_data *n = &new_oc[i];
+
+		oc = &dss_cache.overlay_cache[i];
+
+		switch (ovl_op[i]) {
+		case OVL_DISABLE:
+			if (oc->enabled) {
+				oc->enabled = false;
+				oc->dirty |= OVL_DIRTY_ENABLE;
+			}
+			break;
+
+		case OVL_KEEP:
+			if (!oc->enabled)
+				break;
+
+			if (oc->burst_size != n->burst_size ||
+					oc->fifo_low != n->fifo_low ||
+					oc->fifo_high != n->fifo_high) {
+				oc->burst_size = n->burst_size;
+				oc->fifo_low = n->fifo_low;
+				oc->fifo_high = n->fifo_high;
+				oc->dirty |= OVL_DIRTY_FIFO;
+			}
+
+			++num_planes_enabled;
+			break;
+
+		case OVL_UPDATE:
+			n->dirty = oc->dirty | overlay_cache_diff(oc, n);
+			n->shadow_dirty = oc->shadow_dirty;
+			n->plane_off = oc->plane_off;
+			*oc = *n;
+
+			++num_planes_enabled;
+			break;
+
+		default:
+			break;
+		}
 	}
 
 	/* Configure managers */
@@ -1240,63 +1647,6 @@ static int omap_dss_mgr_apply(struct omap_overlay_manager *mgr)
 			dssdev->get_update_mode(dssdev) != OMAP_DSS_UPDATE_AUTO;
 	}
 
-	/* XXX TODO: Try to get fifomerge working. The problem is that it
-	 * affects both managers, not individually but at the same time. This
-	 * means the change has to be well synchronized. I guess the proper way
-	 * is to have a two step process for fifo merge:
-	 *        fifomerge enable:
-	 *             1. disable other planes, leaving one plane enabled
-	 *             2. wait until the planes are disabled on HW
-	 *             3. config merged fifo thresholds, enable fifomerge
-	 *        fifomerge disable:
-	 *             1. config unmerged fifo thresholds, disable fifomerge
-	 *             2. wait until fifo changes are in HW
-	 *             3. enable planes
-	 */
-	use_fifomerge = false;
-
-	/* Configure overlay fifos */
-	for (i = 0; i < omap_dss_get_num_overlays(); ++i) {
-		struct omap_dss_device *dssdev;
-		u32 size;
-
-		ovl = omap_dss_get_overlay(i);
-
-		if (!(ovl->caps & OMAP_DSS_OVL_CAP_DISPC))
-			continue;
-
-		oc = &dss_cache.overlay_cache[ovl->id];
-
-		if (!oc->enabled)
-			continue;
-
-		dssdev = ovl->manager->device;
-
-		size = dispc_get_plane_fifo_size(ovl->id);
-		if (use_fifomerge)
-			size *= 3;
-
-		switch (dssdev->type) {
-		case OMAP_DISPLAY_TYPE_DPI:
-		case OMAP_DISPLAY_TYPE_DBI:
-		case OMAP_DISPLAY_TYPE_SDI:
-		case OMAP_DISPLAY_TYPE_VENC:
-			default_get_overlay_fifo_thresholds(ovl->id, size,
-					&oc->burst_size, &oc->fifo_low,
-					&oc->fifo_high);
-			break;
-#ifdef CONFIG_OMAP2_DSS_DSI
-		case OMAP_DISPLAY_TYPE_DSI:
-			dsi_get_overlay_fifo_thresholds(ovl->id, size,
-					&oc->burst_size, &oc->fifo_low,
-					&oc->fifo_high);
-			break;
-#endif
-		default:
-			BUG();
-		}
-	}
-
 	r = 0;
 	dss_clk_enable(DSS_CLK_ICK | DSS_CLK_FCK1);
 	if (!dss_cache.irq_enabled) {
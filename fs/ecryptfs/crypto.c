@@ -31,22 +31,12 @@
 #include <linux/key.h>
 #include <linux/namei.h>
 #include <linux/crypto.h>
+#include <linux/completion.h>
 #include <linux/file.h>
 #include <linux/scatterlist.h>
 #include <asm/unaligned.h>
 #include "ecryptfs_kernel.h"
 
-static int
-ecryptfs_decrypt_page_offset(struct ecryptfs_crypt_stat *crypt_stat,
-			     struct page *dst_page, int dst_offset,
-			     struct page *src_page, int src_offset, int size,
-			     unsigned char *iv);
-static int
-ecryptfs_encrypt_page_offset(struct ecryptfs_crypt_stat *crypt_stat,
-			     struct page *dst_page, int dst_offset,
-			     struct page *src_page, int src_offset, int size,
-			     unsigned char *iv);
-
 /**
  * ecryptfs_to_hex
  * @dst: Buffer to take hex character representation of contents of
@@ -242,7 +232,7 @@ void ecryptfs_destroy_crypt_stat(struct ecryptfs_crypt_stat *crypt_stat)
 	struct ecryptfs_key_sig *key_sig, *key_sig_tmp;
 
 	if (crypt_stat->tfm)
-		crypto_free_blkcipher(crypt_stat->tfm);
+		crypto_free_ablkcipher(crypt_stat->tfm);
 	if (crypt_stat->hash_tfm)
 		crypto_free_hash(crypt_stat->hash_tfm);
 	list_for_each_entry_safe(key_sig, key_sig_tmp,
@@ -323,264 +313,325 @@ int virt_to_scatterlist(const void *addr, int size, struct scatterlist *sg,
 }
 
 /**
- * encrypt_scatterlist
- * @crypt_stat: Pointer to the crypt_stat struct to initialize.
- * @dest_sg: Destination of encrypted data
- * @src_sg: Data to be encrypted
- * @size: Length of data to be encrypted
- * @iv: iv to use during encryption
+ * ecryptfs_lower_offset_for_extent
  *
- * Returns the number of bytes encrypted; negative value on error
+ * Convert an eCryptfs page index into a lower byte offset
  */
-static int encrypt_scatterlist(struct ecryptfs_crypt_stat *crypt_stat,
-			       struct scatterlist *dest_sg,
-			       struct scatterlist *src_sg, int size,
-			       unsigned char *iv)
+static void ecryptfs_lower_offset_for_extent(loff_t *offset, loff_t extent_num,
+					     struct ecryptfs_crypt_stat *crypt_stat)
+{
+	(*offset) = ecryptfs_lower_header_size(crypt_stat)
+		    + (crypt_stat->extent_size * extent_num);
+}
+
+/*
+ * A set of extent requests submitted together to the (possibly
+ * asynchronous) cipher, and waited for together. One reference is
+ * held by the submitter until ecryptfs_crypt_batch_wait(), one by each
+ * request in flight.
+ */
+struct ecryptfs_crypt_batch {
+	struct ecryptfs_crypt_stat *crypt_stat;
+	int encrypt;
+	atomic_t pending;
+	struct completion completion;
+	int rc;
+};
+
+struct ecryptfs_extent_req {
+	struct ecryptfs_crypt_batch *batch;
+	struct scatterlist src_sg;
+	struct scatterlist dst_sg;
+	char iv[ECRYPTFS_MAX_IV_BYTES];
+	/* Must be last: followed by the request context of the tfm */
+	struct ablkcipher_request req;
+};
+
+/**
+ * ecryptfs_crypt_batch_init
+ * @batch: The batch to initialize
+ * @crypt_stat: The cryptographic context of the file
+ * @encrypt: Nonzero to encrypt, zero to decrypt
+ *
+ * Sets the key of the file's tfm the first time it is used.
+ *
+ * Returns zero on success; non-zero otherwise
+ */
+static int ecryptfs_crypt_batch_init(struct ecryptfs_crypt_batch *batch,
+				     struct ecryptfs_crypt_stat *crypt_stat,
+				     int encrypt)
 {
-	struct blkcipher_desc desc = {
-		.tfm = crypt_stat->tfm,
-		.info = iv,
-		.flags = CRYPTO_TFM_REQ_MAY_SLEEP
-	};
 	int rc = 0;
 
 	BUG_ON(!crypt_stat || !crypt_stat->tfm
 	       || !(crypt_stat->flags & ECRYPTFS_STRUCT_INITIALIZED));
+	batch->crypt_stat = crypt_stat;
+	batch->encrypt = encrypt;
+	atomic_set(&batch->pending, 1);
+	init_completion(&batch->completion);
+	batch->rc = 0;
 	if (unlikely(ecryptfs_verbosity > 0)) {
 		ecryptfs_printk(KERN_DEBUG, "Key size [%d]; key:\n",
 				crypt_stat->key_size);
 		ecryptfs_dump_hex(crypt_stat->key,
 				  crypt_stat->key_size);
 	}
-	/* Consider doing this once, when the file is opened */
+	/*
+	 * The key is set once, then only read by the requests in flight;
+	 * ECRYPTFS_KEY_SET is cleared whenever the file's key changes.
+	 */
 	mutex_lock(&crypt_stat->cs_tfm_mutex);
 	if (!(crypt_stat->flags & ECRYPTFS_KEY_SET)) {
-		rc = crypto_blkcipher_setkey(crypt_stat->tfm, crypt_stat->key,
-					     crypt_stat->key_size);
-		crypt_stat->flags |= ECRYPTFS_KEY_SET;
+		rc = crypto_ablkcipher_setkey(crypt_stat->tfm, crypt_stat->key,
+					      crypt_stat->key_size);
+		if (!rc)
+			crypt_stat->flags |= ECRYPTFS_KEY_SET;
 	}
+	mutex_unlock(&crypt_stat->cs_tfm_mutex);
 	if (rc) {
 		ecryptfs_printk(KERN_ERR, "Error setting key; rc = [%d]\n",
 				rc);
-		mutex_unlock(&crypt_stat->cs_tfm_mutex);
 		rc = -EINVAL;
-		goto out;
 	}
-	ecryptfs_printk(KERN_DEBUG, "Encrypting [%d] bytes.\n", size);
-	crypto_blkcipher_encrypt_iv(&desc, dest_sg, src_sg, size);
-	mutex_unlock(&crypt_stat->cs_tfm_mutex);
-out:
 	return rc;
 }
 
-/**
- * ecryptfs_lower_offset_for_extent
- *
- * Convert an eCryptfs page index into a lower byte offset
- */
-static void ecryptfs_lower_offset_for_extent(loff_t *offset, loff_t extent_num,
-					     struct ecryptfs_crypt_stat *crypt_stat)
+static void ecryptfs_extent_req_finish(struct ecryptfs_extent_req *extent_req,
+				       int rc)
 {
-	(*offset) = ecryptfs_lower_header_size(crypt_stat)
-		    + (crypt_stat->extent_size * extent_num);
+	struct ecryptfs_crypt_batch *batch = extent_req->batch;
+
+	if (rc) {
+		ecryptfs_printk(KERN_ERR, "Error %s extent; rc = [%d]\n",
+				batch->encrypt ? "encrypting" : "decrypting",
+				rc);
+		batch->rc = rc;
+	}
+	kfree(extent_req);
+	if (atomic_dec_and_test(&batch->pending))
+		complete(&batch->completion);
+}
+
+static void ecryptfs_extent_req_done(struct crypto_async_request *req, int rc)
+{
+	/* A backlogged request was queued; it completes later */
+	if (rc == -EINPROGRESS)
+		return;
+	ecryptfs_extent_req_finish(req->data, rc);
 }
 
 /**
- * ecryptfs_encrypt_extent
- * @enc_extent_page: Allocated page into which to encrypt the data in
- *                   @page
- * @crypt_stat: crypt_stat containing cryptographic context for the
- *              encryption operation
- * @page: Page containing plaintext data extent to encrypt
+ * ecryptfs_crypt_extent
+ * @batch: The batch the request belongs to
+ * @page: Page mapped from the eCryptfs inode for the file, holding the
+ *        plaintext extent
+ * @enc_extent_page: Page holding the ciphertext extent, at the same
+ *                   offset as in @page
  * @extent_offset: Page extent offset for use in generating IV
  *
- * Encrypts one extent of data.
+ * Submits the encryption of one extent of @page into @enc_extent_page,
+ * or the decryption of one extent of @enc_extent_page into @page. The
+ * request may still be in flight on return; the result is known after
+ * ecryptfs_crypt_batch_wait().
  *
- * Return zero on success; non-zero otherwise
+ * Returns zero if the request was submitted; non-zero otherwise
  */
-static int ecryptfs_encrypt_extent(struct page *enc_extent_page,
-				   struct ecryptfs_crypt_stat *crypt_stat,
-				   struct page *page,
-				   unsigned long extent_offset)
+static int ecryptfs_crypt_extent(struct ecryptfs_crypt_batch *batch,
+				 struct page *page,
+				 struct page *enc_extent_page,
+				 unsigned long extent_offset)
 {
+	struct ecryptfs_crypt_stat *crypt_stat = batch->crypt_stat;
+	struct ecryptfs_extent_req *extent_req;
+	struct ablkcipher_request *req;
+	unsigned int offset = extent_offset * crypt_stat->extent_size;
 	loff_t extent_base;
-	char extent_iv[ECRYPTFS_MAX_IV_BYTES];
 	int rc;
 
+	extent_req = kmalloc(sizeof(*extent_req)
+			     + crypto_ablkcipher_reqsize(crypt_stat->tfm),
+			     GFP_NOFS);
+	if (!extent_req) {
+		ecryptfs_printk(KERN_ERR, "Error allocating memory for "
+				"extent request\n");
+		return -ENOMEM;
+	}
 	extent_base = (((loff_t)page->index)
 		       * (PAGE_CACHE_SIZE / crypt_stat->extent_size));
-	rc = ecryptfs_derive_iv(extent_iv, crypt_stat,
+	rc = ecryptfs_derive_iv(extent_req->iv, crypt_stat,
 				(extent_base + extent_offset));
 	if (rc) {
 		ecryptfs_printk(KERN_ERR, "Error attempting to "
 				"derive IV for extent [0x%.16x]; "
 				"rc = [%d]\n", (extent_base + extent_offset),
 				rc);
-		goto out;
+		kfree(extent_req);
+		return rc;
 	}
 	if (unlikely(ecryptfs_verbosity > 0)) {
-		ecryptfs_printk(KERN_DEBUG, "Encrypting extent "
-				"with iv:\n");
-		ecryptfs_dump_hex(extent_iv, crypt_stat->iv_bytes);
-		ecryptfs_printk(KERN_DEBUG, "First 8 bytes before "
-				"encryption:\n");
-		ecryptfs_dump_hex((char *)
-				  (page_address(page)
-				   + (extent_offset * crypt_stat->extent_size)),
-				  8);
-	}
-	rc = ecryptfs_encrypt_page_offset(crypt_stat, enc_extent_page, 0,
-					  page, (extent_offset
-						 * crypt_stat->extent_size),
-					  crypt_stat->extent_size, extent_iv);
-	if (rc < 0) {
-		printk(KERN_ERR "%s: Error attempting to encrypt page with "
-		       "page->index = [%ld], extent_offset = [%ld]; "
-		       "rc = [%d]\n", __func__, page->index, extent_offset,
-		       rc);
-		goto out;
-	}
-	rc = 0;
-	if (unlikely(ecryptfs_verbosity > 0)) {
-		ecryptfs_printk(KERN_DEBUG, "Encrypt extent [0x%.16x]; "
-				"rc = [%d]\n", (extent_base + extent_offset),
-				rc);
-		ecryptfs_printk(KERN_DEBUG, "First 8 bytes after "
-				"encryption:\n");
-		ecryptfs_dump_hex((char *)(page_address(enc_extent_page)), 8);
-	}
-out:
-	return rc;
+		ecryptfs_printk(KERN_DEBUG, "%s extent [0x%.16x] with iv:\n",
+				batch->encrypt ? "Encrypting" : "Decrypting",
+				(extent_base + extent_offset));
+		ecryptfs_dump_hex(extent_req->iv, crypt_stat->iv_bytes);
+	}
+	extent_req->batch = batch;
+	sg_init_table(&extent_req->src_sg, 1);
+	sg_init_table(&extent_req->dst_sg, 1);
+	if (batch->encrypt) {
+		sg_set_page(&extent_req->src_sg, page,
+			    crypt_stat->extent_size, offset);
+		sg_set_page(&extent_req->dst_sg, enc_extent_page,
+			    crypt_stat->extent_size, offset);
+	} else {
+		sg_set_page(&extent_req->src_sg, enc_extent_page,
+			    crypt_stat->extent_size, offset);
+		sg_set_page(&extent_req->dst_sg, page,
+			    crypt_stat->extent_size, offset);
+	}
+
+	req = &extent_req->req;
+	ablkcipher_request_set_tfm(req, crypt_stat->tfm);
+	ablkcipher_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG |
+					CRYPTO_TFM_REQ_MAY_SLEEP,
+					ecryptfs_extent_req_done, extent_req);
+	ablkcipher_request_set_crypt(req, &extent_req->src_sg,
+				     &extent_req->dst_sg,
+				     crypt_stat->extent_size, extent_req->iv);
+
+	atomic_inc(&batch->pending);
+	if (batch->encrypt)
+		rc = crypto_ablkcipher_encrypt(req);
+	else
+		rc = crypto_ablkcipher_decrypt(req);
+	/* -EBUSY: backlogged, the callback runs when it is done */
+	if (rc != -EINPROGRESS && rc != -EBUSY)
+		ecryptfs_extent_req_finish(extent_req, rc);
+	return 0;
 }
 
 /**
- * ecryptfs_encrypt_page
- * @page: Page mapped from the eCryptfs inode for the file; contains
- *        decrypted content that needs to be encrypted (to a temporary
- *        page; not in place) and written out to the lower file
+ * ecryptfs_crypt_batch_wait
+ * @batch: The batch to wait for
+ *
+ * Returns zero if all the requests of @batch succeeded; non-zero
+ * otherwise
+ */
+static int ecryptfs_crypt_batch_wait(struct ecryptfs_crypt_batch *batch)
+{
+	if (!atomic_dec_and_test(&batch->pending))
+		wait_for_completion(&batch->completion);
+	return batch->rc;
+}
+
+/**
+ * ecryptfs_encrypt_pages
+ * @pages: Pages mapped from one eCryptfs inode; contain decrypted
+ *         content that needs to be encrypted (to temporary pages;
+ *         not in place) and written out to the lower file
+ * @nr_pages: Number of pages in @pages
  *
- * Encrypt an eCryptfs page. This is done on a per-extent basis. Note
- * that eCryptfs pages may straddle the lower pages -- for instance,
- * if the file was created on a machine with an 8K page size
- * (resulting in an 8K header), and then the file is copied onto a
- * host with a 32K page size, then when reading page 0 of the eCryptfs
- * file, 24K of page 0 of the lower file will be read and decrypted,
- * and then 8K of page 1 of the lower file will be read and decrypted.
+ * Encrypt eCryptfs pages. This is done on a per-extent basis, with the
+ * extents of all the pages submitted to the cipher before waiting for
+ * any of them, so that an asynchronous cipher (cryptd, a hardware
+ * engine) works on them in parallel. Note that eCryptfs pages may
+ * straddle the lower pages -- for instance, if the file was created on
+ * a machine with an 8K page size (resulting in an 8K header), and then
+ * the file is copied onto a host with a 32K page size, then when
+ * reading page 0 of the eCryptfs file, 24K of page 0 of the lower file
+ * will be read and decrypted, and then 8K of page 1 of the lower file
+ * will be read and decrypted.
  *
  * Returns zero on success; negative on error
  */
-int ecryptfs_encrypt_page(struct page *page)
+int ecryptfs_encrypt_pages(struct page **pages, int nr_pages)
 {
 	struct inode *ecryptfs_inode;
 	struct ecryptfs_crypt_stat *crypt_stat;
-	char *enc_extent_virt;
-	struct page *enc_extent_page = NULL;
-	loff_t extent_offset;
-	int rc = 0;
+	struct ecryptfs_crypt_batch batch;
+	struct page **enc_extent_pages;
+	unsigned long extent_offset;
+	unsigned long extents_per_page;
+	int i, rc, wait_rc;
 
-	ecryptfs_inode = page->mapping->host;
+	ecryptfs_inode = pages[0]->mapping->host;
 	crypt_stat =
 		&(ecryptfs_inode_to_private(ecryptfs_inode)->crypt_stat);
 	BUG_ON(!(crypt_stat->flags & ECRYPTFS_ENCRYPTED));
-	enc_extent_page = alloc_page(GFP_USER);
-	if (!enc_extent_page) {
+	extents_per_page = PAGE_CACHE_SIZE / crypt_stat->extent_size;
+	enc_extent_pages = kcalloc(nr_pages, sizeof(*enc_extent_pages),
+				   GFP_NOFS);
+	if (!enc_extent_pages) {
 		rc = -ENOMEM;
-		ecryptfs_printk(KERN_ERR, "Error allocating memory for "
-				"encrypted extent\n");
 		goto out;
 	}
-	enc_extent_virt = kmap(enc_extent_page);
-	for (extent_offset = 0;
-	     extent_offset < (PAGE_CACHE_SIZE / crypt_stat->extent_size);
-	     extent_offset++) {
+	for (i = 0; i < nr_pages; i++) {
+		enc_extent_pages[i] = alloc_page(GFP_USER);
+		if (!enc_extent_pages[i]) {
+			rc = -ENOMEM;
+			ecryptfs_printk(KERN_ERR, "Error allocating memory for "
+					"encrypted extent\n");
+			goto out_free;
+		}
+	}
+	rc = ecryptfs_crypt_batch_init(&batch, crypt_stat, 1);
+	if (rc)
+		goto out_free;
+	for (i = 0; i < nr_pages && !rc; i++)
+		for (extent_offset = 0;
+		     extent_offset < extents_per_page && !rc;
+		     extent_offset++)
+			rc = ecryptfs_crypt_extent(&batch, pages[i],
+						   enc_extent_pages[i],
+						   extent_offset);
+	wait_rc = ecryptfs_crypt_batch_wait(&batch);
+	if (!rc)
+		rc = wait_rc;
+	if (rc) {
+		printk(KERN_ERR "%s: Error encrypting extent; "
+		       "rc = [%d]\n", __func__, rc);
+		goto out_free;
+	}
+	/* The extents of a page are contiguous in the lower file */
+	for (i = 0; i < nr_pages; i++) {
 		loff_t offset;
 
-		rc = ecryptfs_encrypt_extent(enc_extent_page, crypt_stat, page,
-					     extent_offset);
-		if (rc) {
-			printk(KERN_ERR "%s: Error encrypting extent; "
-			       "rc = [%d]\n", __func__, rc);
-			goto out;
-		}
 		ecryptfs_lower_offset_for_extent(
-			&offset, ((((loff_t)page->index)
-				   * (PAGE_CACHE_SIZE
-				      / crypt_stat->extent_size))
-				  + extent_offset), crypt_stat);
-		rc = ecryptfs_write_lower(ecryptfs_inode, enc_extent_virt,
-					  offset, crypt_stat->extent_size);
+			&offset, ((loff_t)pages[i]->index * extents_per_page),
+			crypt_stat);
+		rc = ecryptfs_write_lower(ecryptfs_inode,
+					  kmap(enc_extent_pages[i]),
+					  offset, PAGE_CACHE_SIZE);
+		kunmap(enc_extent_pages[i]);
 		if (rc < 0) {
 			ecryptfs_printk(KERN_ERR, "Error attempting "
 					"to write lower page; rc = [%d]"
 					"\n", rc);
-			goto out;
+			goto out_free;
 		}
 	}
 	rc = 0;
+out_free:
+	for (i = 0; i < nr_pages; i++)
+		if (enc_extent_pages[i])
+			__free_page(enc_extent_pages[i]);
+	kfree(enc_extent_pages);
 out:
-	if (enc_extent_page) {
-		kunmap(enc_extent_page);
-		__free_page(enc_extent_page);
-	}
 	return rc;
 }
 
-static int ecryptfs_decrypt_extent(struct page *page,
-				   struct ecryptfs_crypt_stat *crypt_stat,
-				   struct page *enc_extent_page,
-				   unsigned long extent_offset)
+/**
+ * ecryptfs_encrypt_page
+ * @page: Page mapped from the eCryptfs inode for the file; contains
+ *        decrypted content that needs to be encrypted (to a temporary
+ *        page; not in place) and written out to the lower file
+ *
+ * Encrypt an eCryptfs page; see ecryptfs_encrypt_pages().
+ *
+ * Returns zero on success; negative on error
+ */
+int ecryptfs_encrypt_page(struct page *page)
 {
-	loff_t extent_base;
-	char extent_iv[ECRYPTFS_MAX_IV_BYTES];
-	int rc;
-
-	extent_base = (((loff_t)page->index)
-		       * (PAGE_CACHE_SIZE / crypt_stat->extent_size));
-	rc = ecryptfs_derive_iv(extent_iv, crypt_stat,
-				(extent_base + extent_offset));
-	if (rc) {
-		ecryptfs_printk(KERN_ERR, "Error attempting to "
-				"derive IV for extent [0x%.16x]; "
-				"rc = [%d]\n", (extent_base + extent_offset),
-				rc);
-		goto out;
-	}
-	if (unlikely(ecryptfs_verbosity > 0)) {
-		ecryptfs_printk(KERN_DEBUG, "Decrypting extent "
-				"with iv:\n");
-		ecryptfs_dump_hex(extent_iv, crypt_stat->iv_bytes);
-		ecryptfs_printk(KERN_DEBUG, "First 8 bytes before "
-				"decryption:\n");
-		ecryptfs_dump_hex((char *)
-				  (page_address(enc_extent_page)
-				   + (extent_offset * crypt_stat->extent_size)),
-				  8);
-	}
-	rc = ecryptfs_decrypt_page_offset(crypt_stat, page,
-					  (extent_offset
-					   * crypt_stat->extent_size),
-					  enc_extent_page, 0,
-					  crypt_stat->extent_size, extent_iv);
-	if (rc < 0) {
-		printk(KERN_ERR "%s: Error attempting to decrypt to page with "
-		       "page->index = [%ld], extent_offset = [%ld]; "
-		       "rc = [%d]\n", __func__, page->index, extent_offset,
-		       rc);
-		goto out;
-	}
-	rc = 0;
-	if (unlikely(ecryptfs_verbosity > 0)) {
-		ecryptfs_printk(KERN_DEBUG, "Decrypt extent [0x%.16x]; "
-				"rc = [%d]\n", (extent_base + extent_offset),
-				rc);
-		ecryptfs_printk(KERN_DEBUG, "First 8 bytes after "
-				"decryption:\n");
-		ecryptfs_dump_hex((char *)(page_address(page)
-					   + (extent_offset
-					      * crypt_stat->extent_size)), 8);
-	}
-out:
-	return rc;
+	return ecryptfs_encrypt_pages(&page, 1);
 }
 
 /**
@@ -589,13 +640,15 @@ out:
  *        and decrypted from the lower file will be written into this
  *        page
  *
- * Decrypt an eCryptfs page. This is done on a per-extent basis. Note
- * that eCryptfs pages may straddle the lower pages -- for instance,
- * if the file was created on a machine with an 8K page size
- * (resulting in an 8K header), and then the file is copied onto a
- * host with a 32K page size, then when reading page 0 of the eCryptfs
- * file, 24K of page 0 of the lower file will be read and decrypted,
- * and then 8K of page 1 of the lower file will be read and decrypted.
+ * Decrypt an eCryptfs page. The extents of the page are read from the
+ * lower file at once, then all submitted to the cipher before waiting
+ * for any of them. Note that eCryptfs pages may straddle the lower
+ * pages -- for instance, if the file was created on a machine with an
+ * 8K page size (resulting in an 8K header), and then the file is
+ * copied onto a host with a 32K page size, then when reading page 0 of
+ * the eCryptfs file, 24K of page 0 of the lower file will be read and
+ * decrypted, and then 8K of page 1 of the lower file will be read and
+ * decrypted.
  *
  * Returns zero on success; negative on error
  */
@@ -603,15 +656,19 @@ int ecryptfs_decrypt_page(struct page *page)
 {
 	struct inode *ecryptfs_inode;
 	struct ecryptfs_crypt_stat *crypt_stat;
+	struct ecryptfs_crypt_batch batch;
 	char *enc_extent_virt;
 	struct page *enc_extent_page = NULL;
 	unsigned long extent_offset;
-	int rc = 0;
+	unsigned long extents_per_page;
+	loff_t offset;
+	int rc = 0, wait_rc;
 
 	ecryptfs_inode = page->mapping->host;
 	crypt_stat =
 		&(ecryptfs_inode_to_private(ecryptfs_inode)->crypt_stat);
 	BUG_ON(!(crypt_stat->flags & ECRYPTFS_ENCRYPTED));
+	extents_per_page = PAGE_CACHE_SIZE / crypt_stat->extent_size;
 	enc_extent_page = alloc_page(GFP_USER);
 	if (!enc_extent_page) {
 		rc = -ENOMEM;
@@ -620,32 +677,29 @@ int ecryptfs_decrypt_page(struct page *page)
 		goto out;
 	}
 	enc_extent_virt = kmap(enc_extent_page);
-	for (extent_offset = 0;
-	     extent_offset < (PAGE_CACHE_SIZE / crypt_stat->extent_size);
-	     extent_offset++) {
-		loff_t offset;
-
-		ecryptfs_lower_offset_for_extent(
-			&offset, ((page->index * (PAGE_CACHE_SIZE
-						  / crypt_stat->extent_size))
-				  + extent_offset), crypt_stat);
-		rc = ecryptfs_read_lower(enc_extent_virt, offset,
-					 crypt_stat->extent_size,
-					 ecryptfs_inode);
-		if (rc < 0) {
-			ecryptfs_printk(KERN_ERR, "Error attempting "
-					"to read lower page; rc = [%d]"
-					"\n", rc);
-			goto out;
-		}
-		rc = ecryptfs_decrypt_extent(page, crypt_stat, enc_extent_page,
-					     extent_offset);
-		if (rc) {
-			printk(KERN_ERR "%s: Error encrypting extent; "
-			       "rc = [%d]\n", __func__, rc);
-			goto out;
-		}
+	ecryptfs_lower_offset_for_extent(
+		&offset, ((loff_t)page->index * extents_per_page), crypt_stat);
+	rc = ecryptfs_read_lower(enc_extent_virt, offset, PAGE_CACHE_SIZE,
+				 ecryptfs_inode);
+	if (rc < 0) {
+		ecryptfs_printk(KERN_ERR, "Error attempting "
+				"to read lower page; rc = [%d]"
+				"\n", rc);
+		goto out;
 	}
+	rc = ecryptfs_crypt_batch_init(&batch, crypt_stat, 0);
+	if (rc)
+		goto out;
+	for (extent_offset = 0; extent_offset < extents_per_page && !rc;
+	     extent_offset++)
+		rc = ecryptfs_crypt_extent(&batch, page, enc_extent_page,
+					   extent_offset);
+	wait_rc = ecryptfs_crypt_batch_wait(&batch);
+	if (!rc)
+		rc = wait_rc;
+	if (rc)
+		printk(KERN_ERR "%s: Error decrypting extent; "
+		       "rc = [%d]\n", __func__, rc);
 out:
 	if (enc_extent_page) {
 		kunmap(enc_extent_page);
@@ -654,109 +708,6 @@ out:
 	return rc;
 }
 
-/**
- * decrypt_scatterlist
- * @crypt_stat: Cryptographic context
- * @dest_sg: The destination scatterlist to decrypt into
- * @src_sg: The source scatterlist to decrypt from
- * @size: The number of bytes to decrypt
- * @iv: The initialization vector to use for the decryption
- *
- * Returns the number of bytes decrypted; negative value on error
- */
-static int decrypt_scatterlist(struct ecryptfs_crypt_stat *crypt_stat,
-			       struct scatterlist *dest_sg,
-			       struct scatterlist *src_sg, int size,
-			       unsigned char *iv)
-{
-	struct blkcipher_desc desc = {
-		.tfm = crypt_stat->tfm,
-		.info = iv,
-		.flags = CRYPTO_TFM_REQ_MAY_SLEEP
-	};
-	int rc = 0;
-
-	/* Consider doing this once, when the file is opened */
-	mutex_lock(&crypt_stat->cs_tfm_mutex);
-	rc = crypto_blkcipher_setkey(crypt_stat->tfm, crypt_stat->key,
-				     crypt_stat->key_size);
-	if (rc) {
-		ecryptfs_printk(KERN_ERR, "Error setting key; rc = [%d]\n",
-				rc);
-		mutex_unlock(&crypt_stat->cs_tfm_mutex);
-		rc = -EINVAL;
-		goto out;
-	}
-	ecryptfs_printk(KERN_DEBUG, "Decrypting [%d] bytes.\n", size);
-	rc = crypto_blkcipher_decrypt_iv(&desc, dest_sg, src_sg, size);
-	mutex_unlock(&crypt_stat->cs_tfm_mutex);
-	if (rc) {
-		ecryptfs_printk(KERN_ERR, "Error decrypting; rc = [%d]\n",
-				rc);
-		goto out;
-	}
-	rc = size;
-out:
-	return rc;
-}
-
-/**
- * ecryptfs_encrypt_page_offset
- * @crypt_stat: The cryptographic context
- * @dst_page: The page to encrypt into
- * @dst_offset: The offset in the page to encrypt into
- * @src_page: The page to encrypt from
- * @src_offset: The offset in the page to encrypt from
- * @size: The number of bytes to encrypt
- * @iv: The initialization vector to use for the encryption
- *
- * Returns the number of bytes encrypted
- */
-static int
-ecryptfs_encrypt_page_offset(struct ecryptfs_crypt_stat *crypt_stat,
-			     struct page *dst_page, int dst_offset,
-			     struct page *src_page, int src_offset, int size,
-			     unsigned char *iv)
-{
-	struct scatterlist src_sg, dst_sg;
-
-	sg_init_table(&src_sg, 1);
-	sg_init_table(&dst_sg, 1);
-
-	sg_set_page(&src_sg, src_page, size, src_offset);
-	sg_set_page(&dst_sg, dst_page, size, dst_offset);
-	return encrypt_scatterlist(crypt_stat, &dst_sg, &src_sg, size, iv);
-}
-
-/**
- * ecryptfs_decrypt_page_offset
- * @crypt_stat: The cryptographic context
- * @dst_page: The page to decrypt into
- * @dst_offset: The offset in the page to decrypt into
- * @src_page: The page to decrypt from
- * @src_offset: The offset in the page to decrypt from
- * @size: The number of bytes to decrypt
- * @iv: The initialization vector to use for the decryption
- *
- * Returns the number of bytes decrypted
- */
-static int
-ecryptfs_decrypt_page_offset(struct ecryptfs_crypt_stat *crypt_stat,
-			     struct page *dst_page, int dst_offset,
-			     struct page *src_page, int src_offset, int size,
-			     unsigned char *iv)
-{
-	struct scatterlist src_sg, dst_sg;
-
-	sg_init_table(&src_sg, 1);
-	sg_set_page(&src_sg, src_page, size, src_offset);
-
-	sg_init_table(&dst_sg, 1);
-	sg_set_page(&dst_sg, dst_page, size, dst_offset);
-
-	return decrypt_scatterlist(crypt_stat, &dst_sg, &src_sg, size, iv);
-}
-
 #define ECRYPTFS_MAX_SCATTERLIST_LEN 4
 
 /**
@@ -791,8 +742,7 @@ int ecryptfs_init_crypt_ctx(struct ecryptfs_crypt_stat *crypt_stat)
 						    crypt_stat->cipher, "cbc");
 	if (rc)
 		goto out_unlock;
-	crypt_stat->tfm = crypto_alloc_blkcipher(full_alg_name, 0,
-						 CRYPTO_ALG_ASYNC);
+	crypt_stat->tfm = crypto_alloc_ablkcipher(full_alg_name, 0, 0);
 	kfree(full_alg_name);
 	if (IS_ERR(crypt_stat->tfm)) {
 		rc = PTR_ERR(crypt_stat->tfm);
@@ -802,7 +752,7 @@ int ecryptfs_init_crypt_ctx(struct ecryptfs_crypt_stat *crypt_stat)
 				crypt_stat->cipher);
 		goto out_unlock;
 	}
-	crypto_blkcipher_set_flags(crypt_stat->tfm, CRYPTO_TFM_REQ_WEAK_KEY);
+	crypto_ablkcipher_set_flags(crypt_stat->tfm, CRYPTO_TFM_REQ_WEAK_KEY);
 	rc = 0;
 out_unlock:
 	mutex_unlock(&crypt_stat->cs_tfm_mutex);
@@ -883,6 +833,7 @@ static void ecryptfs_generate_new_key(struct ecryptfs_crypt_stat *crypt_stat)
 {
 	get_random_bytes(crypt_stat->key, crypt_stat->key_size);
 	crypt_stat->flags |= ECRYPTFS_KEY_VALID;
+	crypt_stat->flags &= ~ECRYPTFS_KEY_SET;
 	ecryptfs_compute_root_iv(crypt_stat);
 	if (unlikely(ecryptfs_verbosity > 0)) {
 		ecryptfs_printk(KERN_DEBUG, "Generated new session key:\n");
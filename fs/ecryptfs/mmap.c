@@ -99,6 +99,75 @@ static int ecryptfs_writepage(struct page *page, struct writeback_control *wbc)
 	return rc;
 }
 
+/* Pages of a writepages call encrypted together */
+#define ECRYPTFS_WRITEPAGES_BATCH 16
+
+struct ecryptfs_writepages_batch {
+	struct page *pages[ECRYPTFS_WRITEPAGES_BATCH];
+	int nr_pages;
+};
+
+static int ecryptfs_writepages_flush(struct ecryptfs_writepages_batch *batch)
+{
+	int i, rc;
+
+	if (!batch->nr_pages)
+		return 0;
+	rc = ecryptfs_encrypt_pages(batch->pages, batch->nr_pages);
+	if (rc)
+		ecryptfs_printk(KERN_ERR, "Error encrypting [%d] pages (upper "
+				"index [0x%.16x])\n", batch->nr_pages,
+				batch->pages[0]->index);
+	for (i = 0; i < batch->nr_pages; i++) {
+		if (rc)
+			ClearPageUptodate(batch->pages[i]);
+		else
+			SetPageUptodate(batch->pages[i]);
+		unlock_page(batch->pages[i]);
+	}
+	batch->nr_pages = 0;
+	return rc;
+}
+
+static int ecryptfs_writepages_add(struct page *page,
+				   struct writeback_control *wbc, void *data)
+{
+	struct ecryptfs_writepages_batch *batch = data;
+
+	batch->pages[batch->nr_pages++] = page;
+	if (batch->nr_pages == ECRYPTFS_WRITEPAGES_BATCH)
+		return ecryptfs_writepages_flush(batch);
+	return 0;
+}
+
+/**
+ * ecryptfs_writepages
+ * @mapping: The eCryptfs address space
+ * @wbc: Writeback control
+ *
+ * Collects the dirty pages, still locked, in batches which are
+ * encrypted at once, so that the extents of several pages are in
+ * flight in the cipher together.
+ *
+ * Returns zero on success; non-zero otherwise
+ */
+static int ecryptfs_writepages(struct address_space *mapping,
+			       struct writeback_control *wbc)
+{
+	struct ecryptfs_crypt_stat *crypt_stat =
+		&(ecryptfs_inode_to_private(mapping->host)->crypt_stat);
+	struct ecryptfs_writepages_batch batch;
+	int rc, flush_rc;
+
+	if (!(crypt_stat->flags & ECRYPTFS_ENCRYPTED)
+	    || (crypt_stat->flags & ECRYPTFS_NEW_FILE))
+		return generic_writepages(mapping, wbc);
+	batch.nr_pages = 0;
+	rc = write_cache_pages(mapping, wbc, ecryptfs_writepages_add, &batch);
+	flush_rc = ecryptfs_writepages_flush(&batch);
+	return rc ? rc : flush_rc;
+}
+
 static void strip_xattr_flag(char *page_virt,
 			     struct ecryptfs_crypt_stat *crypt_stat)
 {
@@ -570,6 +639,7 @@ static sector_t ecryptfs_bmap(struct address_space *mapping, sector_t block)
 
 const struct address_space_operations ecryptfs_aops = {
 	.writepage = ecryptfs_writepage,
+	.writepages = ecryptfs_writepages,
 	.readpage = ecryptfs_readpage,
 	.write_begin = ecryptfs_write_begin,
 	.write_end = ecryptfs_write_end,
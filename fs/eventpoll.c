@@ -33,6 +33,8 @@
 #include <linux/bitops.h>
 #include <linux/mutex.h>
 #include <linux/anon_inodes.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
 #include <asm/uaccess.h>
 #include <asm/system.h>
 #include <asm/io.h>
@@ -46,13 +48,17 @@
  * 1) epmutex (mutex)
  * 2) ep->mtx (mutex)
  * 3) ep->lock (spinlock)
+ * 4) ep->ring_lock (spinlock)
  *
- * The acquire order is the one listed above, from 1 to 3.
- * We need a spinlock (ep->lock) because we manipulate objects
- * from inside the poll callback, that might be triggered from
- * a wake_up() that in turn might be called from IRQ context.
- * So we can't sleep inside the poll callback and hence we need
- * a spinlock. During the event transfer loop (from kernel to
+ * The acquire order is the one listed above, from 1 to 4.
+ * The poll callback might be triggered from a wake_up() that in turn
+ * might be called from IRQ context, so it can't sleep. It does not take
+ * ep->lock either: it pushes the ready item on ep->rdlstack with
+ * cmpxchg(), and whoever holds "mtx" next moves the stacked items to
+ * the ready list, under the spinlock ep->lock. Only the edge triggered
+ * events stored in the mmap()ed ring take a spinlock in the callback,
+ * ep->ring_lock, held for the copy of one event.
+ * During the event transfer loop (from kernel to
  * user space) we could end up sleeping due a copy_to_user(), so
  * we need a lock that will allow us to sleep. This lock is a
  * mutex (ep->mtx). It is acquired during the event transfer loop,
@@ -86,6 +92,15 @@
 
 #define EP_ITEM_COST (sizeof(struct epitem) + sizeof(struct eppoll_entry))
 
+/* Events copied to user space at a time by ep_send_events_proc() */
+#define EP_SEND_BATCH 16
+
+/* Largest mmap()ed ready ring, 4096 events */
+#define EP_RING_MAX_SIZE (64UL << 10)
+
+/* Watches charged to the user for a ring of @size bytes */
+#define EP_RING_COST(size) DIV_ROUND_UP(size, EP_ITEM_COST)
+
 struct epoll_filefd {
 	struct file *file;
 	int fd;
@@ -122,8 +137,8 @@ struct epitem {
 	struct list_head rdllink;
 
 	/*
-	 * Works together "struct eventpoll"->ovflist in keeping the
-	 * single linked chain of items.
+	 * Chains the item on "struct eventpoll"->rdlstack. EP_UNACTIVE_PTR
+	 * while the item is not there.
 	 */
 	struct epitem *next;
 
@@ -176,11 +191,22 @@ struct eventpoll {
 	struct rb_root rbr;
 
 	/*
-	 * This is a single linked list that chains all the "struct epitem" that
-	 * happened while transfering ready events to userspace w/out
-	 * holding ->lock.
+	 * This is a single linked stack of the "struct epitem" made ready by
+	 * the poll callback, which pushes them without holding ->lock. They
+	 * are moved to the ready list by ep_drain_ready_stack().
 	 */
-	struct epitem *ovflist;
+	struct epitem *rdlstack;
+
+	/*
+	 * Ready ring mmap()ed by user space, or NULL. The kernel keeps its
+	 * own head and mask, which user space can't corrupt. The memory of
+	 * the ring is charged to the user as "ring_cost" watches.
+	 */
+	struct epoll_ring *ring;
+	spinlock_t ring_lock;
+	u32 ring_head;
+	u32 ring_mask;
+	int ring_cost;
 
 	/* The user that created the eventpoll descriptor */
 	struct user_struct *user;
@@ -299,6 +325,75 @@ static inline int ep_op_has_event(int op)
 	return op != EPOLL_CTL_DEL;
 }
 
+/*
+ * Pushes the item on ep->rdlstack, lockless. Returns zero if the item was
+ * already there, in which case the wakeup that queued it is still pending.
+ */
+static inline int ep_push_ready(struct eventpoll *ep, struct epitem *epi)
+{
+	struct epitem *head;
+
+	if (cmpxchg(&epi->next, EP_UNACTIVE_PTR, NULL) != EP_UNACTIVE_PTR)
+		return 0;
+
+	do {
+		head = ACCESS_ONCE(ep->rdlstack);
+		epi->next = head;
+	} while (cmpxchg(&ep->rdlstack, head, epi) != head);
+
+	return 1;
+}
+
+/*
+ * Moves the items pushed by the poll callback to the tail of the ready
+ * list, in the order they were pushed. An item already linked, on the
+ * ready list or on the "txlist" of ep_scan_ready_list(), stays where it
+ * is. Must be called with "mtx" and "ep->lock" held.
+ */
+static void ep_drain_ready_stack(struct eventpoll *ep)
+{
+	struct epitem *epi, *nepi, *fifo = NULL;
+
+	if (!ACCESS_ONCE(ep->rdlstack))
+		return;
+
+	/*
+	 * Detach the stack and reverse it. The items stay claimed, "next"
+	 * not being EP_UNACTIVE_PTR, until released one by one below.
+	 */
+	for (epi = xchg(&ep->rdlstack, NULL); epi; epi = nepi) {
+		nepi = epi->next;
+		epi->next = fifo;
+		fifo = epi;
+	}
+
+	for (epi = fifo; epi; epi = nepi) {
+		nepi = epi->next;
+		/* From here the poll callback can push the item again */
+		epi->next = EP_UNACTIVE_PTR;
+		if (!ep_is_linked(&epi->rdllink))
+			list_add_tail(&epi->rdllink, &ep->rdllist);
+	}
+}
+
+/* Tells if the mmap()ed ring holds events not consumed yet */
+static inline int ep_ring_pending(struct eventpoll *ep)
+{
+	struct epoll_ring *ring = ACCESS_ONCE(ep->ring);
+
+	return ring && ACCESS_ONCE(ep->ring_head) != ACCESS_ONCE(ring->tail);
+}
+
+/*
+ * Tells if there may be events to return to the caller. Can be called
+ * without locks: ep_scan_ready_list() sorts it out.
+ */
+static inline int ep_events_available(struct eventpoll *ep)
+{
+	return !list_empty(&ep->rdllist) || ACCESS_ONCE(ep->rdlstack) ||
+		ep_ring_pending(ep);
+}
+
 /* Initialize the poll safe wake up structure */
 static void ep_nested_calls_init(struct nested_calls *ncalls)
 {
@@ -452,7 +547,6 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 {
 	int error, pwake = 0;
 	unsigned long flags;
-	struct epitem *epi, *nepi;
 	LIST_HEAD(txlist);
 
 	/*
@@ -463,15 +557,14 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 
 	/*
 	 * Steal the ready list, and re-init the original one to the
-	 * empty list. Also, set ep->ovflist to NULL so that events
-	 * happening while looping w/out locks, are not lost. We cannot
-	 * have the poll callback to queue directly on ep->rdllist,
-	 * because we want the "sproc" callback to be able to do it
-	 * in a lockless way.
+	 * empty list. The poll callback never queues directly on
+	 * ep->rdllist, it pushes on ep->rdlstack, so the "sproc" callback
+	 * is able to work on the list in a lockless way, and the events
+	 * happening meanwhile are not lost.
 	 */
 	spin_lock_irqsave(&ep->lock, flags);
+	ep_drain_ready_stack(ep);
 	list_splice_init(&ep->rdllist, &txlist);
-	ep->ovflist = NULL;
 	spin_unlock_irqrestore(&ep->lock, flags);
 
 	/*
@@ -483,25 +576,11 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 	/*
 	 * During the time we spent inside the "sproc" callback, some
 	 * other events might have been queued by the poll callback.
-	 * We re-insert them inside the main ready-list here.
+	 * We insert them inside the main ready-list here. The "txlist"
+	 * might already contain some of them, and the list_splice() below
+	 * takes care of those.
 	 */
-	for (nepi = ep->ovflist; (epi = nepi) != NULL;
-	     nepi = epi->next, epi->next = EP_UNACTIVE_PTR) {
-		/*
-		 * We need to check if the item is already in the list.
-		 * During the "sproc" callback execution time, items are
-		 * queued into ->ovflist but the "txlist" might already
-		 * contain them, and the list_splice() below takes care of them.
-		 */
-		if (!ep_is_linked(&epi->rdllink))
-			list_add_tail(&epi->rdllink, &ep->rdllist);
-	}
-	/*
-	 * We need to set back ep->ovflist to EP_UNACTIVE_PTR, so that after
-	 * releasing the lock, events will be queued in the normal way inside
-	 * ep->rdllist.
-	 */
-	ep->ovflist = EP_UNACTIVE_PTR;
+	ep_drain_ready_stack(ep);
 
 	/*
 	 * Quickly re-inject items left on "txlist".
@@ -514,7 +593,7 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 		 * the ->poll() wait list (delayed after we release the lock).
 		 */
 		if (waitqueue_active(&ep->wq))
-			wake_up_locked(&ep->wq);
+			wake_up(&ep->wq);
 		if (waitqueue_active(&ep->poll_wait))
 			pwake++;
 	}
@@ -544,7 +623,7 @@ static int ep_remove(struct eventpoll *ep, struct epitem *epi)
 	 * sequence of the lock acquisition. Here we do "ep->lock" then the wait
 	 * queue head lock when unregistering the wait queue. The wakeup callback
 	 * will run by holding the wait queue head lock and will call our callback
-	 * that will try to get "ep->lock".
+	 * that will try to get "ep->ring_lock".
 	 */
 	ep_unregister_pollwait(ep, epi);
 
@@ -556,7 +635,12 @@ static int ep_remove(struct eventpoll *ep, struct epitem *epi)
 
 	rb_erase(&epi->rbn, &ep->rbr);
 
+	/*
+	 * No poll callback can push the item any more, take it off
+	 * ep->rdlstack if it is still there.
+	 */
 	spin_lock_irqsave(&ep->lock, flags);
+	ep_drain_ready_stack(ep);
 	if (ep_is_linked(&epi->rdllink))
 		list_del_init(&epi->rdllink);
 	spin_unlock_irqrestore(&ep->lock, flags);
@@ -610,6 +694,10 @@ static void ep_free(struct eventpoll *ep)
 
 	mutex_unlock(&epmutex);
 	mutex_destroy(&ep->mtx);
+	if (ep->ring) {
+		vfree(ep->ring);
+		atomic_sub(ep->ring_cost, &ep->user->epoll_watches);
+	}
 	free_uid(ep->user);
 	kfree(ep);
 }
@@ -659,6 +747,9 @@ static unsigned int ep_eventpoll_poll(struct file *file, poll_table *wait)
 	/* Insert inside our poll wait queue */
 	poll_wait(file, &ep->poll_wait, wait);
 
+	if (ep_ring_pending(ep))
+		return POLLIN | POLLRDNORM;
+
 	/*
 	 * Proceed to find out if wanted events are really available inside
 	 * the ready list. This need to be done under ep_call_nested()
@@ -671,10 +762,87 @@ static unsigned int ep_eventpoll_poll(struct file *file, poll_table *wait)
 	return pollflags != -1 ? pollflags : 0;
 }
 
+/*
+ * Maps the ready ring of the epoll file. From then on the edge triggered
+ * events reported with a key are stored there by the poll callback, and
+ * user space can consume them without entering the kernel. The ring can
+ * be set up only once.
+ */
+static int ep_eventpoll_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct eventpoll *ep = file->private_data;
+	unsigned long size = vma->vm_end - vma->vm_start;
+	unsigned long nr;
+	struct epoll_ring *ring;
+	int error, cost;
+
+	if (vma->vm_pgoff || !(vma->vm_flags & VM_SHARED) ||
+	    size > EP_RING_MAX_SIZE)
+		return -EINVAL;
+
+	/*
+	 * We are called with the mmap_sem held, which ep_send_events()
+	 * takes under "mtx" when faulting on the user buffer, so only
+	 * ep->ring_lock can be used here.
+	 */
+	if (ACCESS_ONCE(ep->ring))
+		return -EBUSY;
+
+	nr = (size - sizeof(*ring)) / sizeof(struct epoll_event);
+	nr = rounddown_pow_of_two(nr);
+
+	/*
+	 * The ring takes vmalloc space and unswappable memory, charge it
+	 * to the user against the same limit as the watches.
+	 */
+	cost = EP_RING_COST(size);
+	if (atomic_add_return(cost, &ep->user->epoll_watches) >
+	    max_user_watches) {
+		error = -ENOMEM;
+		goto error_uncharge;
+	}
+
+	error = -ENOMEM;
+	ring = vmalloc_user(size);
+	if (!ring)
+		goto error_uncharge;
+	ring->mask = nr - 1;
+
+	error = remap_vmalloc_range(vma, ring, 0);
+	if (error)
+		goto error_free;
+
+	error = -EBUSY;
+	spin_lock_irq(&ep->ring_lock);
+	if (!ep->ring) {
+		ep->ring_head = 0;
+		ep->ring_mask = nr - 1;
+		ep->ring_cost = cost;
+		smp_wmb();
+		ep->ring = ring;
+		error = 0;
+	}
+	spin_unlock_irq(&ep->ring_lock);
+	if (error)
+		goto error_free;
+
+	vma->vm_flags |= VM_DONTEXPAND;
+
+	return 0;
+
+error_free:
+	/* The pages mapped already are released with the mapping */
+	vfree(ring);
+error_uncharge:
+	atomic_sub(cost, &ep->user->epoll_watches);
+	return error;
+}
+
 /* File callbacks that implement the eventpoll file behaviour */
 static const struct file_operations eventpoll_fops = {
 	.release	= ep_eventpoll_release,
-	.poll		= ep_eventpoll_poll
+	.poll		= ep_eventpoll_poll,
+	.mmap		= ep_eventpoll_mmap
 };
 
 /* Fast test to see if the file is an evenpoll file */
@@ -740,7 +908,7 @@ static int ep_alloc(struct eventpoll **pep)
 	init_waitqueue_head(&ep->poll_wait);
 	INIT_LIST_HEAD(&ep->rdllist);
 	ep->rbr = RB_ROOT;
-	ep->ovflist = EP_UNACTIVE_PTR;
+	spin_lock_init(&ep->ring_lock);
 	ep->user = user;
 
 	*pep = ep;
@@ -781,6 +949,54 @@ static struct epitem *ep_find(struct eventpoll *ep, struct file *file, int fd)
 	return epir;
 }
 
+/*
+ * Stores an event of an edge triggered item in the mmap()ed ring, if
+ * there is one and it has room. Returns zero if the event has to go
+ * through the ready list.
+ */
+static int ep_ring_add(struct eventpoll *ep, struct epitem *epi,
+		       unsigned long key)
+{
+	struct epoll_ring *ring;
+	struct epoll_event *uevent;
+	unsigned long flags;
+	unsigned int events;
+	int added = 0;
+
+	if (!ACCESS_ONCE(ep->ring))
+		return 0;
+
+	spin_lock_irqsave(&ep->ring_lock, flags);
+	ring = ep->ring;
+	events = epi->event.events;
+
+	/*
+	 * Level triggered items must be polled again at every epoll_wait(),
+	 * and one-shot ones disabled, both are left to the ready list.
+	 */
+	if ((events & EP_PRIVATE_BITS) != EPOLLET)
+		goto out_unlock;
+
+	if (ep->ring_head - ACCESS_ONCE(ring->tail) > ep->ring_mask) {
+		ring->lost++;
+		goto out_unlock;
+	}
+
+	uevent = &ring->events[ep->ring_head & ep->ring_mask];
+	uevent->events = key & events & ~EP_PRIVATE_BITS;
+	uevent->data = epi->event.data;
+
+	/* User space reads the entry after seeing the new head */
+	smp_wmb();
+	ring->head = ++ep->ring_head;
+	added = 1;
+
+out_unlock:
+	spin_unlock_irqrestore(&ep->ring_lock, flags);
+
+	return added;
+}
+
 /*
  * This is the callback that is passed to the wait queue wakeup
  * machanism. It is called by the stored file descriptors when they
@@ -788,13 +1004,9 @@ static struct epitem *ep_find(struct eventpoll *ep, struct file *file, int fd)
  */
 static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *key)
 {
-	int pwake = 0;
-	unsigned long flags;
 	struct epitem *epi = ep_item_from_wait(wait);
 	struct eventpoll *ep = epi->ep;
 
-	spin_lock_irqsave(&ep->lock, flags);
-
 	/*
 	 * If the event mask does not contain any poll(2) event, we consider the
 	 * descriptor to be disabled. This condition is likely the effect of the
@@ -802,7 +1014,7 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	 * until the next EPOLL_CTL_MOD will be issued.
 	 */
 	if (!(epi->event.events & ~EP_PRIVATE_BITS))
-		goto out_unlock;
+		return 1;
 
 	/*
 	 * Check the events coming with the callback. At this stage, not
@@ -811,40 +1023,27 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	 * test for "key" != NULL before the event match test.
 	 */
 	if (key && !((unsigned long) key & epi->event.events))
-		goto out_unlock;
+		return 1;
 
 	/*
-	 * If we are trasfering events to userspace, we can hold no locks
-	 * (because we're accessing user memory, and because of linux f_op->poll()
-	 * semantics). All the events that happens during that period of time are
-	 * chained in ep->ovflist and requeued later on.
+	 * The events coming with a key can be delivered straight through
+	 * the mmap()ed ring. The others are pushed on ep->rdlstack, without
+	 * taking ep->lock, which is held by epoll_wait() and epoll_ctl()
+	 * callers. If this item is already there we exit soon.
 	 */
-	if (unlikely(ep->ovflist != EP_UNACTIVE_PTR)) {
-		if (epi->next == EP_UNACTIVE_PTR) {
-			epi->next = ep->ovflist;
-			ep->ovflist = epi;
-		}
-		goto out_unlock;
-	}
-
-	/* If this file is already in the ready list we exit soon */
-	if (!ep_is_linked(&epi->rdllink))
-		list_add_tail(&epi->rdllink, &ep->rdllist);
+	if (!(key && ep_ring_add(ep, epi, (unsigned long) key)) &&
+	    !ep_push_ready(ep, epi))
+		return 1;
 
 	/*
 	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
-	 * wait list.
+	 * wait list. The barrier orders the queueing above before the tests,
+	 * against set_current_state() in ep_poll().
 	 */
+	smp_mb();
 	if (waitqueue_active(&ep->wq))
-		wake_up_locked(&ep->wq);
+		wake_up(&ep->wq);
 	if (waitqueue_active(&ep->poll_wait))
-		pwake++;
-
-out_unlock:
-	spin_unlock_irqrestore(&ep->lock, flags);
-
-	/* We have to call this outside the lock */
-	if (pwake)
 		ep_poll_safewake(&ep->poll_wait);
 
 	return 1;
@@ -961,7 +1160,7 @@ static int ep_insert(struct eventpoll *ep, struct epoll_event *event,
 
 		/* Notify waiting tasks that events are available */
 		if (waitqueue_active(&ep->wq))
-			wake_up_locked(&ep->wq);
+			wake_up(&ep->wq);
 		if (waitqueue_active(&ep->poll_wait))
 			pwake++;
 	}
@@ -981,11 +1180,12 @@ error_unregister:
 
 	/*
 	 * We need to do this because an event could have been arrived on some
-	 * allocated wait queue. Note that we don't care about the ep->ovflist
-	 * list, since that is used/cleaned only inside a section bound by "mtx".
-	 * And ep_insert() is called with "mtx" held.
+	 * allocated wait queue, and pushed the item on ep->rdlstack. That is
+	 * drained only inside a section bound by "mtx", and ep_insert() is
+	 * called with "mtx" held.
 	 */
 	spin_lock_irqsave(&ep->lock, flags);
+	ep_drain_ready_stack(ep);
 	if (ep_is_linked(&epi->rdllink))
 		list_del_init(&epi->rdllink);
 	spin_unlock_irqrestore(&ep->lock, flags);
@@ -1007,10 +1207,13 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 	/*
 	 * Set the new event interest mask before calling f_op->poll();
 	 * otherwise we might miss an event that happens between the
-	 * f_op->poll() call and the new event set registering.
+	 * f_op->poll() call and the new event set registering. The ring
+	 * lock keeps ep_ring_add() from seeing half of the update.
 	 */
+	spin_lock_irq(&ep->ring_lock);
 	epi->event.events = event->events;
 	epi->event.data = event->data; /* protected by mtx */
+	spin_unlock_irq(&ep->ring_lock);
 
 	/*
 	 * Get current event bits. We can safely use the file* here because
@@ -1029,7 +1232,7 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 
 			/* Notify waiting tasks that events are available */
 			if (waitqueue_active(&ep->wq))
-				wake_up_locked(&ep->wq);
+				wake_up(&ep->wq);
 			if (waitqueue_active(&ep->poll_wait))
 				pwake++;
 		}
@@ -1043,43 +1246,110 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 	return 0;
 }
 
+/*
+ * Copies to user space the events waiting in the mmap()ed ring, which go
+ * before those of the ready list. User space must not consume the ring
+ * meanwhile. Called with "mtx" held.
+ */
+static int ep_ring_send_events(struct eventpoll *ep,
+			       struct ep_send_events_data *esed)
+{
+	struct epoll_ring *ring = ACCESS_ONCE(ep->ring);
+	u32 head, tail, nr, first, size;
+
+	if (!ring)
+		return 0;
+
+	smp_rmb();
+	size = ep->ring_mask + 1;
+	head = ACCESS_ONCE(ep->ring_head);
+	tail = ACCESS_ONCE(ring->tail);
+
+	/* Read the entries after the head, pairs with ep_ring_add() */
+	smp_rmb();
+	nr = head - tail;
+	if (nr > size) {
+		/* The tail has been scribbled on, drop the ring content */
+		ring->tail = head;
+		return 0;
+	}
+	nr = min_t(u32, nr, esed->maxevents);
+	first = min(nr, size - (tail & ep->ring_mask));
+
+	if (__copy_to_user(esed->events, &ring->events[tail & ep->ring_mask],
+			   first * sizeof(struct epoll_event)) ||
+	    __copy_to_user(esed->events + first, &ring->events[0],
+			   (nr - first) * sizeof(struct epoll_event)))
+		return -EFAULT;
+
+	/* The entries are read before the producer can reuse them */
+	smp_mb();
+	ring->tail = tail + nr;
+
+	return nr;
+}
+
 static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 			       void *priv)
 {
 	struct ep_send_events_data *esed = priv;
-	int eventcnt;
+	struct epoll_event batch[EP_SEND_BATCH];
+	struct epitem *items[EP_SEND_BATCH];
+	int eventcnt, nr, i;
 	unsigned int revents;
 	struct epitem *epi;
-	struct epoll_event __user *uevent;
+
+	eventcnt = ep_ring_send_events(ep, esed);
+	if (eventcnt < 0)
+		return eventcnt;
+
+	/* Only the fields are set below, don't leak the padding */
+	memset(batch, 0, sizeof(batch));
 
 	/*
 	 * We can loop without lock because we are passed a task private list.
 	 * Items cannot vanish during the loop because ep_scan_ready_list() is
 	 * holding "mtx" during this call.
 	 */
-	for (eventcnt = 0, uevent = esed->events;
-	     !list_empty(head) && eventcnt < esed->maxevents;) {
-		epi = list_first_entry(head, struct epitem, rdllink);
+	while (!list_empty(head) && eventcnt < esed->maxevents) {
+		/*
+		 * Gather up to EP_SEND_BATCH events and copy them to user
+		 * space at once.
+		 */
+		for (nr = 0; nr < EP_SEND_BATCH && !list_empty(head) &&
+			     eventcnt + nr < esed->maxevents;) {
+			epi = list_first_entry(head, struct epitem, rdllink);
 
-		list_del_init(&epi->rdllink);
+			list_del_init(&epi->rdllink);
 
-		revents = epi->ffd.file->f_op->poll(epi->ffd.file, NULL) &
-			epi->event.events;
+			revents = epi->ffd.file->f_op->poll(epi->ffd.file,
+							    NULL) &
+				epi->event.events;
 
-		/*
-		 * If the event mask intersect the caller-requested one,
-		 * deliver the event to userspace. Again, ep_scan_ready_list()
-		 * is holding "mtx", so no operations coming from userspace
-		 * can change the item.
-		 */
-		if (revents) {
-			if (__put_user(revents, &uevent->events) ||
-			    __put_user(epi->event.data, &uevent->data)) {
-				list_add(&epi->rdllink, head);
-				return eventcnt ? eventcnt : -EFAULT;
+			/*
+			 * If the event mask intersect the caller-requested one,
+			 * deliver the event to userspace. Again,
+			 * ep_scan_ready_list() is holding "mtx", so no
+			 * operations coming from userspace can change the item.
+			 */
+			if (revents) {
+				batch[nr].events = revents;
+				batch[nr].data = epi->event.data;
+				items[nr++] = epi;
 			}
-			eventcnt++;
-			uevent++;
+		}
+
+		if (__copy_to_user(esed->events + eventcnt, batch,
+				   nr * sizeof(struct epoll_event))) {
+			/* Put the items back, in order, for the next call */
+			while (nr--)
+				list_add(&items[nr]->rdllink, head);
+			return eventcnt ? eventcnt : -EFAULT;
+		}
+		eventcnt += nr;
+
+		for (i = 0; i < nr; i++) {
+			epi = items[i];
 			if (epi->event.events & EPOLLONESHOT)
 				epi->event.events &= EP_PRIVATE_BITS;
 			else if (!(epi->event.events & EPOLLET)) {
@@ -1092,7 +1362,7 @@ static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 				 * into ep->rdllist besides us. The epoll_ctl()
 				 * callers are locked out by
 				 * ep_scan_ready_list() holding "mtx" and the
-				 * poll callback will queue them in ep->ovflist.
+				 * poll callback pushes on ep->rdlstack.
 				 */
 				list_add_tail(&epi->rdllink, &ep->rdllist);
 			}
@@ -1117,7 +1387,6 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 		   int maxevents, long timeout)
 {
 	int res, eavail;
-	unsigned long flags;
 	long jtimeout;
 	wait_queue_t wait;
 
@@ -1130,18 +1399,15 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 		MAX_SCHEDULE_TIMEOUT : (timeout * HZ + 999) / 1000;
 
 retry:
-	spin_lock_irqsave(&ep->lock, flags);
-
 	res = 0;
-	if (list_empty(&ep->rdllist)) {
+	if (!ep_events_available(ep)) {
 		/*
 		 * We don't have any available event to return to the caller.
 		 * We need to sleep here, and we will be wake up by
 		 * ep_poll_callback() when events will become available.
 		 */
 		init_waitqueue_entry(&wait, current);
-		wait.flags |= WQ_FLAG_EXCLUSIVE;
-		__add_wait_queue(&ep->wq, &wait);
+		add_wait_queue_exclusive(&ep->wq, &wait);
 
 		for (;;) {
 			/*
@@ -1150,25 +1416,21 @@ retry:
 			 * to TASK_INTERRUPTIBLE before doing the checks.
 			 */
 			set_current_state(TASK_INTERRUPTIBLE);
-			if (!list_empty(&ep->rdllist) || !jtimeout)
+			if (ep_events_available(ep) || !jtimeout)
 				break;
 			if (signal_pending(current)) {
 				res = -EINTR;
 				break;
 			}
 
-			spin_unlock_irqrestore(&ep->lock, flags);
 			jtimeout = schedule_timeout(jtimeout);
-			spin_lock_irqsave(&ep->lock, flags);
 		}
-		__remove_wait_queue(&ep->wq, &wait);
+		remove_wait_queue(&ep->wq, &wait);
 
 		set_current_state(TASK_RUNNING);
 	}
 	/* Is it worth to try to dig for events ? */
-	eavail = !list_empty(&ep->rdllist) || ep->ovflist != EP_UNACTIVE_PTR;
-
-	spin_unlock_irqrestore(&ep->lock, flags);
+	eavail = ep_events_available(ep);
 
 	/*
 	 * Try to transfer events to user space. In case we get 0 events and
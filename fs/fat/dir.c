@@ -18,6 +18,8 @@
 #include <linux/time.h>
 #include <linux/buffer_head.h>
 #include <linux/compat.h>
+#include <linux/hash.h>
+#include <linux/log2.h>
 #include <asm/uaccess.h>
 #include "fat.h"
 
@@ -337,54 +339,57 @@ parse_long:
 	return 0;
 }
 
+/* Names of a directory record, as decoded by fat_next_record() */
+struct fat_record_names {
+	unsigned char shortname[FAT_MAX_SHORT_SIZE];
+	int short_len;
+	unsigned char *longname;	/* in the unicode buffer, or NULL */
+	int long_len;
+};
+
 /*
- * Return values: negative -> error, 0 -> not found, positive -> found,
- * value is the total amount of slots, including the shortname entry.
+ * Reads the next record (long name slots, if any, and the short entry)
+ * starting at *cpos, and decodes its names. On success, *de and *bh are
+ * the short entry, *cpos is right after it and *nr_slots is the number of
+ * long name slots. Returns -ENOENT at the end of the directory.
  */
-int fat_search_long(struct inode *inode, const unsigned char *name,
-		    int name_len, struct fat_slot_info *sinfo)
+static int fat_next_record(struct inode *inode, loff_t *cpos,
+			   struct buffer_head **bh, struct msdos_dir_entry **de,
+			   wchar_t **unicode, unsigned char *nr_slots,
+			   struct fat_record_names *names)
 {
-	struct super_block *sb = inode->i_sb;
-	struct msdos_sb_info *sbi = MSDOS_SB(sb);
-	struct buffer_head *bh = NULL;
-	struct msdos_dir_entry *de;
+	struct msdos_sb_info *sbi = MSDOS_SB(inode->i_sb);
 	struct nls_table *nls_disk = sbi->nls_disk;
-	unsigned char nr_slots;
 	wchar_t bufuname[14];
-	wchar_t *unicode = NULL;
 	unsigned char work[MSDOS_NAME];
-	unsigned char bufname[FAT_MAX_SHORT_SIZE];
 	unsigned short opt_shortname = sbi->options.shortname;
-	loff_t cpos = 0;
-	int chl, i, j, last_u, err, len;
+	int chl, i, j, last_u;
 
-	err = -ENOENT;
 	while (1) {
-		if (fat_get_entry(inode, &cpos, &bh, &de) == -1)
-			goto end_of_dir;
+		if (fat_get_entry(inode, cpos, bh, de) == -1)
+			return -ENOENT;
 parse_record:
-		nr_slots = 0;
-		if (de->name[0] == DELETED_FLAG)
+		*nr_slots = 0;
+		if ((*de)->name[0] == DELETED_FLAG)
 			continue;
-		if (de->attr != ATTR_EXT && (de->attr & ATTR_VOLUME))
+		if ((*de)->attr != ATTR_EXT && ((*de)->attr & ATTR_VOLUME))
 			continue;
-		if (de->attr != ATTR_EXT && IS_FREE(de->name))
+		if ((*de)->attr != ATTR_EXT && IS_FREE((*de)->name))
 			continue;
-		if (de->attr == ATTR_EXT) {
-			int status = fat_parse_long(inode, &cpos, &bh, &de,
-						    &unicode, &nr_slots);
-			if (status < 0) {
-				err = status;
-				goto end_of_dir;
-			} else if (status == PARSE_INVALID)
+		if ((*de)->attr == ATTR_EXT) {
+			int status = fat_parse_long(inode, cpos, bh, de,
+						    unicode, nr_slots);
+			if (status < 0)
+				return status;
+			else if (status == PARSE_INVALID)
 				continue;
 			else if (status == PARSE_NOT_LONGNAME)
 				goto parse_record;
 			else if (status == PARSE_EOF)
-				goto end_of_dir;
+				return -ENOENT;
 		}
 
-		memcpy(work, de->name, sizeof(de->name));
+		memcpy(work, (*de)->name, sizeof((*de)->name));
 		/* see namei.c, msdos_format_name */
 		if (work[0] == 0x05)
 			work[0] = 0xE5;
@@ -393,7 +398,7 @@ parse_record:
 				break;
 			chl = fat_shortname2uni(nls_disk, &work[i], 8 - i,
 						&bufuname[j++], opt_shortname,
-						de->lcase & CASE_LOWER_BASE);
+						(*de)->lcase & CASE_LOWER_BASE);
 			if (chl <= 1) {
 				if (work[i] != ' ')
 					last_u = j;
@@ -410,7 +415,7 @@ parse_record:
 			chl = fat_shortname2uni(nls_disk, &work[i],
 						MSDOS_NAME - i,
 						&bufuname[j++], opt_shortname,
-						de->lcase & CASE_LOWER_EXT);
+						(*de)->lcase & CASE_LOWER_EXT);
 			if (chl <= 1) {
 				if (work[i] != ' ')
 					last_u = j;
@@ -422,32 +427,333 @@ parse_record:
 		if (!last_u)
 			continue;
 
-		/* Compare shortname */
 		bufuname[last_u] = 0x0000;
-		len = fat_uni_to_x8(sbi, bufuname, bufname, sizeof(bufname));
-		if (fat_name_match(sbi, name, name_len, bufname, len))
-			goto found;
+		names->short_len = fat_uni_to_x8(sbi, bufuname, names->shortname,
+						 sizeof(names->shortname));
+		names->longname = NULL;
+		names->long_len = 0;
+		if (*nr_slots) {
+			names->longname = (unsigned char *)(*unicode +
+							    FAT_MAX_UNI_CHARS);
+			names->long_len = fat_uni_to_x8(sbi, *unicode,
+							names->longname,
+							PATH_MAX - FAT_MAX_UNI_SIZE);
+		}
+		return 0;
+	}
+}
 
-		if (nr_slots) {
-			void *longname = unicode + FAT_MAX_UNI_CHARS;
-			int size = PATH_MAX - FAT_MAX_UNI_SIZE;
+static inline int fat_record_match(struct msdos_sb_info *sbi,
+				   const unsigned char *name, int name_len,
+				   struct fat_record_names *names)
+{
+	if (fat_name_match(sbi, name, name_len, names->shortname,
+			   names->short_len))
+		return 1;
+	return names->longname && fat_name_match(sbi, name, name_len,
+						 names->longname,
+						 names->long_len);
+}
 
-			/* Compare longname */
-			len = fat_uni_to_x8(sbi, unicode, longname, size);
-			if (fat_name_match(sbi, name, name_len, longname, len))
-				goto found;
+/*
+ * Index of the names of a large vfat directory: the long and short name
+ * of each record, hashed the way fat_name_match() compares them, to the
+ * offset of the record. It is built by the first fat_search_long() on the
+ * directory, kept up to date by fat_add_entries() and fat_remove_entries(),
+ * and thrown away if that fails. Everything runs under lock_super(), like
+ * the rest of the directory operations.
+ */
+#define FAT_NAME_HASH_MIN_SIZE	8192	/* bytes of directory entries */
+#define FAT_NAME_HASH_MIN_BITS	6
+#define FAT_NAME_HASH_MAX_BITS	13
+
+struct fat_name_node {
+	struct hlist_node hnode;
+	unsigned int hash;
+	loff_t pos;		/* offset of the first slot of the record */
+};
+
+struct fat_name_hash {
+	unsigned int bits;
+	struct hlist_head table[0];
+};
+
+static struct kmem_cache *fat_name_cachep;
+
+int __init fat_name_hash_init(void)
+{
+	fat_name_cachep = kmem_cache_create("fat_name_hash",
+				sizeof(struct fat_name_node),
+				0, SLAB_RECLAIM_ACCOUNT|SLAB_MEM_SPREAD,
+				NULL);
+	if (fat_name_cachep == NULL)
+		return -ENOMEM;
+	return 0;
+}
+
+void fat_name_hash_destroy(void)
+{
+	kmem_cache_destroy(fat_name_cachep);
+}
+
+static unsigned int fat_name_hash(struct msdos_sb_info *sbi,
+				  const unsigned char *name, int len)
+{
+	unsigned long hash = init_name_hash();
+
+	if (sbi->options.name_check != 's') {
+		while (len--)
+			hash = partial_name_hash(nls_tolower(sbi->nls_io,
+							     *name++), hash);
+	} else {
+		while (len--)
+			hash = partial_name_hash(*name++, hash);
+	}
+	return end_name_hash(hash);
+}
+
+static inline struct hlist_head *fat_name_bucket(struct fat_name_hash *nh,
+						 unsigned int hash)
+{
+	return &nh->table[hash_32(hash, nh->bits)];
+}
+
+void fat_name_hash_free(struct inode *dir)
+{
+	struct fat_name_hash *nh = MSDOS_I(dir)->i_name_hash;
+	struct fat_name_node *node;
+	struct hlist_node *pos, *n;
+	int i;
+
+	if (!nh)
+		return;
+	MSDOS_I(dir)->i_name_hash = NULL;
+
+	for (i = 0; i < (1 << nh->bits); i++) {
+		hlist_for_each_entry_safe(node, pos, n, &nh->table[i], hnode)
+			kmem_cache_free(fat_name_cachep, node);
+	}
+	kfree(nh);
+}
+
+static int fat_name_hash_add(struct fat_name_hash *nh, unsigned int hash,
+			     loff_t pos)
+{
+	struct fat_name_node *node;
+
+	node = kmem_cache_alloc(fat_name_cachep, GFP_NOFS);
+	if (!node)
+		return -ENOMEM;
+	node->hash = hash;
+	node->pos = pos;
+	hlist_add_head(&node->hnode, fat_name_bucket(nh, hash));
+	return 0;
+}
+
+static int fat_name_hash_del(struct fat_name_hash *nh, unsigned int hash,
+			     loff_t pos)
+{
+	struct fat_name_node *node;
+	struct hlist_node *n;
+
+	hlist_for_each_entry(node, n, fat_name_bucket(nh, hash), hnode) {
+		if (node->hash == hash && node->pos == pos) {
+			hlist_del(&node->hnode);
+			kmem_cache_free(fat_name_cachep, node);
+			return 0;
 		}
 	}
+	return -ENOENT;
+}
 
-found:
+/* Adds or removes the names of the record at @pos */
+static int fat_name_hash_update(struct inode *dir, struct fat_name_hash *nh,
+				loff_t pos, struct fat_record_names *names,
+				int add)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(dir->i_sb);
+	unsigned int hash, long_hash;
+	int err;
+
+	hash = fat_name_hash(sbi, names->shortname, names->short_len);
+	err = add ? fat_name_hash_add(nh, hash, pos) :
+		    fat_name_hash_del(nh, hash, pos);
+	if (err || !names->longname)
+		return err;
+
+	long_hash = fat_name_hash(sbi, names->longname, names->long_len);
+	if (long_hash == hash)
+		return 0;
+	return add ? fat_name_hash_add(nh, long_hash, pos) :
+		     fat_name_hash_del(nh, long_hash, pos);
+}
+
+static void fat_name_hash_build(struct inode *dir)
+{
+	struct fat_name_hash *nh;
+	struct fat_record_names names;
+	struct buffer_head *bh = NULL;
+	struct msdos_dir_entry *de = NULL;
+	wchar_t *unicode = NULL;
+	unsigned char nr_slots;
+	unsigned int bits, i;
+	loff_t cpos = 0;
+	int err;
+
+	bits = ilog2(roundup_pow_of_two(dir->i_size >> 6));
+	bits = clamp_t(unsigned int, bits, FAT_NAME_HASH_MIN_BITS,
+		       FAT_NAME_HASH_MAX_BITS);
+	nh = kmalloc(sizeof(*nh) + (sizeof(struct hlist_head) << bits),
+		     GFP_NOFS);
+	if (!nh)
+		return;
+	nh->bits = bits;
+	for (i = 0; i < (1 << bits); i++)
+		INIT_HLIST_HEAD(&nh->table[i]);
+	MSDOS_I(dir)->i_name_hash = nh;
+
+	while (1) {
+		err = fat_next_record(dir, &cpos, &bh, &de, &unicode,
+				      &nr_slots, &names);
+		if (err)
+			break;
+		err = fat_name_hash_update(dir, nh, cpos -
+					   (nr_slots + 1) * sizeof(*de),
+					   &names, 1);
+		if (err) {
+			brelse(bh);
+			break;
+		}
+	}
+	if (err != -ENOENT)
+		fat_name_hash_free(dir);
+	if (unicode)
+		__putname(unicode);
+}
+
+/*
+ * Keeps the index in sync with the record at @pos which is about to be
+ * removed, or which has just been added.
+ */
+static void fat_name_hash_record(struct inode *dir, loff_t pos, int add)
+{
+	struct fat_name_hash *nh = MSDOS_I(dir)->i_name_hash;
+	struct fat_record_names names;
+	struct buffer_head *bh = NULL;
+	struct msdos_dir_entry *de = NULL;
+	wchar_t *unicode = NULL;
+	unsigned char nr_slots;
+	loff_t cpos = pos;
+	int err;
+
+	if (!nh)
+		return;
+
+	err = fat_next_record(dir, &cpos, &bh, &de, &unicode, &nr_slots,
+			      &names);
+	if (!err) {
+		if (cpos - (nr_slots + 1) * sizeof(*de) == pos)
+			err = fat_name_hash_update(dir, nh, pos, &names, add);
+		else
+			err = -EINVAL;
+		brelse(bh);
+	}
+	if (err)
+		fat_name_hash_free(dir);
+	if (unicode)
+		__putname(unicode);
+}
+
+static void fat_fill_slot_info(struct super_block *sb, loff_t cpos,
+			       unsigned char nr_slots, struct buffer_head *bh,
+			       struct msdos_dir_entry *de,
+			       struct fat_slot_info *sinfo)
+{
 	nr_slots++;	/* include the de */
 	sinfo->slot_off = cpos - nr_slots * sizeof(*de);
 	sinfo->nr_slots = nr_slots;
 	sinfo->de = de;
 	sinfo->bh = bh;
 	sinfo->i_pos = fat_make_i_pos(sb, sinfo->bh, sinfo->de);
-	err = 0;
-end_of_dir:
+}
+
+static int fat_search_hashed(struct inode *inode, struct fat_name_hash *nh,
+			     const unsigned char *name, int name_len,
+			     struct fat_slot_info *sinfo)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(inode->i_sb);
+	struct fat_record_names names;
+	struct fat_name_node *node;
+	struct hlist_node *n;
+	wchar_t *unicode = NULL;
+	unsigned char nr_slots;
+	unsigned int hash;
+	int err = -ENOENT;
+
+	hash = fat_name_hash(sbi, name, name_len);
+	hlist_for_each_entry(node, n, fat_name_bucket(nh, hash), hnode) {
+		struct buffer_head *bh = NULL;
+		struct msdos_dir_entry *de = NULL;
+		loff_t cpos = node->pos;
+
+		if (node->hash != hash)
+			continue;
+		err = fat_next_record(inode, &cpos, &bh, &de, &unicode,
+				      &nr_slots, &names);
+		if (err == -ENOENT)
+			continue;
+		if (err < 0)
+			break;
+		if (cpos - (nr_slots + 1) * sizeof(*de) == node->pos &&
+		    fat_record_match(sbi, name, name_len, &names)) {
+			fat_fill_slot_info(inode->i_sb, cpos, nr_slots, bh, de,
+					   sinfo);
+			break;
+		}
+		brelse(bh);
+		err = -ENOENT;
+	}
+	if (unicode)
+		__putname(unicode);
+
+	return err;
+}
+
+/*
+ * Return values: negative -> error, 0 -> not found, positive -> found,
+ * value is the total amount of slots, including the shortname entry.
+ */
+int fat_search_long(struct inode *inode, const unsigned char *name,
+		    int name_len, struct fat_slot_info *sinfo)
+{
+	struct super_block *sb = inode->i_sb;
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+	struct fat_name_hash *nh = MSDOS_I(inode)->i_name_hash;
+	struct fat_record_names names;
+	struct buffer_head *bh = NULL;
+	struct msdos_dir_entry *de = NULL;
+	unsigned char nr_slots;
+	wchar_t *unicode = NULL;
+	loff_t cpos = 0;
+	int err;
+
+	if (!nh && inode->i_size >= FAT_NAME_HASH_MIN_SIZE) {
+		fat_name_hash_build(inode);
+		nh = MSDOS_I(inode)->i_name_hash;
+	}
+	if (nh)
+		return fat_search_hashed(inode, nh, name, name_len, sinfo);
+
+	while (1) {
+		err = fat_next_record(inode, &cpos, &bh, &de, &unicode,
+				      &nr_slots, &names);
+		if (err)
+			break;
+		if (fat_record_match(sbi, name, name_len, &names)) {
+			fat_fill_slot_info(sb, cpos, nr_slots, bh, de, sinfo);
+			break;
+		}
+	}
 	if (unicode)
 		__putname(unicode);
 
@@ -996,6 +1302,8 @@ int fat_remove_entries(struct inode *dir, struct fat_slot_info *sinfo)
 	struct buffer_head *bh;
 	int err = 0, nr_slots;
 
+	fat_name_hash_record(dir, sinfo->slot_off, 0);
+
 	/*
 	 * First stage: Remove the shortname. By this, the directory
 	 * entry is removed.
@@ -1354,6 +1662,7 @@ found:
 	sinfo->de = de;
 	sinfo->bh = bh;
 	sinfo->i_pos = fat_make_i_pos(sb, sinfo->bh, sinfo->de);
+	fat_name_hash_record(dir, pos, 1);
 
 	return 0;
 
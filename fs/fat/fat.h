@@ -6,6 +6,7 @@
 #include <linux/nls.h>
 #include <linux/fs.h>
 #include <linux/mutex.h>
+#include <linux/completion.h>
 #include <linux/msdos_fs.h>
 
 /*
@@ -71,6 +72,10 @@ struct msdos_sb_info {
 	unsigned int prev_free;      /* previously allocated cluster number */
 	unsigned int free_clusters;  /* -1 if undefined */
 	unsigned int free_clus_valid; /* is free_clusters valid? */
+	unsigned long *free_map;     /* free cluster bitmap, see fatent.c */
+	unsigned int free_map_valid; /* is free_map complete? */
+	struct task_struct *free_map_task;
+	struct completion free_map_done;
 	struct fat_mount_options options;
 	struct nls_table *nls_disk;  /* Codepage used on disk */
 	struct nls_table *nls_io;    /* Charset used for input and display */
@@ -106,7 +111,9 @@ struct msdos_inode_info {
 	int i_logstart;		/* logical first cluster */
 	int i_attrs;		/* unused attribute bits */
 	loff_t i_pos;		/* on-disk position of directory entry or 0 */
+	int i_alloc_goal;	/* cluster to allocate next, or 0 */
 	struct hlist_node i_fat_hash;	/* hash by i_location */
+	struct fat_name_hash *i_name_hash; /* vfat name index, see dir.c */
 	struct inode vfs_inode;
 };
 
@@ -248,6 +255,9 @@ extern int fat_alloc_new_dir(struct inode *dir, struct timespec *ts);
 extern int fat_add_entries(struct inode *dir, void *slots, int nr_slots,
 			   struct fat_slot_info *sinfo);
 extern int fat_remove_entries(struct inode *dir, struct fat_slot_info *sinfo);
+extern int fat_name_hash_init(void);
+extern void fat_name_hash_destroy(void);
+extern void fat_name_hash_free(struct inode *dir);
 
 /* fat/fatent.c */
 struct fat_entry {
@@ -297,6 +307,8 @@ extern int fat_alloc_clusters(struct inode *inode, int *cluster,
 			      int nr_cluster);
 extern int fat_free_clusters(struct inode *inode, int cluster);
 extern int fat_count_free_clusters(struct super_block *sb);
+extern void fat_free_map_start(struct super_block *sb);
+extern void fat_free_map_stop(struct super_block *sb);
 
 /* fat/file.c */
 extern int fat_generic_ioctl(struct inode *inode, struct file *filp,
@@ -7,6 +7,8 @@
 #include <linux/fs.h>
 #include <linux/msdos_fs.h>
 #include <linux/blkdev.h>
+#include <linux/kthread.h>
+#include <linux/vmalloc.h>
 #include "fat.h"
 
 struct fatent_operations {
@@ -452,6 +454,92 @@ static void fat_collect_bhs(struct buffer_head **bhs, int *nr_bhs,
 	}
 }
 
+/*
+ * The free cluster bitmap has one bit per cluster, set if the cluster is
+ * free. A kernel thread builds it after mount, and the allocation and free
+ * paths keep it up to date under lock_fat(). Once it is complete
+ * (free_map_valid), the free cluster count is known and the allocator
+ * looks for free clusters in it instead of reading the FAT.
+ */
+#define FAT_ALLOC_EXTENT	64	/* free clusters to restart a file on */
+#define FAT_FREE_MAP_MAX_SIZE	(2 * 1024 * 1024)	/* 16M clusters */
+
+static inline void fat_free_map_mark(struct msdos_sb_info *sbi, int entry,
+				     int free)
+{
+	if (!sbi->free_map)
+		return;
+	if (free)
+		__set_bit(entry, sbi->free_map);
+	else
+		__clear_bit(entry, sbi->free_map);
+}
+
+/*
+ * Finds a free cluster for a file which wants to grow at @goal. If @goal
+ * is taken, prefer the start of a run of FAT_ALLOC_EXTENT free clusters,
+ * so that large files don't end up interleaved with each other. Files
+ * without a goal (new ones) just take the next free cluster.
+ */
+static int fat_free_map_find(struct msdos_sb_info *sbi, int goal)
+{
+	unsigned long *map = sbi->free_map;
+	unsigned long max = sbi->max_cluster;
+	unsigned long start = sbi->prev_free + 1;
+	unsigned long bit, end, limit, first = max;
+	int pass;
+
+	if (goal < FAT_START_ENT || goal >= max) {
+		bit = find_next_bit(map, max, start);
+		if (bit >= max)
+			bit = find_next_bit(map, max, FAT_START_ENT);
+		return bit < max ? bit : -1;
+	}
+	if (test_bit(goal, map))
+		return goal;
+
+	for (pass = 0; pass < 2; pass++) {
+		limit = pass ? start : max;
+		bit = find_next_bit(map, limit, pass ? FAT_START_ENT : start);
+		while (bit < limit) {
+			end = find_next_zero_bit(map, limit, bit);
+			if (end - bit >= FAT_ALLOC_EXTENT)
+				return bit;
+			if (first == max)
+				first = bit;
+			bit = find_next_bit(map, limit, end);
+		}
+	}
+	return first < max ? first : -1;
+}
+
+/* Makes the entry in @fatent the new end of the chain ending at @prev_ent */
+static void fat_alloc_link(struct msdos_sb_info *sbi, struct fat_entry *fatent,
+			   struct fat_entry *prev_ent, struct buffer_head **bhs,
+			   int *nr_bhs)
+{
+	struct fatent_operations *ops = sbi->fatent_ops;
+	int entry = fatent->entry;
+
+	/* make the cluster chain */
+	ops->ent_put(fatent, FAT_ENT_EOF);
+	if (prev_ent->nr_bhs)
+		ops->ent_put(prev_ent, entry);
+
+	fat_collect_bhs(bhs, nr_bhs, fatent);
+	fat_free_map_mark(sbi, entry, 0);
+
+	sbi->prev_free = entry;
+	if (sbi->free_clusters != -1)
+		sbi->free_clusters--;
+
+	/*
+	 * fat_collect_bhs() gets ref-count of bhs,
+	 * so we can still use the prev_ent.
+	 */
+	*prev_ent = *fatent;
+}
+
 int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 {
 	struct super_block *sb = inode->i_sb;
@@ -471,9 +559,39 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 	}
 
 	err = nr_bhs = idx_clus = 0;
-	count = FAT_START_ENT;
 	fatent_init(&prev_ent);
 	fatent_init(&fatent);
+
+	if (sbi->free_map_valid) {
+		int entry, goal = MSDOS_I(inode)->i_alloc_goal;
+
+		while ((entry = fat_free_map_find(sbi, goal)) >= 0) {
+			fatent_set_entry(&fatent, entry);
+			err = fat_ent_read_block(sb, &fatent);
+			if (err)
+				goto out;
+			if (ops->ent_get(&fatent) != FAT_ENT_FREE) {
+				printk(KERN_WARNING "FAT: free cluster bitmap "
+				       "out of sync, dropping it\n");
+				sbi->free_map_valid = 0;
+				vfree(sbi->free_map);
+				sbi->free_map = NULL;
+				goto scan;
+			}
+
+			fat_alloc_link(sbi, &fatent, &prev_ent, bhs, &nr_bhs);
+			sb->s_dirt = 1;
+			cluster[idx_clus] = entry;
+			idx_clus++;
+			if (idx_clus == nr_cluster)
+				goto out;
+			goal = entry + 1;
+		}
+		goto nospace;
+	}
+
+scan:
+	count = FAT_START_ENT;
 	fatent_set_entry(&fatent, sbi->prev_free + 1);
 	while (count < sbi->max_cluster) {
 		if (fatent.entry >= sbi->max_cluster)
@@ -488,28 +606,14 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 			if (ops->ent_get(&fatent) == FAT_ENT_FREE) {
 				int entry = fatent.entry;
 
-				/* make the cluster chain */
-				ops->ent_put(&fatent, FAT_ENT_EOF);
-				if (prev_ent.nr_bhs)
-					ops->ent_put(&prev_ent, entry);
-
-				fat_collect_bhs(bhs, &nr_bhs, &fatent);
-
-				sbi->prev_free = entry;
-				if (sbi->free_clusters != -1)
-					sbi->free_clusters--;
+				fat_alloc_link(sbi, &fatent, &prev_ent, bhs,
+					       &nr_bhs);
 				sb->s_dirt = 1;
 
 				cluster[idx_clus] = entry;
 				idx_clus++;
 				if (idx_clus == nr_cluster)
 					goto out;
-
-				/*
-				 * fat_collect_bhs() gets ref-count of bhs,
-				 * so we can still use the prev_ent.
-				 */
-				prev_ent = fatent;
 			}
 			count++;
 			if (count == sbi->max_cluster)
@@ -517,6 +621,7 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 		} while (fat_ent_next(sbi, &fatent));
 	}
 
+nospace:
 	/* Couldn't allocate the free entries */
 	sbi->free_clusters = 0;
 	sbi->free_clus_valid = 1;
@@ -524,6 +629,9 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 	err = -ENOSPC;
 
 out:
+	/* Continue after the last cluster, the chain may be fragmented */
+	if (!err)
+		MSDOS_I(inode)->i_alloc_goal = cluster[nr_cluster - 1] + 1;
 	unlock_fat(sbi);
 	fatent_brelse(&fatent);
 	if (!err) {
@@ -584,6 +692,7 @@ int fat_free_clusters(struct inode *inode, int cluster)
 		}
 
 		ops->ent_put(&fatent, FAT_ENT_FREE);
+		fat_free_map_mark(sbi, fatent.entry, 1);
 		if (sbi->free_clusters != -1) {
 			sbi->free_clusters++;
 			sb->s_dirt = 1;
@@ -646,6 +755,13 @@ int fat_count_free_clusters(struct super_block *sb)
 	unsigned long reada_blocks, reada_mask, cur_block;
 	int err = 0, free;
 
+	/* The bitmap thread reads the whole FAT anyway, and counts */
+	if (sbi->free_map_task) {
+		wait_for_completion(&sbi->free_map_done);
+		if (sbi->free_map_valid)
+			return 0;
+	}
+
 	lock_fat(sbi);
 	if (sbi->free_clusters != -1 && sbi->free_clus_valid)
 		goto out;
@@ -682,3 +798,103 @@ out:
 	unlock_fat(sbi);
 	return err;
 }
+
+static int fat_free_map_thread(void *data)
+{
+	struct super_block *sb = data;
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+	struct fatent_operations *ops = sbi->fatent_ops;
+	struct fat_entry fatent;
+	unsigned long reada_blocks, reada_mask, cur_block;
+	int err = 0;
+
+	reada_blocks = FAT_READA_SIZE >> sb->s_blocksize_bits;
+	reada_mask = reada_blocks - 1;
+	cur_block = 0;
+
+	fatent_init(&fatent);
+	fatent_set_entry(&fatent, FAT_START_ENT);
+	while (fatent.entry < sbi->max_cluster) {
+		if (kthread_should_stop()) {
+			err = -EINTR;
+			break;
+		}
+
+		/* readahead of fat blocks */
+		if ((cur_block & reada_mask) == 0) {
+			unsigned long rest = sbi->fat_length - cur_block;
+			fat_ent_reada(sb, &fatent, min(reada_blocks, rest));
+		}
+		cur_block++;
+
+		/* let the allocator in between blocks */
+		lock_fat(sbi);
+		err = fat_ent_read_block(sb, &fatent);
+		if (err) {
+			unlock_fat(sbi);
+			break;
+		}
+		do {
+			fat_free_map_mark(sbi, fatent.entry,
+					  ops->ent_get(&fatent) == FAT_ENT_FREE);
+		} while (fat_ent_next(sbi, &fatent));
+		unlock_fat(sbi);
+		cond_resched();
+	}
+	fatent_brelse(&fatent);
+
+	lock_fat(sbi);
+	if (!err && sbi->free_map) {
+		sbi->free_clusters = bitmap_weight(sbi->free_map,
+						   sbi->max_cluster);
+		sbi->free_clus_valid = 1;
+		sbi->free_map_valid = 1;
+		sb->s_dirt = 1;
+	}
+	unlock_fat(sbi);
+
+	complete_all(&sbi->free_map_done);
+	return err;
+}
+
+/* Starts building the free cluster bitmap, called at the end of mount */
+void fat_free_map_start(struct super_block *sb)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+	unsigned long size = BITS_TO_LONGS(sbi->max_cluster) *
+			     sizeof(unsigned long);
+	struct task_struct *task;
+
+	if (size > FAT_FREE_MAP_MAX_SIZE)
+		return;
+	sbi->free_map = vmalloc(size);
+	if (!sbi->free_map)
+		return;
+	memset(sbi->free_map, 0, size);
+	init_completion(&sbi->free_map_done);
+
+	task = kthread_create(fat_free_map_thread, sb, "fat-map/%s", sb->s_id);
+	if (IS_ERR(task)) {
+		vfree(sbi->free_map);
+		sbi->free_map = NULL;
+		return;
+	}
+	/* fat_free_map_stop() may run after the thread has exited */
+	get_task_struct(task);
+	sbi->free_map_task = task;
+	wake_up_process(task);
+}
+
+void fat_free_map_stop(struct super_block *sb)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+
+	if (sbi->free_map_task) {
+		kthread_stop(sbi->free_map_task);
+		put_task_struct(sbi->free_map_task);
+		sbi->free_map_task = NULL;
+	}
+	sbi->free_map_valid = 0;
+	vfree(sbi->free_map);
+	sbi->free_map = NULL;
+}
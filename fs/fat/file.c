@@ -265,6 +265,7 @@ static int fat_free(struct inode *inode, int skip)
 		free_start = ret;
 	}
 	inode->i_blocks = skip << (MSDOS_SB(sb)->cluster_bits - 9);
+	MSDOS_I(inode)->i_alloc_goal = 0;
 
 	/* Freeing the remained cluster chain */
 	return fat_free_clusters(inode, free_start);
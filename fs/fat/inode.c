@@ -436,6 +436,7 @@ static void fat_delete_inode(struct inode *inode)
 static void fat_clear_inode(struct inode *inode)
 {
 	fat_cache_inval_inode(inode);
+	fat_name_hash_free(inode);
 	fat_detach(inode);
 }
 
@@ -469,6 +470,8 @@ static void fat_put_super(struct super_block *sb)
 
 	lock_kernel();
 
+	fat_free_map_stop(sb);
+
 	if (sb->s_dirt)
 		fat_write_super(sb);
 
@@ -494,6 +497,7 @@ static struct inode *fat_alloc_inode(struct super_block *sb)
 	ei = kmem_cache_alloc(fat_inode_cachep, GFP_NOFS);
 	if (!ei)
 		return NULL;
+	ei->i_alloc_goal = 0;
 	return &ei->vfs_inode;
 }
 
@@ -511,6 +515,7 @@ static void init_once(void *foo)
 	ei->cache_valid_id = FAT_CACHE_VALID + 1;
 	INIT_LIST_HEAD(&ei->cache_lru);
 	INIT_HLIST_NODE(&ei->i_fat_hash);
+	ei->i_name_hash = NULL;
 	inode_init_once(&ei->vfs_inode);
 }
 
@@ -1488,6 +1493,8 @@ int fat_fill_super(struct super_block *sb, void *data, int silent,
 		goto out_fail;
 	}
 
+	fat_free_map_start(sb);
+
 	return 0;
 
 out_invalid:
@@ -1572,12 +1579,18 @@ static int __init init_fat_fs(void)
 	if (err)
 		return err;
 
-	err = fat_init_inodecache();
+	err = fat_name_hash_init();
 	if (err)
 		goto failed;
 
+	err = fat_init_inodecache();
+	if (err)
+		goto failed_name_hash;
+
 	return 0;
 
+failed_name_hash:
+	fat_name_hash_destroy();
 failed:
 	fat_cache_destroy();
 	return err;
@@ -1586,6 +1599,7 @@ failed:
 static void __exit exit_fat_fs(void)
 {
 	fat_cache_destroy();
+	fat_name_hash_destroy();
 	fat_destroy_inodecache();
 }
 
@@ -10,6 +10,7 @@
 
 #include <linux/init.h>
 #include <linux/module.h>
+#include <linux/seq_file.h>
 
 #define FUSE_CTL_SUPER_MAGIC 0x65735543
 
@@ -176,6 +177,118 @@ static ssize_t fuse_conn_congestion_threshold_write(struct file *file,
 	return ret;
 }
 
+static ssize_t fuse_conn_max_file_background_read(struct file *file,
+						  char __user *buf, size_t len,
+						  loff_t *ppos)
+{
+	struct fuse_conn *fc;
+	unsigned val;
+
+	fc = fuse_ctl_file_conn_get(file);
+	if (!fc)
+		return 0;
+
+	val = fc->max_file_background;
+	fuse_conn_put(fc);
+
+	return fuse_conn_limit_read(file, buf, len, ppos, val);
+}
+
+static ssize_t fuse_conn_max_file_background_write(struct file *file,
+						   const char __user *buf,
+						   size_t count, loff_t *ppos)
+{
+	unsigned val;
+	ssize_t ret;
+
+	ret = fuse_conn_limit_write(file, buf, count, ppos, &val,
+				    max_user_bgreq);
+	if (ret > 0) {
+		struct fuse_conn *fc = fuse_ctl_file_conn_get(file);
+		if (fc) {
+			fc->max_file_background = val;
+			fuse_conn_put(fc);
+		}
+	}
+
+	return ret;
+}
+
+static ssize_t fuse_conn_chan_steering_read(struct file *file,
+					    char __user *buf, size_t len,
+					    loff_t *ppos)
+{
+	struct fuse_conn *fc;
+	unsigned val;
+
+	fc = fuse_ctl_file_conn_get(file);
+	if (!fc)
+		return 0;
+
+	val = fc->chan_steering;
+	fuse_conn_put(fc);
+
+	return fuse_conn_limit_read(file, buf, len, ppos, val);
+}
+
+static ssize_t fuse_conn_chan_steering_write(struct file *file,
+					     const char __user *buf,
+					     size_t count, loff_t *ppos)
+{
+	unsigned val;
+	ssize_t ret;
+
+	ret = fuse_conn_limit_write(file, buf, count, ppos, &val,
+				    FUSE_STEER_CPU);
+	if (ret > 0) {
+		struct fuse_conn *fc;
+
+		if (val > FUSE_STEER_CPU)
+			return -EINVAL;
+
+		fc = fuse_ctl_file_conn_get(file);
+		if (fc) {
+			fc->chan_steering = val;
+			fuse_conn_put(fc);
+		}
+	}
+
+	return ret;
+}
+
+static int fuse_conn_stats_show(struct seq_file *m, void *v)
+{
+	struct fuse_conn *fc = fuse_ctl_file_conn_get(m->private);
+	unsigned i;
+
+	if (!fc)
+		return 0;
+
+	spin_lock(&fc->lock);
+	seq_printf(m, "lock_acquired %llu\n",
+		   (unsigned long long) fc->lock_acquired);
+	seq_printf(m, "lock_contended %llu\n",
+		   (unsigned long long) fc->lock_contended);
+	seq_printf(m, "lock_wait_ns %llu\n",
+		   (unsigned long long) fc->lock_wait_ns);
+	seq_printf(m, "channels %u\n", fc->num_chans);
+	for (i = 0; i < fc->num_chans; i++) {
+		struct fuse_chan *chan = fc->chans[i];
+
+		seq_printf(m, "channel%u queued %lu read %lu stolen %lu\n",
+			   i, chan->queued, chan->read, chan->stolen);
+	}
+	spin_unlock(&fc->lock);
+	fuse_conn_put(fc);
+
+	return 0;
+}
+
+static int fuse_conn_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fuse_conn_stats_show, file);
+}
+
 static const struct file_operations fuse_ctl_abort_ops = {
 	.open = nonseekable_open,
 	.write = fuse_conn_abort_write,
@@ -198,6 +311,25 @@ static const struct file_operations fuse_conn_congestion_threshold_ops = {
 	.write = fuse_conn_congestion_threshold_write,
 };
 
+static const struct file_operations fuse_conn_max_file_background_ops = {
+	.open = nonseekable_open,
+	.read = fuse_conn_max_file_background_read,
+	.write = fuse_conn_max_file_background_write,
+};
+
+static const struct file_operations fuse_conn_chan_steering_ops = {
+	.open = nonseekable_open,
+	.read = fuse_conn_chan_steering_read,
+	.write = fuse_conn_chan_steering_write,
+};
+
+static const struct file_operations fuse_ctl_stats_ops = {
+	.open = fuse_conn_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static struct dentry *fuse_ctl_add_dentry(struct dentry *parent,
 					  struct fuse_conn *fc,
 					  const char *name,
@@ -261,7 +393,15 @@ int fuse_ctl_add_conn(struct fuse_conn *fc)
 				 1, NULL, &fuse_conn_max_background_ops) ||
 	    !fuse_ctl_add_dentry(parent, fc, "congestion_threshold",
 				 S_IFREG | 0600, 1, NULL,
-				 &fuse_conn_congestion_threshold_ops))
+				 &fuse_conn_congestion_threshold_ops) ||
+	    !fuse_ctl_add_dentry(parent, fc, "max_file_background",
+				 S_IFREG | 0600, 1, NULL,
+				 &fuse_conn_max_file_background_ops) ||
+	    !fuse_ctl_add_dentry(parent, fc, "channel_steering",
+				 S_IFREG | 0600, 1, NULL,
+				 &fuse_conn_chan_steering_ops) ||
+	    !fuse_ctl_add_dentry(parent, fc, "stats", S_IFREG | 0400, 1,
+				 NULL, &fuse_ctl_stats_ops))
 		goto err;
 
 	return 0;
@@ -487,7 +487,8 @@ static int cuse_channel_open(struct inode *inode, struct file *file)
 		fuse_conn_put(&cc->fc);
 		return rc;
 	}
-	file->private_data = &cc->fc;	/* channel owns base reference to cc */
+	/* channel owns base reference to cc */
+	file->private_data = &cc->fc.main_chan;
 
 	return 0;
 }
@@ -505,7 +506,8 @@ static int cuse_channel_open(struct inode *inode, struct file *file)
  */
 static int cuse_channel_release(struct inode *inode, struct file *file)
 {
-	struct cuse_conn *cc = fc_to_cc(file->private_data);
+	struct fuse_chan *chan = file->private_data;
+	struct cuse_conn *cc = fc_to_cc(chan->fc);
 	int rc;
 
 	/* remove from the conntbl, no more access from this point on */
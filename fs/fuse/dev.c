@@ -16,20 +16,147 @@
 #include <linux/pagemap.h>
 #include <linux/file.h>
 #include <linux/slab.h>
+#include <linux/pipe_fs_i.h>
+#include <linux/swap.h>
+#include <linux/splice.h>
+#include <linux/hash.h>
+#include <linux/sched.h>
 
 MODULE_ALIAS_MISCDEV(FUSE_MINOR);
 
 static struct kmem_cache *fuse_req_cachep;
 
-static struct fuse_conn *fuse_get_conn(struct file *file)
+static struct fuse_chan *fuse_get_chan(struct file *file)
 {
 	/*
 	 * Lockless access is OK, because file->private data is set
-	 * once during mount and is valid until the file is released.
+	 * once during mount (or clone) and is valid until the file is
+	 * released.
 	 */
 	return file->private_data;
 }
 
+static struct fuse_conn *fuse_get_conn(struct file *file)
+{
+	struct fuse_chan *chan = fuse_get_chan(file);
+
+	return chan ? chan->fc : NULL;
+}
+
+/*
+ * Take fc->lock on the request paths, accounting for contention.  The
+ * counters are updated with the lock held, and can be read from the
+ * "stats" file of the connection in the control filesystem.
+ */
+static void fuse_conn_lock(struct fuse_conn *fc)
+__acquires(&fc->lock)
+{
+	u64 start;
+	s64 wait;
+
+	if (spin_trylock(&fc->lock)) {
+		fc->lock_acquired++;
+		return;
+	}
+	start = cpu_clock(raw_smp_processor_id());
+	spin_lock(&fc->lock);
+	wait = cpu_clock(raw_smp_processor_id()) - start;
+	fc->lock_acquired++;
+	fc->lock_contended++;
+	if (wait > 0)
+		fc->lock_wait_ns += wait;
+}
+
+void fuse_chan_init(struct fuse_chan *chan, struct fuse_conn *fc)
+{
+	memset(chan, 0, sizeof(*chan));
+	chan->fc = fc;
+	init_waitqueue_head(&chan->waitq);
+	INIT_LIST_HEAD(&chan->pending);
+}
+
+/*
+ * Choose the channel of a new request.  Steering by inode keeps the
+ * requests of a file on one daemon thread, steering by CPU spreads
+ * the requests of a single busy file too.
+ */
+static struct fuse_chan *fuse_chan_steer(struct fuse_conn *fc,
+					 struct fuse_req *req)
+{
+	unsigned i;
+
+	if (fc->num_chans == 1)
+		return &fc->main_chan;
+
+	if (fc->chan_steering == FUSE_STEER_INODE && req->in.h.nodeid)
+		i = hash_64(req->in.h.nodeid, 32) % fc->num_chans;
+	else
+		i = raw_smp_processor_id() % fc->num_chans;
+
+	return fc->chans[i];
+}
+
+/*
+ * Wake up a reader for a request queued on @chan.  Nobody waiting on
+ * the channel means its daemon thread is busy, in which case an idle
+ * reader of another channel is woken instead, and takes the request
+ * over.
+ */
+static void fuse_chan_kick(struct fuse_conn *fc, struct fuse_chan *chan)
+{
+	unsigned i;
+
+	if (!waitqueue_active(&chan->waitq)) {
+		for (i = 0; i < fc->num_chans; i++) {
+			if (waitqueue_active(&fc->chans[i]->waitq)) {
+				chan = fc->chans[i];
+				break;
+			}
+		}
+	}
+	wake_up(&chan->waitq);
+	kill_fasync(&chan->fasync, SIGIO, POLL_IN);
+}
+
+/*
+ * Choose the channel to read the next request from: @chan itself if it
+ * has pending requests, otherwise the first one which has.
+ */
+static struct fuse_chan *fuse_chan_pick(struct fuse_chan *chan)
+{
+	struct fuse_conn *fc = chan->fc;
+	unsigned i;
+
+	if (!list_empty(&chan->pending))
+		return chan;
+
+	for (i = 0; i < fc->num_chans; i++)
+		if (!list_empty(&fc->chans[i]->pending))
+			return fc->chans[i];
+
+	return NULL;
+}
+
+/* Move the pending requests of all channels to the main one */
+static void fuse_chans_gather(struct fuse_conn *fc)
+{
+	unsigned i;
+
+	for (i = 1; i < fc->num_chans; i++)
+		list_splice_tail_init(&fc->chans[i]->pending,
+				      &fc->main_chan.pending);
+}
+
+void fuse_wake_readers(struct fuse_conn *fc)
+{
+	unsigned i;
+
+	for (i = 0; i < fc->num_chans; i++) {
+		wake_up_all(&fc->chans[i]->waitq);
+		kill_fasync(&fc->chans[i]->fasync, SIGIO, POLL_IN);
+	}
+}
+
 static void fuse_request_init(struct fuse_req *req)
 {
 	memset(req, 0, sizeof(*req));
@@ -235,17 +362,19 @@ static u64 fuse_get_unique(struct fuse_conn *fc)
 
 static void queue_request(struct fuse_conn *fc, struct fuse_req *req)
 {
+	struct fuse_chan *chan = fuse_chan_steer(fc, req);
+
 	req->in.h.unique = fuse_get_unique(fc);
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		len_args(req->in.numargs, (struct fuse_arg *) req->in.args);
-	list_add_tail(&req->list, &fc->pending);
+	list_add_tail(&req->list, &chan->pending);
+	chan->queued++;
 	req->state = FUSE_REQ_PENDING;
 	if (!req->waiting) {
 		req->waiting = 1;
 		atomic_inc(&fc->num_waiting);
 	}
-	wake_up(&fc->waitq);
-	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
+	fuse_chan_kick(fc, chan);
 }
 
 static void flush_bg_queue(struct fuse_conn *fc)
@@ -316,8 +445,7 @@ __acquires(&fc->lock)
 static void queue_interrupt(struct fuse_conn *fc, struct fuse_req *req)
 {
 	list_add_tail(&req->intr_entry, &fc->interrupts);
-	wake_up(&fc->waitq);
-	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
+	fuse_chan_kick(fc, &fc->main_chan);
 }
 
 static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
@@ -388,7 +516,7 @@ __acquires(&fc->lock)
 void fuse_request_send(struct fuse_conn *fc, struct fuse_req *req)
 {
 	req->isreply = 1;
-	spin_lock(&fc->lock);
+	fuse_conn_lock(fc);
 	if (!fc->connected)
 		req->out.h.error = -ENOTCONN;
 	else if (fc->conn_error)
@@ -423,7 +551,7 @@ static void fuse_request_send_nowait_locked(struct fuse_conn *fc,
 
 static void fuse_request_send_nowait(struct fuse_conn *fc, struct fuse_req *req)
 {
-	spin_lock(&fc->lock);
+	fuse_conn_lock(fc);
 	if (fc->connected) {
 		fuse_request_send_nowait_locked(fc, req);
 		spin_unlock(&fc->lock);
@@ -467,7 +595,7 @@ static int lock_request(struct fuse_conn *fc, struct fuse_req *req)
 {
 	int err = 0;
 	if (req) {
-		spin_lock(&fc->lock);
+		fuse_conn_lock(fc);
 		if (req->aborted)
 			err = -ENOENT;
 		else
@@ -485,7 +613,7 @@ static int lock_request(struct fuse_conn *fc, struct fuse_req *req)
 static void unlock_request(struct fuse_conn *fc, struct fuse_req *req)
 {
 	if (req) {
-		spin_lock(&fc->lock);
+		fuse_conn_lock(fc);
 		req->locked = 0;
 		if (req->aborted)
 			wake_up(&req->waitq);
@@ -493,11 +621,20 @@ static void unlock_request(struct fuse_conn *fc, struct fuse_req *req)
 	}
 }
 
+/*
+ * The userspace side of the copy is either an iovec (read/write) or an
+ * array of pipe buffers (splice).  For a splice read the pipe buffers
+ * are filled here and nr_segs counts the used ones, for a splice write
+ * they were taken from the pipe and nr_segs counts the remaining ones.
+ */
 struct fuse_copy_state {
 	struct fuse_conn *fc;
 	int write;
 	struct fuse_req *req;
 	const struct iovec *iov;
+	struct pipe_buffer *pipebufs;
+	struct pipe_buffer *currbuf;
+	struct pipe_inode_info *pipe;
 	unsigned long nr_segs;
 	unsigned long seglen;
 	unsigned long addr;
@@ -505,6 +642,7 @@ struct fuse_copy_state {
 	void *mapaddr;
 	void *buf;
 	unsigned len;
+	unsigned move_pages:1;
 };
 
 static void fuse_copy_init(struct fuse_copy_state *cs, struct fuse_conn *fc,
@@ -522,8 +660,19 @@ static void fuse_copy_init(struct fuse_copy_state *cs, struct fuse_conn *fc,
 /* Unmap and put previous page of userspace buffer */
 static void fuse_copy_finish(struct fuse_copy_state *cs)
 {
-	if (cs->mapaddr) {
-		kunmap_atomic(cs->mapaddr, KM_USER0);
+	if (cs->currbuf) {
+		struct pipe_buffer *buf = cs->currbuf;
+
+		if (!cs->write) {
+			buf->ops->unmap(cs->pipe, buf, cs->mapaddr);
+		} else {
+			kunmap(buf->page);
+			buf->len = PAGE_SIZE - cs->len;
+		}
+		cs->currbuf = NULL;
+		cs->mapaddr = NULL;
+	} else if (cs->mapaddr) {
+		kunmap(cs->pg);
 		if (cs->write) {
 			flush_dcache_page(cs->pg);
 			set_page_dirty_lock(cs->pg);
@@ -544,26 +693,64 @@ static int fuse_copy_fill(struct fuse_copy_state *cs)
 
 	unlock_request(cs->fc, cs->req);
 	fuse_copy_finish(cs);
-	if (!cs->seglen) {
-		BUG_ON(!cs->nr_segs);
-		cs->seglen = cs->iov[0].iov_len;
-		cs->addr = (unsigned long) cs->iov[0].iov_base;
-		cs->iov++;
-		cs->nr_segs--;
+	if (cs->pipebufs) {
+		struct pipe_buffer *buf = cs->pipebufs;
+
+		if (!cs->write) {
+			err = buf->ops->confirm(cs->pipe, buf);
+			if (err)
+				return err;
+
+			BUG_ON(!cs->nr_segs);
+			cs->currbuf = buf;
+			cs->mapaddr = buf->ops->map(cs->pipe, buf, 0);
+			cs->len = buf->len;
+			cs->buf = cs->mapaddr + buf->offset;
+			cs->pipebufs++;
+			cs->nr_segs--;
+		} else {
+			struct page *page;
+
+			if (cs->nr_segs == PIPE_BUFFERS)
+				return -EIO;
+
+			page = alloc_page(GFP_HIGHUSER);
+			if (!page)
+				return -ENOMEM;
+
+			buf->page = page;
+			buf->offset = 0;
+			buf->len = 0;
+
+			cs->currbuf = buf;
+			cs->mapaddr = kmap(page);
+			cs->buf = cs->mapaddr;
+			cs->len = PAGE_SIZE;
+			cs->pipebufs++;
+			cs->nr_segs++;
+		}
+	} else {
+		if (!cs->seglen) {
+			BUG_ON(!cs->nr_segs);
+			cs->seglen = cs->iov[0].iov_len;
+			cs->addr = (unsigned long) cs->iov[0].iov_base;
+			cs->iov++;
+			cs->nr_segs--;
+		}
+		down_read(&current->mm->mmap_sem);
+		err = get_user_pages(current, current->mm, cs->addr, 1,
+				     cs->write, 0, &cs->pg, NULL);
+		up_read(&current->mm->mmap_sem);
+		if (err < 0)
+			return err;
+		BUG_ON(err != 1);
+		offset = cs->addr % PAGE_SIZE;
+		cs->mapaddr = kmap(cs->pg);
+		cs->buf = cs->mapaddr + offset;
+		cs->len = min(PAGE_SIZE - offset, cs->seglen);
+		cs->seglen -= cs->len;
+		cs->addr += cs->len;
 	}
-	down_read(&current->mm->mmap_sem);
-	err = get_user_pages(current, current->mm, cs->addr, 1, cs->write, 0,
-			     &cs->pg, NULL);
-	up_read(&current->mm->mmap_sem);
-	if (err < 0)
-		return err;
-	BUG_ON(err != 1);
-	offset = cs->addr % PAGE_SIZE;
-	cs->mapaddr = kmap_atomic(cs->pg, KM_USER0);
-	cs->buf = cs->mapaddr + offset;
-	cs->len = min(PAGE_SIZE - offset, cs->seglen);
-	cs->seglen -= cs->len;
-	cs->addr += cs->len;
 
 	return lock_request(cs->fc, cs->req);
 }
@@ -585,23 +772,193 @@ static int fuse_copy_do(struct fuse_copy_state *cs, void **val, unsigned *size)
 	return ncpy;
 }
 
+static int fuse_check_page(struct page *page)
+{
+	if (page_mapcount(page) ||
+	    page->mapping != NULL ||
+	    page_count(page) != 1 ||
+	    (page->flags & PAGE_FLAGS_CHECK_AT_PREP &
+	     ~(1 << PG_locked |
+	       1 << PG_referenced |
+	       1 << PG_uptodate |
+	       1 << PG_lru |
+	       1 << PG_active |
+	       1 << PG_reclaim))) {
+		printk(KERN_WARNING "fuse: trying to steal weird page\n");
+		printk(KERN_WARNING "  page=%p index=%li flags=%08lx, "
+		       "count=%i, mapcount=%i, mapping=%p\n", page,
+		       page->index, page->flags, page_count(page),
+		       page_mapcount(page), page->mapping);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Replace a page of a readpages request with the page in the next pipe
+ * buffer, if the buffer can be stolen.  Returns 1 if the data must be
+ * copied instead, in which case the buffer is mapped for the copy.
+ */
+static int fuse_try_move_page(struct fuse_copy_state *cs, struct page **pagep)
+{
+	int err;
+	struct page *oldpage = *pagep;
+	struct page *newpage;
+	struct pipe_buffer *buf = cs->pipebufs;
+	struct address_space *mapping;
+	pgoff_t index;
+
+	unlock_request(cs->fc, cs->req);
+	fuse_copy_finish(cs);
+
+	err = buf->ops->confirm(cs->pipe, buf);
+	if (err)
+		return err;
+
+	BUG_ON(!cs->nr_segs);
+	cs->currbuf = buf;
+	cs->len = buf->len;
+	cs->pipebufs++;
+	cs->nr_segs--;
+
+	if (cs->len != PAGE_SIZE)
+		goto out_fallback;
+
+	if (buf->ops->steal(cs->pipe, buf) != 0)
+		goto out_fallback;
+
+	newpage = buf->page;
+
+	if (WARN_ON(!PageUptodate(newpage)))
+		return -EIO;
+
+	ClearPageMappedToDisk(newpage);
+
+	if (fuse_check_page(newpage) != 0)
+		goto out_fallback_unlock;
+
+	mapping = oldpage->mapping;
+	index = oldpage->index;
+
+	/*
+	 * This is a new and locked page, it shouldn't be mapped or
+	 * have any special flags on it
+	 */
+	if (WARN_ON(page_mapped(oldpage)))
+		goto out_fallback_unlock;
+	if (WARN_ON(page_has_private(oldpage)))
+		goto out_fallback_unlock;
+	if (WARN_ON(PageDirty(oldpage) || PageWriteback(oldpage)))
+		goto out_fallback_unlock;
+	if (WARN_ON(PageMlocked(oldpage)))
+		goto out_fallback_unlock;
+
+	/* the data is not used yet, keep the readahead accounting right */
+	if (TestClearPagePrefetched(oldpage))
+		SetPagePrefetched(newpage);
+	remove_from_page_cache(oldpage);
+	page_cache_release(oldpage);
+
+	err = add_to_page_cache_locked(newpage, mapping, index, GFP_KERNEL);
+	if (err) {
+		printk(KERN_WARNING "fuse_try_move_page: failed to add page\n");
+		goto out_fallback_unlock;
+	}
+	page_cache_get(newpage);
+
+	if (!(buf->flags & PIPE_BUF_FLAG_LRU))
+		lru_cache_add_file(newpage);
+
+	err = 0;
+	spin_lock(&cs->fc->lock);
+	if (cs->req->aborted)
+		err = -ENOENT;
+	else
+		*pagep = newpage;
+	spin_unlock(&cs->fc->lock);
+
+	if (err) {
+		unlock_page(newpage);
+		page_cache_release(newpage);
+		return err;
+	}
+
+	unlock_page(oldpage);
+	page_cache_release(oldpage);
+	cs->len = 0;
+
+	return 0;
+
+out_fallback_unlock:
+	unlock_page(newpage);
+out_fallback:
+	cs->mapaddr = buf->ops->map(cs->pipe, buf, 0);
+	cs->buf = cs->mapaddr + buf->offset;
+
+	err = lock_request(cs->fc, cs->req);
+	if (err)
+		return err;
+
+	return 1;
+}
+
+/*
+ * Hand a page of the request to the pipe instead of copying it.  The
+ * pipe buffer holds its own reference to the page.
+ */
+static int fuse_ref_page(struct fuse_copy_state *cs, struct page *page,
+			 unsigned offset, unsigned count)
+{
+	struct pipe_buffer *buf;
+
+	if (cs->nr_segs == PIPE_BUFFERS)
+		return -EIO;
+
+	unlock_request(cs->fc, cs->req);
+	fuse_copy_finish(cs);
+
+	buf = cs->pipebufs;
+	page_cache_get(page);
+	buf->page = page;
+	buf->offset = offset;
+	buf->len = count;
+
+	cs->pipebufs++;
+	cs->nr_segs++;
+	cs->len = 0;
+
+	return 0;
+}
+
 /*
  * Copy a page in the request to/from the userspace buffer.  Must be
  * done atomically
  */
-static int fuse_copy_page(struct fuse_copy_state *cs, struct page *page,
+static int fuse_copy_page(struct fuse_copy_state *cs, struct page **pagep,
 			  unsigned offset, unsigned count, int zeroing)
 {
+	int err;
+	struct page *page = *pagep;
+
 	if (page && zeroing && count < PAGE_SIZE) {
 		void *mapaddr = kmap_atomic(page, KM_USER1);
 		memset(mapaddr, 0, PAGE_SIZE);
 		kunmap_atomic(mapaddr, KM_USER1);
 	}
 	while (count) {
-		if (!cs->len) {
-			int err = fuse_copy_fill(cs);
-			if (err)
-				return err;
+		if (cs->write && cs->pipebufs && page) {
+			return fuse_ref_page(cs, page, offset, count);
+		} else if (!cs->len) {
+			if (cs->move_pages && page &&
+			    offset == 0 && count == PAGE_SIZE) {
+				err = fuse_try_move_page(cs, pagep);
+				if (err <= 0)
+					return err;
+			} else {
+				err = fuse_copy_fill(cs);
+				if (err)
+					return err;
+			}
 		}
 		if (page) {
 			void *mapaddr = kmap_atomic(page, KM_USER1);
@@ -626,8 +983,10 @@ static int fuse_copy_pages(struct fuse_copy_state *cs, unsigned nbytes,
 	unsigned count = min(nbytes, (unsigned) PAGE_SIZE - offset);
 
 	for (i = 0; i < req->num_pages && (nbytes || zeroing); i++) {
-		struct page *page = req->pages[i];
-		int err = fuse_copy_page(cs, page, offset, count, zeroing);
+		int err;
+
+		err = fuse_copy_page(cs, &req->pages[i], offset, count,
+				     zeroing);
 		if (err)
 			return err;
 
@@ -670,20 +1029,20 @@ static int fuse_copy_args(struct fuse_copy_state *cs, unsigned numargs,
 	return err;
 }
 
-static int request_pending(struct fuse_conn *fc)
+static int request_pending(struct fuse_chan *chan)
 {
-	return !list_empty(&fc->pending) || !list_empty(&fc->interrupts);
+	return fuse_chan_pick(chan) || !list_empty(&chan->fc->interrupts);
 }
 
-/* Wait until a request is available on the pending list */
-static void request_wait(struct fuse_conn *fc)
+/* Wait until a request is available on the pending lists */
+static void request_wait(struct fuse_conn *fc, struct fuse_chan *chan)
 __releases(&fc->lock)
 __acquires(&fc->lock)
 {
 	DECLARE_WAITQUEUE(wait, current);
 
-	add_wait_queue_exclusive(&fc->waitq, &wait);
-	while (fc->connected && !request_pending(fc)) {
+	add_wait_queue_exclusive(&chan->waitq, &wait);
+	while (fc->connected && !request_pending(chan)) {
 		set_current_state(TASK_INTERRUPTIBLE);
 		if (signal_pending(current))
 			break;
@@ -693,7 +1052,7 @@ __acquires(&fc->lock)
 		spin_lock(&fc->lock);
 	}
 	set_current_state(TASK_RUNNING);
-	remove_wait_queue(&fc->waitq, &wait);
+	remove_wait_queue(&chan->waitq, &wait);
 }
 
 /*
@@ -704,11 +1063,10 @@ __acquires(&fc->lock)
  *
  * Called with fc->lock held, releases it
  */
-static int fuse_read_interrupt(struct fuse_conn *fc, struct fuse_req *req,
-			       const struct iovec *iov, unsigned long nr_segs)
+static int fuse_read_interrupt(struct fuse_conn *fc, struct fuse_copy_state *cs,
+			       size_t nbytes, struct fuse_req *req)
 __releases(&fc->lock)
 {
-	struct fuse_copy_state cs;
 	struct fuse_in_header ih;
 	struct fuse_interrupt_in arg;
 	unsigned reqsize = sizeof(ih) + sizeof(arg);
@@ -724,14 +1082,13 @@ __releases(&fc->lock)
 	arg.unique = req->in.h.unique;
 
 	spin_unlock(&fc->lock);
-	if (iov_length(iov, nr_segs) < reqsize)
+	if (nbytes < reqsize)
 		return -EINVAL;
 
-	fuse_copy_init(&cs, fc, 1, NULL, iov, nr_segs);
-	err = fuse_copy_one(&cs, &ih, sizeof(ih));
+	err = fuse_copy_one(cs, &ih, sizeof(ih));
 	if (!err)
-		err = fuse_copy_one(&cs, &arg, sizeof(arg));
-	fuse_copy_finish(&cs);
+		err = fuse_copy_one(cs, &arg, sizeof(arg));
+	fuse_copy_finish(cs);
 
 	return err ? err : reqsize;
 }
@@ -745,48 +1102,49 @@ __releases(&fc->lock)
  * request_end().  Otherwise add it to the processing list, and set
  * the 'sent' flag.
  */
-static ssize_t fuse_dev_read(struct kiocb *iocb, const struct iovec *iov,
-			      unsigned long nr_segs, loff_t pos)
+static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
+				struct fuse_copy_state *cs, size_t nbytes)
 {
 	int err;
 	struct fuse_req *req;
 	struct fuse_in *in;
-	struct fuse_copy_state cs;
+	struct fuse_chan *chan = fuse_get_chan(file);
+	struct fuse_chan *from;
 	unsigned reqsize;
-	struct file *file = iocb->ki_filp;
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (!fc)
-		return -EPERM;
 
  restart:
-	spin_lock(&fc->lock);
+	fuse_conn_lock(fc);
 	err = -EAGAIN;
 	if ((file->f_flags & O_NONBLOCK) && fc->connected &&
-	    !request_pending(fc))
+	    !request_pending(chan))
 		goto err_unlock;
 
-	request_wait(fc);
+	request_wait(fc, chan);
 	err = -ENODEV;
 	if (!fc->connected)
 		goto err_unlock;
 	err = -ERESTARTSYS;
-	if (!request_pending(fc))
+	if (!request_pending(chan))
 		goto err_unlock;
 
 	if (!list_empty(&fc->interrupts)) {
 		req = list_entry(fc->interrupts.next, struct fuse_req,
 				 intr_entry);
-		return fuse_read_interrupt(fc, req, iov, nr_segs);
+		return fuse_read_interrupt(fc, cs, nbytes, req);
 	}
 
-	req = list_entry(fc->pending.next, struct fuse_req, list);
+	from = fuse_chan_pick(chan);
+	req = list_entry(from->pending.next, struct fuse_req, list);
+	chan->read++;
+	if (from != chan)
+		chan->stolen++;
 	req->state = FUSE_REQ_READING;
 	list_move(&req->list, &fc->io);
 
 	in = &req->in;
 	reqsize = in->h.len;
 	/* If request is too large, reply with an error and restart the read */
-	if (iov_length(iov, nr_segs) < reqsize) {
+	if (nbytes < reqsize) {
 		req->out.h.error = -EIO;
 		/* SETXATTR is special, since it may contain too large data */
 		if (in->h.opcode == FUSE_SETXATTR)
@@ -795,13 +1153,13 @@ static ssize_t fuse_dev_read(struct kiocb *iocb, const struct iovec *iov,
 		goto restart;
 	}
 	spin_unlock(&fc->lock);
-	fuse_copy_init(&cs, fc, 1, req, iov, nr_segs);
-	err = fuse_copy_one(&cs, &in->h, sizeof(in->h));
+	cs->req = req;
+	err = fuse_copy_one(cs, &in->h, sizeof(in->h));
 	if (!err)
-		err = fuse_copy_args(&cs, in->numargs, in->argpages,
+		err = fuse_copy_args(cs, in->numargs, in->argpages,
 				     (struct fuse_arg *) in->args, 0);
-	fuse_copy_finish(&cs);
-	spin_lock(&fc->lock);
+	fuse_copy_finish(cs);
+	fuse_conn_lock(fc);
 	req->locked = 0;
 	if (req->aborted) {
 		request_end(fc, req);
@@ -828,6 +1186,116 @@ static ssize_t fuse_dev_read(struct kiocb *iocb, const struct iovec *iov,
 	return err;
 }
 
+static ssize_t fuse_dev_read(struct kiocb *iocb, const struct iovec *iov,
+			      unsigned long nr_segs, loff_t pos)
+{
+	struct fuse_copy_state cs;
+	struct file *file = iocb->ki_filp;
+	struct fuse_conn *fc = fuse_get_conn(file);
+	if (!fc)
+		return -EPERM;
+
+	fuse_copy_init(&cs, fc, 1, NULL, iov, nr_segs);
+
+	return fuse_dev_do_read(fc, file, &cs, iov_length(iov, nr_segs));
+}
+
+static int fuse_dev_pipe_buf_steal(struct pipe_inode_info *pipe,
+				   struct pipe_buffer *buf)
+{
+	return 1;
+}
+
+static const struct pipe_buf_operations fuse_dev_pipe_buf_ops = {
+	.can_merge = 0,
+	.map = generic_pipe_buf_map,
+	.unmap = generic_pipe_buf_unmap,
+	.confirm = generic_pipe_buf_confirm,
+	.release = generic_pipe_buf_release,
+	.steal = fuse_dev_pipe_buf_steal,
+	.get = generic_pipe_buf_get,
+};
+
+/*
+ * Read a request into a pipe.  Pages of the request (e.g. the data of
+ * a WRITE) are referenced by the pipe rather than copied.  The whole
+ * request must fit in the free buffers of the pipe.
+ */
+static ssize_t fuse_dev_splice_read(struct file *in, loff_t *ppos,
+				    struct pipe_inode_info *pipe,
+				    size_t len, unsigned int flags)
+{
+	int ret;
+	int page_nr = 0;
+	int do_wakeup = 0;
+	struct pipe_buffer *bufs;
+	struct fuse_copy_state cs;
+	struct fuse_conn *fc = fuse_get_conn(in);
+	if (!fc)
+		return -EPERM;
+
+	bufs = kmalloc(PIPE_BUFFERS * sizeof(struct pipe_buffer), GFP_KERNEL);
+	if (!bufs)
+		return -ENOMEM;
+
+	fuse_copy_init(&cs, fc, 1, NULL, NULL, 0);
+	cs.pipebufs = bufs;
+	cs.pipe = pipe;
+	ret = fuse_dev_do_read(fc, in, &cs, len);
+	if (ret < 0)
+		goto out;
+
+	ret = 0;
+	pipe_lock(pipe);
+
+	if (!pipe->readers) {
+		send_sig(SIGPIPE, current, 0);
+		if (!ret)
+			ret = -EPIPE;
+		goto out_unlock;
+	}
+
+	if (pipe->nrbufs + cs.nr_segs > PIPE_BUFFERS) {
+		ret = -EIO;
+		goto out_unlock;
+	}
+
+	while (page_nr < cs.nr_segs) {
+		int newbuf = (pipe->curbuf + pipe->nrbufs) & (PIPE_BUFFERS - 1);
+		struct pipe_buffer *buf = pipe->bufs + newbuf;
+
+		buf->page = bufs[page_nr].page;
+		buf->offset = bufs[page_nr].offset;
+		buf->len = bufs[page_nr].len;
+		buf->flags = 0;
+		buf->ops = &fuse_dev_pipe_buf_ops;
+
+		pipe->nrbufs++;
+		page_nr++;
+		ret += buf->len;
+
+		if (pipe->inode)
+			do_wakeup = 1;
+	}
+
+out_unlock:
+	pipe_unlock(pipe);
+
+	if (do_wakeup) {
+		smp_mb();
+		if (waitqueue_active(&pipe->wait))
+			wake_up_interruptible(&pipe->wait);
+		kill_fasync(&pipe->fasync_readers, SIGIO, POLL_IN);
+	}
+
+out:
+	for (; page_nr < cs.nr_segs; page_nr++)
+		page_cache_release(bufs[page_nr].page);
+
+	kfree(bufs);
+	return ret;
+}
+
 static int fuse_notify_poll(struct fuse_conn *fc, unsigned int size,
 			    struct fuse_copy_state *cs)
 {
@@ -987,23 +1455,17 @@ static int copy_out_args(struct fuse_copy_state *cs, struct fuse_out *out,
  * it from the list and copy the rest of the buffer to the request.
  * The request is finished by calling request_end()
  */
-static ssize_t fuse_dev_write(struct kiocb *iocb, const struct iovec *iov,
-			       unsigned long nr_segs, loff_t pos)
+static ssize_t fuse_dev_do_write(struct fuse_conn *fc,
+				 struct fuse_copy_state *cs, size_t nbytes)
 {
 	int err;
-	size_t nbytes = iov_length(iov, nr_segs);
 	struct fuse_req *req;
 	struct fuse_out_header oh;
-	struct fuse_copy_state cs;
-	struct fuse_conn *fc = fuse_get_conn(iocb->ki_filp);
-	if (!fc)
-		return -EPERM;
 
-	fuse_copy_init(&cs, fc, 0, NULL, iov, nr_segs);
 	if (nbytes < sizeof(struct fuse_out_header))
 		return -EINVAL;
 
-	err = fuse_copy_one(&cs, &oh, sizeof(oh));
+	err = fuse_copy_one(cs, &oh, sizeof(oh));
 	if (err)
 		goto err_finish;
 
@@ -1016,7 +1478,7 @@ static ssize_t fuse_dev_write(struct kiocb *iocb, const struct iovec *iov,
 	 * and error contains notification code.
 	 */
 	if (!oh.unique) {
-		err = fuse_notify(fc, oh.error, nbytes - sizeof(oh), &cs);
+		err = fuse_notify(fc, oh.error, nbytes - sizeof(oh), cs);
 		return err ? err : nbytes;
 	}
 
@@ -1024,7 +1486,7 @@ static ssize_t fuse_dev_write(struct kiocb *iocb, const struct iovec *iov,
 	if (oh.error <= -1000 || oh.error > 0)
 		goto err_finish;
 
-	spin_lock(&fc->lock);
+	fuse_conn_lock(fc);
 	err = -ENOENT;
 	if (!fc->connected)
 		goto err_unlock;
@@ -1035,7 +1497,7 @@ static ssize_t fuse_dev_write(struct kiocb *iocb, const struct iovec *iov,
 
 	if (req->aborted) {
 		spin_unlock(&fc->lock);
-		fuse_copy_finish(&cs);
+		fuse_copy_finish(cs);
 		spin_lock(&fc->lock);
 		request_end(fc, req);
 		return -ENOENT;
@@ -1052,7 +1514,7 @@ static ssize_t fuse_dev_write(struct kiocb *iocb, const struct iovec *iov,
 			queue_interrupt(fc, req);
 
 		spin_unlock(&fc->lock);
-		fuse_copy_finish(&cs);
+		fuse_copy_finish(cs);
 		return nbytes;
 	}
 
@@ -1060,13 +1522,15 @@ static ssize_t fuse_dev_write(struct kiocb *iocb, const struct iovec *iov,
 	list_move(&req->list, &fc->io);
 	req->out.h = oh;
 	req->locked = 1;
-	cs.req = req;
+	cs->req = req;
+	if (!req->out.page_replace)
+		cs->move_pages = 0;
 	spin_unlock(&fc->lock);
 
-	err = copy_out_args(&cs, &req->out, nbytes);
-	fuse_copy_finish(&cs);
+	err = copy_out_args(cs, &req->out, nbytes);
+	fuse_copy_finish(cs);
 
-	spin_lock(&fc->lock);
+	fuse_conn_lock(fc);
 	req->locked = 0;
 	if (!err) {
 		if (req->aborted)
@@ -1080,23 +1544,122 @@ static ssize_t fuse_dev_write(struct kiocb *iocb, const struct iovec *iov,
  err_unlock:
 	spin_unlock(&fc->lock);
  err_finish:
-	fuse_copy_finish(&cs);
+	fuse_copy_finish(cs);
 	return err;
 }
 
+static ssize_t fuse_dev_write(struct kiocb *iocb, const struct iovec *iov,
+			      unsigned long nr_segs, loff_t pos)
+{
+	struct fuse_copy_state cs;
+	struct fuse_conn *fc = fuse_get_conn(iocb->ki_filp);
+	if (!fc)
+		return -EPERM;
+
+	fuse_copy_init(&cs, fc, 0, NULL, iov, nr_segs);
+
+	return fuse_dev_do_write(fc, &cs, iov_length(iov, nr_segs));
+}
+
+/*
+ * Write a reply from a pipe.  The buffers making up the reply are taken
+ * off the pipe first.  With SPLICE_F_MOVE, full pages of a READ reply
+ * that can be stolen from the pipe replace the page cache pages of the
+ * request instead of being copied into them.
+ */
+static ssize_t fuse_dev_splice_write(struct pipe_inode_info *pipe,
+				     struct file *out, loff_t *ppos,
+				     size_t len, unsigned int flags)
+{
+	unsigned nbuf;
+	unsigned idx;
+	struct pipe_buffer *bufs;
+	struct fuse_copy_state cs;
+	struct fuse_conn *fc;
+	size_t rem;
+	ssize_t ret;
+
+	fc = fuse_get_conn(out);
+	if (!fc)
+		return -EPERM;
+
+	bufs = kmalloc(PIPE_BUFFERS * sizeof(struct pipe_buffer), GFP_KERNEL);
+	if (!bufs)
+		return -ENOMEM;
+
+	pipe_lock(pipe);
+	nbuf = 0;
+	rem = 0;
+	for (idx = 0; idx < pipe->nrbufs && rem < len; idx++)
+		rem += pipe->bufs[(pipe->curbuf + idx) & (PIPE_BUFFERS - 1)].len;
+
+	ret = -EINVAL;
+	if (rem < len) {
+		pipe_unlock(pipe);
+		goto out;
+	}
+
+	rem = len;
+	while (rem) {
+		struct pipe_buffer *ibuf;
+		struct pipe_buffer *obuf;
+
+		BUG_ON(nbuf >= PIPE_BUFFERS);
+		BUG_ON(!pipe->nrbufs);
+		ibuf = &pipe->bufs[pipe->curbuf];
+		obuf = &bufs[nbuf];
+
+		if (rem >= ibuf->len) {
+			*obuf = *ibuf;
+			ibuf->ops = NULL;
+			pipe->curbuf = (pipe->curbuf + 1) & (PIPE_BUFFERS - 1);
+			pipe->nrbufs--;
+		} else {
+			ibuf->ops->get(pipe, ibuf);
+			*obuf = *ibuf;
+			obuf->flags &= ~PIPE_BUF_FLAG_GIFT;
+			obuf->len = rem;
+			ibuf->offset += obuf->len;
+			ibuf->len -= obuf->len;
+		}
+		nbuf++;
+		rem -= obuf->len;
+	}
+	pipe_unlock(pipe);
+
+	fuse_copy_init(&cs, fc, 0, NULL, NULL, nbuf);
+	cs.pipebufs = bufs;
+	cs.pipe = pipe;
+
+	if (flags & SPLICE_F_MOVE)
+		cs.move_pages = 1;
+
+	ret = fuse_dev_do_write(fc, &cs, len);
+
+	for (idx = 0; idx < nbuf; idx++) {
+		struct pipe_buffer *buf = &bufs[idx];
+		buf->ops->release(pipe, buf);
+	}
+out:
+	kfree(bufs);
+	return ret;
+}
+
 static unsigned fuse_dev_poll(struct file *file, poll_table *wait)
 {
 	unsigned mask = POLLOUT | POLLWRNORM;
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (!fc)
+	struct fuse_chan *chan = fuse_get_chan(file);
+	struct fuse_conn *fc;
+	if (!chan)
 		return POLLERR;
 
-	poll_wait(file, &fc->waitq, wait);
+	fc = chan->fc;
+	poll_wait(file, &chan->waitq, wait);
 
 	spin_lock(&fc->lock);
 	if (!fc->connected)
 		mask = POLLERR;
-	else if (request_pending(fc))
+	else if (request_pending(chan))
 		mask |= POLLIN | POLLRDNORM;
 	spin_unlock(&fc->lock);
 
@@ -1184,25 +1747,55 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		fc->connected = 0;
 		fc->blocked = 0;
 		end_io_requests(fc);
-		end_requests(fc, &fc->pending);
+		fuse_chans_gather(fc);
+		end_requests(fc, &fc->main_chan.pending);
 		end_requests(fc, &fc->processing);
-		wake_up_all(&fc->waitq);
+		fuse_wake_readers(fc);
 		wake_up_all(&fc->blocked_waitq);
-		kill_fasync(&fc->fasync, SIGIO, POLL_IN);
 	}
 	spin_unlock(&fc->lock);
 }
 EXPORT_SYMBOL_GPL(fuse_abort_conn);
 
+/*
+ * Detach a cloned channel.  Its pending requests go back to the main
+ * channel.
+ */
+static void fuse_chan_detach(struct fuse_conn *fc, struct fuse_chan *chan)
+{
+	struct fuse_chan *last = fc->chans[fc->num_chans - 1];
+
+	list_splice_tail_init(&chan->pending, &fc->main_chan.pending);
+	fc->chans[chan->index] = last;
+	last->index = chan->index;
+	fc->chans[--fc->num_chans] = NULL;
+	if (!list_empty(&fc->main_chan.pending))
+		fuse_chan_kick(fc, &fc->main_chan);
+}
+
+/*
+ * Closing the main channel disconnects the filesystem, closing a clone
+ * only detaches it.
+ */
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (fc) {
+	struct fuse_chan *chan = fuse_get_chan(file);
+	if (chan) {
+		struct fuse_conn *fc = chan->fc;
+
 		spin_lock(&fc->lock);
-		fc->connected = 0;
-		end_requests(fc, &fc->pending);
-		end_requests(fc, &fc->processing);
-		spin_unlock(&fc->lock);
+		if (chan != &fc->main_chan) {
+			fuse_chan_detach(fc, chan);
+			spin_unlock(&fc->lock);
+			kfree(chan);
+		} else {
+			fc->connected = 0;
+			fuse_chans_gather(fc);
+			end_requests(fc, &fc->main_chan.pending);
+			end_requests(fc, &fc->processing);
+			fuse_wake_readers(fc);
+			spin_unlock(&fc->lock);
+		}
 		fuse_conn_put(fc);
 	}
 
@@ -1212,12 +1805,89 @@ EXPORT_SYMBOL_GPL(fuse_dev_release);
 
 static int fuse_dev_fasync(int fd, struct file *file, int on)
 {
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (!fc)
+	struct fuse_chan *chan = fuse_get_chan(file);
+	if (!chan)
 		return -EPERM;
 
 	/* No locking - fasync_helper does its own locking */
-	return fasync_helper(fd, file, on, &fc->fasync);
+	return fasync_helper(fd, file, on, &chan->fasync);
+}
+
+/*
+ * Attach @file, a newly opened device file, to the connection of the
+ * device file @oldfd as a new channel.
+ */
+static int fuse_dev_clone(struct file *file, int oldfd)
+{
+	struct fuse_chan *chan;
+	struct fuse_conn *fc;
+	struct file *old;
+	int err;
+
+	old = fget(oldfd);
+	if (!old)
+		return -EBADF;
+
+	err = -EINVAL;
+	if (old->f_op != &fuse_dev_operations ||
+	    file->f_op != &fuse_dev_operations)
+		goto out_fput;
+
+	err = -ENOMEM;
+	chan = kmalloc(sizeof(*chan), GFP_KERNEL);
+	if (!chan)
+		goto out_fput;
+
+	/* fuse_mutex serializes against mount and other clones */
+	mutex_lock(&fuse_mutex);
+	err = -EINVAL;
+	fc = fuse_get_conn(old);
+	if (!fc || file->private_data)
+		goto out_unlock;
+
+	fuse_chan_init(chan, fc);
+	spin_lock(&fc->lock);
+	err = -ENOTCONN;
+	if (!fc->connected)
+		goto out_unlock_fc;
+	err = -EBUSY;
+	if (fc->num_chans == FUSE_MAX_CHANS)
+		goto out_unlock_fc;
+
+	chan->index = fc->num_chans;
+	fc->chans[fc->num_chans++] = chan;
+	spin_unlock(&fc->lock);
+
+	fuse_conn_get(fc);
+	file->private_data = chan;
+	mutex_unlock(&fuse_mutex);
+	fput(old);
+	return 0;
+
+ out_unlock_fc:
+	spin_unlock(&fc->lock);
+ out_unlock:
+	mutex_unlock(&fuse_mutex);
+	kfree(chan);
+ out_fput:
+	fput(old);
+	return err;
+}
+
+static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
+			   unsigned long arg)
+{
+	u32 oldfd;
+
+	switch (cmd) {
+	case FUSE_DEV_IOC_CLONE:
+		if (get_user(oldfd, (u32 __user *) arg))
+			return -EFAULT;
+		return fuse_dev_clone(file, oldfd);
+
+	default:
+		return -ENOTTY;
+	}
 }
 
 const struct file_operations fuse_dev_operations = {
@@ -1225,9 +1895,12 @@ const struct file_operations fuse_dev_operations = {
 	.llseek		= no_llseek,
 	.read		= do_sync_read,
 	.aio_read	= fuse_dev_read,
+	.splice_read	= fuse_dev_splice_read,
 	.write		= do_sync_write,
 	.aio_write	= fuse_dev_write,
+	.splice_write	= fuse_dev_splice_write,
 	.poll		= fuse_dev_poll,
+	.unlocked_ioctl	= fuse_dev_ioctl,
 	.release	= fuse_dev_release,
 	.fasync		= fuse_dev_fasync,
 };
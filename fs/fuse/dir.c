@@ -1265,6 +1265,7 @@ static int fuse_do_setattr(struct dentry *entry, struct iattr *attr,
 	struct fuse_setattr_in inarg;
 	struct fuse_attr_out outarg;
 	bool is_truncate = false;
+	bool is_wb = fc->writeback_cache && S_ISREG(inode->i_mode);
 	loff_t oldsize;
 	int err;
 
@@ -1336,8 +1337,19 @@ static int fuse_do_setattr(struct dentry *entry, struct iattr *attr,
 	spin_lock(&fc->lock);
 	fuse_change_attributes_common(inode, &outarg.attr,
 				      attr_timeout(&outarg));
+	if (is_wb) {
+		/* times set explicitly, see fuse_change_attributes_common() */
+		if (attr->ia_valid & ATTR_MTIME) {
+			inode->i_mtime.tv_sec = outarg.attr.mtime;
+			inode->i_mtime.tv_nsec = outarg.attr.mtimensec;
+		}
+		inode->i_ctime.tv_sec = outarg.attr.ctime;
+		inode->i_ctime.tv_nsec = outarg.attr.ctimensec;
+	}
 	oldsize = inode->i_size;
-	i_size_write(inode, outarg.attr.size);
+	/* see the comment in fuse_change_attributes() */
+	if (!is_wb || is_truncate)
+		i_size_write(inode, outarg.attr.size);
 
 	if (is_truncate) {
 		/* NOTE: this may release/reacquire fc->lock */
@@ -1349,9 +1361,12 @@ static int fuse_do_setattr(struct dentry *entry, struct iattr *attr,
 	 * Only call invalidate_inode_pages2() after removing
 	 * FUSE_NOWRITE, otherwise fuse_launder_page() would deadlock.
 	 */
-	if (S_ISREG(inode->i_mode) && oldsize != outarg.attr.size) {
+	if (S_ISREG(inode->i_mode) && (!is_wb || is_truncate) &&
+	    oldsize != outarg.attr.size) {
 		truncate_pagecache(inode, oldsize, outarg.attr.size);
-		invalidate_inode_pages2(inode->i_mapping);
+		/* the cached pages are the reference with the writeback cache */
+		if (!is_wb)
+			invalidate_inode_pages2(inode->i_mapping);
 	}
 
 	return 0;
@@ -32,7 +32,10 @@
 #define FUSE_NAME_MAX 1024
 
 /** Number of dentries for each connection in the control filesystem */
-#define FUSE_CTL_NUM_DENTRIES 5
+#define FUSE_CTL_NUM_DENTRIES 8
+
+/** Maximum number of device channels of a connection */
+#define FUSE_MAX_CHANS 32
 
 /** If the FUSE_DEFAULT_PERMISSIONS flag is given, the filesystem
     module will check permissions based on the file mode.  Otherwise no
@@ -128,6 +131,12 @@ struct fuse_file {
 
 	/** Wait queue head for poll */
 	wait_queue_head_t poll_wait;
+
+	/** Number of readahead requests in flight */
+	unsigned num_readahead;
+
+	/** Wait queue head for the readahead limit */
+	wait_queue_head_t readahead_waitq;
 };
 
 /** One input argument of a request */
@@ -177,6 +186,9 @@ struct fuse_out {
 	/** Zero partially or not copied pages */
 	unsigned page_zeroing:1;
 
+	/** Pages may be replaced with new ones */
+	unsigned page_replace:1;
+
 	/** Number or arguments */
 	unsigned numargs;
 
@@ -297,6 +309,50 @@ struct fuse_req {
 	struct file *stolen_file;
 };
 
+/** Request steering between the channels of a connection */
+enum fuse_chan_steering {
+	/** All requests of an inode go to the same channel */
+	FUSE_STEER_INODE,
+
+	/** Requests go to a channel chosen by the submitting CPU */
+	FUSE_STEER_CPU,
+};
+
+/**
+ * A channel of a connection: an open file of the FUSE device from
+ * which the daemon reads requests.  The file given at mount time is
+ * the main channel, others are cloned from it with FUSE_DEV_IOC_CLONE,
+ * typically one per daemon thread, so that each thread waits on its
+ * own queue.
+ *
+ * Protected by the connection's lock.
+ */
+struct fuse_chan {
+	/** The connection */
+	struct fuse_conn *fc;
+
+	/** Index in fc->chans */
+	unsigned index;
+
+	/** Readers of the channel are waiting on this */
+	wait_queue_head_t waitq;
+
+	/** The list of pending requests */
+	struct list_head pending;
+
+	/** O_ASYNC requests */
+	struct fasync_struct *fasync;
+
+	/** Number of requests queued on this channel */
+	unsigned long queued;
+
+	/** Number of requests read from this channel */
+	unsigned long read;
+
+	/** Number of the above taken from another channel */
+	unsigned long stolen;
+};
+
 /**
  * A Fuse connection.
  *
@@ -329,11 +385,17 @@ struct fuse_conn {
 	/** Maximum write size */
 	unsigned max_write;
 
-	/** Readers of the connection are waiting on this */
-	wait_queue_head_t waitq;
+	/** The channel of the device file given at mount time */
+	struct fuse_chan main_chan;
 
-	/** The list of pending requests */
-	struct list_head pending;
+	/** All channels, the main one first */
+	struct fuse_chan *chans[FUSE_MAX_CHANS];
+
+	/** Number of channels */
+	unsigned num_chans;
+
+	/** How requests are spread over the channels */
+	unsigned chan_steering;
 
 	/** The list of requests being processed */
 	struct list_head processing;
@@ -353,6 +415,10 @@ struct fuse_conn {
 	/** Number of background requests at which congestion starts */
 	unsigned congestion_threshold;
 
+	/** Maximum number of readahead requests in flight for a
+	    file, 0 for no limit but max_background */
+	unsigned max_file_background;
+
 	/** Number of requests currently in the background */
 	unsigned num_background;
 
@@ -453,6 +519,11 @@ struct fuse_conn {
 	/** Don't apply umask to creation modes */
 	unsigned dont_mask:1;
 
+	/** Buffered writes go through the page cache, the kernel is
+	    then the authority on the size and times of regular files.
+	    Only set in INIT */
+	unsigned writeback_cache:1;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -474,8 +545,14 @@ struct fuse_conn {
 	/** number of dentries used in the above array */
 	int ctl_ndents;
 
-	/** O_ASYNC requests */
-	struct fasync_struct *fasync;
+	/** Acquisitions of the lock on the request paths */
+	u64 lock_acquired;
+
+	/** Those of the above which had to wait for the lock */
+	u64 lock_contended;
+
+	/** Total time spent waiting for the lock */
+	u64 lock_wait_ns;
 
 	/** Key for lock owner ID scrambling */
 	u32 scramble_key[4];
@@ -719,6 +796,11 @@ int fuse_update_attributes(struct inode *inode, struct kstat *stat,
 
 void fuse_flush_writepages(struct inode *inode);
 
+/**
+ * Send the modification time of a regular file in writeback cache mode
+ */
+int fuse_write_inode(struct inode *inode, int wait);
+
 void fuse_set_nowrite(struct inode *inode);
 void fuse_release_nowrite(struct inode *inode);
 
@@ -746,4 +828,14 @@ long fuse_do_ioctl(struct file *file, unsigned int cmd, unsigned long arg,
 unsigned fuse_file_poll(struct file *file, poll_table *wait);
 int fuse_dev_release(struct inode *inode, struct file *file);
 
+/**
+ * Initialize a device channel of a connection
+ */
+void fuse_chan_init(struct fuse_chan *chan, struct fuse_conn *fc);
+
+/**
+ * Wake up all readers of the connection, called with fc->lock held
+ */
+void fuse_wake_readers(struct fuse_conn *fc);
+
 #endif /* _FS_FUSE_I_H */
@@ -81,6 +81,7 @@
 #include <linux/elf.h>
 #include <linux/pid_namespace.h>
 #include <linux/fs_struct.h>
+#include <linux/iocontext.h>
 #include "internal.h"
 
 /* NOTE:
@@ -1299,6 +1300,108 @@ static const struct file_operations proc_pid_sched_operations = {
 
 #endif
 
+#ifdef CONFIG_SCHEDLAT
+/*
+ * Scheduling latency histograms of the thread, or of all the threads
+ * of the process.  Writing anything resets them.
+ */
+static int schedlat_show(struct seq_file *m, int whole)
+{
+	struct inode *inode = m->private;
+	struct task_struct *p;
+	int ret;
+
+	p = get_proc_task(inode);
+	if (!p)
+		return -ESRCH;
+	ret = proc_schedlat_show_task(p, m, whole);
+
+	put_task_struct(p);
+
+	return ret;
+}
+
+static int tid_schedlat_show(struct seq_file *m, void *v)
+{
+	return schedlat_show(m, 0);
+}
+
+static int tgid_schedlat_show(struct seq_file *m, void *v)
+{
+	return schedlat_show(m, 1);
+}
+
+static ssize_t schedlat_write(struct file *file, size_t count, int whole)
+{
+	struct inode *inode = file->f_path.dentry->d_inode;
+	struct task_struct *p;
+	int ret;
+
+	p = get_proc_task(inode);
+	if (!p)
+		return -ESRCH;
+	ret = proc_schedlat_reset_task(p, whole);
+
+	put_task_struct(p);
+
+	return ret < 0 ? ret : count;
+}
+
+static ssize_t
+tid_schedlat_write(struct file *file, const char __user *buf,
+		   size_t count, loff_t *offset)
+{
+	return schedlat_write(file, count, 0);
+}
+
+static ssize_t
+tgid_schedlat_write(struct file *file, const char __user *buf,
+		    size_t count, loff_t *offset)
+{
+	return schedlat_write(file, count, 1);
+}
+
+static int schedlat_open(struct inode *inode, struct file *filp,
+			 int (*show)(struct seq_file *, void *))
+{
+	int ret;
+
+	ret = single_open(filp, show, NULL);
+	if (!ret) {
+		struct seq_file *m = filp->private_data;
+
+		m->private = inode;
+	}
+	return ret;
+}
+
+static int tid_schedlat_open(struct inode *inode, struct file *filp)
+{
+	return schedlat_open(inode, filp, tid_schedlat_show);
+}
+
+static int tgid_schedlat_open(struct inode *inode, struct file *filp)
+{
+	return schedlat_open(inode, filp, tgid_schedlat_show);
+}
+
+static const struct file_operations proc_tid_schedlat_operations = {
+	.open		= tid_schedlat_open,
+	.read		= seq_read,
+	.write		= tid_schedlat_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static const struct file_operations proc_tgid_schedlat_operations = {
+	.open		= tgid_schedlat_open,
+	.read		= seq_read,
+	.write		= tgid_schedlat_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif /* CONFIG_SCHEDLAT */
+
 #ifdef CONFIG_SCHED_AUTOGROUP
 /*
  * Print out autogroup related information:
@@ -1375,6 +1478,58 @@ static const struct file_operations proc_pid_sched_autogroup_operations = {
 
 #endif /* CONFIG_SCHED_AUTOGROUP */
 
+static ssize_t latency_nice_read(struct file *file, char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct task_struct *task = get_proc_task(file->f_path.dentry->d_inode);
+	char buffer[PROC_NUMBUF];
+	int latency_nice, err;
+	size_t len;
+
+	if (!task)
+		return -ESRCH;
+	err = sched_getlatency(task, &latency_nice);
+	put_task_struct(task);
+	if (err)
+		return err;
+
+	len = snprintf(buffer, sizeof(buffer), "%d\n", latency_nice);
+
+	return simple_read_from_buffer(buf, count, ppos, buffer, len);
+}
+
+static ssize_t latency_nice_write(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	struct task_struct *task;
+	char buffer[PROC_NUMBUF];
+	long latency_nice;
+	int err;
+
+	memset(buffer, 0, sizeof(buffer));
+	if (count > sizeof(buffer) - 1)
+		count = sizeof(buffer) - 1;
+	if (copy_from_user(buffer, buf, count))
+		return -EFAULT;
+
+	err = strict_strtol(strstrip(buffer), 0, &latency_nice);
+	if (err)
+		return -EINVAL;
+
+	task = get_proc_task(file->f_path.dentry->d_inode);
+	if (!task)
+		return -ESRCH;
+	err = sched_setlatency(task, latency_nice);
+	put_task_struct(task);
+
+	return err ? err : count;
+}
+
+static const struct file_operations proc_latency_nice_operations = {
+	.read		= latency_nice_read,
+	.write		= latency_nice_write,
+};
+
 /*
  * We added or removed a vma mapping the executable. The vmas are only mapped
  * during exec and are not mapped with the mmap system call.
@@ -2586,6 +2741,20 @@ static int proc_tgid_io_accounting(struct task_struct *task, char *buffer)
 }
 #endif /* CONFIG_TASK_IO_ACCOUNTING */
 
+#ifdef CONFIG_BLK_IO_LATENCY
+static int proc_tid_io_latency(struct seq_file *m, struct pid_namespace *ns,
+			       struct pid *pid, struct task_struct *task)
+{
+	return task_io_latency_show(m, task, 0);
+}
+
+static int proc_tgid_io_latency(struct seq_file *m, struct pid_namespace *ns,
+				struct pid *pid, struct task_struct *task)
+{
+	return task_io_latency_show(m, task, 1);
+}
+#endif /* CONFIG_BLK_IO_LATENCY */
+
 static int proc_pid_personality(struct seq_file *m, struct pid_namespace *ns,
 				struct pid *pid, struct task_struct *task)
 {
@@ -2614,9 +2783,13 @@ static const struct pid_entry tgid_base_stuff[] = {
 #ifdef CONFIG_SCHED_DEBUG
 	REG("sched",      S_IRUGO|S_IWUSR, proc_pid_sched_operations),
 #endif
+#ifdef CONFIG_SCHEDLAT
+	REG("schedlat",   S_IRUGO|S_IWUSR, proc_tgid_schedlat_operations),
+#endif
 #ifdef CONFIG_SCHED_AUTOGROUP
 	REG("autogroup",  S_IRUGO|S_IWUSR, proc_pid_sched_autogroup_operations),
 #endif
+	REG("latency_nice", S_IRUGO|S_IWUSR, proc_latency_nice_operations),
 #ifdef CONFIG_HAVE_ARCH_TRACEHOOK
 	INF("syscall",    S_IRUSR, proc_pid_syscall),
 #endif
@@ -2675,6 +2848,9 @@ static const struct pid_entry tgid_base_stuff[] = {
 #ifdef CONFIG_TASK_IO_ACCOUNTING
 	INF("io",	S_IRUGO, proc_tgid_io_accounting),
 #endif
+#ifdef CONFIG_BLK_IO_LATENCY
+	ONE("io_latency", S_IRUSR, proc_tgid_io_latency),
+#endif
 };
 
 static int proc_tgid_base_readdir(struct file * filp,
@@ -2951,6 +3127,10 @@ static const struct pid_entry tid_base_stuff[] = {
 #ifdef CONFIG_SCHED_DEBUG
 	REG("sched",     S_IRUGO|S_IWUSR, proc_pid_sched_operations),
 #endif
+#ifdef CONFIG_SCHEDLAT
+	REG("schedlat",  S_IRUGO|S_IWUSR, proc_tid_schedlat_operations),
+#endif
+	REG("latency_nice", S_IRUGO|S_IWUSR, proc_latency_nice_operations),
 #ifdef CONFIG_HAVE_ARCH_TRACEHOOK
 	INF("syscall",   S_IRUSR, proc_pid_syscall),
 #endif
@@ -3005,6 +3185,9 @@ static const struct pid_entry tid_base_stuff[] = {
 #ifdef CONFIG_TASK_IO_ACCOUNTING
 	INF("io",	S_IRUGO, proc_tid_io_accounting),
 #endif
+#ifdef CONFIG_BLK_IO_LATENCY
+	ONE("io_latency", S_IRUSR, proc_tid_io_latency),
+#endif
 };
 
 static int proc_tid_base_readdir(struct file * filp,
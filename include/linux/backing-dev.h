@@ -38,6 +38,9 @@ typedef int (congested_fn)(void *, int);
 enum bdi_stat_item {
 	BDI_RECLAIMABLE,
 	BDI_WRITEBACK,
+	BDI_READAHEAD,		/* pages read ahead */
+	BDI_READAHEAD_USED,	/* ... and accessed */
+	BDI_READAHEAD_WASTED,	/* ... and dropped before any access */
 	NR_BDI_STAT_ITEMS
 };
 
@@ -61,6 +64,7 @@ struct backing_dev_info {
 	struct list_head bdi_list;
 	struct rcu_head rcu_head;
 	unsigned long ra_pages;	/* max readahead in PAGE_CACHE_SIZE units */
+	unsigned int ra_adaptive; /* files get adaptive readahead windows */
 	unsigned long state;	/* Always use atomic bitops on this */
 	unsigned int capabilities; /* Device capabilities */
 	congested_fn *congested_fn; /* Function pointer if device is md/dm */
@@ -138,6 +142,16 @@ static inline void inc_bdi_stat(struct backing_dev_info *bdi,
 	local_irq_restore(flags);
 }
 
+static inline void add_bdi_stat(struct backing_dev_info *bdi,
+		enum bdi_stat_item item, s64 amount)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	__add_bdi_stat(bdi, item, amount);
+	local_irq_restore(flags);
+}
+
 static inline void __dec_bdi_stat(struct backing_dev_info *bdi,
 		enum bdi_stat_item item)
 {
@@ -193,6 +193,12 @@ struct request {
 
 	struct gendisk *rq_disk;
 	unsigned long start_time;
+#ifdef CONFIG_BLK_IO_LATENCY
+	u64 start_time_ns;
+	u64 dispatch_time_ns;
+	u64 io_start_time_ns;
+	struct io_context *lat_ioc;	/* submitter, for latency accounting */
+#endif
 
 	/* Number of scatter-gather DMA addr+len pairs after
 	 * physical address coalescing is performed.
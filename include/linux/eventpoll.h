@@ -49,6 +49,21 @@ struct epoll_event {
 	__u64 data;
 } EPOLL_PACKED;
 
+/*
+ * Ring of ready events shared with user space by mmap()ing the epoll
+ * file, see Documentation/filesystems/epoll.txt. The kernel adds the
+ * events at "head", user space consumes them up to "head" and stores the
+ * new "tail"; "mask + 1" is the number of entries. "lost" counts the
+ * events that found the ring full and went to epoll_wait() instead.
+ */
+struct epoll_ring {
+	__u32 head;
+	__u32 tail;
+	__u32 mask;
+	__u32 lost;
+	struct epoll_event events[0];
+};
+
 #ifdef __KERNEL__
 
 /* Forward declarations to avoid compiler errors */
@@ -891,6 +891,11 @@ struct file_ra_state {
 	unsigned int ra_pages;		/* Maximum readahead window */
 	unsigned int mmap_miss;		/* Cache miss stat for mmap accesses */
 	loff_t prev_pos;		/* Cache last read() position */
+
+	/* adaptive mode: window limit tuned by the use of read ahead pages */
+	unsigned int adapt_pages;	/* current limit, 0 if not adaptive */
+	unsigned int ra_issued;		/* pages read ahead since last tuning */
+	unsigned int ra_hits;		/* read ahead pages accessed since */
 };
 
 /*
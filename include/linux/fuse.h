@@ -34,12 +34,15 @@
  * 7.13
  *  - make max number of background requests and congestion threshold
  *    tunables
+ *  - add FUSE_DEV_IOC_CLONE to read requests from several device files
+ *  - add FUSE_WRITEBACK_CACHE
  */
 
 #ifndef _LINUX_FUSE_H
 #define _LINUX_FUSE_H
 
 #include <linux/types.h>
+#include <linux/ioctl.h>
 
 /*
  * Version negotiation:
@@ -142,6 +145,7 @@ struct fuse_file_lock {
  *
  * FUSE_EXPORT_SUPPORT: filesystem handles lookups of "." and ".."
  * FUSE_DONT_MASK: don't apply umask to file mode on create operations
+ * FUSE_WRITEBACK_CACHE: use writeback cache for buffered writes
  */
 #define FUSE_ASYNC_READ		(1 << 0)
 #define FUSE_POSIX_LOCKS	(1 << 1)
@@ -150,6 +154,7 @@ struct fuse_file_lock {
 #define FUSE_EXPORT_SUPPORT	(1 << 4)
 #define FUSE_BIG_WRITES		(1 << 5)
 #define FUSE_DONT_MASK		(1 << 6)
+#define FUSE_WRITEBACK_CACHE	(1 << 16)
 
 /**
  * CUSE INIT request/reply flags
@@ -565,4 +570,15 @@ struct fuse_notify_inval_entry_out {
 	__u32	padding;
 };
 
+/*
+ * Device ioctls
+ *
+ * FUSE_DEV_IOC_CLONE: attach a newly opened /dev/fuse file to the
+ * connection of the device file whose descriptor is passed as argument.
+ * Requests are spread over the attached files, and replies can be
+ * written to any of them.
+ */
+#define FUSE_DEV_IOC_MAGIC		229
+#define FUSE_DEV_IOC_CLONE		_IOR(FUSE_DEV_IOC_MAGIC, 0, __u32)
+
 #endif /* _LINUX_FUSE_H */
@@ -63,6 +63,34 @@ struct cfq_io_context {
  * I/O subsystem state of the associated processes.  It is refcounted
  * and kmalloc'ed. These could be shared between processes.
  */
+#ifdef CONFIG_BLK_IO_LATENCY
+/*
+ * Block request latency histograms, in microseconds.  Bucket i counts
+ * the requests which took less than 2^i us and at least 2^(i-1) us,
+ * the last bucket all the longer ones.
+ */
+#define IO_LATENCY_BUCKETS	24
+
+enum io_latency_phase {
+	IO_LATENCY_QUEUE,	/* in the I/O scheduler */
+	IO_LATENCY_DISPATCH,	/* dispatched, not yet taken by the driver */
+	IO_LATENCY_SERVICE,	/* in the driver and the device */
+	IO_LATENCY_TOTAL,
+	IO_LATENCY_NR,
+};
+
+struct io_latency_hist {
+	u64 sum;
+	u32 max;
+	u32 buckets[IO_LATENCY_BUCKETS];
+};
+
+struct io_latency {
+	unsigned long count[2];		/* reads, writes */
+	struct io_latency_hist hist[IO_LATENCY_NR];
+};
+#endif
+
 struct io_context {
 	atomic_long_t refcount;
 	atomic_t nr_tasks;
@@ -83,6 +111,11 @@ struct io_context {
 	struct radix_tree_root radix_root;
 	struct hlist_head cic_list;
 	void *ioc_data;
+
+#ifdef CONFIG_BLK_IO_LATENCY
+	/* requests allocated by the tasks using this context */
+	struct io_latency latency;
+#endif
 };
 
 static inline struct io_context *ioc_task_link(struct io_context *ioc)
@@ -105,6 +138,11 @@ void exit_io_context(void);
 struct io_context *get_io_context(gfp_t gfp_flags, int node);
 struct io_context *alloc_io_context(gfp_t gfp_flags, int node);
 void copy_io_context(struct io_context **pdst, struct io_context **psrc);
+#ifdef CONFIG_BLK_IO_LATENCY
+struct seq_file;
+int task_io_latency_show(struct seq_file *m, struct task_struct *task,
+			 int whole);
+#endif
 #else
 static inline void exit_io_context(void)
 {
@@ -0,0 +1,60 @@
+/*
+ * include/linux/launch_prefetch.h
+ *
+ * Launch-time page cache prefetch: record the page cache misses of a
+ * process while it starts, replay them as one batch of readahead on the
+ * next launches.  See Documentation/vm/launch_prefetch.txt.
+ */
+#ifndef _LINUX_LAUNCH_PREFETCH_H
+#define _LINUX_LAUNCH_PREFETCH_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+#define LAUNCH_PREFETCH_DEV	"/dev/launch_prefetch"
+
+struct lp_record {
+	__s32 pid;		/* process to record, 0 for the caller */
+	__u32 timeout_ms;	/* recording window, 0 for no limit */
+	__u32 max_entries;	/* misses kept, 0 for the default */
+	__u32 reserved;
+};
+
+struct lp_replay {
+	__u64 list;		/* user pointer to the list to replay */
+	__u32 len;		/* its length in bytes */
+	__u32 flags;		/* must be 0 */
+};
+
+#define __LPIOC			0x7c
+
+#define LP_IOC_RECORD_START	_IOW(__LPIOC, 1, struct lp_record)
+#define LP_IOC_RECORD_STOP	_IO(__LPIOC, 2)
+#define LP_IOC_REPLAY		_IOW(__LPIOC, 3, struct lp_replay)
+
+#ifdef __KERNEL__
+
+struct file;
+
+#ifdef CONFIG_LAUNCH_PREFETCH
+extern int launch_prefetch_active;
+extern void __launch_prefetch_miss(struct file *file, pgoff_t index);
+
+/*
+ * Called when @index of @file had to be read from the disk, or was read
+ * by readahead, for the current task
+ */
+static inline void launch_prefetch_miss(struct file *file, pgoff_t index)
+{
+	if (unlikely(launch_prefetch_active))
+		__launch_prefetch_miss(file, index);
+}
+#else
+static inline void launch_prefetch_miss(struct file *file, pgoff_t index)
+{
+}
+#endif
+
+#endif /* __KERNEL__ */
+
+#endif /* _LINUX_LAUNCH_PREFETCH_H */
@@ -17,10 +17,22 @@
 
 #define EVENTS_PER_CHANNEL	65536
 
+/*
+ * Writer synchronization of a channel. The lockless scheme is the default;
+ * the others trade write cost for bounded interference from nested writers.
+ */
+enum ltt_chan_sync {
+	LTT_CHAN_SYNC_LOCKLESS,		/* cmpxchg on the write offset */
+	LTT_CHAN_SYNC_IRQOFF,		/* irqs off from reserve to commit */
+	LTT_CHAN_SYNC_LOCKED,		/* irqoff and per-buffer spinlock */
+	LTT_CHAN_SYNC_NR,
+};
+
 struct ltt_chan {
 	struct ltt_chan_alloc a;		/* Parent. First field. */
 	int overwrite:1;
 	int active:1;
+	unsigned int sync;			/* enum ltt_chan_sync */
 	unsigned long commit_count_mask;	/*
 						 * Commit count mask, removing
 						 * the MSBs corresponding to
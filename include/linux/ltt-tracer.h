@@ -107,12 +107,15 @@ enum ltt_channels {
 	LTT_CHANNEL_DEFAULT,
 };
 
+struct ltt_filter_prog;
+
 struct ltt_active_marker {
 	struct list_head node;		/* active markers list */
 	const char *channel;
 	const char *name;
 	const char *format;
 	struct ltt_available_probe *probe;
+	struct ltt_filter_prog *filter;	/* argument filter, RCU-sched */
 };
 
 extern void ltt_vtrace(const struct marker *mdata, void *probe_data,
@@ -619,6 +622,9 @@ int ltt_trace_set_channel_enable(const char *trace_name,
 int ltt_trace_set_channel_overwrite(const char *trace_name,
 				    const char *channel_name,
 				    unsigned int overwrite);
+int ltt_trace_set_channel_sync(const char *trace_name,
+			       const char *channel_name,
+			       unsigned int sync);
 int ltt_trace_alloc(const char *trace_name);
 int ltt_trace_destroy(const char *trace_name);
 int ltt_trace_start(const char *trace_name);
@@ -637,6 +643,13 @@ extern int ltt_filter_control(enum ltt_filter_control_msg msg,
 
 extern struct dentry *get_filter_root(void);
 
+extern struct ltt_filter_prog *ltt_filter_compile(const char *format,
+						  const char *expr);
+extern void ltt_filter_free(struct ltt_filter_prog *prog);
+extern const char *ltt_filter_expr(const struct ltt_filter_prog *prog);
+extern int ltt_filter_eval(const struct ltt_filter_prog *prog,
+			   va_list *args);
+
 void ltt_core_register(int (*function)(u8, void *));
 
 void ltt_core_unregister(void);
@@ -650,6 +663,11 @@ extern int ltt_marker_connect(const char *channel, const char *mname,
 			      const char *pname);
 extern int ltt_marker_disconnect(const char *channel, const char *mname,
 				 const char *pname);
+extern int ltt_marker_set_filter(const char *channel, const char *mname,
+				 const char *pname, const char *format,
+				 const char *expr);
+extern int ltt_marker_get_filter(const char *channel, const char *mname,
+				 const char *pname, char *buf, size_t size);
 extern void ltt_dump_marker_state(struct ltt_trace *trace);
 
 void ltt_lock_traces(void);
@@ -170,6 +170,11 @@ print_cfs_rq(struct seq_file *m, int cpu, struct cfs_rq *cfs_rq)
 {
 }
 #endif
+#ifdef CONFIG_SCHEDLAT
+extern int proc_schedlat_show_task(struct task_struct *p, struct seq_file *m,
+				   int whole);
+extern int proc_schedlat_reset_task(struct task_struct *p, int whole);
+#endif
 
 extern unsigned long long time_sync_thresh;
 
@@ -773,6 +778,35 @@ struct sched_info {
 };
 #endif /* defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT) */
 
+#ifdef CONFIG_SCHEDLAT
+/*
+ * Scheduling latency histograms, in microseconds: bucket i counts the
+ * latencies of less than 2^i us (bucket 0 the zero ones), the last
+ * bucket all the longer ones.
+ */
+#define SCHEDLAT_BUCKETS	20
+
+enum schedlat_kind {
+	SCHEDLAT_WAKEUP,	/* from wakeup to running */
+	SCHEDLAT_PREEMPT_OFF,	/* from a resched request to the switch */
+	SCHEDLAT_NR,
+};
+
+struct schedlat_hist {
+	u64 sum;
+	u32 max;
+	u32 buckets[SCHEDLAT_BUCKETS];
+};
+
+struct sched_lat {
+	/* timestamps, rq->clock of the cpu of the task, 0 when not armed */
+	u64 wakeup_start;
+	u64 resched_start;
+
+	struct schedlat_hist hist[SCHEDLAT_NR];
+};
+#endif /* CONFIG_SCHEDLAT */
+
 #ifdef CONFIG_TASK_DELAY_ACCT
 struct task_delay_info {
 	spinlock_t	lock;
@@ -1158,6 +1192,7 @@ struct sched_entity {
 	u64			avg_running;
 
 #ifdef CONFIG_SCHEDSTATS
+	u64			wakeup_start;
 	u64			wait_start;
 	u64			wait_max;
 	u64			wait_count;
@@ -1235,6 +1270,7 @@ struct task_struct {
 #endif
 
 	int prio, static_prio, normal_prio;
+	int latency_nice;
 	unsigned int rt_priority;
 	const struct sched_class *sched_class;
 	struct sched_entity se;
@@ -1271,6 +1307,9 @@ struct task_struct {
 #if defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT)
 	struct sched_info sched_info;
 #endif
+#ifdef CONFIG_SCHEDLAT
+	struct sched_lat schedlat;
+#endif
 
 	struct list_head tasks;
 	struct plist_node pushable_tasks;
@@ -1573,6 +1612,13 @@ struct task_struct {
 #define MAX_PRIO		(MAX_RT_PRIO + 40)
 #define DEFAULT_PRIO		(MAX_RT_PRIO + 20)
 
+/*
+ * Latency nice levels of SCHED_NORMAL tasks, from the most latency
+ * sensitive to the most tolerant, see sched_setlatency().
+ */
+#define MIN_LATENCY_NICE	-20
+#define MAX_LATENCY_NICE	19
+
 static inline int rt_prio(int prio)
 {
 	if (unlikely(prio < MAX_RT_PRIO))
@@ -1937,6 +1983,10 @@ static inline unsigned int get_sysctl_timer_migration(void)
 extern unsigned int sysctl_sched_rt_period;
 extern int sysctl_sched_rt_runtime;
 
+#ifdef CONFIG_CFS_BANDWIDTH
+extern unsigned int sysctl_sched_cfs_bandwidth_slice;
+#endif
+
 int sched_rt_handler(struct ctl_table *table, int write,
 		void __user *buffer, size_t *lenp,
 		loff_t *ppos);
@@ -1980,6 +2030,8 @@ extern int can_nice(const struct task_struct *p, const int nice);
 extern int task_curr(const struct task_struct *p);
 extern int idle_cpu(int cpu);
 extern int sched_setscheduler(struct task_struct *, int, struct sched_param *);
+extern int sched_setlatency(struct task_struct *p, int latency_nice);
+extern int sched_getlatency(struct task_struct *p, int *latency_nice);
 extern int sched_setscheduler_nocheck(struct task_struct *, int,
 				      struct sched_param *);
 extern struct task_struct *idle_task(int cpu);
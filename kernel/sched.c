@@ -134,6 +134,13 @@ static inline int task_has_rt_policy(struct task_struct *p)
 	return rt_policy(p->policy);
 }
 
+/*
+ * Log2 buckets of the wakeup latency histograms, in us: bucket 0 counts
+ * latencies below 1us, bucket n those from 2^(n-1) to 2^n us, the last
+ * one everything longer.
+ */
+#define WAKEUP_LAT_BUCKETS	16
+
 /*
  * This is the priority-queue data structure of the RT scheduling class:
  */
@@ -193,33 +200,38 @@ static inline int rt_bandwidth_enabled(void)
 	return sysctl_sched_rt_runtime >= 0;
 }
 
-static void start_rt_bandwidth(struct rt_bandwidth *rt_b)
+static void start_bandwidth_timer(struct hrtimer *period_timer, ktime_t period)
 {
 	ktime_t now;
 
-	if (!rt_bandwidth_enabled() || rt_b->rt_runtime == RUNTIME_INF)
-		return;
-
-	if (hrtimer_active(&rt_b->rt_period_timer))
-		return;
-
-	spin_lock(&rt_b->rt_runtime_lock);
 	for (;;) {
 		unsigned long delta;
 		ktime_t soft, hard;
 
-		if (hrtimer_active(&rt_b->rt_period_timer))
+		if (hrtimer_active(period_timer))
 			break;
 
-		now = hrtimer_cb_get_time(&rt_b->rt_period_timer);
-		hrtimer_forward(&rt_b->rt_period_timer, now, rt_b->rt_period);
+		now = hrtimer_cb_get_time(period_timer);
+		hrtimer_forward(period_timer, now, period);
 
-		soft = hrtimer_get_softexpires(&rt_b->rt_period_timer);
-		hard = hrtimer_get_expires(&rt_b->rt_period_timer);
+		soft = hrtimer_get_softexpires(period_timer);
+		hard = hrtimer_get_expires(period_timer);
 		delta = ktime_to_ns(ktime_sub(hard, soft));
-		__hrtimer_start_range_ns(&rt_b->rt_period_timer, soft, delta,
+		__hrtimer_start_range_ns(period_timer, soft, delta,
 				HRTIMER_MODE_ABS_PINNED, 0);
 	}
+}
+
+static void start_rt_bandwidth(struct rt_bandwidth *rt_b)
+{
+	if (!rt_bandwidth_enabled() || rt_b->rt_runtime == RUNTIME_INF)
+		return;
+
+	if (hrtimer_active(&rt_b->rt_period_timer))
+		return;
+
+	spin_lock(&rt_b->rt_runtime_lock);
+	start_bandwidth_timer(&rt_b->rt_period_timer, rt_b->rt_period);
 	spin_unlock(&rt_b->rt_runtime_lock);
 }
 
@@ -230,6 +242,91 @@ static void destroy_rt_bandwidth(struct rt_bandwidth *rt_b)
 }
 #endif
 
+#ifdef CONFIG_CFS_BANDWIDTH
+/*
+ * CFS bandwidth control: a task group may consume at most quota ns of cpu
+ * time per period, summed over all cpus.  The quota is refilled by the
+ * period timer and handed out to the per-cpu cfs_rqs in slices; a cfs_rq
+ * which runs out and cannot get another slice is throttled until the
+ * next refill.
+ */
+struct cfs_bandwidth {
+	spinlock_t		lock;
+	ktime_t			period;
+	u64			quota;
+	u64			runtime;	/* left in this period */
+
+	int			idle;		/* no runtime used this period */
+	int			timer_active;
+	int			nr_throttled_rqs;
+	struct hrtimer		period_timer;
+
+	/* statistics */
+	int			nr_periods;
+	int			nr_throttled;
+	u64			throttled_time;
+};
+
+static int do_sched_cfs_period_timer(struct cfs_bandwidth *cfs_b, int overrun);
+
+static enum hrtimer_restart sched_cfs_period_timer(struct hrtimer *timer)
+{
+	struct cfs_bandwidth *cfs_b =
+		container_of(timer, struct cfs_bandwidth, period_timer);
+	ktime_t now;
+	int overrun;
+	int idle = 0;
+
+	for (;;) {
+		now = hrtimer_cb_get_time(timer);
+		overrun = hrtimer_forward(timer, now, cfs_b->period);
+
+		if (!overrun)
+			break;
+
+		idle = do_sched_cfs_period_timer(cfs_b, overrun);
+	}
+
+	return idle ? HRTIMER_NORESTART : HRTIMER_RESTART;
+}
+
+static void init_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
+{
+	spin_lock_init(&cfs_b->lock);
+	cfs_b->runtime = 0;
+	cfs_b->quota = RUNTIME_INF;
+	cfs_b->period = ns_to_ktime(NSEC_PER_SEC / 10);
+
+	hrtimer_init(&cfs_b->period_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	cfs_b->period_timer.function = sched_cfs_period_timer;
+}
+
+/* requires cfs_b->lock, may release it while waiting for the timer */
+static void __start_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
+{
+	/*
+	 * The timer may still be running its last callback, which has
+	 * already cleared timer_active and will not rearm it: wait for it
+	 * and start it again, unless somebody else did meanwhile.
+	 */
+	while (unlikely(hrtimer_active(&cfs_b->period_timer))) {
+		spin_unlock(&cfs_b->lock);
+		hrtimer_cancel(&cfs_b->period_timer);
+		spin_lock(&cfs_b->lock);
+		if (cfs_b->timer_active)
+			return;
+	}
+
+	cfs_b->timer_active = 1;
+	start_bandwidth_timer(&cfs_b->period_timer, cfs_b->period);
+}
+
+static void destroy_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
+{
+	hrtimer_cancel(&cfs_b->period_timer);
+}
+#endif /* CONFIG_CFS_BANDWIDTH */
+
 /*
  * sched_domains_mutex serializes calls to arch_init_sched_domains,
  * detach_destroy_domains and partition_sched_domains.
@@ -260,6 +357,9 @@ struct task_group {
 	/* runqueue "owned" by this group on each cpu */
 	struct cfs_rq **cfs_rq;
 	unsigned long shares;
+#ifdef CONFIG_CFS_BANDWIDTH
+	struct cfs_bandwidth cfs_bandwidth;
+#endif
 #endif
 
 #ifdef CONFIG_RT_GROUP_SCHED
@@ -452,6 +552,17 @@ struct cfs_rq {
 	 */
 	unsigned long rq_weight;
 #endif
+#ifdef CONFIG_CFS_BANDWIDTH
+	/*
+	 * runtime_remaining is what is left of the slices this cfs_rq got
+	 * from tg->cfs_bandwidth, throttled is set while the group entity
+	 * is kept off the runqueue for lack of it.
+	 */
+	int runtime_enabled;
+	int throttled;
+	s64 runtime_remaining;
+	u64 throttled_timestamp;
+#endif
 #endif
 };
 
@@ -634,6 +745,9 @@ struct rq {
 
 	/* BKL stats */
 	unsigned int bkl_count;
+
+	/* wakeup to run latency of fair tasks, by sign of latency nice */
+	unsigned int wakeup_lat[3][WAKEUP_LAT_BUCKETS];
 #endif
 };
 
@@ -1178,6 +1292,8 @@ static inline void init_hrtick(void)
  * might also involve a cross-CPU call to trigger the scheduler on
  * the target CPU.
  */
+static inline void schedlat_resched(struct task_struct *p);
+
 #ifdef CONFIG_SMP
 
 #ifndef tsk_is_polling
@@ -1194,6 +1310,7 @@ static void resched_task(struct task_struct *p)
 		return;
 
 	set_tsk_need_resched(p);
+	schedlat_resched(p);
 
 	cpu = task_cpu(p);
 	if (cpu == smp_processor_id())
@@ -1284,6 +1401,7 @@ static void resched_task(struct task_struct *p)
 {
 	assert_spin_locked(&task_rq(p)->lock);
 	set_tsk_need_resched(p);
+	schedlat_resched(p);
 }
 
 static void sched_rt_avg_update(struct rq *rq, u64 rt_delta)
@@ -1399,6 +1517,25 @@ static const u32 prio_to_wmult[40] = {
  /*  15 */ 119304647, 148102320, 186737708, 238609294, 286331153,
 };
 
+/*
+ * Latency nice levels scale the wakeup granularity and the slice of a
+ * task by a factor of two every five levels, in 1/1024 units: -20 gives
+ * 1/16th, 19 almost 14 times the default.
+ */
+#define LATENCY_SCALE_SHIFT	10
+#define LATENCY_SCALE_UNIT	(1UL << LATENCY_SCALE_SHIFT)
+
+static const int latency_nice_to_scale[40] = {
+ /* -20 */        64,        74,        84,        97,       111,
+ /* -15 */       128,       147,       169,       194,       223,
+ /* -10 */       256,       294,       338,       388,       446,
+ /*  -5 */       512,       588,       676,       776,       891,
+ /*   0 */      1024,      1176,      1351,      1552,      1783,
+ /*   5 */      2048,      2353,      2702,      3104,      3566,
+ /*  10 */      4096,      4705,      5405,      6208,      7132,
+ /*  15 */      8192,      9410,     10809,     12417,     14263,
+};
+
 static void activate_task(struct rq *rq, struct task_struct *p, int wakeup);
 
 /*
@@ -2081,12 +2218,18 @@ void set_task_cpu(struct task_struct *p, unsigned int new_cpu)
 	trace_sched_migrate_task(p, new_cpu);
 
 #ifdef CONFIG_SCHEDSTATS
+	if (p->se.wakeup_start)
+		p->se.wakeup_start -= clock_offset;
 	if (p->se.wait_start)
 		p->se.wait_start -= clock_offset;
 	if (p->se.sleep_start)
 		p->se.sleep_start -= clock_offset;
 	if (p->se.block_start)
 		p->se.block_start -= clock_offset;
+#endif
+#ifdef CONFIG_SCHEDLAT
+	if (p->schedlat.wakeup_start)
+		p->schedlat.wakeup_start -= clock_offset;
 #endif
 	if (old_cpu != new_cpu) {
 		p->se.nr_migrations++;
@@ -2426,6 +2569,7 @@ out_activate:
 	else
 		schedstat_inc(p, se.nr_wakeups_remote);
 	activate_task(rq, p, 1);
+	schedlat_wakeup(rq, p);
 	success = 1;
 
 	/*
@@ -2512,6 +2656,7 @@ static void __sched_fork(struct task_struct *p)
 	p->se.avg_running		= 0;
 
 #ifdef CONFIG_SCHEDSTATS
+	p->se.wakeup_start			= 0;
 	p->se.wait_start			= 0;
 	p->se.wait_max				= 0;
 	p->se.wait_count			= 0;
@@ -2543,6 +2688,9 @@ static void __sched_fork(struct task_struct *p)
 	p->se.nr_wakeups_passive		= 0;
 	p->se.nr_wakeups_idle			= 0;
 
+#endif
+#ifdef CONFIG_SCHEDLAT
+	memset(&p->schedlat, 0, sizeof(p->schedlat));
 #endif
 
 	INIT_LIST_HEAD(&p->rt.run_list);
@@ -2586,6 +2734,9 @@ void sched_fork(struct task_struct *p, int clone_flags)
 			set_load_weight(p);
 		}
 
+		if (p->latency_nice < 0)
+			p->latency_nice = 0;
+
 		/*
 		 * We don't need the reset flag anymore after the fork. It has
 		 * fulfilled its duty:
@@ -5466,6 +5617,7 @@ need_resched_nonpreemptible:
 	spin_lock_irq(&rq->lock);
 	update_rq_clock(rq);
 	clear_tsk_need_resched(prev);
+	schedlat_resched_done(rq, prev);
 
 	if (prev->state && !(preempt_count() & PREEMPT_ACTIVE)) {
 		if (unlikely(signal_pending_state(prev->state, prev)))
@@ -5485,6 +5637,7 @@ need_resched_nonpreemptible:
 
 	if (likely(prev != next)) {
 		sched_info_switch(prev, next);
+		schedlat_arrive(rq, next);
 		perf_event_task_sched_out(prev, next, cpu);
 
 		rq->nr_switches++;
@@ -6542,6 +6695,56 @@ out_unlock:
 	return retval;
 }
 
+/**
+ * sched_setlatency - set the latency nice level of a thread
+ * @p: the thread in question.
+ * @latency_nice: the new level, from MIN_LATENCY_NICE to MAX_LATENCY_NICE.
+ *
+ * A SCHED_NORMAL thread with a negative level preempts others sooner on
+ * wakeup, is preempted later by others, and runs in shorter slices; a
+ * positive level does the opposite.  Lowering it requires CAP_SYS_NICE.
+ * Written through /proc/<pid>/task/<tid>/latency_nice.
+ */
+int sched_setlatency(struct task_struct *p, int latency_nice)
+{
+	unsigned long flags;
+	struct rq *rq;
+	int retval;
+
+	if (latency_nice < MIN_LATENCY_NICE || latency_nice > MAX_LATENCY_NICE)
+		return -EINVAL;
+
+	if (!check_same_owner(p) && !capable(CAP_SYS_NICE))
+		return -EPERM;
+	if (latency_nice < p->latency_nice && !capable(CAP_SYS_NICE))
+		return -EPERM;
+
+	retval = security_task_setscheduler(p, p->policy, NULL);
+	if (retval)
+		return retval;
+
+	rq = task_rq_lock(p, &flags);
+	p->latency_nice = latency_nice;
+	task_rq_unlock(rq, &flags);
+
+	return 0;
+}
+
+/**
+ * sched_getlatency - get the latency nice level of a thread
+ * @p: the thread in question.
+ * @latency_nice: where to store it.
+ */
+int sched_getlatency(struct task_struct *p, int *latency_nice)
+{
+	int retval;
+
+	retval = security_task_getscheduler(p);
+	if (!retval)
+		*latency_nice = p->latency_nice;
+	return retval;
+}
+
 long sched_setaffinity(pid_t pid, const struct cpumask *in_mask)
 {
 	cpumask_var_t cpus_allowed, new_mask;
@@ -9472,6 +9675,10 @@ void __init sched_init(void)
 	init_rt_bandwidth(&def_rt_bandwidth,
 			global_rt_period(), global_rt_runtime());
 
+#ifdef CONFIG_CFS_BANDWIDTH
+	init_cfs_bandwidth(&init_task_group.cfs_bandwidth);
+#endif
+
 #ifdef CONFIG_RT_GROUP_SCHED
 	init_rt_bandwidth(&init_task_group.rt_bandwidth,
 			global_rt_period(), global_rt_runtime());
@@ -9717,6 +9924,7 @@ void normalize_rt_tasks(void)
 
 		p->se.exec_start		= 0;
 #ifdef CONFIG_SCHEDSTATS
+		p->se.wakeup_start		= 0;
 		p->se.wait_start		= 0;
 		p->se.sleep_start		= 0;
 		p->se.block_start		= 0;
@@ -9795,6 +10003,10 @@ static void free_fair_sched_group(struct task_group *tg)
 {
 	int i;
 
+#ifdef CONFIG_CFS_BANDWIDTH
+	destroy_cfs_bandwidth(tg_cfs_bandwidth(tg));
+#endif
+
 	for_each_possible_cpu(i) {
 		if (tg->cfs_rq)
 			kfree(tg->cfs_rq[i]);
@@ -9814,6 +10026,11 @@ int alloc_fair_sched_group(struct task_group *tg, struct task_group *parent)
 	struct rq *rq;
 	int i;
 
+#ifdef CONFIG_CFS_BANDWIDTH
+	/* before anything can fail: free_fair_sched_group() cancels the timer */
+	init_cfs_bandwidth(tg_cfs_bandwidth(tg));
+#endif
+
 	tg->cfs_rq = kzalloc(sizeof(cfs_rq) * nr_cpu_ids, GFP_KERNEL);
 	if (!tg->cfs_rq)
 		goto err;
@@ -10166,6 +10383,115 @@ unsigned long sched_group_shares(struct task_group *tg)
 }
 #endif
 
+#ifdef CONFIG_CFS_BANDWIDTH
+static DEFINE_MUTEX(cfs_constraints_mutex);
+
+static const u64 max_cfs_quota_period = 1 * NSEC_PER_SEC;	/* 1s */
+static const u64 min_cfs_quota_period = 1 * NSEC_PER_MSEC;	/* 1ms */
+
+static int tg_set_cfs_bandwidth(struct task_group *tg, u64 period, u64 quota)
+{
+	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(tg);
+	int i, runtime_enabled;
+
+	/*
+	 * The root group is not limited, it is what the others are limited
+	 * relative to.
+	 */
+	if (tg == &root_task_group)
+		return -EINVAL;
+
+	if (period < min_cfs_quota_period || period > max_cfs_quota_period)
+		return -EINVAL;
+
+	if (quota != RUNTIME_INF && quota < min_cfs_quota_period)
+		return -EINVAL;
+
+	runtime_enabled = quota != RUNTIME_INF;
+
+	mutex_lock(&cfs_constraints_mutex);
+	spin_lock_irq(&cfs_b->lock);
+	cfs_b->period = ns_to_ktime(period);
+	cfs_b->quota = quota;
+	cfs_b->runtime = quota;
+
+	/* reprogram a running timer for the new period */
+	if (runtime_enabled && cfs_b->timer_active) {
+		cfs_b->timer_active = 0;
+		__start_cfs_bandwidth(cfs_b);
+	}
+	spin_unlock_irq(&cfs_b->lock);
+
+	for_each_possible_cpu(i) {
+		struct cfs_rq *cfs_rq = tg->cfs_rq[i];
+		struct rq *rq = rq_of(cfs_rq);
+
+		spin_lock_irq(&rq->lock);
+		cfs_rq->runtime_enabled = runtime_enabled;
+		cfs_rq->runtime_remaining = 0;
+
+		/* throttled against the old limits, let them try again */
+		if (cfs_rq_throttled(cfs_rq))
+			unthrottle_cfs_rq(cfs_rq);
+		spin_unlock_irq(&rq->lock);
+	}
+	mutex_unlock(&cfs_constraints_mutex);
+
+	return 0;
+}
+
+static int tg_set_cfs_quota(struct task_group *tg, long cfs_quota_us)
+{
+	u64 quota, period;
+
+	period = ktime_to_ns(tg_cfs_bandwidth(tg)->period);
+	if (cfs_quota_us < 0)
+		quota = RUNTIME_INF;
+	else if ((u64)cfs_quota_us >= div_u64(RUNTIME_INF, NSEC_PER_USEC))
+		return -EINVAL;
+	else
+		quota = (u64)cfs_quota_us * NSEC_PER_USEC;
+
+	return tg_set_cfs_bandwidth(tg, period, quota);
+}
+
+static long tg_get_cfs_quota(struct task_group *tg)
+{
+	u64 quota_us;
+
+	if (tg_cfs_bandwidth(tg)->quota == RUNTIME_INF)
+		return -1;
+
+	quota_us = tg_cfs_bandwidth(tg)->quota;
+	do_div(quota_us, NSEC_PER_USEC);
+
+	return quota_us;
+}
+
+static int tg_set_cfs_period(struct task_group *tg, u64 cfs_period_us)
+{
+	u64 quota, period;
+
+	if (cfs_period_us > div_u64(max_cfs_quota_period, NSEC_PER_USEC))
+		return -EINVAL;
+
+	period = cfs_period_us * NSEC_PER_USEC;
+	quota = tg_cfs_bandwidth(tg)->quota;
+
+	return tg_set_cfs_bandwidth(tg, period, quota);
+}
+
+static u64 tg_get_cfs_period(struct task_group *tg)
+{
+	u64 cfs_period_us;
+
+	cfs_period_us = ktime_to_ns(tg_cfs_bandwidth(tg)->period);
+	do_div(cfs_period_us, NSEC_PER_USEC);
+
+	return cfs_period_us;
+}
+#endif /* CONFIG_CFS_BANDWIDTH */
+
 #ifdef CONFIG_RT_GROUP_SCHED
 /*
  * Ensure that the real time constraints are schedulable.
@@ -10553,6 +10879,50 @@ static u64 cpu_shares_read_u64(struct cgroup *cgrp, struct cftype *cft)
 
 	return (u64) tg->shares;
 }
+
+#ifdef CONFIG_CFS_BANDWIDTH
+static int cpu_cfs_quota_write_s64(struct cgroup *cgrp, struct cftype *cftype,
+				   s64 cfs_quota_us)
+{
+	if (cfs_quota_us > LONG_MAX)
+		return -EINVAL;
+
+	return tg_set_cfs_quota(cgroup_tg(cgrp), cfs_quota_us);
+}
+
+static s64 cpu_cfs_quota_read_s64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return tg_get_cfs_quota(cgroup_tg(cgrp));
+}
+
+static int cpu_cfs_period_write_u64(struct cgroup *cgrp, struct cftype *cftype,
+				    u64 cfs_period_us)
+{
+	return tg_set_cfs_period(cgroup_tg(cgrp), cfs_period_us);
+}
+
+static u64 cpu_cfs_period_read_u64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return tg_get_cfs_period(cgroup_tg(cgrp));
+}
+
+static int cpu_stats_show(struct cgroup *cgrp, struct cftype *cft,
+		struct cgroup_map_cb *cb)
+{
+	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(cgroup_tg(cgrp));
+	u64 throttled_time;
+
+	spin_lock_irq(&cfs_b->lock);
+	throttled_time = cfs_b->throttled_time;
+	spin_unlock_irq(&cfs_b->lock);
+
+	cb->fill(cb, "nr_periods", cfs_b->nr_periods);
+	cb->fill(cb, "nr_throttled", cfs_b->nr_throttled);
+	cb->fill(cb, "throttled_time", throttled_time);
+
+	return 0;
+}
+#endif /* CONFIG_CFS_BANDWIDTH */
 #endif /* CONFIG_FAIR_GROUP_SCHED */
 
 #ifdef CONFIG_RT_GROUP_SCHED
@@ -10587,6 +10957,22 @@ static struct cftype cpu_files[] = {
 		.write_u64 = cpu_shares_write_u64,
 	},
 #endif
+#ifdef CONFIG_CFS_BANDWIDTH
+	{
+		.name = "cfs_quota_us",
+		.read_s64 = cpu_cfs_quota_read_s64,
+		.write_s64 = cpu_cfs_quota_write_s64,
+	},
+	{
+		.name = "cfs_period_us",
+		.read_u64 = cpu_cfs_period_read_u64,
+		.write_u64 = cpu_cfs_period_write_u64,
+	},
+	{
+		.name = "stat",
+		.read_map = cpu_stats_show,
+	},
+#endif
 #ifdef CONFIG_RT_GROUP_SCHED
 	{
 		.name = "rt_runtime_us",
@@ -214,6 +214,11 @@ void print_cfs_rq(struct seq_file *m, int cpu, struct cfs_rq *cfs_rq)
 #ifdef CONFIG_FAIR_GROUP_SCHED
 #ifdef CONFIG_SMP
 	SEQ_printf(m, "  .%-30s: %lu\n", "shares", cfs_rq->shares);
+#endif
+#ifdef CONFIG_CFS_BANDWIDTH
+	SEQ_printf(m, "  .%-30s: %d\n", "throttled", cfs_rq->throttled);
+	SEQ_printf(m, "  .%-30s: %Ld.%06ld\n", "runtime_remaining",
+			SPLIT_NS(cfs_rq->runtime_remaining));
 #endif
 	print_cfs_group_stats(m, cpu, cfs_rq->tg);
 #endif
@@ -247,6 +252,32 @@ void print_rt_rq(struct seq_file *m, int cpu, struct rt_rq *rt_rq)
 #undef P
 }
 
+#ifdef CONFIG_SCHEDSTATS
+static void print_wakeup_latency(struct seq_file *m, struct rq *rq)
+{
+	static const char *classes[3] = {
+		"latency_nice<0", "latency_nice=0", "latency_nice>0",
+	};
+	char label[16];
+	int i, j;
+
+	SEQ_printf(m, "  .%-30s:", "wakeup_latency_us");
+	for (j = 0; j < WAKEUP_LAT_BUCKETS - 1; j++) {
+		snprintf(label, sizeof(label), "<%u", 1U << j);
+		SEQ_printf(m, " %7s", label);
+	}
+	snprintf(label, sizeof(label), ">=%u", 1U << (j - 1));
+	SEQ_printf(m, " %7s\n", label);
+
+	for (i = 0; i < 3; i++) {
+		SEQ_printf(m, "  .%-30s:", classes[i]);
+		for (j = 0; j < WAKEUP_LAT_BUCKETS; j++)
+			SEQ_printf(m, " %7u", rq->wakeup_lat[i][j]);
+		SEQ_printf(m, "\n");
+	}
+}
+#endif
+
 static void print_cpu(struct seq_file *m, int cpu)
 {
 	struct rq *rq = cpu_rq(cpu);
@@ -303,6 +334,7 @@ static void print_cpu(struct seq_file *m, int cpu)
 	P(bkl_count);
 
 #undef P
+	print_wakeup_latency(m, rq);
 #endif
 	print_cfs_stats(m, cpu);
 	print_rt_stats(m, cpu);
@@ -465,6 +497,7 @@ void proc_sched_show_task(struct task_struct *p, struct seq_file *m)
 	P(se.load.weight);
 	P(policy);
 	P(prio);
+	P(latency_nice);
 #undef PN
 #undef __PN
 #undef P
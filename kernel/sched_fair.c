@@ -441,10 +441,40 @@ static u64 __sched_period(unsigned long nr_running)
  *
  * s = p*P[w/rw]
  */
+static inline unsigned long task_latency_scale(struct task_struct *p)
+{
+	return latency_nice_to_scale[p->latency_nice - MIN_LATENCY_NICE];
+}
+
+/*
+ * Scale the slice of a task by its latency nice level.  A shorter slice
+ * is not made shorter than sysctl_sched_min_granularity, a longer one not
+ * longer than the latency period.
+ */
+static u64 latency_slice(u64 slice, struct task_struct *p)
+{
+	unsigned long scale = task_latency_scale(p);
+	u64 scaled;
+
+	if (likely(scale == LATENCY_SCALE_UNIT))
+		return slice;
+
+	scaled = (slice * scale) >> LATENCY_SCALE_SHIFT;
+
+	if (scale < LATENCY_SCALE_UNIT)
+		return max_t(u64, scaled,
+			     min_t(u64, slice, sysctl_sched_min_granularity));
+
+	return min_t(u64, scaled, max_t(u64, slice, sysctl_sched_latency));
+}
+
 static u64 sched_slice(struct cfs_rq *cfs_rq, struct sched_entity *se)
 {
 	u64 slice = __sched_period(cfs_rq->nr_running + !se->on_rq);
 
+	if (entity_is_task(se))
+		slice = latency_slice(slice, task_of(se));
+
 	for_each_sched_entity(se) {
 		struct load_weight *load;
 		struct load_weight lw;
@@ -492,6 +522,83 @@ __update_curr(struct cfs_rq *cfs_rq, struct sched_entity *curr,
 	update_min_vruntime(cfs_rq);
 }
 
+#ifdef CONFIG_CFS_BANDWIDTH
+/*
+ * Amount of runtime a cfs_rq takes from its group's quota at a time, in
+ * us.  Bigger slices mean fewer trips to the global pool, smaller ones
+ * less runtime left stranded on cpus that no longer use it.
+ */
+unsigned int sysctl_sched_cfs_bandwidth_slice = 5000UL;
+
+static inline u64 sched_cfs_bandwidth_slice(void)
+{
+	return (u64)sysctl_sched_cfs_bandwidth_slice * NSEC_PER_USEC;
+}
+
+static inline struct cfs_bandwidth *tg_cfs_bandwidth(struct task_group *tg)
+{
+	return &tg->cfs_bandwidth;
+}
+
+/*
+ * Top up runtime_remaining from the group's pool, by a slice if there
+ * is that much left.  Returns whether the cfs_rq is back in credit.
+ */
+static int assign_cfs_rq_runtime(struct cfs_rq *cfs_rq)
+{
+	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(cfs_rq->tg);
+	u64 amount = 0, min_amount;
+
+	/* runtime_remaining <= 0: this is a slice plus what was overrun */
+	min_amount = sched_cfs_bandwidth_slice() - cfs_rq->runtime_remaining;
+
+	spin_lock(&cfs_b->lock);
+	if (cfs_b->quota == RUNTIME_INF)
+		amount = min_amount;
+	else {
+		/* the group was idle for a whole period, start afresh */
+		if (!cfs_b->timer_active) {
+			cfs_b->runtime = cfs_b->quota;
+			__start_cfs_bandwidth(cfs_b);
+		}
+
+		if (cfs_b->runtime > 0) {
+			amount = min(cfs_b->runtime, min_amount);
+			cfs_b->runtime -= amount;
+			cfs_b->idle = 0;
+		}
+	}
+	spin_unlock(&cfs_b->lock);
+
+	cfs_rq->runtime_remaining += amount;
+
+	return cfs_rq->runtime_remaining > 0;
+}
+
+static void
+account_cfs_rq_runtime(struct cfs_rq *cfs_rq, unsigned long delta_exec)
+{
+	if (likely(!cfs_rq->runtime_enabled))
+		return;
+
+	cfs_rq->runtime_remaining -= delta_exec;
+	if (likely(cfs_rq->runtime_remaining > 0))
+		return;
+
+	/*
+	 * Out of runtime and none left in the pool: reschedule, so that
+	 * put_prev_entity() throttles the group.
+	 */
+	if (!assign_cfs_rq_runtime(cfs_rq) && likely(cfs_rq->curr))
+		resched_task(rq_of(cfs_rq)->curr);
+}
+#else /* !CONFIG_CFS_BANDWIDTH */
+static inline void
+account_cfs_rq_runtime(struct cfs_rq *cfs_rq, unsigned long delta_exec)
+{
+}
+#endif /* CONFIG_CFS_BANDWIDTH */
+
 static void update_curr(struct cfs_rq *cfs_rq)
 {
 	struct sched_entity *curr = cfs_rq->curr;
@@ -512,6 +619,7 @@ static void update_curr(struct cfs_rq *cfs_rq)
 
 	__update_curr(cfs_rq, curr, delta_exec);
 	curr->exec_start = now;
+	account_cfs_rq_runtime(cfs_rq, delta_exec);
 
 	if (entity_is_task(curr)) {
 		struct task_struct *curtask = task_of(curr);
@@ -558,6 +666,37 @@ update_stats_wait_end(struct cfs_rq *cfs_rq, struct sched_entity *se)
 	schedstat_set(se->wait_start, 0);
 }
 
+#ifdef CONFIG_SCHEDSTATS
+/*
+ * A task woken up by enqueue_task_fair() gets to run: account the delay
+ * in the wakeup latency histogram of the rq.
+ */
+static void
+update_stats_wakeup_latency(struct cfs_rq *cfs_rq, struct sched_entity *se)
+{
+	struct rq *rq = rq_of(cfs_rq);
+	s64 delta;
+	u64 us;
+	int class;
+
+	if (!se->wakeup_start || !entity_is_task(se))
+		return;
+
+	delta = rq->clock - se->wakeup_start;
+	se->wakeup_start = 0;
+	us = delta > 0 ? div_u64(delta, NSEC_PER_USEC) : 0;
+
+	class = 1 + (task_of(se)->latency_nice > 0) -
+		(task_of(se)->latency_nice < 0);
+	rq->wakeup_lat[class][min_t(u64, fls64(us), WAKEUP_LAT_BUCKETS - 1)]++;
+}
+#else
+static inline void
+update_stats_wakeup_latency(struct cfs_rq *cfs_rq, struct sched_entity *se)
+{
+}
+#endif
+
 static inline void
 update_stats_dequeue(struct cfs_rq *cfs_rq, struct sched_entity *se)
 {
@@ -740,6 +879,210 @@ place_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int initial)
 	se->vruntime = vruntime;
 }
 
+#ifdef CONFIG_CFS_BANDWIDTH
+static void
+enqueue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int wakeup);
+static void
+dequeue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int sleep);
+
+static inline int cfs_rq_throttled(struct cfs_rq *cfs_rq)
+{
+	return cfs_rq->throttled;
+}
+
+/*
+ * Take the group entity off the runqueue, and its parents as long as that
+ * leaves them empty.  The tasks stay queued on cfs_rq, out of reach of
+ * pick_next_task_fair() until unthrottle_cfs_rq() puts the entity back.
+ */
+static void throttle_cfs_rq(struct cfs_rq *cfs_rq)
+{
+	struct rq *rq = rq_of(cfs_rq);
+	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(cfs_rq->tg);
+	struct sched_entity *se = cfs_rq->tg->se[cpu_of(rq)];
+
+	for_each_sched_entity(se) {
+		struct cfs_rq *qcfs_rq = cfs_rq_of(se);
+
+		/* throttled parent, or the group is being dequeued */
+		if (!se->on_rq)
+			break;
+
+		dequeue_entity(qcfs_rq, se, 1);
+		if (qcfs_rq->load.weight)
+			break;
+	}
+
+	cfs_rq->throttled = 1;
+	cfs_rq->throttled_timestamp = rq->clock;
+
+	spin_lock(&cfs_b->lock);
+	cfs_b->nr_throttled_rqs++;
+	spin_unlock(&cfs_b->lock);
+}
+
+static void unthrottle_cfs_rq(struct cfs_rq *cfs_rq)
+{
+	struct rq *rq = rq_of(cfs_rq);
+	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(cfs_rq->tg);
+	struct sched_entity *se = cfs_rq->tg->se[cpu_of(rq)];
+
+	update_rq_clock(rq);
+
+	cfs_rq->throttled = 0;
+
+	spin_lock(&cfs_b->lock);
+	cfs_b->nr_throttled_rqs--;
+	cfs_b->throttled_time += rq->clock - cfs_rq->throttled_timestamp;
+	spin_unlock(&cfs_b->lock);
+
+	if (!cfs_rq->load.weight)
+		return;
+
+	for_each_sched_entity(se) {
+		if (se->on_rq)
+			break;
+		cfs_rq = cfs_rq_of(se);
+		enqueue_entity(cfs_rq, se, 1);
+		if (cfs_rq_throttled(cfs_rq))
+			break;
+	}
+
+	/* the cpu may have gone idle for lack of anything else to run */
+	if (rq->curr == rq->idle && rq->cfs.nr_running)
+		resched_task(rq->curr);
+}
+
+/*
+ * Called from put_prev_entity(): a cfs_rq found out of runtime by
+ * update_curr() is throttled when its current entity is put back.
+ */
+static void check_cfs_rq_runtime(struct cfs_rq *cfs_rq)
+{
+	if (likely(!cfs_rq->runtime_enabled || cfs_rq->runtime_remaining > 0))
+		return;
+
+	if (cfs_rq_throttled(cfs_rq))
+		return;
+
+	throttle_cfs_rq(cfs_rq);
+}
+
+/*
+ * An idle cfs_rq gets no update_curr() to notice that it has run out, so
+ * check when it gets its first entity back.  A running one is left to
+ * the update_curr() -> put_prev_entity() path.
+ */
+static void check_enqueue_throttle(struct cfs_rq *cfs_rq)
+{
+	if (likely(!cfs_rq->runtime_enabled) || cfs_rq->curr)
+		return;
+
+	if (cfs_rq_throttled(cfs_rq))
+		return;
+
+	if (cfs_rq->runtime_remaining <= 0 && !assign_cfs_rq_runtime(cfs_rq))
+		throttle_cfs_rq(cfs_rq);
+}
+
+/*
+ * Hand the refilled quota to the throttled cfs_rqs, unthrottling those it
+ * brings back in credit.  Returns what is left of it.
+ */
+static u64 distribute_cfs_runtime(struct cfs_bandwidth *cfs_b, u64 runtime)
+{
+	struct task_group *tg =
+		container_of(cfs_b, struct task_group, cfs_bandwidth);
+	int i;
+
+	for_each_online_cpu(i) {
+		struct cfs_rq *cfs_rq = tg->cfs_rq[i];
+		struct rq *rq = rq_of(cfs_rq);
+		u64 amount;
+
+		if (!runtime)
+			break;
+
+		spin_lock(&rq->lock);
+		if (cfs_rq_throttled(cfs_rq)) {
+			amount = 1 - cfs_rq->runtime_remaining;
+			if (amount > runtime)
+				amount = runtime;
+			runtime -= amount;
+
+			cfs_rq->runtime_remaining += amount;
+			if (cfs_rq->runtime_remaining > 0)
+				unthrottle_cfs_rq(cfs_rq);
+		}
+		spin_unlock(&rq->lock);
+	}
+
+	return runtime;
+}
+
+/*
+ * Refill the quota each period and unthrottle what can be.  cfs_b->idle
+ * is cleared whenever runtime is taken from the pool, so a period which
+ * ends with it set and nothing throttled lets the timer stop; it is
+ * restarted by the next assign_cfs_rq_runtime().
+ */
+static int do_sched_cfs_period_timer(struct cfs_bandwidth *cfs_b, int overrun)
+{
+	u64 runtime;
+	int idle = 1, throttled;
+
+	spin_lock(&cfs_b->lock);
+	if (cfs_b->quota == RUNTIME_INF)
+		goto out_unlock;
+
+	throttled = cfs_b->nr_throttled_rqs > 0;
+	idle = cfs_b->idle && !throttled;
+	cfs_b->nr_periods += overrun;
+	if (idle)
+		goto out_unlock;
+
+	cfs_b->runtime = cfs_b->quota;
+	if (!throttled) {
+		cfs_b->idle = 1;
+		goto out_unlock;
+	}
+	cfs_b->nr_throttled += overrun;
+
+	/*
+	 * Rq locks nest outside cfs_b->lock: take the runtime out of the
+	 * pool and drop the lock while handing it around.
+	 */
+	runtime = cfs_b->runtime;
+	cfs_b->runtime = 0;
+	spin_unlock(&cfs_b->lock);
+
+	runtime = distribute_cfs_runtime(cfs_b, runtime);
+
+	spin_lock(&cfs_b->lock);
+	cfs_b->runtime = runtime;
+	cfs_b->idle = 0;
+out_unlock:
+	if (idle)
+		cfs_b->timer_active = 0;
+	spin_unlock(&cfs_b->lock);
+
+	return idle;
+}
+#else /* !CONFIG_CFS_BANDWIDTH */
+static inline int cfs_rq_throttled(struct cfs_rq *cfs_rq)
+{
+	return 0;
+}
+
+static inline void check_cfs_rq_runtime(struct cfs_rq *cfs_rq)
+{
+}
+
+static inline void check_enqueue_throttle(struct cfs_rq *cfs_rq)
+{
+}
+#endif /* CONFIG_CFS_BANDWIDTH */
+
 static void
 enqueue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int wakeup)
 {
@@ -758,6 +1101,9 @@ enqueue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int wakeup)
 	check_spread(cfs_rq, se);
 	if (se != cfs_rq->curr)
 		__enqueue_entity(cfs_rq, se);
+
+	if (cfs_rq->nr_running == 1)
+		check_enqueue_throttle(cfs_rq);
 }
 
 static void __clear_buddies(struct cfs_rq *cfs_rq, struct sched_entity *se)
@@ -859,6 +1205,8 @@ set_next_entity(struct cfs_rq *cfs_rq, struct sched_entity *se)
 		__dequeue_entity(cfs_rq, se);
 	}
 
+	update_stats_wakeup_latency(cfs_rq, se);
+
 	update_stats_curr_start(cfs_rq, se);
 	cfs_rq->curr = se;
 #ifdef CONFIG_SCHEDSTATS
@@ -906,6 +1254,9 @@ static void put_prev_entity(struct cfs_rq *cfs_rq, struct sched_entity *prev)
 	if (prev->on_rq)
 		update_curr(cfs_rq);
 
+	/* throttle the group if it ran out of runtime */
+	check_cfs_rq_runtime(cfs_rq);
+
 	check_spread(cfs_rq, prev);
 	if (prev->on_rq) {
 		update_stats_wait_start(cfs_rq, prev);
@@ -1014,11 +1365,17 @@ static void enqueue_task_fair(struct rq *rq, struct task_struct *p, int wakeup)
 	struct cfs_rq *cfs_rq;
 	struct sched_entity *se = &p->se;
 
+	if (wakeup)
+		schedstat_set(se->wakeup_start, rq->clock);
+
 	for_each_sched_entity(se) {
 		if (se->on_rq)
 			break;
 		cfs_rq = cfs_rq_of(se);
 		enqueue_entity(cfs_rq, se, wakeup);
+		/* a throttled group stays off its parent's runqueue */
+		if (cfs_rq_throttled(cfs_rq))
+			break;
 		wakeup = 1;
 	}
 
@@ -1038,8 +1395,11 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int sleep)
 	for_each_sched_entity(se) {
 		cfs_rq = cfs_rq_of(se);
 		dequeue_entity(cfs_rq, se, sleep);
-		/* Don't dequeue parent if it has other entities besides us */
-		if (cfs_rq->load.weight)
+		/*
+		 * Don't dequeue parent if it has other entities besides us,
+		 * or if it is not queued as the group is throttled.
+		 */
+		if (cfs_rq->load.weight || cfs_rq_throttled(cfs_rq))
 			break;
 		sleep = 1;
 	}
@@ -1583,9 +1943,11 @@ wakeup_gran(struct sched_entity *curr, struct sched_entity *se)
  *  w(c, s2) =  0
  *  w(c, s3) =  1
  *
+ * The granularity g is scaled by latency_ratio, in 1/1024 units.
  */
 static int
-wakeup_preempt_entity(struct sched_entity *curr, struct sched_entity *se)
+__wakeup_preempt_entity(struct sched_entity *curr, struct sched_entity *se,
+			unsigned long latency_ratio)
 {
 	s64 gran, vdiff = curr->vruntime - se->vruntime;
 
@@ -1593,25 +1955,56 @@ wakeup_preempt_entity(struct sched_entity *curr, struct sched_entity *se)
 		return -1;
 
 	gran = wakeup_gran(curr, se);
+	if (unlikely(latency_ratio != LATENCY_SCALE_UNIT))
+		gran = min_t(s64, (gran * latency_ratio) >> LATENCY_SCALE_SHIFT,
+			     sysctl_sched_latency);
 	if (vdiff > gran)
 		return 1;
 
 	return 0;
 }
 
+static int
+wakeup_preempt_entity(struct sched_entity *curr, struct sched_entity *se)
+{
+	return __wakeup_preempt_entity(curr, se, LATENCY_SCALE_UNIT);
+}
+
+/*
+ * How much of a lead the woken task p needs to preempt curr, relative to
+ * equal latency nice levels.  It comes from the tasks themselves, as the
+ * entities compared may be their groups.
+ */
+static unsigned long
+latency_ratio(struct task_struct *curr, struct task_struct *p)
+{
+	if (likely(curr->latency_nice == p->latency_nice))
+		return LATENCY_SCALE_UNIT;
+
+	return (task_latency_scale(p) << LATENCY_SCALE_SHIFT) /
+		task_latency_scale(curr);
+}
+
 static void set_last_buddy(struct sched_entity *se)
 {
 	if (likely(task_of(se)->policy != SCHED_IDLE)) {
-		for_each_sched_entity(se)
+		for_each_sched_entity(se) {
+			/* no buddies outside the tree of a throttled group */
+			if (!se->on_rq)
+				return;
 			cfs_rq_of(se)->last = se;
+		}
 	}
 }
 
 static void set_next_buddy(struct sched_entity *se)
 {
 	if (likely(task_of(se)->policy != SCHED_IDLE)) {
-		for_each_sched_entity(se)
+		for_each_sched_entity(se) {
+			if (!se->on_rq)
+				return;
 			cfs_rq_of(se)->next = se;
+		}
 	}
 }
 
@@ -1685,7 +2078,7 @@ static void check_preempt_wakeup(struct rq *rq, struct task_struct *p, int wake_
 
 	BUG_ON(!pse);
 
-	if (wakeup_preempt_entity(se, pse) == 1) {
+	if (__wakeup_preempt_entity(se, pse, latency_ratio(curr, p)) == 1) {
 		resched_task(curr);
 		/*
 		 * Only set the backward buddy when the current task is still
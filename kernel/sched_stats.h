@@ -276,6 +276,84 @@ sched_info_switch(struct task_struct *prev, struct task_struct *next)
 #define sched_info_switch(t, next)		do { } while (0)
 #endif /* CONFIG_SCHEDSTATS || CONFIG_TASK_DELAY_ACCT */
 
+#ifdef CONFIG_SCHEDLAT
+/*
+ * Per-task scheduling latency histograms, shown by kernel/schedlat.c.
+ * Both latencies are taken on rq->clock, under the rq lock, and only
+ * cost a timestamp and a histogram update per wakeup or preemption.
+ */
+static inline void schedlat_account(struct schedlat_hist *h, u64 start,
+				    u64 now)
+{
+	u32 us = 0;
+
+	if ((s64)(now - start) > 0)
+		us = min_t(u64, div_u64(now - start, NSEC_PER_USEC), ~0U);
+
+	h->sum += us;
+	if (us > h->max)
+		h->max = us;
+	h->buckets[min_t(int, fls(us), SCHEDLAT_BUCKETS - 1)]++;
+}
+
+/* @p has just been put back on @rq by a wakeup */
+static inline void schedlat_wakeup(struct rq *rq, struct task_struct *p)
+{
+	p->schedlat.wakeup_start = rq->clock;
+}
+
+/* @next is about to run on @rq */
+static inline void schedlat_arrive(struct rq *rq, struct task_struct *next)
+{
+	struct sched_lat *lat = &next->schedlat;
+
+	if (lat->wakeup_start) {
+		schedlat_account(&lat->hist[SCHEDLAT_WAKEUP],
+				 lat->wakeup_start, rq->clock);
+		lat->wakeup_start = 0;
+	}
+}
+
+/*
+ * @p was asked to reschedule: until it gets into schedule() it keeps
+ * the cpu, with preemption off or in a non preemptible kernel path.
+ */
+static inline void schedlat_resched(struct task_struct *p)
+{
+	struct rq *rq = task_rq(p);
+
+	if (!p->schedlat.resched_start && p != rq->idle)
+		p->schedlat.resched_start = rq->clock;
+}
+
+/* @prev entered schedule() and cleared its need_resched */
+static inline void schedlat_resched_done(struct rq *rq,
+					 struct task_struct *prev)
+{
+	struct sched_lat *lat = &prev->schedlat;
+
+	if (lat->resched_start) {
+		schedlat_account(&lat->hist[SCHEDLAT_PREEMPT_OFF],
+				 lat->resched_start, rq->clock);
+		lat->resched_start = 0;
+	}
+}
+#else
+static inline void schedlat_wakeup(struct rq *rq, struct task_struct *p)
+{
+}
+static inline void schedlat_arrive(struct rq *rq, struct task_struct *next)
+{
+}
+static inline void schedlat_resched(struct task_struct *p)
+{
+}
+static inline void schedlat_resched_done(struct rq *rq,
+					 struct task_struct *prev)
+{
+}
+#endif /* CONFIG_SCHEDLAT */
+
 /*
  * The following are functions that support scheduler-internal time accounting.
  * These functions are generally called at the timer tick.  None of this depends
@@ -0,0 +1,260 @@
+/*
+ * kernel/schedlat.c: per-task scheduling latency histograms
+ *
+ * The scheduler keeps, in every task, log2 histograms of two latencies
+ * (see kernel/sched_stats.h):
+ *
+ *  - wakeup: from the wakeup of the task to its first run on a cpu,
+ *  - preempt_off: from a request to reschedule the running task (a
+ *    wakeup preemption or the end of its slice) to its entry into
+ *    schedule(), the time it kept the cpu in non preemptible code.
+ *
+ * They are shown in /proc/<pid>/task/<tid>/schedlat, summed over the
+ * live threads of the process in /proc/<pid>/schedlat, and the threads
+ * with the worst maximum latencies of the system in /proc/schedlat.
+ * Writing anything to one of these files resets the histograms it shows.
+ *
+ * The histograms are updated under the rq lock of the task, and read
+ * and reset without it: a reader racing with an update may see it
+ * half done, which is fine for statistics.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
+
+/* threads listed per latency in /proc/schedlat */
+#define SCHEDLAT_WORST		10
+
+static const char *schedlat_names[SCHEDLAT_NR] = {
+	[SCHEDLAT_WAKEUP]	= "wakeup",
+	[SCHEDLAT_PREEMPT_OFF]	= "preempt_off",
+};
+
+static unsigned long schedlat_count(struct schedlat_hist *h)
+{
+	unsigned long count = 0;
+	int j;
+
+	for (j = 0; j < SCHEDLAT_BUCKETS; j++)
+		count += h->buckets[j];
+	return count;
+}
+
+static void schedlat_add(struct schedlat_hist *sum, struct task_struct *p)
+{
+	int i, j;
+
+	for (i = 0; i < SCHEDLAT_NR; i++) {
+		struct schedlat_hist *s = &sum[i];
+		struct schedlat_hist *h = &p->schedlat.hist[i];
+
+		s->sum += h->sum;
+		s->max = max(s->max, h->max);
+		for (j = 0; j < SCHEDLAT_BUCKETS; j++)
+			s->buckets[j] += h->buckets[j];
+	}
+}
+
+static void schedlat_print(struct seq_file *m, struct schedlat_hist *hist)
+{
+	unsigned long count[SCHEDLAT_NR];
+	int i, j;
+
+	seq_printf(m, "%-10s", "us");
+	for (i = 0; i < SCHEDLAT_NR; i++)
+		seq_printf(m, " %11s", schedlat_names[i]);
+
+	seq_printf(m, "\n%-10s", "count");
+	for (i = 0; i < SCHEDLAT_NR; i++) {
+		count[i] = schedlat_count(&hist[i]);
+		seq_printf(m, " %11lu", count[i]);
+	}
+
+	seq_printf(m, "\n%-10s", "avg");
+	for (i = 0; i < SCHEDLAT_NR; i++)
+		seq_printf(m, " %11llu", count[i] ?
+			   div64_u64(hist[i].sum, count[i]) : 0ULL);
+
+	seq_printf(m, "\n%-10s", "max");
+	for (i = 0; i < SCHEDLAT_NR; i++)
+		seq_printf(m, " %11u", hist[i].max);
+	seq_putc(m, '\n');
+
+	for (j = 0; j < SCHEDLAT_BUCKETS; j++) {
+		if (j < SCHEDLAT_BUCKETS - 1)
+			seq_printf(m, "<%-9lu", 1UL << j);
+		else
+			seq_printf(m, ">=%-8lu", 1UL << (j - 1));
+		for (i = 0; i < SCHEDLAT_NR; i++)
+			seq_printf(m, " %11u", hist[i].buckets[j]);
+		seq_putc(m, '\n');
+	}
+}
+
+/*
+ * Show the latencies of @p, or with @whole of all the live threads of
+ * its process.
+ */
+int proc_schedlat_show_task(struct task_struct *p, struct seq_file *m,
+			    int whole)
+{
+	struct schedlat_hist *sum;
+
+	sum = kzalloc(sizeof(*sum) * SCHEDLAT_NR, GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+
+	if (whole) {
+		struct task_struct *t = p;
+		unsigned long flags;
+
+		if (!lock_task_sighand(p, &flags)) {
+			kfree(sum);
+			return -ESRCH;
+		}
+		do {
+			schedlat_add(sum, t);
+		} while_each_thread(p, t);
+		unlock_task_sighand(p, &flags);
+	} else
+		schedlat_add(sum, p);
+
+	schedlat_print(m, sum);
+	kfree(sum);
+	return 0;
+}
+
+static void schedlat_reset(struct task_struct *p)
+{
+	memset(p->schedlat.hist, 0, sizeof(p->schedlat.hist));
+}
+
+int proc_schedlat_reset_task(struct task_struct *p, int whole)
+{
+	if (whole) {
+		struct task_struct *t = p;
+		unsigned long flags;
+
+		if (!lock_task_sighand(p, &flags))
+			return -ESRCH;
+		do {
+			schedlat_reset(t);
+		} while_each_thread(p, t);
+		unlock_task_sighand(p, &flags);
+	} else
+		schedlat_reset(p);
+	return 0;
+}
+
+struct schedlat_worst {
+	pid_t pid;
+	char comm[TASK_COMM_LEN];
+	u32 max;
+	unsigned long count;
+	u64 sum;
+};
+
+/* Insert @p in @worst, sorted by decreasing maximum latency */
+static void schedlat_rank(struct schedlat_worst *worst, int *nr,
+			  struct task_struct *p, int kind)
+{
+	struct schedlat_hist *h = &p->schedlat.hist[kind];
+	u32 max = h->max;
+	int i;
+
+	if (!max || (*nr == SCHEDLAT_WORST && max <= worst[*nr - 1].max))
+		return;
+
+	if (*nr < SCHEDLAT_WORST)
+		(*nr)++;
+	for (i = *nr - 1; i > 0 && worst[i - 1].max < max; i--)
+		worst[i] = worst[i - 1];
+
+	worst[i].pid = task_pid_nr(p);
+	get_task_comm(worst[i].comm, p);
+	worst[i].max = max;
+	worst[i].count = schedlat_count(h);
+	worst[i].sum = h->sum;
+}
+
+static int schedlat_show(struct seq_file *m, void *v)
+{
+	struct schedlat_worst *worst;
+	struct task_struct *g, *p;
+	int nr[SCHEDLAT_NR] = { 0, };
+	int i, j;
+
+	worst = kcalloc(SCHEDLAT_NR * SCHEDLAT_WORST, sizeof(*worst),
+			GFP_KERNEL);
+	if (!worst)
+		return -ENOMEM;
+
+	read_lock(&tasklist_lock);
+	do_each_thread(g, p) {
+		for (i = 0; i < SCHEDLAT_NR; i++)
+			schedlat_rank(worst + i * SCHEDLAT_WORST, &nr[i], p, i);
+	} while_each_thread(g, p);
+	read_unlock(&tasklist_lock);
+
+	for (i = 0; i < SCHEDLAT_NR; i++) {
+		struct schedlat_worst *w = worst + i * SCHEDLAT_WORST;
+
+		if (i)
+			seq_putc(m, '\n');
+		seq_printf(m, "%s\n%8s %-16s %10s %10s %10s\n",
+			   schedlat_names[i], "tid", "comm", "count",
+			   "avg", "max");
+		for (j = 0; j < nr[i]; j++)
+			seq_printf(m, "%8d %-16s %10lu %10llu %10u\n",
+				   w[j].pid, w[j].comm, w[j].count,
+				   w[j].count ?
+				   div64_u64(w[j].sum, w[j].count) : 0ULL,
+				   w[j].max);
+	}
+
+	kfree(worst);
+	return 0;
+}
+
+/* Writing anything resets the histograms of all the threads */
+static ssize_t schedlat_write(struct file *file, const char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	struct task_struct *g, *p;
+
+	read_lock(&tasklist_lock);
+	do_each_thread(g, p) {
+		schedlat_reset(p);
+	} while_each_thread(g, p);
+	read_unlock(&tasklist_lock);
+
+	return count;
+}
+
+static int schedlat_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, schedlat_show, NULL);
+}
+
+static const struct file_operations schedlat_fops = {
+	.open		= schedlat_open,
+	.read		= seq_read,
+	.write		= schedlat_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init init_schedlat_procfs(void)
+{
+	proc_create("schedlat", 0644, NULL, &schedlat_fops);
+	return 0;
+}
+device_initcall(init_schedlat_procfs);
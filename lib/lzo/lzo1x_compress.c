@@ -17,10 +17,10 @@
 #include <linux/lzo.h>
 #include "lzodefs.h"
 
-static noinline size_t
-lzo1x_1_do_compress(const unsigned char *in, size_t in_len,
-		    unsigned char *out, size_t *out_len,
-		    size_t ti, void *wrkmem)
+static __always_inline size_t
+__lzo1x_1_do_compress(const unsigned char *in, size_t in_len,
+		      unsigned char *out, size_t *out_len,
+		      size_t ti, void *wrkmem, const int fast)
 {
 	const unsigned char *ip;
 	unsigned char *op;
@@ -43,11 +43,11 @@ literal:
 next:
 		if (unlikely(ip >= ip_end))
 			break;
-		dv = get_unaligned_le32(ip);
+		dv = LZO_LOAD_LE32(fast, ip);
 		t = ((dv * 0x1824429d) >> (32 - D_BITS)) & D_MASK;
 		m_pos = in + dict[t];
 		dict[t] = (lzo_dict_t) (ip - in);
-		if (unlikely(dv != get_unaligned_le32(m_pos)))
+		if (unlikely(dv != LZO_LOAD_LE32(fast, m_pos)))
 			goto literal;
 
 		ii -= ti;
@@ -56,12 +56,12 @@ next:
 		if (t != 0) {
 			if (t <= 3) {
 				op[-2] |= t;
-				COPY4(op, ii);
+				LZO_COPY4(fast, op, ii);
 				op += t;
 			} else if (t <= 16) {
 				*op++ = (t - 3);
-				COPY8(op, ii);
-				COPY8(op + 8, ii + 8);
+				LZO_COPY8(fast, op, ii);
+				LZO_COPY8(fast, op + 8, ii + 8);
 				op += t;
 			} else {
 				if (t <= 18) {
@@ -76,8 +76,8 @@ next:
 					*op++ = tt;
 				}
 				do {
-					COPY8(op, ii);
-					COPY8(op + 8, ii + 8);
+					LZO_COPY8(fast, op, ii);
+					LZO_COPY8(fast, op + 8, ii + 8);
 					op += 16;
 					ii += 16;
 					t -= 16;
@@ -131,6 +131,25 @@ next:
 #    error "missing endian definition"
 #  endif
 #else
+#ifdef LZO_ARM_UNALIGNED
+		if (fast) {
+			u32 v;
+
+			for (;;) {
+				v = lzo_ldr(ip + m_len) ^ lzo_ldr(m_pos + m_len);
+				if (v) {
+					m_len += (unsigned) __builtin_ctz(v) / 8;
+					break;
+				}
+				m_len += 4;
+				if (unlikely(ip + m_len >= ip_end))
+					break;
+			}
+			/* stop where the byte loop below does */
+			if (m_len > 4 && ip + m_len > ip_end)
+				m_len = max_t(size_t, ip_end - ip, 5);
+		} else
+#endif
 		if (unlikely(ip[m_len] == m_pos[m_len])) {
 			do {
 				m_len += 1;
@@ -187,9 +206,28 @@ m_len_done:
 	return in_end - (ii - ti);
 }
 
-int lzo1x_1_compress(const unsigned char *in, size_t in_len,
-		     unsigned char *out, size_t *out_len,
-		     void *wrkmem)
+static noinline size_t
+lzo1x_1_do_compress(const unsigned char *in, size_t in_len,
+		    unsigned char *out, size_t *out_len,
+		    size_t ti, void *wrkmem)
+{
+	return __lzo1x_1_do_compress(in, in_len, out, out_len, ti, wrkmem, 0);
+}
+
+#ifdef LZO_ARM_UNALIGNED
+static noinline size_t
+lzo1x_1_do_compress_fast(const unsigned char *in, size_t in_len,
+			 unsigned char *out, size_t *out_len,
+			 size_t ti, void *wrkmem)
+{
+	return __lzo1x_1_do_compress(in, in_len, out, out_len, ti, wrkmem, 1);
+}
+#endif
+
+static __always_inline int
+__lzo1x_1_compress(const unsigned char *in, size_t in_len,
+		   unsigned char *out, size_t *out_len,
+		   void *wrkmem, const int fast)
 {
 	const unsigned char *ip = in;
 	unsigned char *op = out;
@@ -203,7 +241,14 @@ int lzo1x_1_compress(const unsigned char *in, size_t in_len,
 			break;
 		BUILD_BUG_ON(D_SIZE * sizeof(lzo_dict_t) > LZO1X_1_MEM_COMPRESS);
 		memset(wrkmem, 0, D_SIZE * sizeof(lzo_dict_t));
-		t = lzo1x_1_do_compress(ip, ll, op, out_len, t, wrkmem);
+#ifdef LZO_ARM_UNALIGNED
+		if (fast)
+			t = lzo1x_1_do_compress_fast(ip, ll, op, out_len,
+						     t, wrkmem);
+		else
+#endif
+			t = lzo1x_1_do_compress(ip, ll, op, out_len,
+						t, wrkmem);
 		ip += ll;
 		op += *out_len;
 		l  -= ll;
@@ -229,8 +274,8 @@ int lzo1x_1_compress(const unsigned char *in, size_t in_len,
 			*op++ = tt;
 		}
 		if (t >= 16) do {
-			COPY8(op, ii);
-			COPY8(op + 8, ii + 8);
+			LZO_COPY8(fast, op, ii);
+			LZO_COPY8(fast, op + 8, ii + 8);
 			op += 16;
 			ii += 16;
 			t -= 16;
@@ -247,7 +292,28 @@ int lzo1x_1_compress(const unsigned char *in, size_t in_len,
 	*out_len = op - out;
 	return LZO_E_OK;
 }
+
+int lzo1x_1_compress(const unsigned char *in, size_t in_len,
+		     unsigned char *out, size_t *out_len,
+		     void *wrkmem)
+{
+#ifdef LZO_ARM_UNALIGNED
+	if (lzo_fast_unaligned())
+		return __lzo1x_1_compress(in, in_len, out, out_len, wrkmem, 1);
+#endif
+	return __lzo1x_1_compress(in, in_len, out, out_len, wrkmem, 0);
+}
 EXPORT_SYMBOL_GPL(lzo1x_1_compress);
 
+#ifdef LZO_ARM_UNALIGNED
+int lzo1x_1_compress_bytes(const unsigned char *in, size_t in_len,
+			   unsigned char *out, size_t *out_len,
+			   void *wrkmem)
+{
+	return __lzo1x_1_compress(in, in_len, out, out_len, wrkmem, 0);
+}
+EXPORT_SYMBOL_GPL(lzo1x_1_compress_bytes);
+#endif
+
 MODULE_LICENSE("GPL");
 MODULE_DESCRIPTION("LZO1X-1 Compressor");
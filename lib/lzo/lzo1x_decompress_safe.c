@@ -24,8 +24,9 @@
 #define NEED_OP(x)      if (!HAVE_OP(x)) goto output_overrun
 #define TEST_LB(m_pos)  if ((m_pos) < out) goto lookbehind_overrun
 
-int lzo1x_decompress_safe(const unsigned char *in, size_t in_len,
-			  unsigned char *out, size_t *out_len)
+static __always_inline int
+__lzo1x_decompress_safe(const unsigned char *in, size_t in_len,
+			unsigned char *out, size_t *out_len, const int fast)
 {
 	unsigned char *op;
 	const unsigned char *ip;
@@ -63,23 +64,21 @@ int lzo1x_decompress_safe(const unsigned char *in, size_t in_len,
 				}
 				t += 3;
 copy_literal_run:
-#if defined(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS)
-				if (likely(HAVE_IP(t + 15) && HAVE_OP(t + 15))) {
+				if (LZO_FAST(fast) &&
+				    likely(HAVE_IP(t + 15) && HAVE_OP(t + 15))) {
 					const unsigned char *ie = ip + t;
 					unsigned char *oe = op + t;
 					do {
-						COPY8(op, ip);
+						LZO_COPY8(fast, op, ip);
 						op += 8;
 						ip += 8;
-						COPY8(op, ip);
+						LZO_COPY8(fast, op, ip);
 						op += 8;
 						ip += 8;
 					} while (ip < ie);
 					ip = ie;
 					op = oe;
-				} else
-#endif
-				{
+				} else {
 					NEED_OP(t);
 					NEED_IP(t + 3);
 					do {
@@ -150,22 +149,21 @@ copy_literal_run:
 			m_pos -= 0x4000;
 		}
 		TEST_LB(m_pos);
-#if defined(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS)
-		if (op - m_pos >= 8) {
+		if (LZO_FAST(fast) && op - m_pos >= 8) {
 			unsigned char *oe = op + t;
 			if (likely(HAVE_OP(t + 15))) {
 				do {
-					COPY8(op, m_pos);
+					LZO_COPY8(fast, op, m_pos);
 					op += 8;
 					m_pos += 8;
-					COPY8(op, m_pos);
+					LZO_COPY8(fast, op, m_pos);
 					op += 8;
 					m_pos += 8;
 				} while (op < oe);
 				op = oe;
 				if (HAVE_IP(6)) {
 					state = next;
-					COPY4(op, ip);
+					LZO_COPY4(fast, op, ip);
 					op += next;
 					ip += next;
 					continue;
@@ -176,9 +174,7 @@ copy_literal_run:
 					*op++ = *m_pos++;
 				} while (op < oe);
 			}
-		} else
-#endif
-		{
+		} else {
 			unsigned char *oe = op + t;
 			NEED_OP(t);
 			op[0] = m_pos[0];
@@ -192,14 +188,11 @@ copy_literal_run:
 match_next:
 		state = next;
 		t = next;
-#if defined(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS)
-		if (likely(HAVE_IP(6) && HAVE_OP(4))) {
-			COPY4(op, ip);
+		if (LZO_FAST(fast) && likely(HAVE_IP(6) && HAVE_OP(4))) {
+			LZO_COPY4(fast, op, ip);
 			op += t;
 			ip += t;
-		} else
-#endif
-		{
+		} else {
 			NEED_IP(t + 3);
 			NEED_OP(t);
 			while (t > 0) {
@@ -228,8 +221,26 @@ lookbehind_overrun:
 	return LZO_E_LOOKBEHIND_OVERRUN;
 }
 
+int lzo1x_decompress_safe(const unsigned char *in, size_t in_len,
+			  unsigned char *out, size_t *out_len)
+{
+#ifdef LZO_ARM_UNALIGNED
+	if (lzo_fast_unaligned())
+		return __lzo1x_decompress_safe(in, in_len, out, out_len, 1);
+#endif
+	return __lzo1x_decompress_safe(in, in_len, out, out_len, 0);
+}
 EXPORT_SYMBOL_GPL(lzo1x_decompress_safe);
 
+#ifdef LZO_ARM_UNALIGNED
+int lzo1x_decompress_safe_bytes(const unsigned char *in, size_t in_len,
+				unsigned char *out, size_t *out_len)
+{
+	return __lzo1x_decompress_safe(in, in_len, out, out_len, 0);
+}
+EXPORT_SYMBOL_GPL(lzo1x_decompress_safe_bytes);
+#endif
+
 MODULE_LICENSE("GPL");
 MODULE_DESCRIPTION("LZO1X Decompressor");
 
@@ -0,0 +1,322 @@
+/*
+ *  lib/lzo/lzo_selftest.c
+ *
+ *  LZO1X self-test and benchmark
+ *
+ *  Compresses and decompresses generated data of assorted sizes and
+ *  alignments with every variant built in, checks that the round trip
+ *  gives the data back and that all the compressors produce the very
+ *  same stream, then reports the throughput of each variant on a few
+ *  kinds of data.
+ *
+ *  On ARMv6 and later the variants are the default entry points, which
+ *  take the word access paths once unaligned accesses are enabled, and
+ *  the byte access versions.  Elsewhere only the default one is tested.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/vmalloc.h>
+#include <linux/sched.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/lzo.h>
+#include <asm/unaligned.h>
+#include "lzodefs.h"
+
+static unsigned int bench_size = PAGE_SIZE;
+module_param(bench_size, uint, 0444);
+MODULE_PARM_DESC(bench_size, "Size of the benchmark blocks (0: no benchmark)");
+
+static unsigned int bench_iterations = 2000;
+module_param(bench_iterations, uint, 0444);
+MODULE_PARM_DESC(bench_iterations, "Blocks compressed per benchmark run");
+
+#define TEST_MAX_LEN	(65536 + 64)
+
+struct lzo_variant {
+	const char *name;
+	int (*compress)(const unsigned char *src, size_t src_len,
+			unsigned char *dst, size_t *dst_len, void *wrkmem);
+	int (*decompress)(const unsigned char *src, size_t src_len,
+			  unsigned char *dst, size_t *dst_len);
+};
+
+static const struct lzo_variant lzo_variants[] = {
+	{ "default", lzo1x_1_compress, lzo1x_decompress_safe },
+#ifdef LZO_ARM_UNALIGNED
+	{ "bytes", lzo1x_1_compress_bytes, lzo1x_decompress_safe_bytes },
+#endif
+};
+
+#define NR_VARIANTS	ARRAY_SIZE(lzo_variants)
+
+enum lzo_pattern {
+	PATTERN_ZERO,
+	PATTERN_SPARSE,		/* mostly zero, as many anonymous pages */
+	PATTERN_TEXT,
+	PATTERN_REPEAT,		/* short range matches */
+	PATTERN_RANDOM,
+	PATTERN_NR,
+};
+
+static const char *lzo_pattern_names[PATTERN_NR] = {
+	[PATTERN_ZERO]		= "zero",
+	[PATTERN_SPARSE]	= "sparse",
+	[PATTERN_TEXT]		= "text",
+	[PATTERN_REPEAT]	= "repeat",
+	[PATTERN_RANDOM]	= "random",
+};
+
+static const char *lzo_words[] = {
+	"the ", "page ", "cache ", "of ", "and ", "struct ", "return ",
+	"int ", "lock", "(", ");\n", "\t", "if ", "unsigned ", "long ",
+	"= ", "0", "NULL", "->", "static ",
+};
+
+static u32 lzo_seed;
+
+/* deterministic, so that a failure can be reproduced */
+static u32 lzo_rand(void)
+{
+	lzo_seed = lzo_seed * 1664525 + 1013904223;
+	return lzo_seed >> 8;
+}
+
+static void lzo_fill(unsigned char *buf, size_t len, enum lzo_pattern p)
+{
+	size_t i = 0;
+
+	switch (p) {
+	case PATTERN_ZERO:
+		memset(buf, 0, len);
+		break;
+	case PATTERN_SPARSE:
+		memset(buf, 0, len);
+		for (i = 0; i < len; i += 1 + lzo_rand() % 64)
+			buf[i] = lzo_rand();
+		break;
+	case PATTERN_TEXT:
+		while (i < len) {
+			const char *w = lzo_words[lzo_rand() %
+						  ARRAY_SIZE(lzo_words)];
+
+			while (*w && i < len)
+				buf[i++] = *w++;
+		}
+		break;
+	case PATTERN_REPEAT:
+		for (; i < len; i++)
+			buf[i] = (i < 16 || lzo_rand() % 8 == 0) ?
+				 lzo_rand() : buf[i - 1 - lzo_rand() % 16];
+		break;
+	default:
+		for (; i < len; i++)
+			buf[i] = lzo_rand();
+		break;
+	}
+}
+
+struct lzo_buffers {
+	unsigned char *src;
+	unsigned char *dst[NR_VARIANTS];
+	unsigned char *out;
+	void *wrkmem;
+};
+
+static int lzo_test_one(struct lzo_buffers *b, size_t len,
+			unsigned int src_off, unsigned int dst_off)
+{
+	const unsigned char *src = b->src + src_off;
+	size_t clen[NR_VARIANTS];
+	size_t out_len;
+	int i, j, ret;
+
+	for (i = 0; i < NR_VARIANTS; i++) {
+		ret = lzo_variants[i].compress(src, len, b->dst[i] + dst_off,
+					       &clen[i], b->wrkmem);
+		if (ret != LZO_E_OK) {
+			printk(KERN_ERR "lzo_selftest: %s compress failed: "
+			       "%d\n", lzo_variants[i].name, ret);
+			return -EINVAL;
+		}
+		if (i && (clen[i] != clen[0] ||
+			  memcmp(b->dst[i] + dst_off, b->dst[0] + dst_off,
+				 clen[0]))) {
+			printk(KERN_ERR "lzo_selftest: %s and %s compress "
+			       "differently\n", lzo_variants[i].name,
+			       lzo_variants[0].name);
+			return -EINVAL;
+		}
+	}
+
+	for (i = 0; i < NR_VARIANTS; i++)
+		for (j = 0; j < NR_VARIANTS; j++) {
+			out_len = TEST_MAX_LEN;
+			ret = lzo_variants[j].decompress(b->dst[i] + dst_off,
+							 clen[i], b->out + src_off,
+							 &out_len);
+			if (ret != LZO_E_OK || out_len != len ||
+			    memcmp(b->out + src_off, src, len)) {
+				printk(KERN_ERR "lzo_selftest: %s decompress "
+				       "failed: %d, %zu bytes of %zu\n",
+				       lzo_variants[j].name, ret, out_len,
+				       len);
+				return -EINVAL;
+			}
+		}
+
+	/* a truncated stream must be caught, not overrun */
+	if (clen[0] > 3) {
+		for (j = 0; j < NR_VARIANTS; j++) {
+			out_len = TEST_MAX_LEN;
+			ret = lzo_variants[j].decompress(b->dst[0] + dst_off,
+							 clen[0] - 3, b->out,
+							 &out_len);
+			if (ret == LZO_E_OK) {
+				printk(KERN_ERR "lzo_selftest: %s accepted a "
+				       "truncated stream\n",
+				       lzo_variants[j].name);
+				return -EINVAL;
+			}
+		}
+	}
+	return 0;
+}
+
+static const size_t lzo_test_lens[] = {
+	0, 1, 2, 3, 4, 5, 15, 16, 17, 18, 19, 20, 21, 22, 31, 32, 33, 63, 64,
+	238, 239, 255, 256, 1000, 4095, 4096, 4097, 16384, 49151, 49152,
+	49153, 65536,
+};
+
+static int lzo_selftest(struct lzo_buffers *b)
+{
+	unsigned int p, i, off, tests = 0;
+	int ret;
+
+	for (p = 0; p < PATTERN_NR; p++) {
+		for (i = 0; i < ARRAY_SIZE(lzo_test_lens); i++) {
+			for (off = 0; off < 4; off++) {
+				size_t len = lzo_test_lens[i];
+
+				lzo_seed = p * 1000 + i * 4 + off;
+				lzo_fill(b->src + off, len, p);
+				ret = lzo_test_one(b, len, off, (off * 3) & 3);
+				if (ret) {
+					printk(KERN_ERR "lzo_selftest: %s data, "
+					       "%zu bytes, offset %u\n",
+					       lzo_pattern_names[p], len, off);
+					return ret;
+				}
+				tests++;
+			}
+			cond_resched();
+		}
+	}
+
+	printk(KERN_INFO "lzo_selftest: %u tests passed\n", tests);
+	return 0;
+}
+
+static unsigned long lzo_mbps(u64 bytes, s64 ns)
+{
+	return ns > 0 ? div64_u64(bytes * 1000, ns) : 0;
+}
+
+static int lzo_bench(struct lzo_buffers *b)
+{
+	unsigned int p, i, n;
+	size_t clen, out_len;
+	u64 bytes = (u64)bench_size * bench_iterations;
+	ktime_t start;
+	s64 cns, dns;
+	int ret;
+
+	for (p = 0; p < PATTERN_NR; p++) {
+		lzo_seed = p;
+		lzo_fill(b->src, bench_size, p);
+
+		for (i = 0; i < NR_VARIANTS; i++) {
+			const struct lzo_variant *v = &lzo_variants[i];
+
+			start = ktime_get();
+			for (n = 0; n < bench_iterations; n++) {
+				v->compress(b->src, bench_size, b->dst[0],
+					    &clen, b->wrkmem);
+				if (!(n & 63))
+					cond_resched();
+			}
+			cns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+			start = ktime_get();
+			for (n = 0; n < bench_iterations; n++) {
+				out_len = bench_size;
+				ret = v->decompress(b->dst[0], clen, b->out,
+						    &out_len);
+				if (ret != LZO_E_OK)
+					return -EINVAL;
+				if (!(n & 63))
+					cond_resched();
+			}
+			dns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+			printk(KERN_INFO "lzo_selftest: %-7s %-6s %u -> %zu, "
+			       "compress %lu MB/s, decompress %lu MB/s\n",
+			       v->name, lzo_pattern_names[p], bench_size, clen,
+			       lzo_mbps(bytes, cns), lzo_mbps(bytes, dns));
+		}
+	}
+	return 0;
+}
+
+static int __init lzo_selftest_init(void)
+{
+	struct lzo_buffers b;
+	size_t size = lzo1x_worst_compress(TEST_MAX_LEN) + 8;
+	int i, ret = -ENOMEM;
+
+	if (bench_size > TEST_MAX_LEN)
+		return -EINVAL;
+
+	memset(&b, 0, sizeof(b));
+	b.src = vmalloc(TEST_MAX_LEN + 8);
+	b.out = vmalloc(TEST_MAX_LEN + 8);
+	b.wrkmem = vmalloc(LZO1X_1_MEM_COMPRESS);
+	if (!b.src || !b.out || !b.wrkmem)
+		goto out;
+	for (i = 0; i < NR_VARIANTS; i++) {
+		b.dst[i] = vmalloc(size);
+		if (!b.dst[i])
+			goto out;
+	}
+
+#ifdef LZO_ARM_UNALIGNED
+	printk(KERN_INFO "lzo_selftest: default uses the %s access paths\n",
+	       lzo_fast_unaligned() ? "word" : "byte");
+#endif
+	ret = lzo_selftest(&b);
+	if (!ret && bench_size && bench_iterations)
+		ret = lzo_bench(&b);
+out:
+	for (i = 0; i < NR_VARIANTS; i++)
+		vfree(b.dst[i]);
+	vfree(b.wrkmem);
+	vfree(b.out);
+	vfree(b.src);
+	return ret;
+}
+
+static void __exit lzo_selftest_exit(void)
+{
+}
+
+module_init(lzo_selftest_init);
+module_exit(lzo_selftest_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZO1X self-test and benchmark");
@@ -33,6 +33,72 @@
 #define LZO_USE_CTZ32	1
 #endif
 
+/*
+ * Word access paths.  Arches with efficient unaligned access always take
+ * them.  ARMv6 and later do unaligned LDR/STR in hardware, but only once
+ * alignment_init() has cleared the alignment fault enable bit, so there
+ * they are chosen at run time and the byte paths remain for early boot.
+ * The ARM paths give the same output as the byte ones.
+ */
+#if defined(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS)
+#define LZO_FAST(fast)			1
+#define LZO_LOAD_LE32(fast, p)		get_unaligned_le32(p)
+#define LZO_COPY4(fast, dst, src)	COPY4(dst, src)
+#define LZO_COPY8(fast, dst, src)	do { COPY8(dst, src); } while (0)
+#elif defined(__arm__) && (__LINUX_ARM_ARCH__ >= 6) && defined(__LITTLE_ENDIAN)
+#include <asm/system.h>
+
+#define LZO_ARM_UNALIGNED	1
+
+static inline int lzo_fast_unaligned(void)
+{
+	return !(get_cr() & CR_A);
+}
+
+/* explicit LDR/STR, the compiler could merge plain accesses into LDM/LDRD */
+static inline u32 lzo_ldr(const unsigned char *p)
+{
+	u32 v;
+
+	asm("ldr	%0, [%1]" : "=r" (v) : "r" (p), "m" (*(const u32 *)p));
+	return v;
+}
+
+static inline void lzo_str(unsigned char *p, u32 v)
+{
+	asm volatile("str	%1, [%2]" : "=m" (*(u32 *)p) : "r" (v), "r" (p));
+}
+
+#define LZO_FAST(fast)			(fast)
+#define LZO_LOAD_LE32(fast, p)		\
+	((fast) ? lzo_ldr(p) : get_unaligned_le32(p))
+#define LZO_COPY4(fast, dst, src)				\
+	do {							\
+		if (fast)					\
+			lzo_str((dst), lzo_ldr(src));		\
+		else						\
+			COPY4(dst, src);			\
+	} while (0)
+#define LZO_COPY8(fast, dst, src)				\
+	do {							\
+		LZO_COPY4(fast, dst, src);			\
+		LZO_COPY4(fast, (dst) + 4, (src) + 4);		\
+	} while (0)
+#else
+#define LZO_FAST(fast)			0
+#define LZO_LOAD_LE32(fast, p)		get_unaligned_le32(p)
+#define LZO_COPY4(fast, dst, src)	COPY4(dst, src)
+#define LZO_COPY8(fast, dst, src)	do { COPY8(dst, src); } while (0)
+#endif
+
+#ifdef LZO_ARM_UNALIGNED
+/* the byte access versions, for the self-test */
+int lzo1x_1_compress_bytes(const unsigned char *src, size_t src_len,
+			   unsigned char *dst, size_t *dst_len, void *wrkmem);
+int lzo1x_decompress_safe_bytes(const unsigned char *src, size_t src_len,
+				unsigned char *dst, size_t *dst_len);
+#endif
+
 #define M1_MAX_OFFSET	0x0400
 #define M2_MAX_OFFSET	0x0800
 #define M3_MAX_OFFSET	0x4000
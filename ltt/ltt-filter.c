@@ -9,6 +9,10 @@
 #include <linux/fs.h>
 #include <linux/ltt-tracer.h>
 #include <linux/mutex.h>
+#include <linux/ctype.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/sched.h>
 
 #define LTT_FILTER_DIR	"filter"
 
@@ -42,6 +46,697 @@ err_no_root:
 }
 EXPORT_SYMBOL_GPL(get_filter_root);
 
+/*
+ * Marker argument filters.
+ *
+ * A filter expression is compiled against the format string of a marker into
+ * a small stack machine program, attached to the connected marker and run by
+ * ltt_vtrace() before anything is reserved or serialized. Grammar:
+ *
+ * expr    := and ( "||" and )*
+ * and     := unary ( "&&" unary )*
+ * unary   := "!" unary | "(" expr ")" | operand [ relop operand
+ *            | "in" "{" number ( "," number )* "}" ]
+ * operand := field_name | "pid" | "tgid" | "cpu" | number
+ * relop   := "==" | "!=" | "<" | "<=" | ">" | ">="
+ *
+ * Field names are the names preceding each conversion of the marker format,
+ * e.g. "irq_id" in "irq_id %u kernel_mode %u". A bare operand is true when
+ * non-zero. Values are compared as signed 64-bit integers; string fields
+ * cannot be used. Sets are sorted at compile time and binary searched.
+ */
+
+#define LTT_FILTER_MAX_ARGS	16
+#define LTT_FILTER_MAX_INSNS	64
+#define LTT_FILTER_MAX_STACK	16
+#define LTT_FILTER_MAX_SETS	4
+#define LTT_FILTER_MAX_SET_SIZE	64
+#define LTT_FILTER_MAX_NESTING	32	/* of "!" and "(", recursive */
+
+enum ltt_filter_op {
+	LTT_FOP_LOAD_ARG,	/* push marker argument #operand */
+	LTT_FOP_LOAD_PID,
+	LTT_FOP_LOAD_TGID,
+	LTT_FOP_LOAD_CPU,
+	LTT_FOP_LOAD_IMM,	/* push operand */
+	LTT_FOP_EQ,		/* pop b, pop a, push a op b */
+	LTT_FOP_NE,
+	LTT_FOP_LT,
+	LTT_FOP_LE,
+	LTT_FOP_GT,
+	LTT_FOP_GE,
+	LTT_FOP_AND,
+	LTT_FOP_OR,
+	LTT_FOP_NOT,		/* replace top with !top */
+	LTT_FOP_IN,		/* replace top with (top in set #operand) */
+	LTT_FOP_RET,		/* return top != 0 */
+};
+
+/* C types of marker arguments, as fetched with va_arg */
+enum ltt_filter_arg_type {
+	LTT_FARG_INT,
+	LTT_FARG_UINT,
+	LTT_FARG_SHORT,
+	LTT_FARG_USHORT,
+	LTT_FARG_UCHAR,
+	LTT_FARG_LONG,
+	LTT_FARG_ULONG,
+	LTT_FARG_LLONG,
+	LTT_FARG_ULLONG,
+	LTT_FARG_PTR,
+	LTT_FARG_STRING,
+};
+
+struct ltt_filter_insn {
+	u8 op;
+	s64 operand;
+};
+
+struct ltt_filter_set {
+	unsigned int nr;
+	s64 *values;
+};
+
+struct ltt_filter_prog {
+	unsigned int nr_args;		/* arguments fetched before running */
+	u8 arg_types[LTT_FILTER_MAX_ARGS];
+	unsigned int nr_sets;
+	struct ltt_filter_set sets[LTT_FILTER_MAX_SETS];
+	unsigned int nr_insns;
+	struct ltt_filter_insn insns[LTT_FILTER_MAX_INSNS];
+	char expr[];			/* source, for reading back */
+};
+
+struct ltt_filter_field {
+	const char *name;
+	size_t len;
+	enum ltt_filter_arg_type type;
+};
+
+struct ltt_filter_parser {
+	const char *pos;
+	struct ltt_filter_prog *prog;
+	struct ltt_filter_field fields[LTT_FILTER_MAX_ARGS];
+	unsigned int nr_fields;
+	int depth;
+	unsigned int nesting;
+};
+
+/*
+ * Returns the type of the conversion at fmt (just after the '%') and moves
+ * fmt past it, or -EINVAL for conversions the filter cannot walk over.
+ * Flags, field width and precision are skipped; a '*' width or precision
+ * takes an argument of its own and is refused.
+ */
+static int ltt_filter_parse_conv(const char **fmtp)
+{
+	const char *fmt = *fmtp;
+	int qualifier = -1;
+	int ret;
+
+	while (*fmt == '-' || *fmt == '+' || *fmt == ' ' || *fmt == '#'
+	       || *fmt == '0')
+		fmt++;
+
+	while (isdigit(*fmt))
+		fmt++;
+	if (*fmt == '.') {
+		fmt++;
+		while (isdigit(*fmt))
+			fmt++;
+	}
+
+	if (*fmt == 'h' || *fmt == 'l' || *fmt == 'L' || *fmt == 'Z'
+	    || *fmt == 'z' || *fmt == 't') {
+		qualifier = *fmt++;
+		if (qualifier == 'l' && *fmt == 'l') {
+			qualifier = 'L';
+			fmt++;
+		}
+	}
+
+	switch (*fmt) {
+	case 'c':
+		ret = LTT_FARG_UCHAR;
+		break;
+	case 's':
+		ret = LTT_FARG_STRING;
+		break;
+	case 'p':
+		ret = LTT_FARG_PTR;
+		break;
+	case 'd':
+	case 'i':
+		switch (qualifier) {
+		case 'L':
+			ret = LTT_FARG_LLONG;
+			break;
+		case 'l':
+		case 'Z':
+		case 'z':
+		case 't':
+			ret = LTT_FARG_LONG;
+			break;
+		case 'h':
+			ret = LTT_FARG_SHORT;
+			break;
+		default:
+			ret = LTT_FARG_INT;
+		}
+		break;
+	case 'o':
+	case 'u':
+	case 'x':
+	case 'X':
+		switch (qualifier) {
+		case 'L':
+			ret = LTT_FARG_ULLONG;
+			break;
+		case 'l':
+		case 'Z':
+		case 'z':
+		case 't':
+			ret = LTT_FARG_ULONG;
+			break;
+		case 'h':
+			ret = LTT_FARG_USHORT;
+			break;
+		default:
+			ret = LTT_FARG_UINT;
+		}
+		break;
+	default:
+		return -EINVAL;
+	}
+	*fmtp = fmt + 1;
+	return ret;
+}
+
+/*
+ * Collect the field names and argument types of a marker format. Formats
+ * using serialization callbacks (#k) consume arguments the filter cannot
+ * know about and are refused.
+ */
+static int ltt_filter_parse_format(struct ltt_filter_parser *p,
+				   const char *fmt)
+{
+	const char *name = NULL;
+	size_t name_len = 0;
+	int type;
+
+	while (*fmt) {
+		if (isspace(*fmt)) {
+			fmt++;
+		} else if (*fmt == '#') {
+			for (; *fmt && !isspace(*fmt) && *fmt != '%'; fmt++)
+				if (*fmt == 'k')
+					return -EINVAL;
+		} else if (*fmt == '%') {
+			fmt++;
+			if (*fmt == '%') {
+				fmt++;
+				continue;
+			}
+			type = ltt_filter_parse_conv(&fmt);
+			if (type < 0)
+				return type;
+			/* later fields cannot be referenced */
+			if (p->nr_fields == LTT_FILTER_MAX_ARGS)
+				return 0;
+			p->fields[p->nr_fields].name = name;
+			p->fields[p->nr_fields].len = name_len;
+			p->fields[p->nr_fields].type = type;
+			p->nr_fields++;
+			name = NULL;
+		} else {
+			name = fmt;
+			while (*fmt && !isspace(*fmt) && *fmt != '%'
+			       && *fmt != '#')
+				fmt++;
+			name_len = fmt - name;
+		}
+	}
+	return 0;
+}
+
+static void ltt_filter_skip_space(struct ltt_filter_parser *p)
+{
+	while (isspace(*p->pos))
+		p->pos++;
+}
+
+/* Consumes token tok if it is next in the expression */
+static int ltt_filter_accept(struct ltt_filter_parser *p, const char *tok)
+{
+	size_t len = strlen(tok);
+
+	ltt_filter_skip_space(p);
+	if (strncmp(p->pos, tok, len))
+		return 0;
+	/* keywords must not be the prefix of an identifier */
+	if (isalpha(tok[0]) && (isalnum(p->pos[len]) || p->pos[len] == '_'))
+		return 0;
+	p->pos += len;
+	return 1;
+}
+
+static int ltt_filter_emit(struct ltt_filter_parser *p, u8 op, s64 operand,
+			   int stack_delta)
+{
+	struct ltt_filter_prog *prog = p->prog;
+
+	if (prog->nr_insns == LTT_FILTER_MAX_INSNS)
+		return -E2BIG;
+	p->depth += stack_delta;
+	if (p->depth > LTT_FILTER_MAX_STACK)
+		return -E2BIG;
+	prog->insns[prog->nr_insns].op = op;
+	prog->insns[prog->nr_insns].operand = operand;
+	prog->nr_insns++;
+	return 0;
+}
+
+static int ltt_filter_parse_number(struct ltt_filter_parser *p, s64 *val)
+{
+	char *end;
+
+	ltt_filter_skip_space(p);
+	if (!isdigit(*p->pos) && !(*p->pos == '-' && isdigit(p->pos[1])))
+		return -EINVAL;
+	*val = simple_strtoll(p->pos, &end, 0);
+	p->pos = end;
+	return 0;
+}
+
+static int ltt_filter_parse_operand(struct ltt_filter_parser *p)
+{
+	struct ltt_filter_prog *prog = p->prog;
+	const char *name;
+	size_t len;
+	unsigned int i;
+	s64 val;
+
+	ltt_filter_skip_space(p);
+	if (!isalpha(*p->pos) && *p->pos != '_') {
+		if (ltt_filter_parse_number(p, &val))
+			return -EINVAL;
+		return ltt_filter_emit(p, LTT_FOP_LOAD_IMM, val, 1);
+	}
+
+	name = p->pos;
+	while (isalnum(*p->pos) || *p->pos == '_')
+		p->pos++;
+	len = p->pos - name;
+
+	/* marker fields shadow the builtin names */
+	for (i = 0; i < p->nr_fields; i++) {
+		if (p->fields[i].len != len
+		    || strncmp(p->fields[i].name, name, len))
+			continue;
+		if (p->fields[i].type == LTT_FARG_STRING)
+			return -EINVAL;
+		if (i >= prog->nr_args)
+			prog->nr_args = i + 1;
+		return ltt_filter_emit(p, LTT_FOP_LOAD_ARG, i, 1);
+	}
+
+	if (len == 3 && !strncmp(name, "pid", 3))
+		return ltt_filter_emit(p, LTT_FOP_LOAD_PID, 0, 1);
+	if (len == 4 && !strncmp(name, "tgid", 4))
+		return ltt_filter_emit(p, LTT_FOP_LOAD_TGID, 0, 1);
+	if (len == 3 && !strncmp(name, "cpu", 3))
+		return ltt_filter_emit(p, LTT_FOP_LOAD_CPU, 0, 1);
+	return -ENOENT;
+}
+
+static int ltt_filter_cmp_s64(const void *a, const void *b)
+{
+	s64 x = *(const s64 *)a, y = *(const s64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int ltt_filter_parse_set(struct ltt_filter_parser *p)
+{
+	struct ltt_filter_prog *prog = p->prog;
+	struct ltt_filter_set *set;
+	s64 *values;
+	unsigned int nr = 0;
+	int ret;
+
+	if (prog->nr_sets == LTT_FILTER_MAX_SETS)
+		return -E2BIG;
+	if (!ltt_filter_accept(p, "{"))
+		return -EINVAL;
+
+	values = kmalloc(sizeof(*values) * LTT_FILTER_MAX_SET_SIZE,
+			 GFP_KERNEL);
+	if (!values)
+		return -ENOMEM;
+
+	do {
+		if (nr == LTT_FILTER_MAX_SET_SIZE) {
+			ret = -E2BIG;
+			goto error;
+		}
+		ret = ltt_filter_parse_number(p, &values[nr++]);
+		if (ret)
+			goto error;
+	} while (ltt_filter_accept(p, ","));
+
+	if (!ltt_filter_accept(p, "}")) {
+		ret = -EINVAL;
+		goto error;
+	}
+
+	sort(values, nr, sizeof(*values), ltt_filter_cmp_s64, NULL);
+	set = &prog->sets[prog->nr_sets];
+	set->values = values;
+	set->nr = nr;
+	return ltt_filter_emit(p, LTT_FOP_IN, prog->nr_sets++, 0);
+
+error:
+	kfree(values);
+	return ret;
+}
+
+static int ltt_filter_parse_expr(struct ltt_filter_parser *p);
+static int ltt_filter_parse_unary(struct ltt_filter_parser *p);
+
+static int __ltt_filter_parse_unary(struct ltt_filter_parser *p)
+{
+	static const struct {
+		const char *tok;
+		u8 op;
+	} relops[] = {
+		/* two-character operators first */
+		{ "==", LTT_FOP_EQ },
+		{ "!=", LTT_FOP_NE },
+		{ "<=", LTT_FOP_LE },
+		{ ">=", LTT_FOP_GE },
+		{ "<", LTT_FOP_LT },
+		{ ">", LTT_FOP_GT },
+	};
+	unsigned int i;
+	int ret;
+
+	if (ltt_filter_accept(p, "!")) {
+		ret = ltt_filter_parse_unary(p);
+		if (ret)
+			return ret;
+		return ltt_filter_emit(p, LTT_FOP_NOT, 0, 0);
+	}
+
+	if (ltt_filter_accept(p, "(")) {
+		ret = ltt_filter_parse_expr(p);
+		if (ret)
+			return ret;
+		return ltt_filter_accept(p, ")") ? 0 : -EINVAL;
+	}
+
+	ret = ltt_filter_parse_operand(p);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < ARRAY_SIZE(relops); i++) {
+		if (!ltt_filter_accept(p, relops[i].tok))
+			continue;
+		ret = ltt_filter_parse_operand(p);
+		if (ret)
+			return ret;
+		return ltt_filter_emit(p, relops[i].op, 0, -1);
+	}
+
+	if (ltt_filter_accept(p, "in"))
+		return ltt_filter_parse_set(p);
+
+	/* bare operand: true if non-zero */
+	ret = ltt_filter_emit(p, LTT_FOP_LOAD_IMM, 0, 1);
+	if (ret)
+		return ret;
+	return ltt_filter_emit(p, LTT_FOP_NE, 0, -1);
+}
+
+/*
+ * "!" and "(" recurse: bound the nesting, a page of them would overflow
+ * the kernel stack.
+ */
+static int ltt_filter_parse_unary(struct ltt_filter_parser *p)
+{
+	int ret;
+
+	if (p->nesting == LTT_FILTER_MAX_NESTING)
+		return -EINVAL;
+	p->nesting++;
+	ret = __ltt_filter_parse_unary(p);
+	p->nesting--;
+	return ret;
+}
+
+static int ltt_filter_parse_and(struct ltt_filter_parser *p)
+{
+	int ret;
+
+	ret = ltt_filter_parse_unary(p);
+	while (!ret && ltt_filter_accept(p, "&&")) {
+		ret = ltt_filter_parse_unary(p);
+		if (!ret)
+			ret = ltt_filter_emit(p, LTT_FOP_AND, 0, -1);
+	}
+	return ret;
+}
+
+static int ltt_filter_parse_expr(struct ltt_filter_parser *p)
+{
+	int ret;
+
+	ret = ltt_filter_parse_and(p);
+	while (!ret && ltt_filter_accept(p, "||")) {
+		ret = ltt_filter_parse_and(p);
+		if (!ret)
+			ret = ltt_filter_emit(p, LTT_FOP_OR, 0, -1);
+	}
+	return ret;
+}
+
+void ltt_filter_free(struct ltt_filter_prog *prog)
+{
+	unsigned int i;
+
+	if (!prog)
+		return;
+	for (i = 0; i < prog->nr_sets; i++)
+		kfree(prog->sets[i].values);
+	kfree(prog);
+}
+EXPORT_SYMBOL_GPL(ltt_filter_free);
+
+/**
+ * ltt_filter_compile - Compile a filter expression for a marker
+ * @format: format string of the marker
+ * @expr: filter expression
+ *
+ * Returns the program or an ERR_PTR.
+ */
+struct ltt_filter_prog *ltt_filter_compile(const char *format,
+					   const char *expr)
+{
+	struct ltt_filter_parser *p;
+	struct ltt_filter_prog *prog;
+	unsigned int i;
+	size_t len;
+	int ret;
+
+	p = kzalloc(sizeof(*p), GFP_KERNEL);
+	prog = kzalloc(sizeof(*prog) + strlen(expr) + 1, GFP_KERNEL);
+	if (!p || !prog) {
+		ret = -ENOMEM;
+		goto error;
+	}
+	strcpy(prog->expr, expr);
+	p->prog = prog;
+	p->pos = prog->expr;
+
+	ret = ltt_filter_parse_format(p, format);
+	if (ret)
+		goto error;
+
+	ret = ltt_filter_parse_expr(p);
+	if (ret)
+		goto error;
+	ltt_filter_skip_space(p);
+	if (*p->pos) {
+		ret = -EINVAL;
+		goto error;
+	}
+	ret = ltt_filter_emit(p, LTT_FOP_RET, 0, 0);
+	if (ret)
+		goto error;
+
+	for (i = 0; i < prog->nr_args; i++)
+		prog->arg_types[i] = p->fields[i].type;
+
+	/* drop the trailing newline of debugfs writes from the source */
+	len = strlen(prog->expr);
+	while (len && isspace(prog->expr[len - 1]))
+		prog->expr[--len] = '\0';
+
+	kfree(p);
+	return prog;
+
+error:
+	kfree(p);
+	ltt_filter_free(prog);
+	return ERR_PTR(ret);
+}
+EXPORT_SYMBOL_GPL(ltt_filter_compile);
+
+const char *ltt_filter_expr(const struct ltt_filter_prog *prog)
+{
+	return prog->expr;
+}
+EXPORT_SYMBOL_GPL(ltt_filter_expr);
+
+static notrace
+int ltt_filter_set_find(const struct ltt_filter_set *set, s64 val)
+{
+	unsigned int lo = 0, hi = set->nr;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (set->values[mid] == val)
+			return 1;
+		if (set->values[mid] < val)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return 0;
+}
+
+/**
+ * ltt_filter_eval - Run a filter on the arguments of a marker
+ * @prog: compiled filter
+ * @args: marker arguments, left untouched
+ *
+ * Returns non-zero if the event must be recorded. Called with preemption
+ * disabled from the marker probe.
+ */
+notrace
+int ltt_filter_eval(const struct ltt_filter_prog *prog, va_list *args)
+{
+	s64 argv[LTT_FILTER_MAX_ARGS];
+	s64 stack[LTT_FILTER_MAX_STACK];
+	const struct ltt_filter_insn *insn;
+	unsigned int i;
+	int sp = -1;
+	va_list ap;
+
+	va_copy(ap, *args);
+	for (i = 0; i < prog->nr_args; i++) {
+		switch (prog->arg_types[i]) {
+		case LTT_FARG_INT:
+			argv[i] = va_arg(ap, int);
+			break;
+		case LTT_FARG_UINT:
+			argv[i] = va_arg(ap, unsigned int);
+			break;
+		case LTT_FARG_SHORT:
+			argv[i] = (short)va_arg(ap, int);
+			break;
+		case LTT_FARG_USHORT:
+			argv[i] = (unsigned short)va_arg(ap, int);
+			break;
+		case LTT_FARG_UCHAR:
+			argv[i] = (unsigned char)va_arg(ap, int);
+			break;
+		case LTT_FARG_LONG:
+			argv[i] = va_arg(ap, long);
+			break;
+		case LTT_FARG_ULONG:
+			argv[i] = va_arg(ap, unsigned long);
+			break;
+		case LTT_FARG_LLONG:
+			argv[i] = va_arg(ap, long long);
+			break;
+		case LTT_FARG_ULLONG:
+			argv[i] = va_arg(ap, unsigned long long);
+			break;
+		case LTT_FARG_PTR:
+			argv[i] = (unsigned long)va_arg(ap, void *);
+			break;
+		case LTT_FARG_STRING:
+			(void)va_arg(ap, const char *);
+			argv[i] = 0;
+			break;
+		}
+	}
+	va_end(ap);
+
+	for (insn = prog->insns; ; insn++) {
+		switch (insn->op) {
+		case LTT_FOP_LOAD_ARG:
+			stack[++sp] = argv[insn->operand];
+			break;
+		case LTT_FOP_LOAD_PID:
+			stack[++sp] = current->pid;
+			break;
+		case LTT_FOP_LOAD_TGID:
+			stack[++sp] = current->tgid;
+			break;
+		case LTT_FOP_LOAD_CPU:
+			stack[++sp] = raw_smp_processor_id();
+			break;
+		case LTT_FOP_LOAD_IMM:
+			stack[++sp] = insn->operand;
+			break;
+		case LTT_FOP_EQ:
+			sp--;
+			stack[sp] = stack[sp] == stack[sp + 1];
+			break;
+		case LTT_FOP_NE:
+			sp--;
+			stack[sp] = stack[sp] != stack[sp + 1];
+			break;
+		case LTT_FOP_LT:
+			sp--;
+			stack[sp] = stack[sp] < stack[sp + 1];
+			break;
+		case LTT_FOP_LE:
+			sp--;
+			stack[sp] = stack[sp] <= stack[sp + 1];
+			break;
+		case LTT_FOP_GT:
+			sp--;
+			stack[sp] = stack[sp] > stack[sp + 1];
+			break;
+		case LTT_FOP_GE:
+			sp--;
+			stack[sp] = stack[sp] >= stack[sp + 1];
+			break;
+		case LTT_FOP_AND:
+			sp--;
+			stack[sp] = stack[sp] && stack[sp + 1];
+			break;
+		case LTT_FOP_OR:
+			sp--;
+			stack[sp] = stack[sp] || stack[sp + 1];
+			break;
+		case LTT_FOP_NOT:
+			stack[sp] = !stack[sp];
+			break;
+		case LTT_FOP_IN:
+			stack[sp] = ltt_filter_set_find(
+					&prog->sets[insn->operand], stack[sp]);
+			break;
+		case LTT_FOP_RET:
+			return stack[sp] != 0;
+		}
+	}
+}
+EXPORT_SYMBOL_GPL(ltt_filter_eval);
+
 static void __exit ltt_filter_exit(void)
 {
 	debugfs_remove(ltt_filter_dir);
@@ -192,6 +192,10 @@ int ltt_marker_disconnect(const char *channel, const char *mname,
 		goto end;
 	else {
 		list_del(&pdata->node);
+		if (pdata->filter) {
+			synchronize_sched();
+			ltt_filter_free(pdata->filter);
+		}
 		kmem_cache_free(markers_loaded_cachep, pdata);
 	}
 end:
@@ -200,6 +204,90 @@ end:
 }
 EXPORT_SYMBOL_GPL(ltt_marker_disconnect);
 
+/*
+ * Attach the argument filter "expr" to marker "mname" connected to probe
+ * "pname", replacing any previous one. An empty expression removes the
+ * filter. "format" is the marker format the expression is compiled against.
+ */
+int ltt_marker_set_filter(const char *channel, const char *mname,
+			  const char *pname, const char *format,
+			  const char *expr)
+{
+	struct ltt_active_marker *pdata;
+	struct ltt_available_probe *probe;
+	struct ltt_filter_prog *prog = NULL, *old;
+	int ret = 0;
+
+	while (isspace(*expr))
+		expr++;
+	if (*expr) {
+		prog = ltt_filter_compile(format, expr);
+		if (IS_ERR(prog))
+			return PTR_ERR(prog);
+	}
+
+	mutex_lock(&probes_mutex);
+	probe = get_probe_from_name(pname);
+	if (!probe) {
+		ret = -ENOENT;
+		goto end;
+	}
+	pdata = marker_get_private_data(channel, mname, probe->probe_func, 0);
+	if (IS_ERR(pdata)) {
+		ret = PTR_ERR(pdata);
+		goto end;
+	} else if (!pdata) {
+		ret = -EPERM;
+		goto end;
+	}
+	old = pdata->filter;
+	rcu_assign_pointer(pdata->filter, prog);
+	prog = old;
+end:
+	mutex_unlock(&probes_mutex);
+	if (prog) {
+		/* either the replaced filter or the one we failed to attach */
+		if (!ret)
+			synchronize_sched();
+		ltt_filter_free(prog);
+	}
+	return ret;
+}
+EXPORT_SYMBOL_GPL(ltt_marker_set_filter);
+
+/*
+ * Copy the filter expression of marker "mname" connected to probe "pname"
+ * into buf. Returns its length, 0 if there is no filter.
+ */
+int ltt_marker_get_filter(const char *channel, const char *mname,
+			  const char *pname, char *buf, size_t size)
+{
+	struct ltt_active_marker *pdata;
+	struct ltt_available_probe *probe;
+	int ret = 0;
+
+	mutex_lock(&probes_mutex);
+	probe = get_probe_from_name(pname);
+	if (!probe) {
+		ret = -ENOENT;
+		goto end;
+	}
+	pdata = marker_get_private_data(channel, mname, probe->probe_func, 0);
+	if (IS_ERR(pdata)) {
+		ret = PTR_ERR(pdata);
+		goto end;
+	} else if (!pdata) {
+		ret = -EPERM;
+		goto end;
+	}
+	if (pdata->filter)
+		ret = strlcpy(buf, ltt_filter_expr(pdata->filter), size);
+end:
+	mutex_unlock(&probes_mutex);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(ltt_marker_get_filter);
+
 static void disconnect_all_markers(void)
 {
 	struct ltt_active_marker *pdata, *tmp;
@@ -208,6 +296,10 @@ static void disconnect_all_markers(void)
 		marker_probe_unregister_private_data(pdata->probe->probe_func,
 			pdata);
 		list_del(&pdata->node);
+		if (pdata->filter) {
+			synchronize_sched();
+			ltt_filter_free(pdata->filter);
+		}
 		kmem_cache_free(markers_loaded_cachep, pdata);
 	}
 }
@@ -0,0 +1,366 @@
+/*
+ * ltt/ltt-relay-bench.c
+ *
+ * LTTng relay buffer benchmark.
+ *
+ * Writes events straight into a dedicated channel of a private trace, once
+ * for each channel synchronization mode (lockless, irqoff, locked), and
+ * reports the cost of an event, the longest reserve-to-commit window (the
+ * time spent with interrupts off for the irqoff and locked modes) and the
+ * number of events lost to nesting.
+ *
+ * Each writer is a kernel thread bound to a cpu. Unless irq_period_us is 0,
+ * each writer also arms an hrtimer which writes an event from interrupt
+ * context, so that writers nest the way they do on a real system.
+ *
+ * The trace is never started nor read: the channel is in overwrite mode and
+ * events only go through the buffer reservation and commit paths.
+ *
+ * Dual LGPL v2.1/GPL v2 license.
+ */
+
+#include <linux/module.h>
+#include <linux/kthread.h>
+#include <linux/hrtimer.h>
+#include <linux/completion.h>
+#include <linux/slab.h>
+#include <linux/marker.h>
+#include <linux/trace-clock.h>
+#include <linux/ltt-tracer.h>
+#include <linux/ltt-channels.h>
+
+#include "ltt-relay-select.h"
+
+#define BENCH_TRACE		"relay-bench"
+#define BENCH_CHANNEL		"ltt_bench"
+#define BENCH_EVENT		"event"
+#define BENCH_MAX_EVENT_SIZE	256
+
+static unsigned int nr_writers;
+module_param(nr_writers, uint, 0444);
+MODULE_PARM_DESC(nr_writers, "Concurrent writer threads (0: one per cpu)");
+
+static unsigned int nr_events = 100000;
+module_param(nr_events, uint, 0444);
+MODULE_PARM_DESC(nr_events, "Events written by each writer thread");
+
+static unsigned int event_size = 16;
+module_param(event_size, uint, 0444);
+MODULE_PARM_DESC(event_size, "Event payload size in bytes");
+
+static unsigned int irq_period_us = 50;
+module_param(irq_period_us, uint, 0444);
+MODULE_PARM_DESC(irq_period_us,
+		 "Period of the nested interrupt writers (0: disabled)");
+
+static const char *bench_sync_names[LTT_CHAN_SYNC_NR] = {
+	[LTT_CHAN_SYNC_LOCKLESS]	= "lockless",
+	[LTT_CHAN_SYNC_IRQOFF]		= "irqoff",
+	[LTT_CHAN_SYNC_LOCKED]		= "locked",
+};
+
+struct bench_stats {
+	unsigned long events;
+	unsigned long failed;
+	u64 cycles;
+	u64 max_cycles;
+};
+
+struct bench_writer {
+	struct hrtimer timer;
+	struct bench_stats stats;	/* thread context */
+	struct bench_stats nested;	/* hrtimer context */
+	int cpu;
+};
+
+static struct ltt_trace *bench_trace;
+static struct ltt_chan *bench_chan;
+static struct bench_writer *bench_writers;
+static atomic_t bench_running;
+static DECLARE_COMPLETION(bench_done);
+static u32 bench_payload[BENCH_MAX_EVENT_SIZE / sizeof(u32)];
+
+/*
+ * Mirrors the reserve/write/commit sequence of ltt_vtrace(). The event is
+ * never decoded, so it uses event ID 0 of the bench channel.
+ */
+static notrace
+void bench_write_event(struct bench_stats *st)
+{
+	struct ltt_chanbuf *buf;
+	size_t slot_size;
+	long buf_offset;
+	unsigned int rflags = 0;
+	u64 tsc, start, delta;
+	int cpu, ret;
+
+	rcu_read_lock_sched_notrace();
+	cpu = smp_processor_id();
+	__get_cpu_var(ltt_nesting)++;
+	barrier();
+
+	start = trace_clock_read64();
+	ret = ltt_reserve_slot(bench_chan, bench_trace, event_size,
+			       sizeof(u32), cpu, &buf, &slot_size, &buf_offset,
+			       &tsc, &rflags);
+	if (likely(!ret)) {
+		buf_offset = ltt_write_event_header(&buf->a, &bench_chan->a,
+						    buf_offset, 0, event_size,
+						    tsc, rflags);
+		buf_offset += ltt_align(buf_offset, sizeof(u32));
+		ltt_relay_write(&buf->a, &bench_chan->a, buf_offset,
+				bench_payload, event_size);
+		buf_offset += event_size;
+		ltt_commit_slot(buf, bench_chan, buf_offset, event_size,
+				slot_size);
+	}
+	delta = trace_clock_read64() - start;
+
+	barrier();
+	__get_cpu_var(ltt_nesting)--;
+	rcu_read_unlock_sched_notrace();
+
+	if (unlikely(ret)) {
+		st->failed++;
+		return;
+	}
+	st->events++;
+	st->cycles += delta;
+	if (delta > st->max_cycles)
+		st->max_cycles = delta;
+}
+
+static enum hrtimer_restart bench_timer_fn(struct hrtimer *timer)
+{
+	struct bench_writer *w = container_of(timer, struct bench_writer,
+					      timer);
+
+	bench_write_event(&w->nested);
+	hrtimer_forward_now(timer, ns_to_ktime(irq_period_us * NSEC_PER_USEC));
+	return HRTIMER_RESTART;
+}
+
+static int bench_writer_thread(void *data)
+{
+	struct bench_writer *w = data;
+	unsigned int i;
+
+	if (irq_period_us)
+		hrtimer_start(&w->timer,
+			      ns_to_ktime(irq_period_us * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
+
+	for (i = 0; i < nr_events; i++) {
+		bench_write_event(&w->stats);
+		if (!(i & 255))
+			cond_resched();
+	}
+
+	if (irq_period_us)
+		hrtimer_cancel(&w->timer);
+
+	if (atomic_dec_and_test(&bench_running))
+		complete(&bench_done);
+	return 0;
+}
+
+static u64 bench_cycles_to_ns(u64 cycles)
+{
+	return div64_u64(cycles * NSEC_PER_SEC * trace_clock_freq_scale(),
+			 trace_clock_frequency());
+}
+
+static void bench_merge(struct bench_stats *sum, struct bench_stats *st)
+{
+	sum->events += st->events;
+	sum->failed += st->failed;
+	sum->cycles += st->cycles;
+	sum->max_cycles = max(sum->max_cycles, st->max_cycles);
+}
+
+static int bench_setup_trace(unsigned int sync)
+{
+	struct ltt_trace *trace;
+	int index, ret;
+
+	ret = ltt_trace_setup(BENCH_TRACE);
+	if (ret)
+		return ret;
+	ret = ltt_trace_set_type(BENCH_TRACE, "relay");
+	if (ret)
+		goto destroy;
+	ret = ltt_trace_set_channel_overwrite(BENCH_TRACE, BENCH_CHANNEL, 1);
+	if (ret)
+		goto destroy;
+	ret = ltt_trace_set_channel_sync(BENCH_TRACE, BENCH_CHANNEL, sync);
+	if (ret)
+		goto destroy;
+	ret = ltt_trace_alloc(BENCH_TRACE);
+	if (ret)
+		goto destroy;
+
+	index = ltt_channels_get_index_from_name(BENCH_CHANNEL);
+
+	ltt_lock_traces();
+	list_for_each_entry(trace, &ltt_traces.head, list)
+		if (!strcmp(trace->trace_name, BENCH_TRACE))
+			bench_trace = trace;
+	ltt_unlock_traces();
+
+	if (!bench_trace || index < 0) {
+		ret = -ENOENT;
+		goto destroy;
+	}
+	bench_chan = &bench_trace->channels[index];
+	return 0;
+
+destroy:
+	ltt_trace_destroy(BENCH_TRACE);
+	return ret;
+}
+
+static unsigned long bench_events_lost(void)
+{
+	unsigned long lost = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct ltt_chanbuf *buf = per_cpu_ptr(bench_chan->a.buf, cpu);
+
+		if (buf->a.allocated)
+			lost += local_read(&buf->events_lost);
+	}
+	return lost;
+}
+
+static int bench_run(unsigned int sync)
+{
+	struct bench_stats threads = { 0 }, nested = { 0 };
+	unsigned long lost;
+	unsigned int i;
+	int cpu, ret;
+
+	ret = bench_setup_trace(sync);
+	if (ret) {
+		printk(KERN_ERR "ltt-relay-bench: cannot create trace: %d\n",
+		       ret);
+		return ret;
+	}
+
+	memset(bench_writers, 0, sizeof(*bench_writers) * nr_writers);
+	atomic_set(&bench_running, nr_writers);
+	INIT_COMPLETION(bench_done);
+
+	cpu = cpumask_first(cpu_online_mask);
+	for (i = 0; i < nr_writers; i++) {
+		struct bench_writer *w = &bench_writers[i];
+		struct task_struct *task;
+
+		w->cpu = cpu;
+		hrtimer_init(&w->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+		w->timer.function = bench_timer_fn;
+
+		task = kthread_create(bench_writer_thread, w,
+				      "ltt-bench/%u", i);
+		if (IS_ERR(task)) {
+			/* account for the writers which will never run */
+			if (atomic_sub_and_test(nr_writers - i, &bench_running))
+				complete(&bench_done);
+			ret = PTR_ERR(task);
+			break;
+		}
+		kthread_bind(task, cpu);
+		wake_up_process(task);
+
+		cpu = cpumask_next(cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+	}
+
+	wait_for_completion(&bench_done);
+	lost = bench_events_lost();
+	ltt_trace_destroy(BENCH_TRACE);
+	bench_trace = NULL;
+	bench_chan = NULL;
+
+	if (ret)
+		return ret;
+
+	for (i = 0; i < nr_writers; i++) {
+		bench_merge(&threads, &bench_writers[i].stats);
+		bench_merge(&nested, &bench_writers[i].nested);
+	}
+
+	printk(KERN_INFO "ltt-relay-bench: %-8s %lu events %llu ns/event, "
+	       "max %llu ns, max irqoff %llu ns, %lu lost\n",
+	       bench_sync_names[sync], threads.events + nested.events,
+	       threads.events ?
+			bench_cycles_to_ns(div64_u64(threads.cycles,
+						     threads.events)) : 0,
+	       bench_cycles_to_ns(max(threads.max_cycles, nested.max_cycles)),
+	       sync == LTT_CHAN_SYNC_LOCKLESS ? 0 :
+			bench_cycles_to_ns(max(threads.max_cycles,
+					       nested.max_cycles)),
+	       lost);
+	if (nested.events || nested.failed)
+		printk(KERN_INFO "ltt-relay-bench: %-8s nested: %lu events "
+		       "%llu ns/event, %lu dropped\n",
+		       bench_sync_names[sync], nested.events,
+		       nested.events ?
+				bench_cycles_to_ns(div64_u64(nested.cycles,
+							     nested.events)) : 0,
+		       nested.failed);
+	return 0;
+}
+
+static void bench_probe(const struct marker *mdata, void *probe_private,
+			void *call_private, const char *fmt, va_list *args)
+{
+}
+
+static int __init ltt_relay_bench_init(void)
+{
+	unsigned int sync;
+	int ret;
+
+	if (!nr_writers)
+		nr_writers = num_online_cpus();
+	if (!event_size || event_size > BENCH_MAX_EVENT_SIZE)
+		return -EINVAL;
+
+	bench_writers = kcalloc(nr_writers, sizeof(*bench_writers),
+				GFP_KERNEL);
+	if (!bench_writers)
+		return -ENOMEM;
+
+	/* Registering a marker is what creates the bench channel */
+	ret = marker_probe_register(BENCH_CHANNEL, BENCH_EVENT, "size %u",
+				    bench_probe, NULL);
+	if (ret)
+		goto free_writers;
+
+	printk(KERN_INFO "ltt-relay-bench: %u writers, %u events each, "
+	       "%u bytes, irq writer period %u us\n",
+	       nr_writers, nr_events, event_size, irq_period_us);
+
+	for (sync = 0; sync < LTT_CHAN_SYNC_NR; sync++) {
+		ret = bench_run(sync);
+		if (ret)
+			break;
+	}
+
+	marker_probe_unregister(BENCH_CHANNEL, BENCH_EVENT, bench_probe, NULL);
+free_writers:
+	kfree(bench_writers);
+	return ret;
+}
+
+static void __exit ltt_relay_bench_exit(void)
+{
+}
+
+module_init(ltt_relay_bench_init)
+module_exit(ltt_relay_bench_exit)
+
+MODULE_LICENSE("GPL and additional rights");
+MODULE_DESCRIPTION("Linux Trace Toolkit relay buffer benchmark");
@@ -181,6 +181,7 @@ int ltt_chanbuf_create(struct ltt_chanbuf *buf, struct ltt_chan_alloc *chana,
 	init_waitqueue_head(&buf->write_wait);
 	init_waitqueue_head(&buf->read_wait);
 	spin_lock_init(&buf->full_lock);
+	buf->lock = (raw_spinlock_t)__RAW_SPIN_LOCK_UNLOCKED;
 
 	RCHAN_SB_CLEAR_NOREF(buf->a.buf_wsb[0].pages);
 	ltt_buffer_begin(buf, trace->start_tsc, 0);
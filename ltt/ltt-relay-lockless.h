@@ -66,6 +66,9 @@
 #define printk_dbg(fmt, args...)
 #endif
 
+/* Deepest ltt_nesting level at which an event may still be written */
+#define LTT_MAX_NESTING		4
+
 struct commit_counters {
 	local_t cc;
 	local_t cc_sb;			/* Incremented _once_ at sb switch */
@@ -108,6 +111,13 @@ struct ltt_chanbuf {
 	wait_queue_head_t read_wait;	/* reader wait queue */
 	unsigned int finalized;		/* buffer has been finalized */
 	struct timer_list switch_timer;	/* timer for periodical switch */
+	raw_spinlock_t lock;		/* LTT_CHAN_SYNC_LOCKED writers */
+	unsigned long irqflags[LTT_MAX_NESTING];
+					/*
+					 * irq flags saved by reserve for
+					 * non-lockless channels, per nesting
+					 * level.
+					 */
 };
 
 /*
@@ -371,6 +381,41 @@ int ltt_relay_try_reserve(struct ltt_chanbuf *buf, struct ltt_chan *chan,
 	return 0;
 }
 
+/*
+ * Writer side of the irqoff and locked channel modes. Interrupts stay
+ * disabled from reserve to commit; locked channels also hold the buffer
+ * lock. Only the outermost writer may spin on the lock: a nested writer
+ * (NMI, trap in a probe) could be interrupting the lock owner, so it drops
+ * its event when the lock is taken.
+ */
+static __inline__
+int ltt_chanbuf_sync_begin(struct ltt_chanbuf *buf, struct ltt_chan *chan)
+{
+	unsigned int nesting = __get_cpu_var(ltt_nesting);
+	unsigned long flags;
+
+	local_irq_save(flags);
+	if (chan->sync == LTT_CHAN_SYNC_LOCKED) {
+		if (nesting == 1)
+			__raw_spin_lock(&buf->lock);
+		else if (!__raw_spin_trylock(&buf->lock)) {
+			local_irq_restore(flags);
+			local_inc(&buf->events_lost);
+			return -EBUSY;
+		}
+	}
+	buf->irqflags[nesting - 1] = flags;
+	return 0;
+}
+
+static __inline__
+void ltt_chanbuf_sync_end(struct ltt_chanbuf *buf, struct ltt_chan *chan)
+{
+	if (chan->sync == LTT_CHAN_SYNC_LOCKED)
+		__raw_spin_unlock(&buf->lock);
+	local_irq_restore(buf->irqflags[__get_cpu_var(ltt_nesting) - 1]);
+}
+
 static __inline__
 int ltt_reserve_slot(struct ltt_chan *chan,
 		     struct ltt_trace *trace, size_t data_size,
@@ -382,15 +427,20 @@ int ltt_reserve_slot(struct ltt_chan *chan,
 	struct ltt_chanbuf *buf = *ret_buf = per_cpu_ptr(chan->a.buf, cpu);
 	long o_begin, o_end, o_old;
 	size_t before_hdr_pad;
+	int ret;
 
 	/*
 	 * Perform retryable operations.
 	 */
-	if (unlikely(__get_cpu_var(ltt_nesting) > 4)) {
+	if (unlikely(__get_cpu_var(ltt_nesting) > LTT_MAX_NESTING)) {
 		local_inc(&buf->events_lost);
 		return -EPERM;
 	}
 
+	if (unlikely(chan->sync != LTT_CHAN_SYNC_LOCKLESS)
+	    && ltt_chanbuf_sync_begin(buf, chan))
+		return -EBUSY;
+
 	if (unlikely(ltt_relay_try_reserve(buf, chan, data_size, tsc, rflags,
 					   largest_align, &o_begin, &o_end,
 					   &o_old, &before_hdr_pad, slot_size)))
@@ -420,10 +470,12 @@ int ltt_reserve_slot(struct ltt_chan *chan,
 	*buf_offset = o_begin + before_hdr_pad;
 	return 0;
 slow_path:
-	return ltt_reserve_slot_lockless_slow(chan, trace, data_size,
-					      largest_align, cpu, ret_buf,
-					      slot_size, buf_offset, tsc,
-					      rflags);
+	ret = ltt_reserve_slot_lockless_slow(chan, trace, data_size,
+					     largest_align, cpu, ret_buf,
+					     slot_size, buf_offset, tsc, rflags);
+	if (unlikely(ret < 0 && chan->sync != LTT_CHAN_SYNC_LOCKLESS))
+		ltt_chanbuf_sync_end(buf, chan);
+	return ret;
 }
 
 /*
@@ -539,6 +591,9 @@ void ltt_commit_slot(struct ltt_chanbuf *buf, struct ltt_chan *chan,
 	 */
 	ltt_write_commit_counter(buf, chan, endidx, buf_offset,
 				 commit_count, data_size);
+
+	if (unlikely(chan->sync != LTT_CHAN_SYNC_LOCKLESS))
+		ltt_chanbuf_sync_end(buf, chan);
 }
 
 #endif //_LTT_LTT_RELAY_LOCKLESS_H
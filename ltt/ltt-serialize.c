@@ -804,6 +804,7 @@ void ltt_vtrace(const struct marker *mdata, void *probe_data, void *call_data,
 {
 	int largest_align, ret;
 	struct ltt_active_marker *pdata;
+	struct ltt_filter_prog *filter;
 	uint16_t eID;
 	size_t data_size, slot_size;
 	unsigned int chan_index;
@@ -838,6 +839,9 @@ void ltt_vtrace(const struct marker *mdata, void *probe_data, void *call_data,
 	 */
 	barrier();
 	pdata = (struct ltt_active_marker *)probe_data;
+	filter = rcu_dereference(pdata->filter);
+	if (unlikely(filter) && !ltt_filter_eval(filter, args))
+		goto end;
 	eID = mdata->event_id;
 	chan_index = mdata->channel_id;
 	closure.callbacks = pdata->probe->callbacks;
@@ -907,6 +911,7 @@ void ltt_vtrace(const struct marker *mdata, void *probe_data, void *call_data,
 		/* Out-of-order commit */
 		ltt_commit_slot(buf, chan, buf_offset, data_size, slot_size);
 	}
+end:
 	/*
 	 * asm volatile and "memory" clobber prevent the compiler from moving
 	 * instructions out of the ltt nesting count. This is required to ensure
@@ -23,6 +23,7 @@
 #include <linux/notifier.h>
 #include <linux/jiffies.h>
 #include <linux/marker.h>
+#include <linux/slab.h>
 
 #define LTT_CONTROL_DIR "control"
 #define MARKERS_CONTROL_DIR "markers"
@@ -545,6 +546,71 @@ static const struct file_operations ltt_channel_enable_operations = {
 };
 
 
+static const char *ltt_chan_sync_names[LTT_CHAN_SYNC_NR] = {
+	[LTT_CHAN_SYNC_LOCKLESS]	= "lockless",
+	[LTT_CHAN_SYNC_IRQOFF]		= "irqoff",
+	[LTT_CHAN_SYNC_LOCKED]		= "locked",
+};
+
+static
+ssize_t channel_sync_write(struct file *file, const char __user *user_buf,
+			   size_t count, loff_t *ppos)
+{
+	int err = 0;
+	int buf_size;
+	unsigned int sync;
+	const char *channel_name;
+	const char *trace_name;
+	char *buf = (char *)__get_free_page(GFP_KERNEL);
+	char *cmd = (char *)__get_free_page(GFP_KERNEL);
+
+	buf_size = min_t(size_t, count, PAGE_SIZE - 1);
+	err = copy_from_user(buf, user_buf, buf_size);
+	if (err)
+		goto err_copy_from_user;
+	buf[buf_size] = 0;
+
+	if (sscanf(buf, "%s", cmd) != 1) {
+		err = -EPERM;
+		goto err_get_cmd;
+	}
+
+	for (sync = 0; sync < LTT_CHAN_SYNC_NR; sync++)
+		if (!strcmp(cmd, ltt_chan_sync_names[sync]))
+			break;
+	if (sync == LTT_CHAN_SYNC_NR) {
+		err = -EINVAL;
+		goto err_bad_cmd;
+	}
+
+	channel_name = file->f_dentry->d_parent->d_name.name;
+	trace_name = file->f_dentry->d_parent->d_parent->d_parent->d_name.name;
+
+	err = ltt_trace_set_channel_sync(trace_name, channel_name, sync);
+	if (IS_ERR_VALUE(err)) {
+		printk(KERN_ERR "channel_sync_write: "
+		       "ltt_trace_set_channel_sync failed: %d\n", err);
+		goto err_set_sync;
+	}
+
+	free_page((unsigned long)buf);
+	free_page((unsigned long)cmd);
+	return count;
+
+err_set_sync:
+err_bad_cmd:
+err_get_cmd:
+err_copy_from_user:
+	free_page((unsigned long)buf);
+	free_page((unsigned long)cmd);
+	return err;
+}
+
+static const struct file_operations ltt_channel_sync_operations = {
+	.write = channel_sync_write,
+};
+
+
 static int _create_trace_control_dir(const char *trace_name,
 				     struct ltt_trace *trace)
 {
@@ -612,7 +678,8 @@ static int _create_trace_control_dir(const char *trace_name,
 	 *             |   |-- overwrite
 	 *             |   |-- subbuf_num
 	 *             |   |-- subbuf_size
-	 *             |   `-- switch_timer
+	 *             |   |-- switch_timer
+	 *             |   `-- sync
 	 *             `-- ...
 	 */
 
@@ -687,6 +754,17 @@ static int _create_trace_control_dir(const char *trace_name,
 			err = -ENOMEM;
 			goto err_create_subdir;
 		}
+
+		tmp_den = debugfs_create_file("sync", S_IWUSR, channel_den,
+					      NULL,
+					      &ltt_channel_sync_operations);
+		if (IS_ERR(tmp_den) || !tmp_den) {
+			printk(KERN_ERR "_create_trace_control_dir: "
+			       "create sync in %s failed\n",
+			       chan->a.filename);
+			err = -ENOMEM;
+			goto err_create_subdir;
+		}
 	}
 
 	return 0;
@@ -987,6 +1065,92 @@ static const struct file_operations info_fops = {
 	.read = marker_info_read,
 };
 
+static
+ssize_t marker_filter_read(struct file *filp, char __user *ubuf,
+			   size_t cnt, loff_t *ppos)
+{
+	char *buf;
+	const char *channel, *marker;
+	int len;
+
+	marker = filp->f_dentry->d_parent->d_name.name;
+	channel = filp->f_dentry->d_parent->d_parent->d_name.name;
+
+	buf = (char *)__get_free_page(GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	len = ltt_marker_get_filter(channel, marker, "default", buf,
+				    PAGE_SIZE - 1);
+	if (len < 0)
+		len = 0;
+	else if (len > PAGE_SIZE - 2)
+		len = PAGE_SIZE - 2;
+	if (len)
+		buf[len++] = '\n';
+
+	len = simple_read_from_buffer(ubuf, cnt, ppos, buf, len);
+	free_page((unsigned long)buf);
+
+	return len;
+}
+
+/*
+ * The marker must be enabled: the filter is attached to its connection to
+ * the default probe. Writing an empty line removes the filter.
+ */
+static
+ssize_t marker_filter_write(struct file *filp, const char __user *ubuf,
+			    size_t cnt, loff_t *ppos)
+{
+	char *buf = (char *)__get_free_page(GFP_KERNEL);
+	char *format = NULL;
+	int buf_size;
+	ssize_t ret = 0;
+	const char *channel, *marker;
+	struct marker_iter iter;
+
+	marker = filp->f_dentry->d_parent->d_name.name;
+	channel = filp->f_dentry->d_parent->d_parent->d_name.name;
+
+	buf_size = min_t(size_t, cnt, PAGE_SIZE - 1);
+	ret = copy_from_user(buf, ubuf, buf_size);
+	if (ret)
+		goto end;
+
+	buf[buf_size] = 0;
+
+	marker_iter_reset(&iter);
+	marker_iter_start(&iter);
+	for (; iter.marker != NULL; marker_iter_next(&iter)) {
+		if (!strcmp(iter.marker->channel, channel) &&
+		    !strcmp(iter.marker->name, marker)) {
+			format = kstrdup(iter.marker->format, GFP_KERNEL);
+			break;
+		}
+	}
+	marker_iter_stop(&iter);
+
+	if (!format) {
+		ret = -ENOENT;
+		goto end;
+	}
+
+	ret = ltt_marker_set_filter(channel, marker, "default", format, buf);
+	if (ret)
+		goto end;
+	ret = cnt;
+end:
+	kfree(format);
+	free_page((unsigned long)buf);
+	return ret;
+}
+
+static const struct file_operations filter_fops = {
+	.read = marker_filter_read,
+	.write = marker_filter_write,
+};
+
 static int marker_mkdir(struct inode *dir, struct dentry *dentry, int mode)
 {
 	struct dentry *marker_d, *enable_d, *info_d, *channel_d;
@@ -1133,7 +1297,7 @@ const struct inode_operations root_dir_opt = {
 
 static int build_marker_file(struct marker *marker)
 {
-	struct dentry *channel_d, *marker_d, *enable_d, *info_d;
+	struct dentry *channel_d, *marker_d, *enable_d, *info_d, *filter_d;
 	int err;
 
 	channel_d = dir_lookup(markers_control_dir, marker->channel);
@@ -1189,6 +1353,19 @@ static int build_marker_file(struct marker *marker)
 		}
 	}
 
+	filter_d = dir_lookup(marker_d, "filter");
+	if (!filter_d) {
+		filter_d = debugfs_create_file("filter", 0644, marker_d,
+						NULL, &filter_fops);
+		if (IS_ERR(filter_d) || !filter_d) {
+			printk(KERN_ERR
+			       "%s: create file of %s failed\n",
+			       __func__, "filter");
+			err = -ENOMEM;
+			goto err_build_fail;
+		}
+	}
+
 	return 0;
 
 err_build_fail:
@@ -820,6 +820,41 @@ traces_error:
 }
 EXPORT_SYMBOL_GPL(ltt_trace_set_channel_overwrite);
 
+int ltt_trace_set_channel_sync(const char *trace_name,
+			       const char *channel_name,
+			       unsigned int sync)
+{
+	int err = 0;
+	struct ltt_trace *trace;
+	int index;
+
+	if (sync >= LTT_CHAN_SYNC_NR)
+		return -EINVAL;
+
+	ltt_lock_traces();
+
+	trace = _ltt_trace_find_setup(trace_name);
+	if (!trace) {
+		printk(KERN_ERR "LTT : Trace not found %s\n", trace_name);
+		err = -ENOENT;
+		goto traces_error;
+	}
+
+	index = ltt_channels_get_index_from_name(channel_name);
+	if (index < 0) {
+		printk(KERN_ERR "LTT : Channel %s not found\n", channel_name);
+		err = -ENOENT;
+		goto traces_error;
+	}
+
+	trace->channels[index].sync = sync;
+
+traces_error:
+	ltt_unlock_traces();
+	return err;
+}
+EXPORT_SYMBOL_GPL(ltt_trace_set_channel_sync);
+
 int ltt_trace_alloc(const char *trace_name)
 {
 	int err = 0;
@@ -89,6 +89,9 @@ static int bdi_debug_stats_show(struct seq_file *m, void *v)
 	seq_printf(m,
 		   "BdiWriteback:     %8lu kB\n"
 		   "BdiReclaimable:   %8lu kB\n"
+		   "BdiReadahead:     %8lu kB\n"
+		   "BdiReadaheadUsed: %8lu kB\n"
+		   "BdiReadaheadWaste:%8lu kB\n"
 		   "BdiDirtyThresh:   %8lu kB\n"
 		   "DirtyThresh:      %8lu kB\n"
 		   "BackgroundThresh: %8lu kB\n"
@@ -103,6 +106,9 @@ static int bdi_debug_stats_show(struct seq_file *m, void *v)
 		   "wb_cnt:           %8u\n",
 		   (unsigned long) K(bdi_stat(bdi, BDI_WRITEBACK)),
 		   (unsigned long) K(bdi_stat(bdi, BDI_RECLAIMABLE)),
+		   (unsigned long) K(bdi_stat(bdi, BDI_READAHEAD)),
+		   (unsigned long) K(bdi_stat(bdi, BDI_READAHEAD_USED)),
+		   (unsigned long) K(bdi_stat(bdi, BDI_READAHEAD_WASTED)),
 		   K(bdi_thresh), K(dirty_thresh),
 		   K(background_thresh), nr_wb, nr_dirty, nr_io, nr_more_io,
 		   !list_empty(&bdi->bdi_list), bdi->state, bdi->wb_mask,
@@ -179,6 +185,36 @@ static ssize_t name##_show(struct device *dev,				\
 
 BDI_SHOW(read_ahead_kb, K(bdi->ra_pages))
 
+static ssize_t readahead_adaptive_store(struct device *dev,
+					struct device_attribute *attr,
+					const char *buf, size_t count)
+{
+	struct backing_dev_info *bdi = dev_get_drvdata(dev);
+	char *end;
+	unsigned long adaptive;
+	ssize_t ret = -EINVAL;
+
+	adaptive = simple_strtoul(buf, &end, 10);
+	if (*buf && (end[0] == '\0' || (end[0] == '\n' && end[1] == '\0')) &&
+	    adaptive <= 1) {
+		bdi->ra_adaptive = adaptive;
+		ret = count;
+	}
+	return ret;
+}
+BDI_SHOW(readahead_adaptive, bdi->ra_adaptive)
+
+static ssize_t readahead_stats_show(struct device *dev,
+				    struct device_attribute *attr, char *page)
+{
+	struct backing_dev_info *bdi = dev_get_drvdata(dev);
+
+	return snprintf(page, PAGE_SIZE-1, "%lld %lld %lld\n",
+			(long long)bdi_stat(bdi, BDI_READAHEAD),
+			(long long)bdi_stat(bdi, BDI_READAHEAD_USED),
+			(long long)bdi_stat(bdi, BDI_READAHEAD_WASTED));
+}
+
 static ssize_t min_ratio_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t count)
 {
@@ -221,6 +257,8 @@ static struct device_attribute bdi_dev_attrs[] = {
 	__ATTR_RW(read_ahead_kb),
 	__ATTR_RW(min_ratio),
 	__ATTR_RW(max_ratio),
+	__ATTR_RW(readahead_adaptive),
+	__ATTR(readahead_stats, 0444, readahead_stats_show, NULL),
 	__ATTR_NULL,
 };
 
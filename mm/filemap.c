@@ -33,6 +33,7 @@
 #include <linux/cpuset.h>
 #include <linux/hardirq.h> /* for BUG_ON(!in_atomic()) only */
 #include <linux/memcontrol.h>
+#include <linux/launch_prefetch.h>
 #include <linux/mm_inline.h> /* for page_is_file_cache() */
 #include <trace/filemap.h>
 #include "internal.h"
@@ -134,6 +135,9 @@ void __remove_from_page_cache(struct page *page)
 		__dec_zone_page_state(page, NR_SHMEM);
 	BUG_ON(page_mapped(page));
 
+	if (unlikely(PagePrefetched(page)) && TestClearPagePrefetched(page))
+		inc_bdi_stat(mapping->backing_dev_info, BDI_READAHEAD_WASTED);
+
 	/*
 	 * Some filesystems seem to re-dirty the page even after
 	 * the VM has canceled the dirty bit (eg ext3 journaling).
@@ -158,6 +162,7 @@ void remove_from_page_cache(struct page *page)
 	spin_unlock_irq(&mapping->tree_lock);
 	mem_cgroup_uncharge_cache_page(page);
 }
+EXPORT_SYMBOL(remove_from_page_cache);
 
 static int sync_page(void *word)
 {
@@ -1022,6 +1027,7 @@ static void do_generic_file_read(struct file *filp, loff_t *ppos,
 find_page:
 		page = find_get_page(mapping, index);
 		if (!page) {
+			launch_prefetch_miss(filp, index);
 			page_cache_sync_readahead(mapping,
 					ra, filp,
 					index, last_index - index);
@@ -1029,6 +1035,8 @@ find_page:
 			if (unlikely(page == NULL))
 				goto no_cached_page;
 		}
+		if (readahead_page_accessed(mapping, ra, page))
+			launch_prefetch_miss(filp, index);
 		if (PageReadahead(page)) {
 			page_cache_async_readahead(mapping,
 					ra, filp, page,
@@ -1462,7 +1470,9 @@ static void do_sync_mmap_readahead(struct vm_area_struct *vma,
 	/*
 	 * mmap read-around
 	 */
-	ra_pages = max_sane_readahead(ra->ra_pages);
+	if (ra->adapt_pages)
+		ra_adapt(ra, offset);
+	ra_pages = max_sane_readahead(ra_max_pages(ra));
 	if (ra_pages) {
 		ra->start = max_t(long, 0, offset - ra_pages/2);
 		ra->size = ra_pages;
@@ -1541,6 +1551,7 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 		}
 	} else {
 		/* No page in the page cache at all */
+		launch_prefetch_miss(file, offset);
 		do_sync_mmap_readahead(vma, ra, file, offset);
 		count_vm_event(PGMAJFAULT);
 		ret = VM_FAULT_MAJOR;
@@ -1550,6 +1561,9 @@ retry_find:
 			goto no_cached_page;
 	}
 
+	if (readahead_page_accessed(mapping, ra, page))
+		launch_prefetch_miss(file, offset);
+
 	/*
 	 * We have a locked page in the page cache, now we need to check
 	 * that it's up-to-date. If not, it is going to be due to an error.
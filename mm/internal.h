@@ -256,6 +256,25 @@ int __get_user_pages(struct task_struct *tsk, struct mm_struct *mm,
 		     unsigned long start, int len, unsigned int foll_flags,
 		     struct page **pages, struct vm_area_struct **vmas);
 
+/* readahead.c */
+unsigned long ra_max_pages(struct file_ra_state *ra);
+void ra_adapt(struct file_ra_state *ra, pgoff_t offset);
+int __readahead_page_accessed(struct address_space *mapping,
+			      struct file_ra_state *ra, struct page *page);
+
+/*
+ * Account the first access to a page brought in by readahead, returns
+ * true if it was the first one
+ */
+static inline int readahead_page_accessed(struct address_space *mapping,
+					  struct file_ra_state *ra,
+					  struct page *page)
+{
+	if (PagePrefetched(page))
+		return __readahead_page_accessed(mapping, ra, page);
+	return 0;
+}
+
 #define ZONE_RECLAIM_NOSCAN	-2
 #define ZONE_RECLAIM_FULL	-1
 #define ZONE_RECLAIM_SOME	0
@@ -112,6 +112,8 @@ struct ksm_scan {
  * @mm: the memory structure this rmap_item is pointing into
  * @address: the virtual address this rmap_item tracks (+ flags in low bits)
  * @oldchecksum: previous checksum of the page at that virtual address
+ * @changes: how many consecutive scans found a different checksum
+ * @skip_scans: how many more scans should pass over this volatile page
  * @node: rb_node of this rmap_item in either unstable or stable tree
  * @next: next rmap_item hanging off the same node of the stable tree
  * @prev: previous rmap_item hanging off the same node of the stable tree
@@ -124,6 +126,8 @@ struct rmap_item {
 		unsigned int oldchecksum;		/* when unstable */
 		struct rmap_item *next;			/* when stable */
 	};
+	unsigned short changes;
+	unsigned short skip_scans;
 	union {
 		struct rb_node node;			/* when tree node */
 		struct rmap_item *prev;			/* in stable list */
@@ -169,9 +173,39 @@ static unsigned long ksm_max_kernel_pages;
 /* Number of pages ksmd should scan in one batch */
 static unsigned int ksm_thread_pages_to_scan = 100;
 
+/*
+ * Number of pages ksmd scans in one batch when adapting the rate to the
+ * merges found by the last full scan: between pages_to_scan >>
+ * KSM_ADAPT_MIN_SHIFT and pages_to_scan
+ */
+static unsigned int ksm_adaptive_scan = 1;
+static unsigned int ksm_cur_pages_to_scan = 100;
+#define KSM_ADAPT_MIN_SHIFT	4
+/* Merges per 1000 pages scanned below which the rate halves */
+#define KSM_ADAPT_LOW_YIELD	1
+/* and above which it doubles */
+#define KSM_ADAPT_HIGH_YIELD	10
+
+/*
+ * A page whose checksum changed on consecutive scans is skipped for the
+ * next 2^(changes - 1) - 1 scans, at most KSM_MAX_SKIP_SCANS
+ */
+#define KSM_MAX_SKIP_SCANS	63
+
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Pages looked at, skipped as volatile, and merged, since boot */
+static unsigned long ksm_pages_scanned;
+static unsigned long ksm_pages_skipped;
+static unsigned long ksm_pages_merged;
+
+/* Pages scanned and merged at the start of the current full scan */
+static unsigned long ksm_scan_start_scanned;
+static unsigned long ksm_scan_start_merged;
+
+static struct task_struct *ksmd_task;
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -1066,8 +1100,10 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 
 	tree_rmap_item->next = rmap_item;
 	rmap_item->address |= STABLE_FLAG;
+	rmap_item->changes = 0;
 
 	ksm_pages_sharing++;
+	ksm_pages_merged++;
 }
 
 /*
@@ -1128,8 +1164,17 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
+		/*
+		 * The first change may only be the first checksum taken:
+		 * back off from the second consecutive one.
+		 */
+		if (rmap_item->changes < 7)
+			rmap_item->changes++;
+		rmap_item->skip_scans = min((1 << (rmap_item->changes - 1)) - 1,
+					    KSM_MAX_SKIP_SCANS);
 		return;
 	}
+	rmap_item->changes = 0;
 
 	tree_rmap_item = unstable_tree_search_insert(page, page2, rmap_item);
 	if (tree_rmap_item) {
@@ -1197,6 +1242,33 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	return rmap_item;
 }
 
+/*
+ * Called at the end of each full scan: scan faster when the last one
+ * merged a good share of the pages it looked at, slower when it found
+ * next to nothing, as when the mergeable areas have settled.
+ */
+static void ksm_adapt_scan_rate(void)
+{
+	unsigned long scanned = ksm_pages_scanned - ksm_scan_start_scanned;
+	unsigned long merged = ksm_pages_merged - ksm_scan_start_merged;
+	unsigned int min_pages = ksm_thread_pages_to_scan >> KSM_ADAPT_MIN_SHIFT;
+	unsigned int pages = ksm_cur_pages_to_scan;
+
+	ksm_scan_start_scanned = ksm_pages_scanned;
+	ksm_scan_start_merged = ksm_pages_merged;
+
+	if (!ksm_adaptive_scan || !scanned) {
+		ksm_cur_pages_to_scan = ksm_thread_pages_to_scan;
+		return;
+	}
+	if (merged * 1000 < scanned * KSM_ADAPT_LOW_YIELD)
+		pages /= 2;
+	else if (merged * 1000 >= scanned * KSM_ADAPT_HIGH_YIELD)
+		pages *= 2;
+	ksm_cur_pages_to_scan = clamp(pages, max(min_pages, 1U),
+				      ksm_thread_pages_to_scan);
+}
+
 static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 {
 	struct mm_struct *mm;
@@ -1304,6 +1376,7 @@ next_mm:
 		goto next_mm;
 
 	ksm_scan.seqnr++;
+	ksm_adapt_scan_rate();
 	return NULL;
 }
 
@@ -1321,7 +1394,12 @@ static void ksm_do_scan(unsigned int scan_npages)
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
 			return;
-		if (!PageKsm(page) || !in_stable_tree(rmap_item))
+		ksm_pages_scanned++;
+		if (!in_stable_tree(rmap_item) && rmap_item->skip_scans) {
+			/* Volatile: not worth a checksum nor a tree search */
+			rmap_item->skip_scans--;
+			ksm_pages_skipped++;
+		} else if (!PageKsm(page) || !in_stable_tree(rmap_item))
 			cmp_and_merge_page(page, rmap_item);
 		else if (page_mapcount(page) == 1) {
 			/*
@@ -1347,7 +1425,7 @@ static int ksm_scan_thread(void *nothing)
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
 		if (ksmd_should_run())
-			ksm_do_scan(ksm_thread_pages_to_scan);
+			ksm_do_scan(ksm_cur_pages_to_scan);
 		mutex_unlock(&ksm_thread_mutex);
 
 		if (ksmd_should_run()) {
@@ -1525,11 +1603,43 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 		return -EINVAL;
 
 	ksm_thread_pages_to_scan = nr_pages;
+	ksm_cur_pages_to_scan = nr_pages;
 
 	return count;
 }
 KSM_ATTR(pages_to_scan);
 
+static ssize_t adaptive_scan_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_adaptive_scan);
+}
+
+static ssize_t adaptive_scan_store(struct kobject *kobj,
+				   struct kobj_attribute *attr,
+				   const char *buf, size_t count)
+{
+	int err;
+	unsigned long adaptive;
+
+	err = strict_strtoul(buf, 10, &adaptive);
+	if (err || adaptive > 1)
+		return -EINVAL;
+
+	ksm_adaptive_scan = adaptive;
+	ksm_cur_pages_to_scan = ksm_thread_pages_to_scan;
+
+	return count;
+}
+KSM_ATTR(adaptive_scan);
+
+static ssize_t cur_pages_to_scan_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_cur_pages_to_scan);
+}
+KSM_ATTR_RO(cur_pages_to_scan);
+
 static ssize_t run_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf)
 {
@@ -1645,9 +1755,42 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t pages_scanned_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_scanned);
+}
+KSM_ATTR_RO(pages_scanned);
+
+static ssize_t pages_skipped_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_skipped);
+}
+KSM_ATTR_RO(pages_skipped);
+
+static ssize_t pages_merged_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_merged);
+}
+KSM_ATTR_RO(pages_merged);
+
+static ssize_t cpu_time_ms_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	u64 ns = ksmd_task ? task_sched_runtime(ksmd_task) : 0;
+
+	return sprintf(buf, "%llu\n",
+		       (unsigned long long)div_u64(ns, NSEC_PER_MSEC));
+}
+KSM_ATTR_RO(cpu_time_ms);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
+	&adaptive_scan_attr.attr,
+	&cur_pages_to_scan_attr.attr,
 	&run_attr.attr,
 	&max_kernel_pages_attr.attr,
 	&pages_shared_attr.attr,
@@ -1655,6 +1798,10 @@ static struct attribute *ksm_attrs[] = {
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&pages_scanned_attr.attr,
+	&pages_skipped_attr.attr,
+	&pages_merged_attr.attr,
+	&cpu_time_ms_attr.attr,
 	NULL,
 };
 
@@ -1685,6 +1832,7 @@ static int __init ksm_init(void)
 		err = PTR_ERR(ksm_thread);
 		goto out_free2;
 	}
+	ksmd_task = ksm_thread;
 
 #ifdef CONFIG_SYSFS
 	err = sysfs_create_group(mm_kobj, &ksm_attr_group);
@@ -0,0 +1,526 @@
+/*
+ * mm/launch_prefetch.c
+ *
+ * Launch-time page cache prefetch
+ *
+ * While a recording session is active, the page cache misses of one
+ * process (reads which found no page, and first accesses to pages which
+ * readahead brought in) are logged as (file, page index) pairs.  When the
+ * session stops, the log is sorted and merged into page ranges and can be
+ * read back from /dev/launch_prefetch as a text list.
+ *
+ * Replaying the list on the next launches opens each file and issues all
+ * of its ranges as readahead in one batch, sorted by device and inode
+ * number (as a proxy for the on-disk order), before the application asks
+ * for them one fault at a time.
+ *
+ * The list format is one path per line, followed by the "start nr" page
+ * ranges to read from it, one per line.  Lines starting with '#' are
+ * ignored.  See Documentation/vm/launch_prefetch.txt.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/miscdevice.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/hash.h>
+#include <linux/path.h>
+#include <linux/namei.h>
+#include <linux/dcache.h>
+#include <linux/mount.h>
+#include <linux/uaccess.h>
+#include <linux/launch_prefetch.h>
+
+#define LP_DEFAULT_ENTRIES	16384
+#define LP_MAX_ENTRIES		(1 << 20)
+#define LP_MAX_FILES		1024
+#define LP_HASH_BITS		8
+#define LP_MAX_LIST		(1 << 20)	/* bytes, export and replay */
+#define LP_MAX_RANGES		65536
+#define LP_MERGE_GAP		8	/* pages: holes read along */
+
+struct lp_file {
+	struct inode *inode;		/* hash key */
+	struct path path;
+	int next;			/* hash chain, -1 terminated */
+};
+
+struct lp_entry {
+	unsigned int file;
+	pgoff_t index;
+};
+
+/*
+ * Recording state.  Everything is preallocated when the session starts
+ * so that the hook in the read paths never allocates.
+ */
+static DEFINE_SPINLOCK(lp_lock);
+static pid_t lp_tgid;
+static unsigned long lp_end;		/* jiffies */
+static int lp_timed;
+static struct lp_file *lp_files;
+static unsigned int lp_nr_files;
+static int lp_hash[1 << LP_HASH_BITS];
+static struct lp_entry *lp_entries;
+static unsigned int lp_nr_entries, lp_max_entries;
+static unsigned long lp_dropped;
+
+int launch_prefetch_active __read_mostly;
+
+/* Session ownership and the exported list, under lp_mutex */
+static DEFINE_MUTEX(lp_mutex);
+static struct file *lp_owner;
+static char *lp_export;
+static size_t lp_export_len;
+
+static int lp_file_lookup(struct file *file)
+{
+	struct inode *inode = file->f_mapping->host;
+	unsigned long h = hash_ptr(inode, LP_HASH_BITS);
+	int i;
+
+	for (i = lp_hash[h]; i >= 0; i = lp_files[i].next)
+		if (lp_files[i].inode == inode)
+			return i;
+
+	if (lp_nr_files == LP_MAX_FILES)
+		return -1;
+	i = lp_nr_files++;
+	lp_files[i].inode = inode;
+	lp_files[i].path = file->f_path;
+	path_get(&lp_files[i].path);
+	lp_files[i].next = lp_hash[h];
+	lp_hash[h] = i;
+	return i;
+}
+
+void __launch_prefetch_miss(struct file *file, pgoff_t index)
+{
+	struct lp_entry *e;
+	int i;
+
+	if (current->tgid != lp_tgid || !file ||
+	    !S_ISREG(file->f_mapping->host->i_mode))
+		return;
+
+	spin_lock(&lp_lock);
+	if (!launch_prefetch_active)
+		goto out;
+	if (lp_timed && time_after(jiffies, lp_end)) {
+		launch_prefetch_active = 0;
+		goto out;
+	}
+
+	i = lp_file_lookup(file);
+	if (i < 0 || lp_nr_entries == lp_max_entries) {
+		lp_dropped++;
+		goto out;
+	}
+
+	/* a sync readahead miss is followed by the access of the same page */
+	if (lp_nr_entries) {
+		e = &lp_entries[lp_nr_entries - 1];
+		if (e->file == i && e->index == index)
+			goto out;
+	}
+	e = &lp_entries[lp_nr_entries++];
+	e->file = i;
+	e->index = index;
+out:
+	spin_unlock(&lp_lock);
+}
+
+static int lp_entry_cmp(const void *a, const void *b)
+{
+	const struct lp_entry *x = a, *y = b;
+
+	if (x->file != y->file)
+		return x->file < y->file ? -1 : 1;
+	if (x->index != y->index)
+		return x->index < y->index ? -1 : 1;
+	return 0;
+}
+
+static void lp_free_session(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < lp_nr_files; i++)
+		path_put(&lp_files[i].path);
+	vfree(lp_files);
+	vfree(lp_entries);
+	lp_files = NULL;
+	lp_entries = NULL;
+	lp_nr_files = 0;
+	lp_nr_entries = 0;
+}
+
+/*
+ * Turn the sorted log into the text list.  Files whose path cannot be
+ * expressed (unlinked, or with a newline in it) are left out, and the
+ * list is cut at LP_MAX_LIST bytes so that it can always be replayed.
+ */
+static int lp_build_export(void)
+{
+	char *pathbuf, *name;
+	size_t len = 0;
+	unsigned int i = 0, f;
+	int n;
+
+	lp_export = vmalloc(LP_MAX_LIST);
+	pathbuf = (char *)__get_free_page(GFP_KERNEL);
+	if (!lp_export || !pathbuf) {
+		vfree(lp_export);
+		lp_export = NULL;
+		free_page((unsigned long)pathbuf);
+		return -ENOMEM;
+	}
+
+	sort(lp_entries, lp_nr_entries, sizeof(*lp_entries), lp_entry_cmp,
+	     NULL);
+
+	while (i < lp_nr_entries) {
+		f = lp_entries[i].file;
+		name = d_path(&lp_files[f].path, pathbuf, PAGE_SIZE);
+		if (IS_ERR(name) || d_unlinked(lp_files[f].path.dentry) ||
+		    strchr(name, '\n')) {
+			while (i < lp_nr_entries && lp_entries[i].file == f)
+				i++;
+			continue;
+		}
+
+		n = snprintf(lp_export + len, LP_MAX_LIST - len, "%s\n", name);
+		if (len + n >= LP_MAX_LIST)
+			break;
+		len += n;
+
+		while (i < lp_nr_entries && lp_entries[i].file == f) {
+			pgoff_t start = lp_entries[i].index;
+			unsigned long nr = 1;
+
+			for (i++; i < lp_nr_entries &&
+			     lp_entries[i].file == f &&
+			     lp_entries[i].index <= start + nr; i++)
+				nr = lp_entries[i].index - start + 1;
+
+			n = snprintf(lp_export + len, LP_MAX_LIST - len,
+				     "%lu %lu\n", (unsigned long)start, nr);
+			if (len + n >= LP_MAX_LIST)
+				goto full;
+			len += n;
+		}
+	}
+full:
+	lp_export_len = len;
+	free_page((unsigned long)pathbuf);
+	return 0;
+}
+
+static int lp_record_start(struct file *filp, struct lp_record __user *arg)
+{
+	struct lp_record r;
+	struct task_struct *task;
+	struct lp_file *files;
+	struct lp_entry *entries;
+	pid_t tgid;
+	int i;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+	if (copy_from_user(&r, arg, sizeof(r)))
+		return -EFAULT;
+	if (r.pid < 0 || r.max_entries > LP_MAX_ENTRIES)
+		return -EINVAL;
+	if (!r.max_entries)
+		r.max_entries = LP_DEFAULT_ENTRIES;
+
+	if (r.pid) {
+		rcu_read_lock();
+		task = find_task_by_vpid(r.pid);
+		tgid = task ? task->tgid : 0;
+		rcu_read_unlock();
+		if (!tgid)
+			return -ESRCH;
+	} else
+		tgid = current->tgid;
+
+	if (lp_owner)
+		return -EBUSY;
+
+	files = vmalloc(LP_MAX_FILES * sizeof(*files));
+	entries = vmalloc(r.max_entries * sizeof(*entries));
+	if (!files || !entries) {
+		vfree(files);
+		vfree(entries);
+		return -ENOMEM;
+	}
+
+	vfree(lp_export);
+	lp_export = NULL;
+	lp_export_len = 0;
+
+	spin_lock(&lp_lock);
+	lp_files = files;
+	lp_entries = entries;
+	lp_max_entries = r.max_entries;
+	lp_nr_files = 0;
+	lp_nr_entries = 0;
+	lp_dropped = 0;
+	for (i = 0; i < ARRAY_SIZE(lp_hash); i++)
+		lp_hash[i] = -1;
+	lp_tgid = tgid;
+	lp_timed = r.timeout_ms != 0;
+	lp_end = jiffies + msecs_to_jiffies(r.timeout_ms);
+	launch_prefetch_active = 1;
+	spin_unlock(&lp_lock);
+
+	lp_owner = filp;
+	return 0;
+}
+
+static void lp_record_end(void)
+{
+	spin_lock(&lp_lock);
+	launch_prefetch_active = 0;
+	spin_unlock(&lp_lock);
+	lp_owner = NULL;
+}
+
+static int lp_record_stop(struct file *filp)
+{
+	int ret;
+
+	if (lp_owner != filp)
+		return -EINVAL;
+	lp_record_end();
+
+	ret = lp_build_export();
+	if (lp_dropped)
+		printk(KERN_INFO "launch_prefetch: %lu misses not recorded\n",
+		       lp_dropped);
+	lp_free_session();
+	return ret;
+}
+
+struct lp_range {
+	struct file *file;
+	pgoff_t start;
+	unsigned long nr;
+};
+
+static int lp_range_cmp(const void *a, const void *b)
+{
+	const struct lp_range *x = a, *y = b;
+	struct inode *i = x->file->f_mapping->host;
+	struct inode *j = y->file->f_mapping->host;
+
+	if (i->i_sb != j->i_sb)
+		return i->i_sb < j->i_sb ? -1 : 1;
+	if (i->i_ino != j->i_ino)
+		return i->i_ino < j->i_ino ? -1 : 1;
+	if (x->start != y->start)
+		return x->start < y->start ? -1 : 1;
+	return 0;
+}
+
+static void lp_issue(struct lp_range *r, long *issued)
+{
+	int ret;
+
+	ret = force_page_cache_readahead(r->file->f_mapping, r->file,
+					 r->start, r->nr);
+	if (ret > 0)
+		*issued += ret;
+}
+
+/*
+ * Opens a recorded file for readahead if it still is a regular file. The
+ * type is checked first: opening a FIFO now at that path would block the
+ * replay. O_NONBLOCK covers the path being replaced in between.
+ */
+static struct file *lp_open(const char *name)
+{
+	struct path path;
+	int err, reg;
+
+	err = kern_path(name, LOOKUP_FOLLOW, &path);
+	if (err)
+		return ERR_PTR(err);
+	reg = S_ISREG(path.dentry->d_inode->i_mode);
+	path_put(&path);
+	if (!reg)
+		return ERR_PTR(-EINVAL);
+
+	return filp_open(name, O_RDONLY | O_LARGEFILE | O_NONBLOCK, 0);
+}
+
+static long lp_replay(struct lp_replay __user *arg)
+{
+	struct lp_replay r;
+	struct lp_range *ranges = NULL, *cur;
+	struct file **files = NULL, *file = NULL;
+	unsigned int nr_ranges = 0, nr_files = 0, i;
+	char *list, *p, *line;
+	long issued = 0;
+
+	if (copy_from_user(&r, arg, sizeof(r)))
+		return -EFAULT;
+	if (r.flags || r.len > LP_MAX_LIST)
+		return -EINVAL;
+
+	list = vmalloc(r.len + 1);
+	ranges = vmalloc(LP_MAX_RANGES * sizeof(*ranges));
+	files = vmalloc(LP_MAX_FILES * sizeof(*files));
+	if (!list || !ranges || !files) {
+		issued = -ENOMEM;
+		goto out;
+	}
+	if (copy_from_user(list, (void __user *)(unsigned long)r.list,
+			   r.len)) {
+		issued = -EFAULT;
+		goto out;
+	}
+	list[r.len] = '\0';
+
+	p = list;
+	while ((line = strsep(&p, "\n")) != NULL) {
+		unsigned long start, nr;
+
+		if (line[0] == '/') {
+			file = NULL;
+			if (nr_files == LP_MAX_FILES)
+				continue;
+			file = lp_open(line);
+			if (IS_ERR(file) ||
+			    !S_ISREG(file->f_mapping->host->i_mode)) {
+				if (!IS_ERR(file))
+					fput(file);
+				file = NULL;
+				continue;
+			}
+			files[nr_files++] = file;
+		} else if (file && nr_ranges < LP_MAX_RANGES &&
+			   sscanf(line, "%lu %lu", &start, &nr) == 2 && nr) {
+			ranges[nr_ranges].file = file;
+			ranges[nr_ranges].start = start;
+			ranges[nr_ranges].nr = nr;
+			nr_ranges++;
+		}
+	}
+
+	sort(ranges, nr_ranges, sizeof(*ranges), lp_range_cmp, NULL);
+
+	cur = NULL;
+	for (i = 0; i < nr_ranges; i++) {
+		struct lp_range *next = &ranges[i];
+
+		if (fatal_signal_pending(current))
+			break;
+		if (cur && cur->file == next->file &&
+		    next->start <= cur->start + cur->nr + LP_MERGE_GAP) {
+			if (next->start + next->nr > cur->start + cur->nr)
+				cur->nr = next->start + next->nr - cur->start;
+			continue;
+		}
+		if (cur)
+			lp_issue(cur, &issued);
+		cur = next;
+	}
+	if (cur && !fatal_signal_pending(current))
+		lp_issue(cur, &issued);
+
+	for (i = 0; i < nr_files; i++)
+		fput(files[i]);
+out:
+	vfree(files);
+	vfree(ranges);
+	vfree(list);
+	return issued;
+}
+
+static long launch_prefetch_ioctl(struct file *filp, unsigned int cmd,
+				  unsigned long arg)
+{
+	long ret;
+
+	switch (cmd) {
+	case LP_IOC_RECORD_START:
+		mutex_lock(&lp_mutex);
+		ret = lp_record_start(filp, (struct lp_record __user *)arg);
+		mutex_unlock(&lp_mutex);
+		break;
+	case LP_IOC_RECORD_STOP:
+		mutex_lock(&lp_mutex);
+		ret = lp_record_stop(filp);
+		mutex_unlock(&lp_mutex);
+		break;
+	case LP_IOC_REPLAY:
+		ret = lp_replay((struct lp_replay __user *)arg);
+		break;
+	default:
+		ret = -ENOTTY;
+	}
+	return ret;
+}
+
+/* Reads the list exported by the last recording session */
+static ssize_t launch_prefetch_read(struct file *filp, char __user *buf,
+				    size_t count, loff_t *ppos)
+{
+	ssize_t ret;
+
+	mutex_lock(&lp_mutex);
+	ret = simple_read_from_buffer(buf, count, ppos, lp_export,
+				      lp_export_len);
+	mutex_unlock(&lp_mutex);
+	return ret;
+}
+
+static int launch_prefetch_release(struct inode *inode, struct file *filp)
+{
+	mutex_lock(&lp_mutex);
+	if (lp_owner == filp) {
+		lp_record_end();
+		lp_free_session();
+	}
+	mutex_unlock(&lp_mutex);
+	return 0;
+}
+
+static const struct file_operations launch_prefetch_fops = {
+	.owner = THIS_MODULE,
+	.read = launch_prefetch_read,
+	.unlocked_ioctl = launch_prefetch_ioctl,
+	.release = launch_prefetch_release,
+};
+
+static struct miscdevice launch_prefetch_misc = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "launch_prefetch",
+	.fops = &launch_prefetch_fops,
+};
+
+static int __init launch_prefetch_init(void)
+{
+	int ret;
+
+	ret = misc_register(&launch_prefetch_misc);
+	if (unlikely(ret))
+		printk(KERN_ERR "launch_prefetch: failed to register misc "
+		       "device!\n");
+	return ret;
+}
+
+module_init(launch_prefetch_init);
@@ -17,6 +17,8 @@
 #include <linux/pagevec.h>
 #include <linux/pagemap.h>
 
+#include "internal.h"
+
 /*
  * Initialise a struct file's readahead state.  Assumes that the caller has
  * memset *ra to zero.
@@ -24,8 +26,13 @@
 void
 file_ra_state_init(struct file_ra_state *ra, struct address_space *mapping)
 {
-	ra->ra_pages = mapping->backing_dev_info->ra_pages;
+	struct backing_dev_info *bdi = mapping->backing_dev_info;
+
+	ra->ra_pages = bdi->ra_pages;
 	ra->prev_pos = -1;
+	ra->adapt_pages = bdi->ra_adaptive ? ra->ra_pages : 0;
+	ra->ra_issued = 0;
+	ra->ra_hits = 0;
 }
 EXPORT_SYMBOL_GPL(file_ra_state_init);
 
@@ -177,6 +184,7 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 		if (!page)
 			break;
 		page->index = page_offset;
+		__SetPagePrefetched(page);
 		list_add(&page->lru, &page_pool);
 		if (page_idx == nr_to_read - lookahead_size)
 			SetPageReadahead(page);
@@ -188,8 +196,10 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	 * uptodate then the caller will launch readpage again, and
 	 * will then handle the error.
 	 */
-	if (ret)
+	if (ret) {
 		read_pages(mapping, filp, &page_pool, ret);
+		add_bdi_stat(mapping->backing_dev_info, BDI_READAHEAD, ret);
+	}
 	BUG_ON(!list_empty(&page_pool));
 out:
 	return ret;
@@ -248,10 +258,79 @@ unsigned long ra_submit(struct file_ra_state *ra,
 
 	actual = __do_page_cache_readahead(mapping, filp,
 					ra->start, ra->size, ra->async_size);
+	if (ra->adapt_pages && actual > 0)
+		ra->ra_issued += actual;
 
 	return actual;
 }
 
+/*
+ * Adaptive readahead
+ *
+ * Every page read ahead is marked PG_prefetched until its first access,
+ * when it counts as a hit for the file through which it is accessed.
+ * Pages dropped from the page cache with the mark still set were read
+ * for nothing.  Both are also summed up per bdi.
+ *
+ * In adaptive mode (see the bdi's readahead_adaptive attribute) the
+ * window limit of each file starts at ra_pages.  It doubles, up to
+ * RA_ADAPT_SCALE times ra_pages, while nearly all the pages read ahead
+ * get used, as with streaming media.  It halves, down to RA_ADAPT_MIN
+ * pages, while most of them are not used, as with the random reads of
+ * application loads.
+ */
+#define RA_ADAPT_SCALE	4
+#define RA_ADAPT_MIN	((VM_MIN_READAHEAD * 1024) / PAGE_CACHE_SIZE)
+
+unsigned long ra_max_pages(struct file_ra_state *ra)
+{
+	if (!ra->adapt_pages)
+		return ra->ra_pages;
+	return min_t(unsigned long, ra->adapt_pages,
+		     RA_ADAPT_SCALE * ra->ra_pages);
+}
+
+int __readahead_page_accessed(struct address_space *mapping,
+			      struct file_ra_state *ra, struct page *page)
+{
+	if (!TestClearPagePrefetched(page))
+		return 0;
+	inc_bdi_stat(mapping->backing_dev_info, BDI_READAHEAD_USED);
+	if (ra->adapt_pages)
+		ra->ra_hits++;
+	return 1;
+}
+
+/*
+ * Tune the window limit from the hits since the last tuning, once a
+ * window worth of pages has had the chance to be used.  The pages of
+ * the current window ahead of @offset have not, and are carried over.
+ */
+void ra_adapt(struct file_ra_state *ra, pgoff_t offset)
+{
+	unsigned long pending = 0;
+	unsigned long done;
+	unsigned int limit = ra->adapt_pages;
+
+	if (offset >= ra->start && offset < ra->start + ra->size)
+		pending = ra->start + ra->size - offset;
+	if (ra->ra_issued <= pending)
+		return;
+	done = ra->ra_issued - pending;
+	if (done < limit)
+		return;
+
+	if (ra->ra_hits * 8 >= done * 7)
+		limit = min_t(unsigned long, limit * 2,
+			      RA_ADAPT_SCALE * ra->ra_pages);
+	else if (ra->ra_hits * 2 < done)
+		limit = max_t(unsigned long, limit / 2, RA_ADAPT_MIN);
+	ra->adapt_pages = max(limit, 1U);
+
+	ra->ra_issued = pending;
+	ra->ra_hits = 0;
+}
+
 /*
  * Set the initial window size, round to next power of 2 and square
  * for small size, x 4 for medium, and x 2 for large
@@ -391,7 +470,12 @@ ondemand_readahead(struct address_space *mapping,
 		   bool hit_readahead_marker, pgoff_t offset,
 		   unsigned long req_size)
 {
-	unsigned long max = max_sane_readahead(ra->ra_pages);
+	unsigned long max;
+	int actual;
+
+	if (ra->adapt_pages)
+		ra_adapt(ra, offset);
+	max = max_sane_readahead(ra_max_pages(ra));
 
 	/*
 	 * start of file
@@ -458,7 +542,10 @@ ondemand_readahead(struct address_space *mapping,
 	 * standalone, small random read
 	 * Read as is, and do not pollute the readahead state.
 	 */
-	return __do_page_cache_readahead(mapping, filp, offset, req_size, 0);
+	actual = __do_page_cache_readahead(mapping, filp, offset, req_size, 0);
+	if (ra->adapt_pages && actual > 0)
+		ra->ra_issued += actual;
+	return actual;
 
 initial_readahead:
 	ra->start = offset;
@@ -157,6 +157,18 @@ static inline unsigned unix_hash_fold(__wsum n)
 
 #define unix_peer(sk) (unix_sk(sk)->peer)
 
+/* Data of a stream skb not read yet */
+static inline unsigned int unix_skb_len(const struct sk_buff *skb)
+{
+	return skb->len - UNIXCB(skb).consumed;
+}
+
+/*
+ * Stream skbs carry at most this much data in order-0 pages, behind a
+ * linear part of less than a page.
+ */
+#define UNIX_SKB_FRAGS_SZ	(PAGE_SIZE << get_order(32768))
+
 static inline int unix_our_peer(struct sock *sk, struct sock *osk)
 {
 	return unix_peer(osk) == sk;
@@ -495,6 +507,8 @@ static int unix_stream_sendmsg(struct kiocb *, struct socket *,
 			       struct msghdr *, size_t);
 static int unix_stream_recvmsg(struct kiocb *, struct socket *,
 			       struct msghdr *, size_t, int);
+static ssize_t unix_stream_sendpage(struct socket *, struct page *,
+				    int, size_t, int);
 static int unix_dgram_sendmsg(struct kiocb *, struct socket *,
 			      struct msghdr *, size_t);
 static int unix_dgram_recvmsg(struct kiocb *, struct socket *,
@@ -522,7 +536,7 @@ static const struct proto_ops unix_stream_ops = {
 	.sendmsg =	unix_stream_sendmsg,
 	.recvmsg =	unix_stream_recvmsg,
 	.mmap =		sock_no_mmap,
-	.sendpage =	sock_no_sendpage,
+	.sendpage =	unix_stream_sendpage,
 };
 
 static const struct proto_ops unix_dgram_ops = {
@@ -1499,7 +1513,7 @@ static int unix_stream_sendmsg(struct kiocb *kiocb, struct socket *sock,
 	struct sock *sk = sock->sk;
 	struct sock *other = NULL;
 	struct sockaddr_un *sunaddr = msg->msg_name;
-	int err, size;
+	int err, size, data_len;
 	struct sk_buff *skb;
 	int sent = 0;
 	struct scm_cookie tmp_scm;
@@ -1542,28 +1556,25 @@ static int unix_stream_sendmsg(struct kiocb *kiocb, struct socket *sock,
 		if (size > ((sk->sk_sndbuf >> 1) - 64))
 			size = (sk->sk_sndbuf >> 1) - 64;
 
-		if (size > SKB_MAX_ALLOC)
-			size = SKB_MAX_ALLOC;
+		/*
+		 *	Large messages go in order-0 pages behind a small
+		 *	linear part, rather than in a high order buffer
+		 *	which fragmented memory may not have.
+		 */
+		if (size > SKB_MAX_HEAD(0) + UNIX_SKB_FRAGS_SZ)
+			size = SKB_MAX_HEAD(0) + UNIX_SKB_FRAGS_SZ;
+		data_len = max_t(int, 0, size - SKB_MAX_HEAD(0));
 
 		/*
 		 *	Grab a buffer
 		 */
 
-		skb = sock_alloc_send_skb(sk, size, msg->msg_flags&MSG_DONTWAIT,
-					  &err);
+		skb = sock_alloc_send_pskb(sk, size - data_len, data_len,
+					   msg->msg_flags&MSG_DONTWAIT, &err);
 
 		if (skb == NULL)
 			goto out_err;
 
-		/*
-		 *	If you pass two values to the sock_alloc_send_skb
-		 *	it tries to grab the large buffer with GFP_NOFS
-		 *	(which can fail easily), and if it fails grab the
-		 *	fallback size buffer which is under a page and will
-		 *	succeed. [Alan]
-		 */
-		size = min_t(int, size, skb_tailroom(skb));
-
 		memcpy(UNIXCREDS(skb), &siocb->scm->creds, sizeof(struct ucred));
 		/* Only send the fds in the first buffer */
 		if (siocb->scm->fp && !fds_sent) {
@@ -1575,7 +1586,11 @@ static int unix_stream_sendmsg(struct kiocb *kiocb, struct socket *sock,
 			fds_sent = true;
 		}
 
-		err = memcpy_fromiovec(skb_put(skb, size), msg->msg_iov, size);
+		skb_put(skb, size - data_len);
+		skb->data_len = data_len;
+		skb->len = size;
+		err = skb_copy_datagram_from_iovec(skb, 0, msg->msg_iov, sent,
+						   size);
 		if (err) {
 			kfree_skb(skb);
 			goto out_err;
@@ -1611,6 +1626,114 @@ out_err:
 	return sent ? : err;
 }
 
+/*
+ * Can the data of @sk go at the end of @skb, the last one queued to the
+ * peer?  Only if it was sent by @sk with the same credentials, has no
+ * fds attached (the reader stops after them) and @sk is within its send
+ * buffer, which only a new skb waits for.
+ */
+static bool unix_skb_can_append(struct sk_buff *skb, struct sock *sk,
+				struct ucred *creds)
+{
+	return skb->sk == sk && !UNIXCB(skb).fp &&
+	       !memcmp(UNIXCREDS(skb), creds, sizeof(*creds)) &&
+	       atomic_read(&sk->sk_wmem_alloc) < sk->sk_sndbuf;
+}
+
+static int unix_skb_append_page(struct sk_buff *skb, struct page *page,
+				int offset, size_t size)
+{
+	int i = skb_shinfo(skb)->nr_frags;
+
+	if (skb_can_coalesce(skb, i, page, offset)) {
+		skb_shinfo(skb)->frags[i - 1].size += size;
+	} else if (i < MAX_SKB_FRAGS) {
+		get_page(page);
+		skb_fill_page_desc(skb, i, page, offset, size);
+	} else
+		return -EMSGSIZE;
+
+	skb->len += size;
+	skb->data_len += size;
+	skb->truesize += size;
+	return 0;
+}
+
+/*
+ * sendfile() and splice() come here: the page is referenced by the skb
+ * instead of being copied, so data spliced from a file or from user
+ * pages (vmsplice) reaches the reader with a single copy.  The pages of
+ * consecutive calls fill the frags of the skb at the tail of the peer's
+ * queue rather than taking one skb each.
+ */
+static ssize_t unix_stream_sendpage(struct socket *sock, struct page *page,
+				    int offset, size_t size, int flags)
+{
+	struct sock *sk = sock->sk;
+	struct sock *other;
+	struct sk_buff *skb, *newskb = NULL;
+	struct ucred creds;
+	int err;
+
+	if (flags & MSG_OOB)
+		return -EOPNOTSUPP;
+
+	other = unix_peer(sk);
+	if (!other || sk->sk_state != TCP_ESTABLISHED)
+		return -ENOTCONN;
+
+	if (sk->sk_shutdown & SEND_SHUTDOWN)
+		goto pipe_err;
+
+	creds.pid = task_tgid_vnr(current);
+	creds.uid = current_uid();
+	creds.gid = current_gid();
+
+	for (;;) {
+		unix_state_lock(other);
+
+		if (sock_flag(other, SOCK_DEAD) ||
+		    (other->sk_shutdown & RCV_SHUTDOWN))
+			goto pipe_err_free;
+
+		spin_lock(&other->sk_receive_queue.lock);
+		if (newskb) {
+			/* an empty skb always takes the page */
+			unix_skb_append_page(newskb, page, offset, size);
+			atomic_add(size, &sk->sk_wmem_alloc);
+			__skb_queue_tail(&other->sk_receive_queue, newskb);
+			break;
+		}
+		skb = skb_peek_tail(&other->sk_receive_queue);
+		if (skb && unix_skb_can_append(skb, sk, &creds) &&
+		    !unix_skb_append_page(skb, page, offset, size)) {
+			atomic_add(size, &sk->sk_wmem_alloc);
+			break;
+		}
+		spin_unlock(&other->sk_receive_queue.lock);
+		unix_state_unlock(other);
+
+		newskb = sock_alloc_send_skb(sk, 0, flags & MSG_DONTWAIT,
+					     &err);
+		if (!newskb)
+			return err;
+		memcpy(UNIXCREDS(newskb), &creds, sizeof(creds));
+	}
+
+	spin_unlock(&other->sk_receive_queue.lock);
+	unix_state_unlock(other);
+	other->sk_data_ready(other, size);
+	return size;
+
+pipe_err_free:
+	unix_state_unlock(other);
+	kfree_skb(newskb);
+pipe_err:
+	if (!(flags & MSG_NOSIGNAL))
+		send_sig(SIGPIPE, current, 0);
+	return -EPIPE;
+}
+
 static int unix_seqpacket_sendmsg(struct kiocb *kiocb, struct socket *sock,
 				  struct msghdr *msg, size_t len)
 {
@@ -1856,8 +1979,9 @@ static int unix_stream_recvmsg(struct kiocb *iocb, struct socket *sock,
 			sunaddr = NULL;
 		}
 
-		chunk = min_t(unsigned int, skb->len, size);
-		if (memcpy_toiovec(msg->msg_iov, skb->data, chunk)) {
+		chunk = min_t(unsigned int, unix_skb_len(skb), size);
+		if (skb_copy_datagram_iovec(skb, UNIXCB(skb).consumed,
+					    msg->msg_iov, chunk)) {
 			skb_queue_head(&sk->sk_receive_queue, skb);
 			if (copied == 0)
 				copied = -EFAULT;
@@ -1868,13 +1992,13 @@ static int unix_stream_recvmsg(struct kiocb *iocb, struct socket *sock,
 
 		/* Mark read part of skb as used */
 		if (!(flags & MSG_PEEK)) {
-			skb_pull(skb, chunk);
+			UNIXCB(skb).consumed += chunk;
 
 			if (UNIXCB(skb).fp)
 				unix_detach_fds(siocb->scm, skb);
 
 			/* put the skb back if we didn't use it up.. */
-			if (skb->len) {
+			if (unix_skb_len(skb)) {
 				skb_queue_head(&sk->sk_receive_queue, skb);
 				break;
 			}
@@ -1967,7 +2091,7 @@ static int unix_ioctl(struct socket *sock, unsigned int cmd, unsigned long arg)
 			if (sk->sk_type == SOCK_STREAM ||
 			    sk->sk_type == SOCK_SEQPACKET) {
 				skb_queue_walk(&sk->sk_receive_queue, skb)
-					amount += skb->len;
+					amount += unix_skb_len(skb);
 			} else {
 				skb = skb_peek(&sk->sk_receive_queue);
 				if (skb)